@@ -4,8 +4,14 @@
 #include "ui/font.h"
 
 
-int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR cmdLine, int)
 {
+    // --profile-rules ranks rules by scan cost, also written to rule_profile.txt
+    globals.rule_profiling = cmdLine && strstr(cmdLine, "--profile-rules") != NULL;
+    // --lint-rules reports which regexes were rewritten, their atoms, the
+    // throughput gained and the optimizer checks, in rule_lint.txt
+    globals.lint_rules = cmdLine && strstr(cmdLine, "--lint-rules") != NULL;
+
     WNDCLASSEX wc = { sizeof(WNDCLASSEX), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(NULL), NULL, NULL, NULL, NULL, ui::window_title, NULL };
     RegisterClassEx(&wc);
     main_hwnd = CreateWindow(wc.lpszClassName, ui::window_title, WS_POPUP, 0, 0, 5, 5, NULL, NULL, wc.hInstance, NULL);
@@ -92,6 +98,8 @@ int APIENTRY WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
         }
     }
 
+    unloadGenericRules();
+
     ImGui_ImplDX9_Shutdown();
     ImGui_ImplWin32_Shutdown();
     ImGui::DestroyContext();
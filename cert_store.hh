@@ -0,0 +1,181 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include <unordered_set>
+#ifdef _WIN32
+#include <Windows.h>
+#include <wincrypt.h>
+#endif
+
+// thumbprints are kept as upper-case hex sha1 strings so exported lists
+// (certutil / powershell dumps) can be loaded without any conversion
+using thumbprint_set = std::unordered_set<std::string>;
+
+inline std::string thumbprint_to_hex(const std::uint8_t* data, size_t size) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        out.push_back(digits[data[i] >> 4]);
+        out.push_back(digits[data[i] & 0xF]);
+    }
+    return out;
+}
+
+inline std::string normalize_thumbprint(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        if (c >= '0' && c <= '9')
+            out.push_back(c);
+        else if (c >= 'a' && c <= 'f')
+            out.push_back(static_cast<char>(c - 'a' + 'A'));
+        else if (c >= 'A' && c <= 'F')
+            out.push_back(c);
+    }
+    return out;
+}
+
+class thumbprint_source {
+public:
+    virtual ~thumbprint_source() = default;
+    virtual bool load(thumbprint_set& out) = 0;
+};
+
+// one thumbprint per line, separators and '#' comments are ignored
+class thumbprint_file_source : public thumbprint_source {
+    std::string path;
+
+public:
+    explicit thumbprint_file_source(const std::string& file_path) : path(file_path) {}
+
+    bool load(thumbprint_set& out) override {
+        std::ifstream file(path);
+        if (!file.good())
+            return false;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            const auto comment = line.find('#');
+            if (comment != std::string::npos)
+                line.erase(comment);
+
+            std::string thumbprint = normalize_thumbprint(line);
+            if (thumbprint.size() == 40)
+                out.insert(std::move(thumbprint));
+        }
+
+        return true;
+    }
+};
+
+#ifdef _WIN32
+// the same stores IsFileSignatureValid used to open per file, both contexts
+class system_store_source : public thumbprint_source {
+public:
+    bool load(thumbprint_set& out) override {
+        static const LPCWSTR store_names[] = {
+            L"MY", L"Root", L"Trust", L"CA", L"UserDS",
+            L"TrustedPublisher", L"Disallowed", L"AuthRoot",
+            L"TrustedPeople", L"ClientAuthIssuer",
+            L"CertificateEnrollment", L"SmartCardRoot"
+        };
+        const DWORD contexts[] = {
+            CERT_SYSTEM_STORE_CURRENT_USER | CERT_STORE_OPEN_EXISTING_FLAG | CERT_STORE_READONLY_FLAG,
+            CERT_SYSTEM_STORE_LOCAL_MACHINE | CERT_STORE_OPEN_EXISTING_FLAG | CERT_STORE_READONLY_FLAG
+        };
+
+        for (auto ctx : contexts) {
+            for (auto& name : store_names) {
+                HCERTSTORE store = CertOpenStore(
+                    CERT_STORE_PROV_SYSTEM_W,
+                    X509_ASN_ENCODING | PKCS_7_ASN_ENCODING,
+                    NULL,
+                    ctx,
+                    name
+                );
+                if (!store) continue;
+
+                PCCERT_CONTEXT cert = nullptr;
+                while ((cert = CertEnumCertificatesInStore(store, cert)) != nullptr) {
+                    BYTE hash[20];
+                    DWORD hash_size = sizeof(hash);
+                    if (CertGetCertificateContextProperty(cert, CERT_SHA1_HASH_PROP_ID, hash, &hash_size))
+                        out.insert(thumbprint_to_hex(hash, hash_size));
+                }
+
+                CertCloseStore(store, 0);
+            }
+        }
+
+        return true;
+    }
+};
+#endif
+
+// immutable snapshot of every locally installed certificate, shared by all
+// signature checks. lookups never touch the stores, refresh() swaps in a new set.
+// when the first load fails the snapshot stays empty until the next refresh().
+class cert_store_snapshot {
+    mutable std::mutex mutex;
+    std::unique_ptr<thumbprint_source> source;
+    std::shared_ptr<const thumbprint_set> current;
+
+public:
+    void set_source(std::unique_ptr<thumbprint_source> new_source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        source = std::move(new_source);
+        current.reset();
+    }
+
+    bool refresh() {
+        std::lock_guard<std::mutex> lock(mutex);
+#ifdef _WIN32
+        if (!source)
+            source = std::make_unique<system_store_source>();
+#endif
+        if (!source)
+            return false;
+
+        auto fresh = std::make_shared<thumbprint_set>();
+        if (!source->load(*fresh))
+            return false;
+
+        current = std::move(fresh);
+        return true;
+    }
+
+    std::shared_ptr<const thumbprint_set> snapshot() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (current)
+                return current;
+        }
+
+        refresh();
+
+        // a failed load is cached as an empty set so lookups do not hit the
+        // stores again for every file, an explicit refresh() retries
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!current)
+            current = std::make_shared<const thumbprint_set>();
+        return current;
+    }
+
+    bool contains(const std::string& thumbprint) {
+        const auto set = snapshot();
+        return set && set->count(thumbprint) != 0;
+    }
+
+    size_t size() {
+        const auto set = snapshot();
+        return set ? set->size() : 0;
+    }
+};
+
+inline cert_store_snapshot cert_store;
@@ -0,0 +1,230 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#include <yara/ac_compact.h>
+#include <yara/ahocorasick.h>
+#include <yara/error.h>
+#include <yara/mem.h>
+
+#define AC_COMPACT_UNSET 0xFFFFFFFF
+
+// Next state in the regular transition table, following failure links the
+// same way _yr_scanner_scan_mem_block does.
+static uint32_t _yr_ac_compact_table_next(
+    const YR_AC_TRANSITION* transition_table,
+    uint32_t state,
+    int c)
+{
+  uint16_t index = (uint16_t) (c + 1);
+  YR_AC_TRANSITION transition = transition_table[state + index];
+
+  while (YR_AC_INVALID_TRANSITION(transition, index))
+  {
+    if (state == YR_AC_ROOT_STATE)
+      return YR_AC_ROOT_STATE;
+
+    state = YR_AC_NEXT_STATE(transition_table[state]);
+    transition = transition_table[state + index];
+  }
+
+  return YR_AC_NEXT_STATE(transition);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Builds the compact layout of an automaton from its transition and match
+// tables.
+//
+// Args:
+//   transition_table: The automaton's transition table.
+//   match_table: The automaton's match table.
+//   num_slots: Number of entries in both tables.
+//   compact: Receives the new YR_AC_COMPACT.
+//
+// Returns:
+//   ERROR_SUCCESS or ERROR_INSUFFICIENT_MEMORY.
+//
+int yr_ac_compact_create(
+    const YR_AC_TRANSITION* transition_table,
+    const uint32_t* match_table,
+    size_t num_slots,
+    YR_AC_COMPACT** compact)
+{
+  int result = ERROR_INSUFFICIENT_MEMORY;
+
+  uint32_t num_states = 0;
+  uint32_t num_dense = 0;
+  uint32_t num_sparse_children = 0;
+
+  YR_AC_COMPACT* new_compact = NULL;
+
+  // Maps a state in the regular table (which is the offset of its slot) to
+  // its BFS number, and the other way around.
+  uint32_t* new_state = (uint32_t*) yr_malloc(num_slots * sizeof(uint32_t));
+  uint32_t* old_state = (uint32_t*) yr_malloc(num_slots * sizeof(uint32_t));
+  uint16_t* depth = (uint16_t*) yr_malloc(num_slots * sizeof(uint16_t));
+
+  *compact = NULL;
+
+  if (new_state == NULL || old_state == NULL || depth == NULL)
+    goto _exit;
+
+  memset(new_state, 0xFF, num_slots * sizeof(uint32_t));
+
+  new_state[YR_AC_ROOT_STATE] = 0;
+  old_state[0] = YR_AC_ROOT_STATE;
+  depth[0] = 0;
+  num_states = 1;
+
+  for (uint32_t i = 0; i < num_states; i++)
+  {
+    uint32_t state = old_state[i];
+
+    for (int c = 0; c < 256; c++)
+    {
+      YR_AC_TRANSITION transition = transition_table[state + c + 1];
+
+      if (YR_AC_INVALID_TRANSITION(transition, c + 1))
+        continue;
+
+      uint32_t child = YR_AC_NEXT_STATE(transition);
+
+      if (new_state[child] == AC_COMPACT_UNSET)
+      {
+        new_state[child] = num_states;
+        old_state[num_states] = child;
+        depth[num_states] = depth[i] + 1;
+        num_states++;
+      }
+    }
+  }
+
+  while (num_dense < num_states && depth[num_dense] <= YR_AC_COMPACT_DENSE_DEPTH &&
+         (size_t) (num_dense + 1) * 256 * sizeof(uint32_t) <=
+             YR_AC_COMPACT_DENSE_BYTES)
+    num_dense++;
+
+  for (uint32_t i = num_dense; i < num_states; i++)
+  {
+    for (int c = 0; c < 256; c++)
+    {
+      if (!YR_AC_INVALID_TRANSITION(
+              transition_table[old_state[i] + c + 1], c + 1))
+        num_sparse_children++;
+    }
+  }
+
+  new_compact = (YR_AC_COMPACT*) yr_calloc(1, sizeof(YR_AC_COMPACT));
+
+  if (new_compact == NULL)
+    goto _exit;
+
+  new_compact->num_states = num_states;
+  new_compact->num_dense = num_dense;
+  new_compact->size =
+      (size_t) num_dense * 256 * sizeof(uint32_t) +
+      (size_t) (num_states - num_dense) * sizeof(YR_AC_SPARSE_ROW) +
+      (size_t) num_sparse_children * sizeof(uint32_t) +
+      (size_t) num_states * sizeof(uint32_t);
+
+  new_compact->dense = (uint32_t*) yr_malloc(
+      (size_t) num_dense * 256 * sizeof(uint32_t));
+  new_compact->sparse = (YR_AC_SPARSE_ROW*) yr_calloc(
+      num_states - num_dense + 1, sizeof(YR_AC_SPARSE_ROW));
+  new_compact->children = (uint32_t*) yr_malloc(
+      ((size_t) num_sparse_children + 1) * sizeof(uint32_t));
+  new_compact->match_table = (uint32_t*) yr_malloc(
+      (size_t) num_states * sizeof(uint32_t));
+
+  if (new_compact->dense == NULL || new_compact->sparse == NULL ||
+      new_compact->children == NULL || new_compact->match_table == NULL)
+  {
+    yr_ac_compact_destroy(new_compact);
+    goto _exit;
+  }
+
+  for (uint32_t i = 0; i < num_states; i++)
+    new_compact->match_table[i] = match_table[old_state[i]];
+
+  for (uint32_t i = 0; i < num_dense; i++)
+  {
+    for (int c = 0; c < 256; c++)
+      new_compact->dense[(size_t) i * 256 + c] = new_state
+          [_yr_ac_compact_table_next(transition_table, old_state[i], c)];
+  }
+
+  num_sparse_children = 0;
+
+  for (uint32_t i = num_dense; i < num_states; i++)
+  {
+    YR_AC_SPARSE_ROW* row = &new_compact->sparse[i - num_dense];
+    uint32_t state = old_state[i];
+
+    row->children = num_sparse_children;
+    row->failure = new_state[YR_AC_NEXT_STATE(transition_table[state])];
+
+    for (int c = 0; c < 256; c++)
+    {
+      if ((c & 63) == 0)
+        row->rank[c >> 6] = (uint8_t) (num_sparse_children - row->children);
+
+      YR_AC_TRANSITION transition = transition_table[state + c + 1];
+
+      if (YR_AC_INVALID_TRANSITION(transition, c + 1))
+        continue;
+
+      row->bitmap[c >> 6] |= (uint64_t) 1 << (c & 63);
+      new_compact->children[num_sparse_children++] =
+          new_state[YR_AC_NEXT_STATE(transition)];
+    }
+  }
+
+  *compact = new_compact;
+  result = ERROR_SUCCESS;
+
+_exit:
+
+  yr_free(new_state);
+  yr_free(old_state);
+  yr_free(depth);
+
+  return result;
+}
+
+void yr_ac_compact_destroy(YR_AC_COMPACT* compact)
+{
+  if (compact == NULL)
+    return;
+
+  yr_free(compact->dense);
+  yr_free(compact->sparse);
+  yr_free(compact->children);
+  yr_free(compact->match_table);
+  yr_free(compact);
+}
@@ -139,6 +139,11 @@ static int _yr_arena_allocate_memory(
   if (buffer_id > arena->num_buffers)
     return ERROR_INVALID_ARGUMENT;
 
+  // Arenas backed by a file mapping are frozen, they don't keep the list of
+  // relocatable pointers that is needed for moving buffers around.
+  if (arena->mapped_file != NULL || (arena->mapped_buffers & (1U << buffer_id)))
+    return ERROR_INVALID_ARGUMENT;
+
   YR_ARENA_BUFFER* b = &arena->buffers[buffer_id];
 
   // If the new data doesn't fit in the remaining space the buffer must be
@@ -277,10 +282,17 @@ int yr_arena_release(YR_ARENA* arena)
 
   for (uint32_t i = 0; i < arena->num_buffers; i++)
   {
-    if (arena->buffers[i].data != NULL)
+    if (arena->buffers[i].data != NULL &&
+        !(arena->mapped_buffers & (1U << i)))
       yr_free(arena->buffers[i].data);
   }
 
+  if (arena->mapped_file != NULL)
+  {
+    yr_filemap_unmap(arena->mapped_file);
+    yr_free(arena->mapped_file);
+  }
+
   YR_RELOC* reloc = arena->reloc_list_head;
 
   while (reloc != NULL)
@@ -430,6 +442,34 @@ yr_arena_off_t yr_arena_get_current_offset(YR_ARENA* arena, uint32_t buffer_id)
   return (yr_arena_off_t) arena->buffers[buffer_id].used;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Discards everything written to a buffer past the given offset, the next
+// write will start at that offset. The caller must make sure that nothing
+// points into the discarded data, and that no relocatable pointer lives there.
+//
+// Args:
+//   arena: Pointer to the arena.
+//   buffer_id: Buffer number.
+//   offset: New end of the data in the buffer.
+//
+// Returns:
+//    ERROR_SUCCESS if succeed or the corresponding error code otherwise.
+//
+int yr_arena_truncate(
+    YR_ARENA* arena,
+    uint32_t buffer_id,
+    yr_arena_off_t offset)
+{
+  assert(buffer_id < arena->num_buffers);
+
+  if (offset > arena->buffers[buffer_id].used)
+    return ERROR_INVALID_ARGUMENT;
+
+  arena->buffers[buffer_id].used = offset;
+
+  return ERROR_SUCCESS;
+}
+
 int yr_arena_ptr_to_ref(YR_ARENA* arena, const void* address, YR_ARENA_REF* ref)
 {
   *ref = YR_ARENA_NULL_REF;
@@ -624,14 +664,30 @@ int yr_arena_load_stream(YR_STREAM* stream, YR_ARENA** arena)
   return ERROR_SUCCESS;
 }
 
-int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream)
+////////////////////////////////////////////////////////////////////////////////
+// Writes the arena to a stream. Each buffer starts at an offset (relative to
+// the beginning of the stream) that is a multiple of alignment, the gaps are
+// filled with zeroes. With an alignment of 1 this is the format read by
+// yr_arena_load_stream.
+//
+static int _yr_arena_save(
+    YR_ARENA* arena,
+    YR_STREAM* stream,
+    uint8_t magic,
+    size_t alignment)
 {
+  static const uint8_t padding[YR_ARENA_MAPPED_ALIGNMENT] = {0};
+
+  // Mapped arenas don't have a relocation list, save the original file.
+  if (arena->mapped_file != NULL)
+    return ERROR_INVALID_ARGUMENT;
+
   YR_ARENA_FILE_HEADER hdr;
 
   hdr.magic[0] = 'Y';
   hdr.magic[1] = 'A';
   hdr.magic[2] = 'R';
-  hdr.magic[3] = 'A';
+  hdr.magic[3] = magic;
 
   hdr.version = YR_ARENA_FILE_VERSION;
   hdr.num_buffers = arena->num_buffers;
@@ -644,8 +700,14 @@ int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream)
   uint64_t offset = sizeof(YR_ARENA_FILE_HEADER) +
                     sizeof(YR_ARENA_FILE_BUFFER) * arena->num_buffers;
 
+  // written keeps track of the number of bytes already written to the stream,
+  // it's used for computing the padding that goes before each buffer.
+  uint64_t written = offset;
+
   for (uint32_t i = 0; i < arena->num_buffers; ++i)
   {
+    offset = (offset + alignment - 1) / alignment * alignment;
+
     YR_ARENA_FILE_BUFFER buffer = {
         .offset = offset,
         .size = (uint32_t) arena->buffers[i].used,
@@ -702,9 +764,19 @@ int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream)
   {
     YR_ARENA_BUFFER* b = &arena->buffers[i];
 
+    size_t pad = (size_t) ((alignment - written % alignment) % alignment);
+
+    if (pad > 0)
+      if (yr_stream_write(padding, pad, 1, stream) != 1)
+        return ERROR_WRITING_FILE;
+
+    written += pad;
+
     if (b->used > 0)
       if (yr_stream_write(b->data, b->used, 1, stream) != 1)
         return ERROR_WRITING_FILE;
+
+    written += b->used;
   }
 
   // Write the relocation list and restore the pointers back.
@@ -744,3 +816,212 @@ int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream)
 
   return ERROR_SUCCESS;
 }
+
+int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream)
+{
+  return _yr_arena_save(arena, stream, 'A', 1);
+}
+
+int yr_arena_save_mappable_stream(YR_ARENA* arena, YR_STREAM* stream)
+{
+  return _yr_arena_save(arena, stream, 'M', YR_ARENA_MAPPED_ALIGNMENT);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Loads an arena from a file in the format produced by
+// yr_arena_save_mappable_stream. The whole file is mapped read-only, buffers
+// that are the target of some relocation entry (i.e: they contain pointers)
+// are copied to the heap and their pointers fixed as yr_arena_load_stream
+// does, the remaining ones (AC transition table, AC match table, string pool,
+// regexp code, ...) are used in place. Unlike yr_arena_load_stream this
+// doesn't build the relocation list (one heap allocation per pointer), the
+// resulting arena is read-only and can't be saved again.
+//
+// Args:
+//   filename: Path to the file.
+//   offset: Offset within the file where the arena starts.
+//   [out] arena: Address of a YR_ARENA* pointer that will receive the arena.
+//
+// Returns:
+//   ERROR_SUCCESS
+//   ERROR_COULD_NOT_MAP_FILE
+//   ERROR_INVALID_FILE
+//   ERROR_UNSUPPORTED_FILE_VERSION
+//   ERROR_CORRUPT_FILE
+//   ERROR_INSUFFICIENT_MEMORY
+//
+int yr_arena_load_mapped(const char* filename, uint64_t offset, YR_ARENA** arena)
+{
+  YR_MAPPED_FILE* mapped_file = (YR_MAPPED_FILE*) yr_malloc(
+      sizeof(YR_MAPPED_FILE));
+
+  if (mapped_file == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
+
+  if (yr_filemap_map(filename, mapped_file) != ERROR_SUCCESS)
+  {
+    yr_free(mapped_file);
+    return ERROR_COULD_NOT_MAP_FILE;
+  }
+
+  int result = ERROR_SUCCESS;
+  YR_ARENA* new_arena = NULL;
+  YR_ARENA_FILE_HEADER hdr;
+  YR_ARENA_FILE_BUFFER buffers[YR_MAX_ARENA_BUFFERS];
+
+  const uint8_t* base = mapped_file->data + offset;
+  size_t size = offset < mapped_file->size
+                    ? mapped_file->size - (size_t) offset
+                    : 0;
+
+  if (size < sizeof(hdr))
+  {
+    result = ERROR_INVALID_FILE;
+    goto _exit;
+  }
+
+  memcpy(&hdr, base, sizeof(hdr));
+
+  if (hdr.magic[0] != 'Y' || hdr.magic[1] != 'A' || hdr.magic[2] != 'R' ||
+      hdr.magic[3] != 'M')
+  {
+    result = ERROR_INVALID_FILE;
+    goto _exit;
+  }
+
+  if (hdr.version != YR_ARENA_FILE_VERSION)
+  {
+    result = ERROR_UNSUPPORTED_FILE_VERSION;
+    goto _exit;
+  }
+
+  if (hdr.num_buffers > YR_MAX_ARENA_BUFFERS ||
+      size < sizeof(hdr) + hdr.num_buffers * sizeof(YR_ARENA_FILE_BUFFER))
+  {
+    result = ERROR_INVALID_FILE;
+    goto _exit;
+  }
+
+  memcpy(buffers, base + sizeof(hdr), hdr.num_buffers * sizeof(buffers[0]));
+
+  // The relocation entries follow the last buffer and extend up to the end
+  // of the file.
+  uint64_t relocs_offset = sizeof(hdr) +
+                           hdr.num_buffers * sizeof(YR_ARENA_FILE_BUFFER);
+
+  for (int i = 0; i < hdr.num_buffers; ++i)
+  {
+    if (buffers[i].offset > size || buffers[i].size > size - buffers[i].offset)
+    {
+      result = ERROR_CORRUPT_FILE;
+      goto _exit;
+    }
+
+    if (buffers[i].offset + buffers[i].size > relocs_offset)
+      relocs_offset = buffers[i].offset + buffers[i].size;
+  }
+
+  const YR_ARENA_REF* relocs = (const YR_ARENA_REF*) (base + relocs_offset);
+  size_t num_relocs = (size - (size_t) relocs_offset) / sizeof(YR_ARENA_REF);
+
+  // Buffers holding at least one relocatable pointer must be writable.
+  uint32_t patched_buffers = 0;
+
+  for (size_t i = 0; i < num_relocs; ++i)
+  {
+    YR_ARENA_REF reloc_ref;
+    memcpy(&reloc_ref, &relocs[i], sizeof(reloc_ref));
+
+    if (reloc_ref.buffer_id >= hdr.num_buffers)
+    {
+      result = ERROR_CORRUPT_FILE;
+      goto _exit;
+    }
+
+    patched_buffers |= 1U << reloc_ref.buffer_id;
+  }
+
+  result = yr_arena_create(hdr.num_buffers, 10485, &new_arena);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  for (int i = 0; i < hdr.num_buffers; ++i)
+  {
+    if (buffers[i].size == 0)
+      continue;
+
+    const uint8_t* data = base + buffers[i].offset;
+
+    // Buffers are used in place only when they don't need patching and they
+    // are suitably aligned, which is always the case unless the arena starts
+    // at an odd offset within the file.
+    if (!(patched_buffers & (1U << i)) && ((uintptr_t) data % 8) == 0)
+    {
+      new_arena->buffers[i].data = (uint8_t*) data;
+      new_arena->buffers[i].size = buffers[i].size;
+      new_arena->buffers[i].used = buffers[i].size;
+      new_arena->mapped_buffers |= 1U << i;
+    }
+    else
+    {
+      YR_ARENA_REF ref;
+
+      result = yr_arena_allocate_memory(new_arena, i, buffers[i].size, &ref);
+
+      if (result != ERROR_SUCCESS)
+        goto _exit;
+
+      memcpy(
+          yr_arena_get_ptr(new_arena, i, ref.offset), data, buffers[i].size);
+    }
+  }
+
+  for (size_t i = 0; i < num_relocs; ++i)
+  {
+    YR_ARENA_REF reloc_ref;
+    memcpy(&reloc_ref, &relocs[i], sizeof(reloc_ref));
+
+    YR_ARENA_BUFFER* b = &new_arena->buffers[reloc_ref.buffer_id];
+
+    if (b->data == NULL || b->used < sizeof(void*) ||
+        reloc_ref.offset > b->used - sizeof(void*))
+    {
+      result = ERROR_CORRUPT_FILE;
+      goto _exit;
+    }
+
+    YR_ARENA_REF ref;
+
+    memcpy(&ref, b->data + reloc_ref.offset, sizeof(ref));
+
+    void* reloc_ptr = yr_arena_ref_to_ptr(new_arena, &ref);
+
+    memcpy(b->data + reloc_ref.offset, &reloc_ptr, sizeof(reloc_ptr));
+  }
+
+  // From now on the arena owns the mapping, it's unmapped when the arena is
+  // released.
+  new_arena->mapped_file = mapped_file;
+  *arena = new_arena;
+
+  return ERROR_SUCCESS;
+
+_exit:
+
+  if (new_arena != NULL)
+  {
+    // The mapped buffers must not be freed by yr_arena_release.
+    for (int i = 0; i < hdr.num_buffers; ++i)
+      if (new_arena->mapped_buffers & (1U << i))
+        new_arena->buffers[i].data = NULL;
+
+    new_arena->mapped_buffers = 0;
+    yr_arena_release(new_arena);
+  }
+
+  yr_filemap_unmap(mapped_file);
+  yr_free(mapped_file);
+
+  return result;
+}
@@ -0,0 +1,570 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <yara/compare.h>
+#include <yara/cpu.h>
+#include <yara/globals.h>
+
+typedef bool (*YR_COMPARE_FUNC)(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+typedef bool (*YR_COMPARE_XOR_FUNC)(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key);
+
+static YR_COMPARE_FUNC _yr_compare_nocase = yr_compare_nocase_scalar;
+static YR_COMPARE_FUNC _yr_compare_wide = yr_compare_wide_scalar;
+static YR_COMPARE_FUNC _yr_compare_wide_nocase = yr_compare_wide_nocase_scalar;
+static YR_COMPARE_XOR_FUNC _yr_compare_xor = yr_compare_xor_scalar;
+static YR_COMPARE_XOR_FUNC _yr_compare_xor_wide = yr_compare_xor_wide_scalar;
+
+static const char* _yr_compare_implementation = "scalar";
+
+bool yr_compare_nocase_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (yr_lowercase[data[i]] != yr_lowercase[string[i]])
+      return false;
+  }
+
+  return true;
+}
+
+bool yr_compare_wide_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (data[i * 2] != string[i] || data[i * 2 + 1] != 0)
+      return false;
+  }
+
+  return true;
+}
+
+bool yr_compare_wide_nocase_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (yr_lowercase[data[i * 2]] != yr_lowercase[string[i]] ||
+        data[i * 2 + 1] != 0)
+      return false;
+  }
+
+  return true;
+}
+
+bool yr_compare_xor_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (data[i] != (string[i] ^ key))
+      return false;
+  }
+
+  return true;
+}
+
+bool yr_compare_xor_wide_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    if (data[i * 2] != (string[i] ^ key) || data[i * 2 + 1] != key)
+      return false;
+  }
+
+  return true;
+}
+
+#if defined(YR_CPU_X86)
+
+////////////////////////////////////////////////////////////////////////////////
+// Lowercases the ASCII letters in x. Adding 0x80 - 'A' moves 'A'..'Z' to the
+// bottom of the signed range, so a single signed comparison finds them.
+//
+YR_TARGET("sse2")
+static __m128i _yr_compare_lower_sse2(__m128i x)
+{
+  __m128i t = _mm_add_epi8(x, _mm_set1_epi8(0x80 - 'A'));
+  __m128i upper = _mm_cmplt_epi8(t, _mm_set1_epi8(-128 + 26));
+
+  return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+YR_TARGET("avx2")
+static __m256i _yr_compare_lower_avx2(__m256i x)
+{
+  __m256i t = _mm256_add_epi8(x, _mm256_set1_epi8(0x80 - 'A'));
+  __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), t);
+
+  return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+// The SSE2 kernels compare 16 characters at a time, then 8, and leave the
+// rest to the scalar versions. The AVX2 kernels do 32 narrow or 16 wide
+// characters at a time and leave the rest to the SSE2 versions, clearing the
+// upper halves of the YMM registers first so that the legacy SSE instructions
+// don't pay for a state transition. None of them reads beyond the bytes the
+// caller guarantees.
+
+YR_TARGET("sse2")
+static bool _yr_compare_nocase_sse2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i d = _mm_loadu_si128((const __m128i*) (data + i));
+    __m128i s = _mm_loadu_si128((const __m128i*) (string + i));
+    __m128i eq = _mm_cmpeq_epi8(
+        _yr_compare_lower_sse2(d), _yr_compare_lower_sse2(s));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+  }
+
+  if (i + 8 <= length)
+  {
+    __m128i d = _mm_loadl_epi64((const __m128i*) (data + i));
+    __m128i s = _mm_loadl_epi64((const __m128i*) (string + i));
+    __m128i eq = _mm_cmpeq_epi8(
+        _yr_compare_lower_sse2(d), _yr_compare_lower_sse2(s));
+
+    if ((_mm_movemask_epi8(eq) & 0xFF) != 0xFF)
+      return false;
+
+    i += 8;
+  }
+
+  return yr_compare_nocase_scalar(data + i, string + i, length - i);
+}
+
+YR_TARGET("sse2")
+static bool _yr_compare_wide_sse2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i s = _mm_loadu_si128((const __m128i*) (string + i));
+    __m128i d0 = _mm_loadu_si128((const __m128i*) (data + i * 2));
+    __m128i d1 = _mm_loadu_si128((const __m128i*) (data + i * 2 + 16));
+    __m128i eq = _mm_and_si128(
+        _mm_cmpeq_epi8(d0, _mm_unpacklo_epi8(s, zero)),
+        _mm_cmpeq_epi8(d1, _mm_unpackhi_epi8(s, zero)));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+  }
+
+  if (i + 8 <= length)
+  {
+    __m128i s = _mm_loadl_epi64((const __m128i*) (string + i));
+    __m128i d = _mm_loadu_si128((const __m128i*) (data + i * 2));
+    __m128i eq = _mm_cmpeq_epi8(d, _mm_unpacklo_epi8(s, zero));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+
+    i += 8;
+  }
+
+  return yr_compare_wide_scalar(data + i * 2, string + i, length - i);
+}
+
+YR_TARGET("sse2")
+static bool _yr_compare_wide_nocase_sse2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i s = _yr_compare_lower_sse2(
+        _mm_loadu_si128((const __m128i*) (string + i)));
+    __m128i d0 = _yr_compare_lower_sse2(
+        _mm_loadu_si128((const __m128i*) (data + i * 2)));
+    __m128i d1 = _yr_compare_lower_sse2(
+        _mm_loadu_si128((const __m128i*) (data + i * 2 + 16)));
+    __m128i eq = _mm_and_si128(
+        _mm_cmpeq_epi8(d0, _mm_unpacklo_epi8(s, zero)),
+        _mm_cmpeq_epi8(d1, _mm_unpackhi_epi8(s, zero)));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+  }
+
+  if (i + 8 <= length)
+  {
+    __m128i s = _yr_compare_lower_sse2(
+        _mm_loadl_epi64((const __m128i*) (string + i)));
+    __m128i d = _yr_compare_lower_sse2(
+        _mm_loadu_si128((const __m128i*) (data + i * 2)));
+    __m128i eq = _mm_cmpeq_epi8(d, _mm_unpacklo_epi8(s, zero));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+
+    i += 8;
+  }
+
+  return yr_compare_wide_nocase_scalar(data + i * 2, string + i, length - i);
+}
+
+YR_TARGET("sse2")
+static bool _yr_compare_xor_sse2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  __m128i k = _mm_set1_epi8((char) key);
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i d = _mm_loadu_si128((const __m128i*) (data + i));
+    __m128i s = _mm_loadu_si128((const __m128i*) (string + i));
+    __m128i eq = _mm_cmpeq_epi8(d, _mm_xor_si128(s, k));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+  }
+
+  if (i + 8 <= length)
+  {
+    __m128i d = _mm_loadl_epi64((const __m128i*) (data + i));
+    __m128i s = _mm_loadl_epi64((const __m128i*) (string + i));
+    __m128i eq = _mm_cmpeq_epi8(d, _mm_xor_si128(s, k));
+
+    if ((_mm_movemask_epi8(eq) & 0xFF) != 0xFF)
+      return false;
+
+    i += 8;
+  }
+
+  return yr_compare_xor_scalar(data + i, string + i, length - i, key);
+}
+
+YR_TARGET("sse2")
+static bool _yr_compare_xor_wide_sse2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  __m128i k = _mm_set1_epi8((char) key);
+  size_t i = 0;
+
+  // The odd bytes of the data must be the key, which is zero xor'ed with it.
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i s = _mm_xor_si128(
+        _mm_loadu_si128((const __m128i*) (string + i)), k);
+    __m128i d0 = _mm_loadu_si128((const __m128i*) (data + i * 2));
+    __m128i d1 = _mm_loadu_si128((const __m128i*) (data + i * 2 + 16));
+    __m128i eq = _mm_and_si128(
+        _mm_cmpeq_epi8(d0, _mm_unpacklo_epi8(s, k)),
+        _mm_cmpeq_epi8(d1, _mm_unpackhi_epi8(s, k)));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+  }
+
+  if (i + 8 <= length)
+  {
+    __m128i s = _mm_xor_si128(
+        _mm_loadl_epi64((const __m128i*) (string + i)), k);
+    __m128i d = _mm_loadu_si128((const __m128i*) (data + i * 2));
+    __m128i eq = _mm_cmpeq_epi8(d, _mm_unpacklo_epi8(s, k));
+
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return false;
+
+    i += 8;
+  }
+
+  return yr_compare_xor_wide_scalar(
+      data + i * 2, string + i, length - i, key);
+}
+
+YR_TARGET("avx2")
+static bool _yr_compare_nocase_avx2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  size_t i = 0;
+
+  for (; i + 32 <= length; i += 32)
+  {
+    __m256i d = _mm256_loadu_si256((const __m256i*) (data + i));
+    __m256i s = _mm256_loadu_si256((const __m256i*) (string + i));
+    __m256i eq = _mm256_cmpeq_epi8(
+        _yr_compare_lower_avx2(d), _yr_compare_lower_avx2(s));
+
+    if ((uint32_t) _mm256_movemask_epi8(eq) != 0xFFFFFFFF)
+      return false;
+  }
+
+  _mm256_zeroupper();
+
+  return _yr_compare_nocase_sse2(data + i, string + i, length - i);
+}
+
+YR_TARGET("avx2")
+static bool _yr_compare_wide_avx2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m256i s = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128((const __m128i*) (string + i)));
+    __m256i d = _mm256_loadu_si256((const __m256i*) (data + i * 2));
+
+    if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(d, s)) !=
+        0xFFFFFFFF)
+      return false;
+  }
+
+  _mm256_zeroupper();
+
+  return _yr_compare_wide_sse2(data + i * 2, string + i, length - i);
+}
+
+YR_TARGET("avx2")
+static bool _yr_compare_wide_nocase_avx2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m256i s = _yr_compare_lower_avx2(_mm256_cvtepu8_epi16(
+        _mm_loadu_si128((const __m128i*) (string + i))));
+    __m256i d = _yr_compare_lower_avx2(
+        _mm256_loadu_si256((const __m256i*) (data + i * 2)));
+
+    if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(d, s)) !=
+        0xFFFFFFFF)
+      return false;
+  }
+
+  _mm256_zeroupper();
+
+  return _yr_compare_wide_nocase_sse2(data + i * 2, string + i, length - i);
+}
+
+YR_TARGET("avx2")
+static bool _yr_compare_xor_avx2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  __m256i k = _mm256_set1_epi8((char) key);
+  size_t i = 0;
+
+  for (; i + 32 <= length; i += 32)
+  {
+    __m256i d = _mm256_loadu_si256((const __m256i*) (data + i));
+    __m256i s = _mm256_loadu_si256((const __m256i*) (string + i));
+    __m256i eq = _mm256_cmpeq_epi8(d, _mm256_xor_si256(s, k));
+
+    if ((uint32_t) _mm256_movemask_epi8(eq) != 0xFFFFFFFF)
+      return false;
+  }
+
+  _mm256_zeroupper();
+
+  return _yr_compare_xor_sse2(data + i, string + i, length - i, key);
+}
+
+YR_TARGET("avx2")
+static bool _yr_compare_xor_wide_avx2(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  // Zero-extending the string and xor'ing every 16-bit lane with the key in
+  // both bytes yields the expected (character ^ key, key) pairs.
+  __m256i k = _mm256_set1_epi16((short) (key | (key << 8)));
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16)
+  {
+    __m256i s = _mm256_xor_si256(
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (string + i))),
+        k);
+    __m256i d = _mm256_loadu_si256((const __m256i*) (data + i * 2));
+
+    if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(d, s)) !=
+        0xFFFFFFFF)
+      return false;
+  }
+
+  _mm256_zeroupper();
+
+  return _yr_compare_xor_wide_sse2(data + i * 2, string + i, length - i, key);
+}
+
+#endif
+
+bool yr_compare_nocase(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  return _yr_compare_nocase(data, string, length);
+}
+
+bool yr_compare_wide(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  return _yr_compare_wide(data, string, length);
+}
+
+bool yr_compare_wide_nocase(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length)
+{
+  return _yr_compare_wide_nocase(data, string, length);
+}
+
+bool yr_compare_xor(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  return _yr_compare_xor(data, string, length, key);
+}
+
+bool yr_compare_xor_wide(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key)
+{
+  return _yr_compare_xor_wide(data, string, length, key);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Picks the fastest kernels the CPU supports. The vectorized nocase kernels
+// only know about ASCII letters, so they are used only if yr_lowercase doesn't
+// map anything else, which depends on the locale in effect when
+// yr_initialize was called.
+//
+void yr_compare_select_implementation(void)
+{
+#if defined(YR_CPU_X86)
+  bool ascii_lowercase = true;
+
+  for (int c = 0; c < 256; c++)
+  {
+    if (yr_lowercase[c] != ((c >= 'A' && c <= 'Z') ? c + 32 : c))
+      ascii_lowercase = false;
+  }
+
+  if (yr_cpu_has_avx2())
+  {
+    _yr_compare_wide = _yr_compare_wide_avx2;
+    _yr_compare_xor = _yr_compare_xor_avx2;
+    _yr_compare_xor_wide = _yr_compare_xor_wide_avx2;
+
+    if (ascii_lowercase)
+    {
+      _yr_compare_nocase = _yr_compare_nocase_avx2;
+      _yr_compare_wide_nocase = _yr_compare_wide_nocase_avx2;
+    }
+
+    _yr_compare_implementation = "avx2";
+  }
+  else if (yr_cpu_has_sse2())
+  {
+    _yr_compare_wide = _yr_compare_wide_sse2;
+    _yr_compare_xor = _yr_compare_xor_sse2;
+    _yr_compare_xor_wide = _yr_compare_xor_wide_sse2;
+
+    if (ascii_lowercase)
+    {
+      _yr_compare_nocase = _yr_compare_nocase_sse2;
+      _yr_compare_wide_nocase = _yr_compare_wide_nocase_sse2;
+    }
+
+    _yr_compare_implementation = "sse2";
+  }
+#endif
+}
+
+YR_API const char* yr_compare_implementation(void)
+{
+  return _yr_compare_implementation;
+}
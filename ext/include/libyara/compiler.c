@@ -238,6 +238,8 @@ YR_API int yr_compiler_create(YR_COMPILER** compiler)
   new_compiler->include_free = _yr_compiler_default_include_free;
   new_compiler->re_ast_callback = NULL;
   new_compiler->re_ast_clbk_user_data = NULL;
+  new_compiler->atom_quality_callback = NULL;
+  new_compiler->atom_quality_clbk_user_data = NULL;
   new_compiler->last_error = ERROR_SUCCESS;
   new_compiler->last_error_line = 0;
   new_compiler->strict_escape = false;
@@ -357,6 +359,23 @@ YR_API void yr_compiler_set_re_ast_callback(
   compiler->re_ast_clbk_user_data = user_data;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Sets a callback that receives, for every string declared in the rules, the
+// quality of the worst atom added to the Aho-Corasick automaton for it (as
+// returned by yr_atoms_min_quality over the final atom list, after the case
+// and wide variants were generated) and the number of atoms. It allows tools
+// to report on strings that slow down scanning without relying on the
+// warning threshold.
+//
+YR_API void yr_compiler_set_atom_quality_callback(
+    YR_COMPILER* compiler,
+    YR_COMPILER_ATOM_QUALITY_CALLBACK_FUNC atom_quality_callback,
+    void* user_data)
+{
+  compiler->atom_quality_callback = atom_quality_callback;
+  compiler->atom_quality_clbk_user_data = user_data;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // This function allows to specify an atom quality table to be used by the
 // compiler for choosing the best atoms from regular expressions and strings.
@@ -708,6 +727,10 @@ static int _yr_compiler_compile_rules(YR_COMPILER* compiler)
       sizeof(YR_EXTERNAL_VARIABLE),
       NULL));
 
+  // Write an empty string indicating the end of the referenced module fields.
+  FAIL_ON_ERROR(yr_arena_write_string(
+      compiler->arena, YR_MODULE_FIELDS_SECTION, "", NULL));
+
   // Write Aho-Corasick automaton to arena.
   FAIL_ON_ERROR(yr_ac_compile(compiler->automaton, compiler->arena));
 
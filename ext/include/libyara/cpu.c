@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <yara/cpu.h>
+
+#if defined(YR_CPU_X86)
+
+bool yr_cpu_has_sse2(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+  // SSE2 is part of the x86-64 baseline.
+  return true;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool yr_cpu_has_sse42(void)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+bool yr_cpu_has_avx2(void)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7)
+    return false;
+
+  __cpuid(info, 1);
+
+  // AVX2 needs the OS to save the YMM registers (OSXSAVE and XCR0 bits 1-2).
+  if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool yr_cpu_has_sha(void)
+{
+  // The kernels using the SHA extensions also need SSSE3 and SSE4.1, which
+  // every CPU with the extensions has, but it costs nothing to check.
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7)
+    return false;
+
+  __cpuid(info, 1);
+
+  if (!(info[2] & (1 << 9)) || !(info[2] & (1 << 19)))
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 29)) != 0;
+#else
+  return __builtin_cpu_supports("sha") && __builtin_cpu_supports("ssse3") &&
+         __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#else
+
+bool yr_cpu_has_sse2(void)
+{
+  return false;
+}
+
+bool yr_cpu_has_sse42(void)
+{
+  return false;
+}
+
+bool yr_cpu_has_avx2(void)
+{
+  return false;
+}
+
+bool yr_cpu_has_sha(void)
+{
+  return false;
+}
+
+#endif
@@ -0,0 +1,1320 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#include <yara/cpu.h>
+#include <yara/digest.h>
+
+// Number of 64-byte blocks fed to each algorithm before moving to the next
+// one, 4KB stay in the L1 cache while the three of them read it.
+#define DIGEST_SLICE_BLOCKS 64
+
+typedef void (*DIGEST_BLOCKS_FUNC)(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks);
+
+static const uint32_t md5_iv[4] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+static const uint32_t sha1_iv[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667,
+    0xbb67ae85,
+    0x3c6ef372,
+    0xa54ff53a,
+    0x510e527f,
+    0x9b05688c,
+    0x1f83d9ab,
+    0x5be0cd19};
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load_le32(const uint8_t* p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+         ((uint32_t) p[3] << 24);
+}
+
+static uint32_t load_be32(const uint8_t* p)
+{
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+         ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static void store_le32(uint8_t* p, uint32_t v)
+{
+  p[0] = (uint8_t) v;
+  p[1] = (uint8_t) (v >> 8);
+  p[2] = (uint8_t) (v >> 16);
+  p[3] = (uint8_t) (v >> 24);
+}
+
+static void store_be32(uint8_t* p, uint32_t v)
+{
+  p[0] = (uint8_t) (v >> 24);
+  p[1] = (uint8_t) (v >> 16);
+  p[2] = (uint8_t) (v >> 8);
+  p[3] = (uint8_t) v;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Portable implementations, RFC 1321 and FIPS 180-4.
+//
+
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+#define MD5_STEP(f, a, b, c, d, x, k, s)     \
+  {                                          \
+    a += f(b, c, d) + (x) + (uint32_t) (k); \
+    a = ROL32(a, s) + b;                     \
+  }
+
+static void md5_blocks(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+  uint32_t x[16];
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+
+    for (int i = 0; i < 16; i++) x[i] = load_le32(data + i * 4);
+
+    MD5_STEP(MD5_F, a, b, c, d, x[0], 0xd76aa478, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[1], 0xe8c7b756, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070db, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[3], 0xc1bdceee, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[4], 0xf57c0faf, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787c62a, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[6], 0xa8304613, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[7], 0xfd469501, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098d8, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8b44f7af, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895cd7be, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6b901122, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[13], 0xfd987193, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[14], 0xa679438e, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49b40821, 22);
+
+    MD5_STEP(MD5_G, a, b, c, d, x[1], 0xf61e2562, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[6], 0xc040b340, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[0], 0xe9b6c7aa, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[5], 0xd62f105d, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[4], 0xe7d3fbc8, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21e1cde6, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[3], 0xf4d50d87, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455a14ed, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[2], 0xfcefa3f8, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676f02d9, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20);
+
+    MD5_STEP(MD5_H, a, b, c, d, x[5], 0xfffa3942, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771f681, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[14], 0xfde5380c, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[1], 0xa4beea44, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4bdecfa9, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[7], 0xf6bb4b60, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[0], 0xeaa127fa, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[3], 0xd4ef3085, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881d05, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[9], 0xd9d4d039, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[2], 0xc4ac5665, 23);
+
+    MD5_STEP(MD5_I, a, b, c, d, x[0], 0xf4292244, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432aff97, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[5], 0xfc93a039, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8f0ccc92, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[10], 0xffeff47d, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845dd1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6fa87e4f, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[6], 0xa3014314, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[4], 0xf7537e82, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2ad7d2bb, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[9], 0xeb86d391, 21);
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+  }
+}
+
+// Next word of the SHA-1 message schedule, kept in a 16-word ring.
+#define SHA1_W(t)                                        \
+  (w[(t) & 15] = ROL32(                                  \
+       w[((t) + 13) & 15] ^ w[((t) + 8) & 15] ^          \
+           w[((t) + 2) & 15] ^ w[(t) & 15],              \
+       1))
+
+#define SHA1_F0(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_F1(b, c, d) ((b) ^ (c) ^ (d))
+#define SHA1_F2(b, c, d) (((b) & (c)) | ((d) & ((b) | (c))))
+
+// The rounds are unrolled and rotate the names of the variables instead of
+// their values, so that the schedule indexes are constants and every round is
+// a handful of register operations.
+#define SHA1_ROUND(a, b, c, d, e, f, k, x)      \
+  {                                             \
+    e += ROL32(a, 5) + f(b, c, d) + (k) + (x); \
+    b = ROL32(b, 30);                           \
+  }
+
+#define SHA1_ROUNDS5(f, k, t, x)                   \
+  {                                                \
+    SHA1_ROUND(a, b, c, d, e, f, k, x((t) + 0));   \
+    SHA1_ROUND(e, a, b, c, d, f, k, x((t) + 1));   \
+    SHA1_ROUND(d, e, a, b, c, f, k, x((t) + 2));   \
+    SHA1_ROUND(c, d, e, a, b, f, k, x((t) + 3));   \
+    SHA1_ROUND(b, c, d, e, a, f, k, x((t) + 4));   \
+  }
+
+static void sha1_blocks_scalar(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks)
+{
+  uint32_t w[16];
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+
+    for (int t = 0; t < 16; t++) w[t] = load_be32(data + t * 4);
+
+#define SHA1_LOADED(t) w[t]
+
+    SHA1_ROUNDS5(SHA1_F0, 0x5a827999, 0, SHA1_LOADED);
+    SHA1_ROUNDS5(SHA1_F0, 0x5a827999, 5, SHA1_LOADED);
+    SHA1_ROUNDS5(SHA1_F0, 0x5a827999, 10, SHA1_LOADED);
+    SHA1_ROUND(a, b, c, d, e, SHA1_F0, 0x5a827999, w[15]);
+    SHA1_ROUND(e, a, b, c, d, SHA1_F0, 0x5a827999, SHA1_W(16));
+    SHA1_ROUND(d, e, a, b, c, SHA1_F0, 0x5a827999, SHA1_W(17));
+    SHA1_ROUND(c, d, e, a, b, SHA1_F0, 0x5a827999, SHA1_W(18));
+    SHA1_ROUND(b, c, d, e, a, SHA1_F0, 0x5a827999, SHA1_W(19));
+
+#undef SHA1_LOADED
+
+    SHA1_ROUNDS5(SHA1_F1, 0x6ed9eba1, 20, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0x6ed9eba1, 25, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0x6ed9eba1, 30, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0x6ed9eba1, 35, SHA1_W);
+
+    SHA1_ROUNDS5(SHA1_F2, 0x8f1bbcdc, 40, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F2, 0x8f1bbcdc, 45, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F2, 0x8f1bbcdc, 50, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F2, 0x8f1bbcdc, 55, SHA1_W);
+
+    SHA1_ROUNDS5(SHA1_F1, 0xca62c1d6, 60, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0xca62c1d6, 65, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0xca62c1d6, 70, SHA1_W);
+    SHA1_ROUNDS5(SHA1_F1, 0xca62c1d6, 75, SHA1_W);
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+}
+
+#define SHA256_S0(x) (ROR32(x, 2) ^ ROR32(x, 13) ^ ROR32(x, 22))
+#define SHA256_S1(x) (ROR32(x, 6) ^ ROR32(x, 11) ^ ROR32(x, 25))
+#define SHA256_G0(x) (ROR32(x, 7) ^ ROR32(x, 18) ^ ((x) >> 3))
+#define SHA256_G1(x) (ROR32(x, 17) ^ ROR32(x, 19) ^ ((x) >> 10))
+
+// Next word of the SHA-256 message schedule, kept in a 16-word ring.
+#define SHA256_W(t)                                              \
+  (w[(t) & 15] += SHA256_G1(w[((t) + 14) & 15]) + w[((t) + 9) & 15] + \
+                  SHA256_G0(w[((t) + 1) & 15]))
+
+// "wk" is the sum of the round's message word and constant.
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, wk)                            \
+  {                                                                       \
+    uint32_t t1 = h + SHA256_S1(e) + ((g) ^ ((e) & ((f) ^ (g)))) + (wk); \
+    d += t1;                                                              \
+    h = t1 + SHA256_S0(a) + (((a) & (b)) | ((c) & ((a) | (b))));          \
+  }
+
+#define SHA256_ROUNDS8(t, wk)                               \
+  {                                                         \
+    SHA256_ROUND(a, b, c, d, e, f, g, h, wk((t) + 0));      \
+    SHA256_ROUND(h, a, b, c, d, e, f, g, wk((t) + 1));      \
+    SHA256_ROUND(g, h, a, b, c, d, e, f, wk((t) + 2));      \
+    SHA256_ROUND(f, g, h, a, b, c, d, e, wk((t) + 3));      \
+    SHA256_ROUND(e, f, g, h, a, b, c, d, wk((t) + 4));      \
+    SHA256_ROUND(d, e, f, g, h, a, b, c, wk((t) + 5));      \
+    SHA256_ROUND(c, d, e, f, g, h, a, b, wk((t) + 6));      \
+    SHA256_ROUND(b, c, d, e, f, g, h, a, wk((t) + 7));      \
+  }
+
+static void sha256_blocks_scalar(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks)
+{
+  uint32_t w[16];
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+
+    for (int t = 0; t < 16; t++) w[t] = load_be32(data + t * 4);
+
+#define SHA256_LOADED(t) (sha256_k[t] + w[t])
+#define SHA256_NEXT(t)   (sha256_k[t] + SHA256_W(t))
+
+    SHA256_ROUNDS8(0, SHA256_LOADED);
+    SHA256_ROUNDS8(8, SHA256_LOADED);
+
+    SHA256_ROUNDS8(16, SHA256_NEXT);
+    SHA256_ROUNDS8(24, SHA256_NEXT);
+    SHA256_ROUNDS8(32, SHA256_NEXT);
+    SHA256_ROUNDS8(40, SHA256_NEXT);
+    SHA256_ROUNDS8(48, SHA256_NEXT);
+    SHA256_ROUNDS8(56, SHA256_NEXT);
+
+#undef SHA256_LOADED
+#undef SHA256_NEXT
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#if defined(YR_CPU_X86)
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 message schedule for SHA-256. Without the SHA extensions the rounds
+// stay scalar, but the message words of a block, already added to the round
+// constants, are computed four at a time before the rounds start. SHA-1's
+// schedule is too cheap for this to pay off.
+//
+
+#define SSE2_ROL(x, n) \
+  _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+
+#define SSE2_ROR(x, n) \
+  _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+
+// Words 1..4 of the eight in x1:x0, what _mm_alignr_epi8(x1, x0, 4) does with
+// SSSE3.
+#define SSE2_ALIGN4(x1, x0) \
+  _mm_or_si128(_mm_srli_si128(x0, 4), _mm_slli_si128(x1, 12))
+
+// Loads four big-endian words.
+#define SSE2_LOAD_BE32(p)                                                  \
+  _mm_or_si128(                                                            \
+      _mm_slli_epi16(SSE2_ROL(_mm_loadu_si128((const __m128i*) (p)), 16), 8), \
+      _mm_srli_epi16(SSE2_ROL(_mm_loadu_si128((const __m128i*) (p)), 16), 8))
+
+#define SHA256_G1_SSE2(x)                                            \
+  _mm_xor_si128(                                                     \
+      _mm_xor_si128(SSE2_ROR(x, 17), SSE2_ROR(x, 19)), _mm_srli_epi32(x, 10))
+
+// W[t] = g1(W[t-2]) + W[t-7] + g0(W[t-15]) + W[t-16] for four words, x0..x3
+// are the previous sixteen and x0 is replaced by the new ones. The last two
+// words depend on the first two, so g1 is applied in two halves: first to
+// W[t-2] and W[t-1] in the lower lanes, then to the two new words moved to
+// the upper ones. The other lanes are zero in both cases, and g1(0) is zero.
+#define SHA256_SCHEDULE4(x0, x1, x2, x3, t)                              \
+  {                                                                      \
+    __m128i w15 = SSE2_ALIGN4(x1, x0);                                   \
+    __m128i v = _mm_add_epi32(                                           \
+        _mm_add_epi32(x0, SSE2_ALIGN4(x3, x2)),                          \
+        _mm_xor_si128(                                                   \
+            _mm_xor_si128(SSE2_ROR(w15, 7), SSE2_ROR(w15, 18)),          \
+            _mm_srli_epi32(w15, 3)));                                    \
+    v = _mm_add_epi32(v, SHA256_G1_SSE2(_mm_srli_si128(x3, 8)));         \
+    x0 = _mm_add_epi32(v, SHA256_G1_SSE2(_mm_slli_si128(v, 8)));         \
+    _mm_storeu_si128(                                                    \
+        (__m128i*) (wk + (t)),                                           \
+        _mm_add_epi32(                                                   \
+            x0, _mm_loadu_si128((const __m128i*) (sha256_k + (t)))));    \
+  }
+
+YR_TARGET("sse2")
+static void sha256_schedule_sse2(uint32_t* wk, const uint8_t* data)
+{
+  __m128i x[4];
+
+  for (int i = 0; i < 4; i++)
+  {
+    x[i] = SSE2_LOAD_BE32(data + i * 16);
+    _mm_storeu_si128(
+        (__m128i*) (wk + i * 4),
+        _mm_add_epi32(
+            x[i], _mm_loadu_si128((const __m128i*) (sha256_k + i * 4))));
+  }
+
+  __m128i x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+
+  for (int t = 16; t < 64; t += 16)
+  {
+    SHA256_SCHEDULE4(x0, x1, x2, x3, t);
+    SHA256_SCHEDULE4(x1, x2, x3, x0, t + 4);
+    SHA256_SCHEDULE4(x2, x3, x0, x1, t + 8);
+    SHA256_SCHEDULE4(x3, x0, x1, x2, t + 12);
+  }
+}
+
+static void sha256_blocks_sse2(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks)
+{
+  uint32_t wk[64];
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+
+    sha256_schedule_sse2(wk, data);
+
+#define SHA256_WK(t) wk[t]
+
+    SHA256_ROUNDS8(0, SHA256_WK);
+    SHA256_ROUNDS8(8, SHA256_WK);
+    SHA256_ROUNDS8(16, SHA256_WK);
+    SHA256_ROUNDS8(24, SHA256_WK);
+    SHA256_ROUNDS8(32, SHA256_WK);
+    SHA256_ROUNDS8(40, SHA256_WK);
+    SHA256_ROUNDS8(48, SHA256_WK);
+    SHA256_ROUNDS8(56, SHA256_WK);
+
+#undef SHA256_WK
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SHA extensions. The state is kept in the order the instructions expect it,
+// ABCD and E for SHA-1, ABEF and CDGH for SHA-256.
+//
+
+// Four SHA-1 rounds starting at round 4 * i. "e" is the register receiving
+// the E value of these rounds and "next" the one saving it for the next four,
+// m0 holds the current message words and m1..m3 the following ones, which are
+// advanced for the rounds to come.
+#define SHA1_ROUNDS4(e, next, m0, m1, m2, m3, i)  \
+  {                                               \
+    e = _mm_sha1nexte_epu32(e, m0);               \
+    next = abcd;                                  \
+    m1 = _mm_sha1msg2_epu32(m1, m0);              \
+    abcd = _mm_sha1rnds4_epu32(abcd, e, (i) / 5); \
+    m3 = _mm_sha1msg1_epu32(m3, m0);              \
+    m2 = _mm_xor_si128(m2, m0);                   \
+  }
+
+YR_TARGET("sha,sse4.1")
+static void sha1_blocks_shani(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks)
+{
+  const __m128i mask = _mm_set_epi64x(
+      0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+  __m128i abcd = _mm_shuffle_epi32(
+      _mm_loadu_si128((const __m128i*) state), 0x1b);
+
+  __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+  __m128i e1;
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    __m128i abcd_save = abcd;
+    __m128i e0_save = e0;
+
+    __m128i m0 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) data), mask);
+    __m128i m1 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 16)), mask);
+    __m128i m2 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 32)), mask);
+    __m128i m3 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 48)), mask);
+
+    e0 = _mm_add_epi32(e0, m0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+    e1 = _mm_sha1nexte_epu32(e1, m1);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+    m0 = _mm_sha1msg1_epu32(m0, m1);
+
+    e0 = _mm_sha1nexte_epu32(e0, m2);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    m1 = _mm_sha1msg1_epu32(m1, m2);
+    m0 = _mm_xor_si128(m0, m2);
+
+    SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 3);
+    SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 4);
+    SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 5);
+    SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 6);
+    SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 7);
+    SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 8);
+    SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 9);
+    SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 10);
+    SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 11);
+    SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 12);
+    SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 13);
+    SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 14);
+    SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 15);
+    SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 16);
+    SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 17);
+    SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 18);
+
+    e1 = _mm_sha1nexte_epu32(e1, m3);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+    e0 = _mm_sha1nexte_epu32(e0, e0_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+  }
+
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  _mm_storeu_si128((__m128i*) state, abcd);
+  state[4] = (uint32_t) _mm_extract_epi32(e0, 3);
+}
+
+// Four SHA-256 rounds starting at round 4 * i. m0 becomes the message words of
+// these rounds, computed from the previous sixteen, which are m0..m3 in order.
+#define SHA256_ROUNDS4(m0, m1, m2, m3, i)                                   \
+  {                                                                         \
+    m0 = _mm_sha256msg2_epu32(                                              \
+        _mm_add_epi32(                                                      \
+            _mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)),      \
+        m3);                                                                \
+    SHA256_RNDS4(m0, i);                                                    \
+  }
+
+#define SHA256_RNDS4(m, i)                                                   \
+  {                                                                          \
+    __m128i wk = _mm_add_epi32(                                              \
+        m, _mm_loadu_si128((const __m128i*) (sha256_k + (i) * 4)));          \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);                            \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e)); \
+  }
+
+YR_TARGET("sha,sse4.1")
+static void sha256_blocks_shani(
+    uint32_t* state,
+    const uint8_t* data,
+    size_t blocks)
+{
+  const __m128i mask = _mm_set_epi64x(
+      0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i dcba = _mm_shuffle_epi32(
+      _mm_loadu_si128((const __m128i*) state), 0xb1);
+  __m128i hgfe = _mm_shuffle_epi32(
+      _mm_loadu_si128((const __m128i*) (state + 4)), 0x1b);
+
+  __m128i abef = _mm_alignr_epi8(dcba, hgfe, 8);
+  __m128i cdgh = _mm_blend_epi16(hgfe, dcba, 0xf0);
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    __m128i abef_save = abef;
+    __m128i cdgh_save = cdgh;
+
+    __m128i m0 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) data), mask);
+    __m128i m1 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 16)), mask);
+    __m128i m2 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 32)), mask);
+    __m128i m3 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*) (data + 48)), mask);
+
+    SHA256_RNDS4(m0, 0);
+    SHA256_RNDS4(m1, 1);
+    SHA256_RNDS4(m2, 2);
+    SHA256_RNDS4(m3, 3);
+
+    for (int i = 4; i < 16; i += 4)
+    {
+      SHA256_ROUNDS4(m0, m1, m2, m3, i);
+      SHA256_ROUNDS4(m1, m2, m3, m0, i + 1);
+      SHA256_ROUNDS4(m2, m3, m0, m1, i + 2);
+      SHA256_ROUNDS4(m3, m0, m1, m2, i + 3);
+    }
+
+    abef = _mm_add_epi32(abef, abef_save);
+    cdgh = _mm_add_epi32(cdgh, cdgh_save);
+  }
+
+  __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+  __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+
+  _mm_storeu_si128((__m128i*) state, _mm_blend_epi16(feba, dchg, 0xf0));
+  _mm_storeu_si128(
+      (__m128i*) (state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Multi-buffer SHA-256, each of the eight 32-bit lanes of an AVX2 register
+// runs the compression function of a different buffer.
+//
+
+#define X8_ROR(x, n) \
+  _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+// Loads 32 bytes from each lane and transposes them, so that w[i] holds the
+// i-th big-endian word of every lane.
+YR_TARGET("avx2")
+static void sha256_x8_load(__m256i* w, const uint8_t* const* data, size_t at)
+{
+  const __m256i swap = _mm256_set_epi8(
+      12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+      12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+  __m256i r[8], t[8], u[8];
+
+  for (int i = 0; i < 8; i++)
+    r[i] = _mm256_loadu_si256((const __m256i*) (data[i] + at));
+
+  for (int i = 0; i < 8; i += 2)
+  {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+
+  for (int i = 0; i < 8; i += 4)
+  {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    w[i] = _mm256_shuffle_epi8(
+        _mm256_permute2x128_si256(u[i], u[i + 4], 0x20), swap);
+    w[i + 4] = _mm256_shuffle_epi8(
+        _mm256_permute2x128_si256(u[i], u[i + 4], 0x31), swap);
+  }
+}
+
+// Runs "blocks" blocks of each lane. state[i] holds the i-th state word of
+// every lane.
+YR_TARGET("avx2")
+static void sha256_x8_blocks_avx2(
+    uint32_t state[8][8],
+    const uint8_t* const* data,
+    size_t blocks)
+{
+  __m256i s[8];
+  __m256i w[64];
+
+  for (int i = 0; i < 8; i++)
+    s[i] = _mm256_loadu_si256((const __m256i*) state[i]);
+
+  for (size_t block = 0; block < blocks; block++)
+  {
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+    sha256_x8_load(w, data, block * 64);
+    sha256_x8_load(w + 8, data, block * 64 + 32);
+
+    for (int t = 16; t < 64; t++)
+    {
+      __m256i w2 = w[t - 2];
+      __m256i w15 = w[t - 15];
+
+      __m256i g1 = _mm256_xor_si256(
+          _mm256_xor_si256(X8_ROR(w2, 17), X8_ROR(w2, 19)),
+          _mm256_srli_epi32(w2, 10));
+
+      __m256i g0 = _mm256_xor_si256(
+          _mm256_xor_si256(X8_ROR(w15, 7), X8_ROR(w15, 18)),
+          _mm256_srli_epi32(w15, 3));
+
+      w[t] = _mm256_add_epi32(
+          _mm256_add_epi32(g1, w[t - 7]), _mm256_add_epi32(g0, w[t - 16]));
+    }
+
+    for (int t = 0; t < 64; t++)
+    {
+      __m256i s1 = _mm256_xor_si256(
+          _mm256_xor_si256(X8_ROR(e, 6), X8_ROR(e, 11)), X8_ROR(e, 25));
+
+      __m256i ch = _mm256_xor_si256(
+          _mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+
+      __m256i t1 = _mm256_add_epi32(
+          _mm256_add_epi32(h, s1),
+          _mm256_add_epi32(
+              ch,
+              _mm256_add_epi32(
+                  w[t], _mm256_set1_epi32((int) sha256_k[t]))));
+
+      __m256i s0 = _mm256_xor_si256(
+          _mm256_xor_si256(X8_ROR(a, 2), X8_ROR(a, 13)), X8_ROR(a, 22));
+
+      __m256i maj = _mm256_or_si256(
+          _mm256_and_si256(a, b),
+          _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+      h = g;
+      g = f;
+      f = e;
+      e = _mm256_add_epi32(d, t1);
+      d = c;
+      c = b;
+      b = a;
+      a = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], h);
+  }
+
+  for (int i = 0; i < 8; i++)
+    _mm256_storeu_si256((__m256i*) state[i], s[i]);
+
+  _mm256_zeroupper();
+}
+
+#endif
+
+static DIGEST_BLOCKS_FUNC _yr_sha1_blocks = sha1_blocks_scalar;
+static DIGEST_BLOCKS_FUNC _yr_sha256_blocks = sha256_blocks_scalar;
+
+#if defined(YR_CPU_X86)
+static bool _yr_sha256_multi_avx2 = false;
+#endif
+
+static const char* _yr_digest_implementation = "scalar";
+
+static void digest_blocks(
+    YR_DIGEST_CTX* ctx,
+    const uint8_t* data,
+    size_t blocks)
+{
+  while (blocks > 0)
+  {
+    size_t slice = yr_min(blocks, DIGEST_SLICE_BLOCKS);
+
+    if (ctx->algorithms & YR_DIGEST_MD5)
+      md5_blocks(ctx->md5, data, slice);
+
+    if (ctx->algorithms & YR_DIGEST_SHA1)
+      _yr_sha1_blocks(ctx->sha1, data, slice);
+
+    if (ctx->algorithms & YR_DIGEST_SHA256)
+      _yr_sha256_blocks(ctx->sha256, data, slice);
+
+    data += slice * 64;
+    blocks -= slice;
+  }
+}
+
+// Writes the padding that follows the last "length % 64" bytes of a message
+// of "length" bytes, those bytes included, and returns the number of blocks it
+// takes, one or two. All three algorithms pad the same way, only the byte
+// order of the bit length differs.
+static size_t digest_padding(
+    uint8_t tail[128],
+    const uint8_t* rest,
+    uint64_t length,
+    bool little_endian)
+{
+  size_t rest_length = (size_t) (length % 64);
+  size_t blocks = rest_length < 56 ? 1 : 2;
+  uint64_t bits = length * 8;
+
+  memset(tail, 0, 128);
+  memcpy(tail, rest, rest_length);
+  tail[rest_length] = 0x80;
+
+  for (int i = 0; i < 8; i++)
+  {
+    uint8_t byte = (uint8_t) (bits >> (i * 8));
+
+    if (little_endian)
+      tail[blocks * 64 - 8 + i] = byte;
+    else
+      tail[blocks * 64 - 1 - i] = byte;
+  }
+
+  return blocks;
+}
+
+YR_API void yr_digest_init(YR_DIGEST_CTX* ctx, int algorithms)
+{
+  ctx->algorithms = algorithms;
+  ctx->length = 0;
+  ctx->buffer_length = 0;
+
+  memcpy(ctx->md5, md5_iv, sizeof(md5_iv));
+  memcpy(ctx->sha1, sha1_iv, sizeof(sha1_iv));
+  memcpy(ctx->sha256, sha256_iv, sizeof(sha256_iv));
+}
+
+YR_API void yr_digest_update(
+    YR_DIGEST_CTX* ctx,
+    const void* data,
+    size_t length)
+{
+  const uint8_t* bytes = (const uint8_t*) data;
+
+  ctx->length += length;
+
+  if (ctx->buffer_length > 0)
+  {
+    size_t n = yr_min(length, 64 - ctx->buffer_length);
+
+    memcpy(ctx->buffer + ctx->buffer_length, bytes, n);
+
+    ctx->buffer_length += n;
+    bytes += n;
+    length -= n;
+
+    if (ctx->buffer_length < 64)
+      return;
+
+    digest_blocks(ctx, ctx->buffer, 1);
+    ctx->buffer_length = 0;
+  }
+
+  digest_blocks(ctx, bytes, length / 64);
+
+  bytes += length - length % 64;
+  length %= 64;
+
+  memcpy(ctx->buffer, bytes, length);
+  ctx->buffer_length = length;
+}
+
+YR_API void yr_digest_final(YR_DIGEST_CTX* ctx, YR_DIGEST* digest)
+{
+  uint8_t tail[128];
+  size_t blocks;
+
+  if (ctx->algorithms & YR_DIGEST_MD5)
+  {
+    blocks = digest_padding(tail, ctx->buffer, ctx->length, true);
+    md5_blocks(ctx->md5, tail, blocks);
+
+    for (int i = 0; i < 4; i++) store_le32(digest->md5 + i * 4, ctx->md5[i]);
+  }
+
+  blocks = digest_padding(tail, ctx->buffer, ctx->length, false);
+
+  if (ctx->algorithms & YR_DIGEST_SHA1)
+  {
+    _yr_sha1_blocks(ctx->sha1, tail, blocks);
+
+    for (int i = 0; i < 5; i++)
+      store_be32(digest->sha1 + i * 4, ctx->sha1[i]);
+  }
+
+  if (ctx->algorithms & YR_DIGEST_SHA256)
+  {
+    _yr_sha256_blocks(ctx->sha256, tail, blocks);
+
+    for (int i = 0; i < 8; i++)
+      store_be32(digest->sha256 + i * 4, ctx->sha256[i]);
+  }
+}
+
+#if defined(YR_CPU_X86)
+
+typedef struct _SHA256_LANE
+{
+  // Index of the buffer hashed in this lane, -1 if the lane is idle.
+  int64_t buffer;
+
+  // Blocks of the buffer not hashed yet, followed by the padding in "tail".
+  const uint8_t* data;
+  size_t blocks;
+  bool in_tail;
+
+  uint8_t tail[128];
+  size_t tail_blocks;
+
+} SHA256_LANE;
+
+static void sha256_lane_start(
+    SHA256_LANE* lane,
+    uint32_t state[8][8],
+    int lane_index,
+    int64_t buffer,
+    const uint8_t* data,
+    size_t length)
+{
+  for (int i = 0; i < 8; i++) state[i][lane_index] = sha256_iv[i];
+
+  lane->buffer = buffer;
+  lane->data = data;
+  lane->blocks = length / 64;
+  lane->in_tail = false;
+  lane->tail_blocks = digest_padding(
+      lane->tail, data + length - length % 64, length, false);
+
+  if (lane->blocks == 0)
+  {
+    lane->data = lane->tail;
+    lane->blocks = lane->tail_blocks;
+    lane->in_tail = true;
+  }
+}
+
+static void sha256_multi_avx2(
+    const uint8_t* const* data,
+    const size_t* lengths,
+    size_t count,
+    uint8_t (*digests)[YR_DIGEST_SHA256_LENGTH])
+{
+  SHA256_LANE lanes[8];
+  uint32_t state[8][8];
+
+  const uint8_t* pointers[8];
+  size_t next = 0;
+
+  for (int l = 0; l < 8; l++)
+  {
+    lanes[l].buffer = -1;
+
+    if (next < count)
+    {
+      sha256_lane_start(
+          &lanes[l], state, l, (int64_t) next, data[next], lengths[next]);
+      next++;
+    }
+  }
+
+  for (;;)
+  {
+    size_t blocks = SIZE_MAX;
+    int active = 0;
+    int first = -1;
+
+    for (int l = 0; l < 8; l++)
+    {
+      if (lanes[l].buffer < 0)
+        continue;
+
+      blocks = yr_min(blocks, lanes[l].blocks);
+      active++;
+
+      if (first < 0)
+        first = l;
+    }
+
+    if (active == 0)
+      break;
+
+    // A single lane left runs faster through the one-buffer implementation
+    // than in a register with seven idle lanes.
+    if (active == 1 && next == count)
+    {
+      SHA256_LANE* lane = &lanes[first];
+      uint32_t single[8];
+
+      for (int i = 0; i < 8; i++) single[i] = state[i][first];
+
+      _yr_sha256_blocks(single, lane->data, lane->blocks);
+
+      if (!lane->in_tail)
+        _yr_sha256_blocks(single, lane->tail, lane->tail_blocks);
+
+      for (int i = 0; i < 8; i++)
+        store_be32(digests[lane->buffer] + i * 4, single[i]);
+
+      break;
+    }
+
+    // Idle lanes hash the same data as an active one, their results are
+    // never read.
+    for (int l = 0; l < 8; l++)
+      pointers[l] = lanes[l].buffer < 0 ? lanes[first].data : lanes[l].data;
+
+    sha256_x8_blocks_avx2(state, pointers, blocks);
+
+    for (int l = 0; l < 8; l++)
+    {
+      SHA256_LANE* lane = &lanes[l];
+
+      if (lane->buffer < 0)
+        continue;
+
+      lane->data += blocks * 64;
+      lane->blocks -= blocks;
+
+      if (lane->blocks > 0)
+        continue;
+
+      if (!lane->in_tail)
+      {
+        lane->data = lane->tail;
+        lane->blocks = lane->tail_blocks;
+        lane->in_tail = true;
+        continue;
+      }
+
+      for (int i = 0; i < 8; i++)
+        store_be32(digests[lane->buffer] + i * 4, state[i][l]);
+
+      lane->buffer = -1;
+
+      if (next < count)
+      {
+        sha256_lane_start(
+            lane, state, l, (int64_t) next, data[next], lengths[next]);
+        next++;
+      }
+    }
+  }
+}
+
+// Runs the SHA-256 compression function over "blocks[i]" blocks of "data[i]"
+// for every stream, starting from and updating "states[i]". Streams take turns
+// in the eight lanes like the buffers of sha256_multi_avx2.
+static void sha256_streams_avx2(
+    uint32_t* const* states,
+    const uint8_t* const* data,
+    const size_t* blocks,
+    size_t count)
+{
+  int64_t stream[8];
+  const uint8_t* pointers[8];
+  size_t left[8];
+  uint32_t state[8][8];
+  size_t next = 0;
+
+  for (int l = 0; l < 8; l++)
+  {
+    stream[l] = -1;
+
+    while (stream[l] < 0 && next < count)
+    {
+      if (blocks[next] > 0)
+      {
+        stream[l] = (int64_t) next;
+        pointers[l] = data[next];
+        left[l] = blocks[next];
+
+        for (int i = 0; i < 8; i++) state[i][l] = states[next][i];
+      }
+
+      next++;
+    }
+  }
+
+  for (;;)
+  {
+    size_t run = SIZE_MAX;
+    int active = 0;
+    int first = -1;
+
+    for (int l = 0; l < 8; l++)
+    {
+      if (stream[l] < 0)
+        continue;
+
+      run = yr_min(run, left[l]);
+      active++;
+
+      if (first < 0)
+        first = l;
+    }
+
+    if (active == 0)
+      break;
+
+    if (active == 1 && next == count)
+    {
+      for (int i = 0; i < 8; i++) states[stream[first]][i] = state[i][first];
+
+      _yr_sha256_blocks(states[stream[first]], pointers[first], left[first]);
+      break;
+    }
+
+    const uint8_t* lanes[8];
+
+    for (int l = 0; l < 8; l++)
+      lanes[l] = stream[l] < 0 ? pointers[first] : pointers[l];
+
+    sha256_x8_blocks_avx2(state, lanes, run);
+
+    for (int l = 0; l < 8; l++)
+    {
+      if (stream[l] < 0)
+        continue;
+
+      pointers[l] += run * 64;
+      left[l] -= run;
+
+      if (left[l] > 0)
+        continue;
+
+      for (int i = 0; i < 8; i++) states[stream[l]][i] = state[i][l];
+
+      stream[l] = -1;
+
+      while (stream[l] < 0 && next < count)
+      {
+        if (blocks[next] > 0)
+        {
+          stream[l] = (int64_t) next;
+          pointers[l] = data[next];
+          left[l] = blocks[next];
+
+          for (int i = 0; i < 8; i++) state[i][l] = states[next][i];
+        }
+
+        next++;
+      }
+    }
+  }
+}
+
+#endif
+
+YR_API void yr_digest_update_multi(
+    YR_DIGEST_CTX* const* ctxs,
+    const uint8_t* const* data,
+    const size_t* lengths,
+    size_t count)
+{
+#if defined(YR_CPU_X86)
+  if (_yr_sha256_multi_avx2 && count > 1)
+  {
+    uint32_t* states[YR_DIGEST_MULTI_MAX];
+    const uint8_t* blocks_data[YR_DIGEST_MULTI_MAX];
+    size_t blocks[YR_DIGEST_MULTI_MAX];
+    size_t streams = 0;
+
+    for (size_t at = 0; at < count; at += streams)
+    {
+      streams = yr_min(count - at, YR_DIGEST_MULTI_MAX);
+
+      for (size_t i = 0; i < streams; i++)
+      {
+        YR_DIGEST_CTX* ctx = ctxs[at + i];
+        const uint8_t* bytes = data[at + i];
+        size_t length = lengths[at + i];
+
+        ctx->length += length;
+
+        // A partial block left by a previous update is completed and hashed
+        // on its own, with every algorithm.
+        if (ctx->buffer_length > 0)
+        {
+          size_t n = yr_min(length, 64 - ctx->buffer_length);
+
+          memcpy(ctx->buffer + ctx->buffer_length, bytes, n);
+
+          ctx->buffer_length += n;
+          bytes += n;
+          length -= n;
+
+          if (ctx->buffer_length == 64)
+          {
+            digest_blocks(ctx, ctx->buffer, 1);
+            ctx->buffer_length = 0;
+          }
+        }
+
+        states[i] = ctx->sha256;
+        blocks_data[i] = bytes;
+        blocks[i] = (ctx->algorithms & YR_DIGEST_SHA256) ? length / 64 : 0;
+
+        // MD5 and SHA-1 still run per context, SHA-256 goes to the lanes.
+        if (length >= 64)
+        {
+          int algorithms = ctx->algorithms;
+
+          ctx->algorithms &= ~YR_DIGEST_SHA256;
+          digest_blocks(ctx, bytes, length / 64);
+          ctx->algorithms = algorithms;
+        }
+
+        bytes += length - length % 64;
+        length %= 64;
+
+        if (length > 0)
+        {
+          memcpy(ctx->buffer + ctx->buffer_length, bytes, length);
+          ctx->buffer_length += length;
+        }
+      }
+
+      sha256_streams_avx2(states, blocks_data, blocks, streams);
+    }
+
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < count; i++)
+    yr_digest_update(ctxs[i], data[i], lengths[i]);
+}
+
+YR_API void yr_digest_sha256_multi(
+    const uint8_t* const* data,
+    const size_t* lengths,
+    size_t count,
+    uint8_t (*digests)[YR_DIGEST_SHA256_LENGTH])
+{
+#if defined(YR_CPU_X86)
+  if (_yr_sha256_multi_avx2 && count > 1)
+  {
+    sha256_multi_avx2(data, lengths, count, digests);
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < count; i++)
+  {
+    YR_DIGEST_CTX ctx;
+    YR_DIGEST digest;
+
+    yr_digest_init(&ctx, YR_DIGEST_SHA256);
+    yr_digest_update(&ctx, data[i], lengths[i]);
+    yr_digest_final(&ctx, &digest);
+
+    memcpy(digests[i], digest.sha256, YR_DIGEST_SHA256_LENGTH);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Picks the fastest kernels the CPU supports. With the SHA extensions a single
+// core hashes one buffer faster than eight in AVX2 lanes, so multi-buffer
+// hashing is used only without them.
+//
+void yr_digest_select_implementation(void)
+{
+#if defined(YR_CPU_X86)
+  if (yr_cpu_has_sha())
+  {
+    _yr_sha1_blocks = sha1_blocks_shani;
+    _yr_sha256_blocks = sha256_blocks_shani;
+    _yr_digest_implementation = "sha";
+  }
+  else if (yr_cpu_has_sse2())
+  {
+    _yr_sha256_blocks = sha256_blocks_sse2;
+    _yr_digest_implementation = "sse2";
+
+    if (yr_cpu_has_avx2())
+    {
+      _yr_sha256_multi_avx2 = true;
+      _yr_digest_implementation = "avx2";
+    }
+  }
+#endif
+}
+
+YR_API const char* yr_digest_implementation(void)
+{
+  return _yr_digest_implementation;
+}
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <yara/exec.h>
 #include <yara/globals.h>
 #include <yara/limits.h>
+#include <yara/matches.h>
 #include <yara/mem.h>
 #include <yara/modules.h>
 #include <yara/object.h>
@@ -50,6 +51,168 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MEM_SIZE YR_MAX_LOOP_NESTING*(YR_MAX_LOOP_VARS + YR_INTERNAL_LOOP_VARS)
 
+// Labels as values are a GCC extension also supported by clang. When available
+// every instruction jumps straight to the handler of the next one through a
+// table of label addresses, instead of going back to a single switch at the
+// top of the loop. That gives the branch predictor one indirect jump per
+// handler to learn from. Define YR_EXEC_NO_COMPUTED_GOTO to use the switch.
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(YR_EXEC_NO_COMPUTED_GOTO)
+#define YR_EXEC_COMPUTED_GOTO
+#endif
+
+#if defined(YR_EXEC_COMPUTED_GOTO)
+
+#define OPCODE(op)     op_##op
+#define OPCODE_DEFAULT op_unknown
+
+// Jumps to the next instruction unless the execution must stop or it's time
+// to check for the timeout, in which case it goes back to the main loop.
+#define NEXT_OPCODE                   \
+  if (!stop && ++cycle < 100)         \
+  {                                   \
+    opcode = *ip;                     \
+    ip++;                             \
+    goto* dispatch_table[opcode];     \
+  }                                   \
+  break
+
+#else
+
+#define OPCODE(op)     case op
+#define OPCODE_DEFAULT default
+#define NEXT_OPCODE    break
+
+#endif
+
+// Every opcode handled by yr_execute_code.
+#define YR_EXEC_OPCODES(X) \
+  X(OP_NOP)                         \
+  X(OP_HALT)                        \
+  X(OP_ITER_START_ARRAY)            \
+  X(OP_ITER_START_DICT)             \
+  X(OP_ITER_START_INT_RANGE)        \
+  X(OP_ITER_START_INT_ENUM)         \
+  X(OP_ITER_START_STRING_SET)       \
+  X(OP_ITER_START_TEXT_STRING_SET)  \
+  X(OP_ITER_NEXT)                   \
+  X(OP_ITER_CONDITION)              \
+  X(OP_ITER_END)                    \
+  X(OP_PUSH)                        \
+  X(OP_PUSH_8)                      \
+  X(OP_PUSH_16)                     \
+  X(OP_PUSH_32)                     \
+  X(OP_PUSH_U)                      \
+  X(OP_POP)                         \
+  X(OP_CLEAR_M)                     \
+  X(OP_ADD_M)                       \
+  X(OP_INCR_M)                      \
+  X(OP_PUSH_M)                      \
+  X(OP_POP_M)                       \
+  X(OP_SET_M)                       \
+  X(OP_SWAPUNDEF)                   \
+  X(OP_JNUNDEF)                     \
+  X(OP_JUNDEF_P)                    \
+  X(OP_JL_P)                        \
+  X(OP_JLE_P)                       \
+  X(OP_JTRUE)                       \
+  X(OP_JTRUE_P)                     \
+  X(OP_JFALSE)                      \
+  X(OP_JFALSE_P)                    \
+  X(OP_JZ)                          \
+  X(OP_JZ_P)                        \
+  X(OP_AND)                         \
+  X(OP_OR)                          \
+  X(OP_NOT)                         \
+  X(OP_DEFINED)                     \
+  X(OP_MOD)                         \
+  X(OP_SHR)                         \
+  X(OP_SHL)                         \
+  X(OP_BITWISE_NOT)                 \
+  X(OP_BITWISE_AND)                 \
+  X(OP_BITWISE_OR)                  \
+  X(OP_BITWISE_XOR)                 \
+  X(OP_PUSH_RULE)                   \
+  X(OP_INIT_RULE)                   \
+  X(OP_MATCH_RULE)                  \
+  X(OP_OBJ_LOAD)                    \
+  X(OP_OBJ_FIELD)                   \
+  X(OP_OBJ_VALUE)                   \
+  X(OP_INDEX_ARRAY)                 \
+  X(OP_LOOKUP_DICT)                 \
+  X(OP_CALL)                        \
+  X(OP_FOUND)                       \
+  X(OP_FOUND_STRING)                \
+  X(OP_FOUND_AT)                    \
+  X(OP_FOUND_IN)                    \
+  X(OP_COUNT)                       \
+  X(OP_COUNT_IN)                    \
+  X(OP_OFFSET)                      \
+  X(OP_LENGTH)                      \
+  X(OP_OF)                          \
+  X(OP_OF_PERCENT)                  \
+  X(OP_OF_FOUND_IN)                 \
+  X(OP_OF_FOUND_AT)                 \
+  X(OP_FILESIZE)                    \
+  X(OP_ENTRYPOINT)                  \
+  X(OP_INT8)                        \
+  X(OP_INT16)                       \
+  X(OP_INT32)                       \
+  X(OP_UINT8)                       \
+  X(OP_UINT16)                      \
+  X(OP_UINT32)                      \
+  X(OP_INT8BE)                      \
+  X(OP_INT16BE)                     \
+  X(OP_INT32BE)                     \
+  X(OP_UINT8BE)                     \
+  X(OP_UINT16BE)                    \
+  X(OP_UINT32BE)                    \
+  X(OP_IMPORT)                      \
+  X(OP_MATCHES)                     \
+  X(OP_INT_TO_DBL)                  \
+  X(OP_STR_TO_BOOL)                 \
+  X(OP_INT_EQ)                      \
+  X(OP_INT_NEQ)                     \
+  X(OP_INT_LT)                      \
+  X(OP_INT_GT)                      \
+  X(OP_INT_LE)                      \
+  X(OP_INT_GE)                      \
+  X(OP_INT_EQ_IMM)                  \
+  X(OP_INT_NEQ_IMM)                 \
+  X(OP_INT_LT_IMM)                  \
+  X(OP_INT_GT_IMM)                  \
+  X(OP_INT_LE_IMM)                  \
+  X(OP_INT_GE_IMM)                  \
+  X(OP_INT_ADD)                     \
+  X(OP_INT_SUB)                     \
+  X(OP_INT_MUL)                     \
+  X(OP_INT_DIV)                     \
+  X(OP_INT_MINUS)                   \
+  X(OP_DBL_LT)                      \
+  X(OP_DBL_GT)                      \
+  X(OP_DBL_LE)                      \
+  X(OP_DBL_GE)                      \
+  X(OP_DBL_EQ)                      \
+  X(OP_DBL_NEQ)                     \
+  X(OP_DBL_ADD)                     \
+  X(OP_DBL_SUB)                     \
+  X(OP_DBL_MUL)                     \
+  X(OP_DBL_DIV)                     \
+  X(OP_DBL_MINUS)                   \
+  X(OP_STR_EQ)                      \
+  X(OP_STR_NEQ)                     \
+  X(OP_STR_LT)                      \
+  X(OP_STR_LE)                      \
+  X(OP_STR_GT)                      \
+  X(OP_STR_GE)                      \
+  X(OP_CONTAINS)                    \
+  X(OP_ICONTAINS)                   \
+  X(OP_STARTSWITH)                  \
+  X(OP_ISTARTSWITH)                 \
+  X(OP_ENDSWITH)                    \
+  X(OP_IENDSWITH)                   \
+  X(OP_IEQUALS)
+
 #define push(x)                         \
   if (stack.sp < stack.capacity)        \
   {                                     \
@@ -440,10 +603,8 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
   YR_RULE* current_rule = NULL;
   YR_RULE* rule;
   YR_MATCH* match;
+  YR_MATCHES* matches;
   YR_OBJECT_FUNCTION* function;
-  YR_OBJECT** obj_ptr;
-  YR_ARENA* obj_arena;
-  YR_NOTEBOOK* it_notebook;
 
   char* identifier;
   char* args_fmt;
@@ -452,29 +613,41 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
   int count;
   int result = ERROR_SUCCESS;
   int cycle = 0;
-  int obj_count = 0;
 
   bool stop = false;
 
   uint8_t opcode;
 
+#if defined(YR_EXEC_COMPUTED_GOTO)
+#define X(op) [op] = &&op_##op,
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Winitializer-overrides"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+  static const void* dispatch_table[256] = {
+      [0 ... 255] = &&op_unknown, YR_EXEC_OPCODES(X)};
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#else
+#pragma GCC diagnostic pop
+#endif
+#undef X
+#endif
+
   yr_get_configuration_uint32(YR_CONFIG_STACK_SIZE, &stack.capacity);
 
+  // The stack, the iterators and the objects returned by module functions
+  // live in the scanner's notebook, which is reset when the next scan begins.
   stack.sp = 0;
-  stack.items = (YR_VALUE*) yr_malloc(stack.capacity * sizeof(YR_VALUE));
+  stack.items = (YR_VALUE*) yr_notebook_alloc(
+      context->notebook, stack.capacity * sizeof(YR_VALUE));
 
   if (stack.items == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
-  FAIL_ON_ERROR_WITH_CLEANUP(
-      yr_arena_create(1, 512 * sizeof(YR_OBJECT*), &obj_arena),
-      yr_free(stack.items));
-
-  FAIL_ON_ERROR_WITH_CLEANUP(
-      yr_notebook_create(512 * sizeof(YR_ITERATOR), &it_notebook),
-      yr_arena_release(obj_arena);
-      yr_free(stack.items));
-
 #ifdef YR_PROFILING_ENABLED
   start_time = yr_stopwatch_elapsed_ns(&context->stopwatch);
 #endif
@@ -491,22 +664,28 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
     // Advance the instruction pointer, which now points past the opcode.
     ip++;
 
+#if defined(YR_EXEC_COMPUTED_GOTO)
+    do
+    {
+      goto* dispatch_table[opcode];
+#else
     switch (opcode)
     {
-    case OP_NOP:
+#endif
+    OPCODE(OP_NOP):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_NOP: // %s()\n", __FUNCTION__);
-      break;
+      NEXT_OPCODE;
 
-    case OP_HALT:
+    OPCODE(OP_HALT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_HALT: // %s()\n", __FUNCTION__);
       assert(stack.sp == 0);  // When HALT is reached the stack should be empty.
       stop = true;
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_ARRAY:
+    OPCODE(OP_ITER_START_ARRAY):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_START_ARRAY: // %s()\n", __FUNCTION__);
-      r2.p = yr_notebook_alloc(it_notebook, sizeof(YR_ITERATOR));
+      r2.p = yr_notebook_alloc(context->notebook, sizeof(YR_ITERATOR));
 
       if (r2.p == NULL)
       {
@@ -522,12 +701,12 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_DICT:
+    OPCODE(OP_ITER_START_DICT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_START_DICT: // %s()\n", __FUNCTION__);
-      r2.p = yr_notebook_alloc(it_notebook, sizeof(YR_ITERATOR));
+      r2.p = yr_notebook_alloc(context->notebook, sizeof(YR_ITERATOR));
 
       if (r2.p == NULL)
       {
@@ -543,14 +722,14 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_INT_RANGE:
+    OPCODE(OP_ITER_START_INT_RANGE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_START_INT_RANGE: // %s()\n", __FUNCTION__);
       // Creates an iterator for an integer range. The higher bound of the
       // range is at the top of the stack followed by the lower bound.
-      r3.p = yr_notebook_alloc(it_notebook, sizeof(YR_ITERATOR));
+      r3.p = yr_notebook_alloc(context->notebook, sizeof(YR_ITERATOR));
 
       if (r3.p == NULL)
       {
@@ -567,9 +746,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_INT_ENUM:
+    OPCODE(OP_ITER_START_INT_ENUM):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_START_INT_ENUM: // %s()\n", __FUNCTION__);
       // Creates an iterator for an integer enumeration. The number of items
@@ -578,7 +757,8 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       pop(r1);
 
       r3.p = yr_notebook_alloc(
-          it_notebook, sizeof(YR_ITERATOR) + sizeof(uint64_t) * (size_t) r1.i);
+          context->notebook,
+          sizeof(YR_ITERATOR) + sizeof(uint64_t) * (size_t) r1.i);
 
       if (r3.p == NULL)
       {
@@ -600,9 +780,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_STRING_SET:
+    OPCODE(OP_ITER_START_STRING_SET):
       YR_DEBUG_FPRINTF(
           2,
           stderr,
@@ -612,7 +792,7 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       pop(r1);
 
       r3.p = yr_notebook_alloc(
-          it_notebook,
+          context->notebook,
           sizeof(YR_ITERATOR) + sizeof(YR_STRING*) * (size_t) r1.i);
 
       if (r3.p == NULL)
@@ -637,9 +817,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_START_TEXT_STRING_SET:
+    OPCODE(OP_ITER_START_TEXT_STRING_SET):
       YR_DEBUG_FPRINTF(
           2,
           stderr,
@@ -649,7 +829,7 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       pop(r1);
 
       r3.p = yr_notebook_alloc(
-          it_notebook,
+          context->notebook,
           sizeof(YR_ITERATOR) + sizeof(SIZED_STRING*) * (size_t) r1.i);
 
       if (r3.p == NULL)
@@ -672,9 +852,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_NEXT:
+    OPCODE(OP_ITER_NEXT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_NEXT: // %s()\n", __FUNCTION__);
       // Loads the iterator in r1, but leaves the iterator in the stack.
@@ -697,9 +877,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       stop = (result != ERROR_SUCCESS);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_CONDITION:
+    OPCODE(OP_ITER_CONDITION):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_CONDITION: // %s()\n", __FUNCTION__);
 
@@ -731,9 +911,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       // the last expression result
       push(r1);
       push(r4);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ITER_END:
+    OPCODE(OP_ITER_END):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ITER_END: // %s()\n", __FUNCTION__);
 
@@ -765,16 +945,16 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH:
+    OPCODE(OP_PUSH):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_PUSH: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_8:
+    OPCODE(OP_PUSH_8):
       r1.i = *ip;
       YR_DEBUG_FPRINTF(
           2,
@@ -784,9 +964,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
           __FUNCTION__);
       ip += sizeof(uint8_t);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_16:
+    OPCODE(OP_PUSH_16):
       r1.i = yr_unaligned_u16(ip);
       YR_DEBUG_FPRINTF(
           2,
@@ -796,9 +976,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
           __FUNCTION__);
       ip += sizeof(uint16_t);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_32:
+    OPCODE(OP_PUSH_32):
       r1.i = yr_unaligned_u32(ip);
       YR_DEBUG_FPRINTF(
           2,
@@ -808,20 +988,20 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
           __FUNCTION__);
       ip += sizeof(uint32_t);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_U:
+    OPCODE(OP_PUSH_U):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_PUSH_U: // %s()\n", __FUNCTION__);
       r1.i = YR_UNDEFINED;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_POP:
+    OPCODE(OP_POP):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_POP: // %s()\n", __FUNCTION__);
       pop(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_CLEAR_M:
+    OPCODE(OP_CLEAR_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_CLEAR_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -829,9 +1009,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_mem(r1.i);
 #endif
       mem[r1.i].i = 0;
-      break;
+      NEXT_OPCODE;
 
-    case OP_ADD_M:
+    OPCODE(OP_ADD_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_ADD_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -841,9 +1021,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       pop(r2);
       if (!is_undef(r2))
         mem[r1.i].i += r2.i;
-      break;
+      NEXT_OPCODE;
 
-    case OP_INCR_M:
+    OPCODE(OP_INCR_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INCR_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -851,9 +1031,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_mem(r1.i);
 #endif
       mem[r1.i].i++;
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_M:
+    OPCODE(OP_PUSH_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_PUSH_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -862,9 +1042,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 #endif
       r1 = mem[r1.i];
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_POP_M:
+    OPCODE(OP_POP_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_POP_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -873,9 +1053,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 #endif
       pop(r2);
       mem[r1.i] = r2;
-      break;
+      NEXT_OPCODE;
 
-    case OP_SET_M:
+    OPCODE(OP_SET_M):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_SET_M: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -886,9 +1066,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       push(r2);
       if (!is_undef(r2))
         mem[r1.i] = r2;
-      break;
+      NEXT_OPCODE;
 
-    case OP_SWAPUNDEF:
+    OPCODE(OP_SWAPUNDEF):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_SWAPUNDEF: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
@@ -907,95 +1087,95 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       {
         push(r2);
       }
-      break;
+      NEXT_OPCODE;
 
-    case OP_JNUNDEF:
+    OPCODE(OP_JNUNDEF):
       // Jump if the top the stack is not undefined without modifying the stack.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JNUNDEF: // %s()\n", __FUNCTION__);
       pop(r1);
       push(r1);
       ip = jmp_if(!is_undef(r1), ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JUNDEF_P:
+    OPCODE(OP_JUNDEF_P):
       // Removes a value from the top of the stack and jump if the value is not
       // undefined.
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_JUNDEF_P: // %s()\n", __FUNCTION__);
       pop(r1);
       ip = jmp_if(is_undef(r1), ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JL_P:
+    OPCODE(OP_JL_P):
       // Pops two values A and B from the stack and jump if A < B. B is popped
       // first, and then A.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JL_P: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
       ip = jmp_if(r1.i < r2.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JLE_P:
+    OPCODE(OP_JLE_P):
       // Pops two values A and B from the stack and jump if A <= B. B is popped
       // first, and then A.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JLE_P: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
       ip = jmp_if(r1.i <= r2.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JTRUE:
+    OPCODE(OP_JTRUE):
       // Jump if the top of the stack is true without modifying the stack. If
       // the top of the stack is undefined the jump is not taken.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JTRUE: // %s()\n", __FUNCTION__);
       pop(r1);
       push(r1);
       ip = jmp_if(!is_undef(r1) && r1.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JTRUE_P:
+    OPCODE(OP_JTRUE_P):
       // Removes a value from the stack and jump if it is true. If the value
       // is undefined the jump is not taken.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JTRUE_P: // %s()\n", __FUNCTION__);
       pop(r1);
       ip = jmp_if(!is_undef(r1) && r1.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JFALSE:
+    OPCODE(OP_JFALSE):
       // Jump if the top of the stack is false without modifying the stack. If
       // the top of the stack is undefined the jump is not taken.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JFALSE: // %s()\n", __FUNCTION__);
       pop(r1);
       push(r1);
       ip = jmp_if(!is_undef(r1) && !r1.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JFALSE_P:
+    OPCODE(OP_JFALSE_P):
       // Removes a value from the stack and jump if it is false. If the value
       // is undefined the jump is not taken.
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_JFALSE_P: // %s()\n", __FUNCTION__);
       pop(r1);
       ip = jmp_if(!is_undef(r1) && !r1.i, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JZ:
+    OPCODE(OP_JZ):
       // Jump if the value at the top of the stack is 0 without modifying the
       // stack.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JZ: // %s()\n", __FUNCTION__);
       pop(r1);
       push(r1);
       ip = jmp_if(r1.i == 0, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_JZ_P:
+    OPCODE(OP_JZ_P):
       // Removes a value from the stack and jump if the value is 0.
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_JZ_P: // %s()\n", __FUNCTION__);
       pop(r1);
       ip = jmp_if(r1.i == 0, ip);
-      break;
+      NEXT_OPCODE;
 
-    case OP_AND:
+    OPCODE(OP_AND):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_AND: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1008,9 +1188,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       r1.i = r1.i && r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OR:
+    OPCODE(OP_OR):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_OR: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1023,9 +1203,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       r1.i = r1.i || r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_NOT:
+    OPCODE(OP_NOT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_NOT: // %s()\n", __FUNCTION__);
       pop(r1);
 
@@ -1035,15 +1215,15 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
         r1.i = !r1.i;
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DEFINED:
+    OPCODE(OP_DEFINED):
       pop(r1);
       r1.i = !is_undef(r1);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_MOD:
+    OPCODE(OP_MOD):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_MOD: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1056,9 +1236,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       else
         r1.i = r1.i % r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_SHR:
+    OPCODE(OP_SHR):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_SHR: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1071,9 +1251,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       else
         r1.i = 0;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_SHL:
+    OPCODE(OP_SHL):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_SHL: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1086,18 +1266,18 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       else
         r1.i = 0;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_BITWISE_NOT:
+    OPCODE(OP_BITWISE_NOT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_BITWISE_NOT: // %s()\n", __FUNCTION__);
       pop(r1);
       ensure_defined(r1);
       r1.i = ~r1.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_BITWISE_AND:
+    OPCODE(OP_BITWISE_AND):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_BITWISE_AND: // %s()\n", __FUNCTION__);
       pop(r2);
@@ -1106,9 +1286,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i & r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_BITWISE_OR:
+    OPCODE(OP_BITWISE_OR):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_BITWISE_OR: // %s()\n", __FUNCTION__);
       pop(r2);
@@ -1117,9 +1297,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i | r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_BITWISE_XOR:
+    OPCODE(OP_BITWISE_XOR):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_BITWISE_XOR: // %s()\n", __FUNCTION__);
       pop(r2);
@@ -1128,9 +1308,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i ^ r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_PUSH_RULE:
+    OPCODE(OP_PUSH_RULE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_PUSH_RULE: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
@@ -1151,9 +1331,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r2);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INIT_RULE:
+    OPCODE(OP_INIT_RULE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_INIT_RULE: // %s()\n", __FUNCTION__);
 
@@ -1189,9 +1369,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
         ip += sizeof(uint32_t);
       }
 
-      break;
+      NEXT_OPCODE;
 
-    case OP_MATCH_RULE:
+    OPCODE(OP_MATCH_RULE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_MATCH_RULE: // %s()\n", __FUNCTION__);
       pop(r1);
@@ -1217,9 +1397,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 #endif
 
       assert(stack.sp == 0);  // at this point the stack should be empty.
-      break;
+      NEXT_OPCODE;
 
-    case OP_OBJ_LOAD:
+    OPCODE(OP_OBJ_LOAD):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_OBJ_LOAD: // %s()\n", __FUNCTION__);
 
@@ -1235,9 +1415,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       assert(r1.o != NULL);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OBJ_FIELD:
+    OPCODE(OP_OBJ_FIELD):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_OBJ_FIELD: // %s()\n", __FUNCTION__);
 
@@ -1261,9 +1441,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OBJ_VALUE:
+    OPCODE(OP_OBJ_VALUE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_OBJ_VALUE: // %s()\n", __FUNCTION__);
       pop(r1);
@@ -1298,9 +1478,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INDEX_ARRAY:
+    OPCODE(OP_INDEX_ARRAY):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_INDEX_ARRAY: // %s()\n", __FUNCTION__);
       pop(r1);  // index
@@ -1321,9 +1501,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
         r1.i = YR_UNDEFINED;
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_LOOKUP_DICT:
+    OPCODE(OP_LOOKUP_DICT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_LOOKUP_DICT: // %s()\n", __FUNCTION__);
       pop(r1);  // key
@@ -1344,9 +1524,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
         r1.i = YR_UNDEFINED;
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_CALL:
+    OPCODE(OP_CALL):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_CALL: // %s()\n", __FUNCTION__);
 
       args_fmt = yr_unaligned_char_ptr(ip);
@@ -1415,30 +1595,22 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       // Make a copy of the returned object and push the copy into the stack,
       // function->return_obj can't be pushed because it can change in
-      // subsequent calls to the same function.
+      // subsequent calls to the same function. The copy is allocated from
+      // the same notebook than the module's objects, so it doesn't need to
+      // be destroyed explicitly.
       if (result == ERROR_SUCCESS)
         result = yr_object_copy(function->return_obj, &r1.o);
 
-      // A pointer to the copied object is stored in a arena in order to
-      // free the object before exiting yr_execute_code, obj_count tracks
-      // the number of objects written.
-      if (result == ERROR_SUCCESS)
-      {
-        result = yr_arena_write_data(obj_arena, 0, &r1.o, sizeof(r1.o), NULL);
-        obj_count++;
-      }
-      else
-      {
+      if (result != ERROR_SUCCESS)
         r1.i = YR_UNDEFINED;
-      }
 
       stop = (result != ERROR_SUCCESS);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_FOUND:
+    OPCODE(OP_FOUND):
       pop(r1);
-      r2.i = context->matches[r1.s->idx].tail != NULL ? 1 : 0;
+      r2.i = context->matches[r1.s->idx].count > 0 ? 1 : 0;
       YR_DEBUG_FPRINTF(
           2,
           stderr,
@@ -1446,9 +1618,22 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
           r2.i,
           __FUNCTION__);
       push(r2);
-      break;
+      NEXT_OPCODE;
+
+    OPCODE(OP_FOUND_STRING):
+      r1.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      r2.i = context->matches[r1.s->idx].count > 0 ? 1 : 0;
+      YR_DEBUG_FPRINTF(
+          2,
+          stderr,
+          "- case OP_FOUND_STRING: r2.i=%" PRId64 " // %s()\n",
+          r2.i,
+          __FUNCTION__);
+      push(r2);
+      NEXT_OPCODE;
 
-    case OP_FOUND_AT:
+    OPCODE(OP_FOUND_AT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_FOUND_AT: // %s()\n", __FUNCTION__);
       pop(r2);
@@ -1460,27 +1645,20 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_rules_arena(r2.p);
 #endif
 
-      match = context->matches[r2.s->idx].head;
+      matches = &context->matches[r2.s->idx];
+      i = yr_matches_lower_bound(matches, r1.i);
       r3.i = false;
 
-      while (match != NULL)
+      if (i < matches->count)
       {
-        if (r1.i == match->base + match->offset)
-        {
-          r3.i = true;
-          break;
-        }
-
-        if (r1.i < match->base + match->offset)
-          break;
-
-        match = match->next;
+        match = yr_matches_get(matches, i);
+        r3.i = r1.i == match->base + match->offset;
       }
 
       push(r3);
-      break;
+      NEXT_OPCODE;
 
-    case OP_FOUND_IN:
+    OPCODE(OP_FOUND_IN):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_FOUND_IN: // %s()\n", __FUNCTION__);
       pop(r3);
@@ -1494,27 +1672,20 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_rules_arena(r3.p);
 #endif
 
-      match = context->matches[r3.s->idx].head;
+      matches = &context->matches[r3.s->idx];
+      i = yr_matches_lower_bound(matches, r1.i);
       r4.i = false;
 
-      while (match != NULL && !r4.i)
+      if (i < matches->count)
       {
-        if (match->base + match->offset >= r1.i &&
-            match->base + match->offset <= r2.i)
-        {
-          r4.i = true;
-        }
-
-        if (match->base + match->offset > r2.i)
-          break;
-
-        match = match->next;
+        match = yr_matches_get(matches, i);
+        r4.i = match->base + match->offset <= r2.i;
       }
 
       push(r4);
-      break;
+      NEXT_OPCODE;
 
-    case OP_COUNT:
+    OPCODE(OP_COUNT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_COUNT: // %s()\n", __FUNCTION__);
       pop(r1);
 
@@ -1524,9 +1695,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       r2.i = context->matches[r1.s->idx].count;
       push(r2);
-      break;
+      NEXT_OPCODE;
 
-    case OP_COUNT_IN:
+    OPCODE(OP_COUNT_IN):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_COUNT_IN: // %s()\n", __FUNCTION__);
       pop(r3);
@@ -1540,27 +1711,23 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_rules_arena(r3.p);
 #endif
 
-      match = context->matches[r3.s->idx].head;
+      matches = &context->matches[r3.s->idx];
       r4.i = 0;
 
-      while (match != NULL)
+      for (i = yr_matches_lower_bound(matches, r1.i); i < matches->count; i++)
       {
-        if (match->base + match->offset >= r1.i &&
-            match->base + match->offset <= r2.i)
-        {
-          r4.i++;
-        }
+        match = yr_matches_get(matches, i);
 
         if (match->base + match->offset > r2.i)
           break;
 
-        match = match->next;
+        r4.i++;
       }
 
       push(r4);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OFFSET:
+    OPCODE(OP_OFFSET):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_OFFSET: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1571,24 +1738,20 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_rules_arena(r2.p);
 #endif
 
-      match = context->matches[r2.s->idx].head;
-
-      i = 1;
+      matches = &context->matches[r2.s->idx];
       r3.i = YR_UNDEFINED;
 
-      while (match != NULL && r3.i == YR_UNDEFINED)
+      // Match indexes in the condition start at 1.
+      if (r1.i >= 1 && r1.i <= matches->count)
       {
-        if (r1.i == i)
-          r3.i = match->base + match->offset;
-
-        i++;
-        match = match->next;
+        match = yr_matches_get(matches, (int32_t) r1.i - 1);
+        r3.i = match->base + match->offset;
       }
 
       push(r3);
-      break;
+      NEXT_OPCODE;
 
-    case OP_LENGTH:
+    OPCODE(OP_LENGTH):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_LENGTH: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1599,25 +1762,20 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_within_rules_arena(r2.p);
 #endif
 
-      match = context->matches[r2.s->idx].head;
-
-      i = 1;
+      matches = &context->matches[r2.s->idx];
       r3.i = YR_UNDEFINED;
 
-      while (match != NULL && r3.i == YR_UNDEFINED)
+      if (r1.i >= 1 && r1.i <= matches->count)
       {
-        if (r1.i == i)
-          r3.i = match->match_length;
-
-        i++;
-        match = match->next;
+        match = yr_matches_get(matches, (int32_t) r1.i - 1);
+        r3.i = match->match_length;
       }
 
       push(r3);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OF:
-    case OP_OF_PERCENT:
+    OPCODE(OP_OF):
+    OPCODE(OP_OF_PERCENT):
       r2.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
       assert(r2.i == OF_STRING_SET || r2.i == OF_RULE_SET);
@@ -1629,7 +1787,7 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       {
         if (r2.i == OF_STRING_SET)
         {
-          if (context->matches[r1.s->idx].tail != NULL)
+          if (context->matches[r1.s->idx].count > 0)
           {
             found++;
           }
@@ -1683,9 +1841,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OF_FOUND_IN:
+    OPCODE(OP_OF_FOUND_IN):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_OF_FOUND_IN: // %s()\n", __FUNCTION__);
 
@@ -1714,25 +1872,18 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 #if YR_PARANOID_EXEC
         ensure_within_rules_arena(r3.p);
 #endif
-        match = context->matches[r3.s->idx].head;
+        // Matches are sorted by offset in increasing order, so the first
+        // match at or after the range start is the only one to look at.
+        matches = &context->matches[r3.s->idx];
+        i = yr_matches_lower_bound(matches, r1.i);
 
-        while (match != NULL)
+        if (i < matches->count)
         {
+          match = yr_matches_get(matches, i);
+
           // String match within range start and range end?
-          if (match->base + match->offset >= r1.i &&
-              match->base + match->offset <= r2.i)
-          {
+          if (match->base + match->offset <= r2.i)
             found++;
-            break;
-          }
-
-          // If current match is past range end, we can stop as matches
-          // are sorted by offset in increasing order, so all remaining
-          // matches are part the range end too.
-          if (match->base + match->offset > r1.i)
-            break;
-
-          match = match->next;
         }
 
         count++;
@@ -1761,9 +1912,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_OF_FOUND_AT:
+    OPCODE(OP_OF_FOUND_AT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_OF_FOUND_AT: // %s()\n", __FUNCTION__);
 
@@ -1790,24 +1941,16 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 #if YR_PARANOID_EXEC
         ensure_within_rules_arena(r1.p);
 #endif
-        match = context->matches[r1.s->idx].head;
+        matches = &context->matches[r1.s->idx];
+        i = yr_matches_lower_bound(matches, r2.i);
 
-        while (match != NULL)
+        // String match at the desired location?
+        if (i < matches->count)
         {
-          // String match at the desired location?
+          match = yr_matches_get(matches, i);
+
           if (match->base + match->offset == r2.i)
-          {
             found++;
-            break;
-          }
-
-          // If current match is past desired location, we can stop as matches
-          // are sorted by offset in increasing order, so all remaining
-          // matches are past it.
-          if (match->base + match->offset > r2.i)
-            break;
-
-          match = match->next;
         }
 
         count++;
@@ -1836,9 +1979,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_FILESIZE:
+    OPCODE(OP_FILESIZE):
       r1.i = context->file_size;
       YR_DEBUG_FPRINTF(
           2,
@@ -1848,102 +1991,102 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
           r1.i == YR_UNDEFINED ? " AKA YR_UNDEFINED" : "",
           __FUNCTION__);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_ENTRYPOINT:
+    OPCODE(OP_ENTRYPOINT):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_ENTRYPOINT: // %s()\n", __FUNCTION__);
       r1.i = context->entry_point;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT8:
+    OPCODE(OP_INT8):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT8: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int8_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT16:
+    OPCODE(OP_INT16):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT16: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int16_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT32:
+    OPCODE(OP_INT32):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT32: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int32_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT8:
+    OPCODE(OP_UINT8):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_UINT8: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint8_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT16:
+    OPCODE(OP_UINT16):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_UINT16: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint16_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT32:
+    OPCODE(OP_UINT32):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_UINT32: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint32_t_little_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT8BE:
+    OPCODE(OP_INT8BE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT8BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int8_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT16BE:
+    OPCODE(OP_INT16BE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT16BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int16_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT32BE:
+    OPCODE(OP_INT32BE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT32BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_int32_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT8BE:
+    OPCODE(OP_UINT8BE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_UINT8BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint8_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT16BE:
+    OPCODE(OP_UINT16BE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_UINT16BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint16_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_UINT32BE:
+    OPCODE(OP_UINT32BE):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_UINT32BE: // %s()\n", __FUNCTION__);
       pop(r1);
       r1.i = read_uint32_t_big_endian(context->iterator, (size_t) r1.i);
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_IMPORT:
+    OPCODE(OP_IMPORT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_IMPORT: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
       ip += sizeof(uint64_t);
@@ -1957,9 +2100,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       if (result != ERROR_SUCCESS)
         stop = true;
 
-      break;
+      NEXT_OPCODE;
 
-    case OP_MATCHES:
+    OPCODE(OP_MATCHES):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_MATCHES: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -1983,9 +2126,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
 
       r1.i = found >= 0;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_TO_DBL:
+    OPCODE(OP_INT_TO_DBL):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_INT_TO_DBL: // %s()\n", __FUNCTION__);
       r1.i = yr_unaligned_u64(ip);
@@ -2006,18 +2149,18 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
         stack.items[stack.sp - r1.i].i = YR_UNDEFINED;
       else
         stack.items[stack.sp - r1.i].d = (double) r2.i;
-      break;
+      NEXT_OPCODE;
 
-    case OP_STR_TO_BOOL:
+    OPCODE(OP_STR_TO_BOOL):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_STR_TO_BOOL: // %s()\n", __FUNCTION__);
       pop(r1);
       ensure_defined(r1);
       r1.i = r1.ss->length > 0;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_EQ:
+    OPCODE(OP_INT_EQ):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_EQ: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2025,9 +2168,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i == r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_NEQ:
+    OPCODE(OP_INT_NEQ):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_NEQ: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2035,9 +2178,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i != r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_LT:
+    OPCODE(OP_INT_LT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_LT: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2045,9 +2188,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i < r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_GT:
+    OPCODE(OP_INT_GT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_GT: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2055,9 +2198,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i > r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_LE:
+    OPCODE(OP_INT_LE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_LE: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2065,9 +2208,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i <= r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_GE:
+    OPCODE(OP_INT_GE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_GE: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2075,9 +2218,75 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i >= r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_EQ_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_EQ_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i == r2.i;
+      push(r1);
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_NEQ_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_NEQ_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i != r2.i;
+      push(r1);
+      NEXT_OPCODE;
 
-    case OP_INT_ADD:
+    OPCODE(OP_INT_LT_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_LT_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i < r2.i;
+      push(r1);
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_GT_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_GT_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i > r2.i;
+      push(r1);
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_LE_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_LE_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i <= r2.i;
+      push(r1);
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_GE_IMM):
+      YR_DEBUG_FPRINTF(
+          2, stderr, "- case OP_INT_GE_IMM: // %s()\n", __FUNCTION__);
+      r2.i = yr_unaligned_u64(ip);
+      ip += sizeof(uint64_t);
+      pop(r1);
+      ensure_defined(r1);
+      r1.i = r1.i >= r2.i;
+      push(r1);
+      NEXT_OPCODE;
+
+    OPCODE(OP_INT_ADD):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_ADD: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2085,9 +2294,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i + r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_SUB:
+    OPCODE(OP_INT_SUB):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_SUB: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2095,9 +2304,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i - r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_MUL:
+    OPCODE(OP_INT_MUL):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_MUL: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2105,9 +2314,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.i * r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_DIV:
+    OPCODE(OP_INT_DIV):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_INT_DIV: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2120,18 +2329,18 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       else
         r1.i = r1.i / r2.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_INT_MINUS:
+    OPCODE(OP_INT_MINUS):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_INT_MINUS: // %s()\n", __FUNCTION__);
       pop(r1);
       ensure_defined(r1);
       r1.i = -r1.i;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_LT:
+    OPCODE(OP_DBL_LT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_LT: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2140,9 +2349,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       else
         r1.i = r1.d < r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_GT:
+    OPCODE(OP_DBL_GT):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_GT: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2150,9 +2359,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.d > r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_LE:
+    OPCODE(OP_DBL_LE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_LE: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2160,9 +2369,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.d <= r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_GE:
+    OPCODE(OP_DBL_GE):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_GE: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2170,9 +2379,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = r1.d >= r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_EQ:
+    OPCODE(OP_DBL_EQ):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_EQ: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2180,9 +2389,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = fabs(r1.d - r2.d) < DBL_EPSILON;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_NEQ:
+    OPCODE(OP_DBL_NEQ):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_NEQ: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2190,9 +2399,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.i = fabs(r1.d - r2.d) >= DBL_EPSILON;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_ADD:
+    OPCODE(OP_DBL_ADD):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_ADD: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2200,9 +2409,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.d = r1.d + r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_SUB:
+    OPCODE(OP_DBL_SUB):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_SUB: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2210,9 +2419,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.d = r1.d - r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_MUL:
+    OPCODE(OP_DBL_MUL):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_MUL: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2220,9 +2429,9 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.d = r1.d * r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_DIV:
+    OPCODE(OP_DBL_DIV):
       YR_DEBUG_FPRINTF(2, stderr, "- case OP_DBL_DIV: // %s()\n", __FUNCTION__);
       pop(r2);
       pop(r1);
@@ -2230,23 +2439,23 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       ensure_defined(r1);
       r1.d = r1.d / r2.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_DBL_MINUS:
+    OPCODE(OP_DBL_MINUS):
       YR_DEBUG_FPRINTF(
           2, stderr, "- case OP_DBL_MINUS: // %s()\n", __FUNCTION__);
       pop(r1);
       ensure_defined(r1);
       r1.d = -r1.d;
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_STR_EQ:
-    case OP_STR_NEQ:
-    case OP_STR_LT:
-    case OP_STR_LE:
-    case OP_STR_GT:
-    case OP_STR_GE:
+    OPCODE(OP_STR_EQ):
+    OPCODE(OP_STR_NEQ):
+    OPCODE(OP_STR_LT):
+    OPCODE(OP_STR_LE):
+    OPCODE(OP_STR_GT):
+    OPCODE(OP_STR_GE):
       pop(r2);
       pop(r1);
 
@@ -2288,15 +2497,15 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    case OP_CONTAINS:
-    case OP_ICONTAINS:
-    case OP_STARTSWITH:
-    case OP_ISTARTSWITH:
-    case OP_ENDSWITH:
-    case OP_IENDSWITH:
-    case OP_IEQUALS:
+    OPCODE(OP_CONTAINS):
+    OPCODE(OP_ICONTAINS):
+    OPCODE(OP_STARTSWITH):
+    OPCODE(OP_ISTARTSWITH):
+    OPCODE(OP_ENDSWITH):
+    OPCODE(OP_IENDSWITH):
+    OPCODE(OP_IEQUALS):
       pop(r2);
       pop(r1);
 
@@ -2343,44 +2552,44 @@ int yr_execute_code(YR_SCAN_CONTEXT* context)
       }
 
       push(r1);
-      break;
+      NEXT_OPCODE;
 
-    default:
+    OPCODE_DEFAULT:
       YR_DEBUG_FPRINTF(
           2, stderr, "- case <unknown instruction>: // %s()\n", __FUNCTION__);
       // Unknown instruction, this shouldn't happen.
       assert(false);
+#if defined(YR_EXEC_COMPUTED_GOTO)
+    } while (0);
+#else
     }
+#endif
 
     // Check for timeout every 100 instruction cycles. If timeout == 0 it means
     // no timeout at all.
 
-    if (context->timeout > 0ULL && ++cycle == 100)
+    if (++cycle >= 100)
     {
-      elapsed_time = yr_stopwatch_elapsed_ns(&context->stopwatch);
-
-      if (elapsed_time > context->timeout)
+      if (context->timeout > 0ULL)
       {
+        elapsed_time = yr_stopwatch_elapsed_ns(&context->stopwatch);
+
+        if (elapsed_time > context->timeout)
+        {
 #ifdef YR_PROFILING_ENABLED
-        context->profiling_info[current_rule_idx].exec_time +=
-            (elapsed_time - start_time);
+          context->profiling_info[current_rule_idx].exec_time +=
+              (elapsed_time - start_time);
 #endif
-        result = ERROR_SCAN_TIMEOUT;
-        stop = true;
+          result = ERROR_SCAN_TIMEOUT;
+          stop = true;
+        }
       }
 
       cycle = 0;
     }
   }
 
-  obj_ptr = yr_arena_get_ptr(obj_arena, 0, 0);
-
-  for (int i = 0; i < obj_count; i++) yr_object_destroy(obj_ptr[i]);
-
-  yr_arena_release(obj_arena);
-  yr_notebook_destroy(it_notebook);
   yr_modules_unload_all(context);
-  yr_free(stack.items);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -1043,6 +1043,12 @@ identifier
                   NULL,
                   NULL);
 
+            // Fields of a module's top-level structure are recorded so that
+            // the module can skip populating the ones no rule reads.
+            if (result == ERROR_SUCCESS && $1.value.object->parent == NULL)
+              result = yr_parser_reference_module_field(
+                  yyscanner, $1.value.object->identifier, $3);
+
             $$.type = EXPRESSION_TYPE_OBJECT;
             $$.value.object = field;
             $$.identifier.ref = ref;
@@ -110,6 +110,24 @@ uint32_t yr_hash(uint32_t seed, const void* buffer, size_t len)
   return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Allocates and frees the memory used by the table's entries, which comes from
+// the table's notebook when it has one.
+//
+static void* _yr_hash_table_alloc(YR_HASH_TABLE* table, size_t size)
+{
+  if (table->notebook != NULL)
+    return yr_notebook_alloc(table->notebook, size);
+
+  return yr_malloc(size);
+}
+
+static void _yr_hash_table_free(YR_HASH_TABLE* table, void* ptr)
+{
+  if (table->notebook == NULL)
+    yr_free(ptr);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Return the value associated to a given key and optionally remove it from
 // the hash table. Key can be any byte sequence, namespace is a null-terminated
@@ -158,10 +176,10 @@ static void* _yr_hash_table_lookup(
           prev_entry->next = entry->next;
 
         if (entry->ns != NULL)
-          yr_free(entry->ns);
+          _yr_hash_table_free(table, entry->ns);
 
-        yr_free(entry->key);
-        yr_free(entry);
+        _yr_hash_table_free(table, entry->key);
+        _yr_hash_table_free(table, entry);
       }
 
       return result;
@@ -175,17 +193,36 @@ static void* _yr_hash_table_lookup(
 }
 
 YR_API int yr_hash_table_create(int size, YR_HASH_TABLE** table)
+{
+  return yr_hash_table_create_in_notebook(size, NULL, table);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Creates a hash table whose memory, including the table itself, is allocated
+// from the given notebook. Such a table goes away when the notebook is reset
+// or destroyed; yr_hash_table_clean and yr_hash_table_destroy still call
+// free_value for each value, but don't free anything else.
+//
+YR_API int yr_hash_table_create_in_notebook(
+    int size,
+    YR_NOTEBOOK* notebook,
+    YR_HASH_TABLE** table)
 {
   YR_HASH_TABLE* new_table;
+  size_t table_size = sizeof(YR_HASH_TABLE) +
+                      size * sizeof(YR_HASH_TABLE_ENTRY*);
   int i;
 
-  new_table = (YR_HASH_TABLE*) yr_malloc(
-      sizeof(YR_HASH_TABLE) + size * sizeof(YR_HASH_TABLE_ENTRY*));
+  if (notebook != NULL)
+    new_table = (YR_HASH_TABLE*) yr_notebook_alloc(notebook, table_size);
+  else
+    new_table = (YR_HASH_TABLE*) yr_malloc(table_size);
 
   if (new_table == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
   new_table->size = size;
+  new_table->notebook = notebook;
 
   for (i = 0; i < size; i++) new_table->buckets[i] = NULL;
 
@@ -218,10 +255,10 @@ YR_API void yr_hash_table_clean(
         free_value(entry->value);
 
       if (entry->ns != NULL)
-        yr_free(entry->ns);
+        _yr_hash_table_free(table, entry->ns);
 
-      yr_free(entry->key);
-      yr_free(entry);
+      _yr_hash_table_free(table, entry->key);
+      _yr_hash_table_free(table, entry);
 
       entry = next_entry;
     }
@@ -235,7 +272,9 @@ YR_API void yr_hash_table_destroy(
     YR_HASH_TABLE_FREE_VALUE_FUNC free_value)
 {
   yr_hash_table_clean(table, free_value);
-  yr_free(table);
+
+  if (table != NULL)
+    _yr_hash_table_free(table, table);
 }
 
 YR_API int yr_hash_table_iterate(
@@ -298,30 +337,35 @@ YR_API int yr_hash_table_add_raw_key(
   YR_HASH_TABLE_ENTRY* entry;
   uint32_t bucket_index;
 
-  entry = (YR_HASH_TABLE_ENTRY*) yr_malloc(sizeof(YR_HASH_TABLE_ENTRY));
+  entry = (YR_HASH_TABLE_ENTRY*) _yr_hash_table_alloc(
+      table, sizeof(YR_HASH_TABLE_ENTRY));
 
   if (entry == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
-  entry->key = yr_malloc(key_length);
+  entry->key = _yr_hash_table_alloc(table, key_length);
 
   if (entry->key == NULL)
   {
-    yr_free(entry);
+    _yr_hash_table_free(table, entry);
     return ERROR_INSUFFICIENT_MEMORY;
   }
 
   if (ns != NULL)
   {
-    entry->ns = yr_strdup(ns);
+    size_t ns_length = strlen(ns) + 1;
+
+    entry->ns = (char*) _yr_hash_table_alloc(table, ns_length);
 
     if (entry->ns == NULL)
     {
-      yr_free(entry->key);
-      yr_free(entry);
+      _yr_hash_table_free(table, entry->key);
+      _yr_hash_table_free(table, entry);
 
       return ERROR_INSUFFICIENT_MEMORY;
     }
+
+    memcpy(entry->ns, ns, ns_length);
   }
   else
   {
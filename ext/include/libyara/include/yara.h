@@ -31,8 +31,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_YARA_H
 
 #include "yara/compiler.h"
+#include "yara/digest.h"
 #include "yara/error.h"
 #include "yara/filemap.h"
+#include "yara/fingerprint.h"
 #include "yara/hash.h"
 #include "yara/libyara.h"
 #include "yara/mem.h"
@@ -0,0 +1,142 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef YR_AC_COMPACT_H
+#define YR_AC_COMPACT_H
+
+#include <yara/integers.h>
+#include <yara/types.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// States with a dense row take this many bytes of table each. The first states
+// in BFS order get dense rows until their total size reaches this budget or
+// their depth exceeds YR_AC_COMPACT_DENSE_DEPTH.
+#ifndef YR_AC_COMPACT_DENSE_BYTES
+#define YR_AC_COMPACT_DENSE_BYTES (1024 * 1024)
+#endif
+
+#ifndef YR_AC_COMPACT_DENSE_DEPTH
+#define YR_AC_COMPACT_DENSE_DEPTH 3
+#endif
+
+// YR_AC_COMPACT is an alternative layout for the Aho-Corasick automaton that
+// is built from the regular transition table when the rules are loaded, if
+// YR_CONFIG_AC_COMPACT_LAYOUT is enabled. States are renumbered in BFS order
+// so that shallow states, where the scanner spends almost all its time, are
+// next to each other. Those states get a dense row with 256 next states in
+// which failure links are already resolved. Deeper states, which usually have
+// a single child, get a sparse row: a 256-bit bitmap of the bytes that have
+// a child plus a popcount rank into a shared array of children. Missing a
+// sparse row follows the failure link, which always ends in a dense row
+// because failure links point to shallower states.
+
+typedef struct YR_AC_SPARSE_ROW YR_AC_SPARSE_ROW;
+typedef struct YR_AC_COMPACT YR_AC_COMPACT;
+
+struct YR_AC_SPARSE_ROW
+{
+  uint64_t bitmap[4];
+
+  // Index in "children" of this state's first child.
+  uint32_t children;
+
+  // State the automaton moves to when the byte has no child.
+  uint32_t failure;
+
+  // Number of children in the bitmap words before each word.
+  uint8_t rank[4];
+
+  uint32_t reserved;
+};
+
+struct YR_AC_COMPACT
+{
+  uint32_t num_states;
+  uint32_t num_dense;
+
+  // num_dense rows of 256 entries each.
+  uint32_t* dense;
+
+  // num_states - num_dense rows, row N belongs to state num_dense + N.
+  YR_AC_SPARSE_ROW* sparse;
+
+  uint32_t* children;
+
+  // Same meaning as YR_RULES.ac_match_table, indexed by the new state numbers.
+  uint32_t* match_table;
+
+  // Total size of the tables above, in bytes.
+  size_t size;
+};
+
+int yr_ac_compact_create(
+    const YR_AC_TRANSITION* transition_table,
+    const uint32_t* match_table,
+    size_t num_slots,
+    YR_AC_COMPACT** compact);
+
+void yr_ac_compact_destroy(YR_AC_COMPACT* compact);
+
+static inline int _yr_ac_compact_popcount(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  return (int) __popcnt64(x);
+#elif defined(_MSC_VER)
+  return (int) (__popcnt((uint32_t) x) + __popcnt((uint32_t) (x >> 32)));
+#else
+  return __builtin_popcountll(x);
+#endif
+}
+
+static inline uint32_t yr_ac_compact_next(
+    const YR_AC_COMPACT* compact,
+    uint32_t state,
+    uint8_t c)
+{
+  while (state >= compact->num_dense)
+  {
+    const YR_AC_SPARSE_ROW* row = &compact->sparse[state - compact->num_dense];
+    uint64_t word = row->bitmap[c >> 6];
+    uint64_t bit = (uint64_t) 1 << (c & 63);
+
+    if (word & bit)
+      return compact->children
+          [row->children + row->rank[c >> 6] +
+           _yr_ac_compact_popcount(word & (bit - 1))];
+
+    state = row->failure;
+  }
+
+  return compact->dense[(size_t) state * 256 + c];
+}
+
+#endif
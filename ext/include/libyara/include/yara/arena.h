@@ -31,13 +31,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_ARENA_H
 
 #include <stddef.h>
+#include <yara/filemap.h>
 #include <yara/integers.h>
 #include <yara/limits.h>
 #include <yara/stream.h>
 
 #define EOL ((size_t) -1)
 
-#define YR_ARENA_FILE_VERSION 21
+#define YR_ARENA_FILE_VERSION 23
+
+// Buffers in the mappable file format (see yr_arena_save_mappable_stream)
+// start at offsets that are multiples of this value, so that each buffer
+// begins on its own page when the file is memory-mapped.
+#define YR_ARENA_MAPPED_ALIGNMENT 4096
 
 #define YR_ARENA_NULL_REF  \
   (YR_ARENA_REF)           \
@@ -162,6 +168,16 @@ struct YR_ARENA
 
   // Tail of the list containing relocation entries.
   YR_RELOC* reloc_list_tail;
+
+  // File mapping backing the arena when it was loaded with
+  // yr_arena_load_mapped, NULL otherwise. Buffers that don't contain any
+  // relocatable pointer are used in place from the read-only mapping, which
+  // means that their pages are shared by every process mapping the same file.
+  YR_MAPPED_FILE* mapped_file;
+
+  // Bit i is set if buffer i points into mapped_file instead of the heap.
+  // Those buffers can't be written nor grown.
+  uint32_t mapped_buffers;
 };
 
 // Creates an arena with the specified number of buffers and takes ownership of
@@ -206,6 +222,11 @@ void* yr_arena_get_ptr(
 
 yr_arena_off_t yr_arena_get_current_offset(YR_ARENA* arena, uint32_t buffer_id);
 
+int yr_arena_truncate(
+    YR_ARENA* arena,
+    uint32_t buffer_id,
+    yr_arena_off_t offset);
+
 int yr_arena_allocate_memory(
     YR_ARENA* arena,
     uint32_t buffer_id,
@@ -250,4 +271,16 @@ int yr_arena_load_stream(YR_STREAM* stream, YR_ARENA** arena);
 
 int yr_arena_save_stream(YR_ARENA* arena, YR_STREAM* stream);
 
+// Saves the arena in the mappable file format. The format is the same as the
+// one produced by yr_arena_save_stream, except for the magic ("YARM") and the
+// buffers, which are padded to YR_ARENA_MAPPED_ALIGNMENT. Buffer offsets in
+// the header are relative to the first byte written to the stream.
+int yr_arena_save_mappable_stream(YR_ARENA* arena, YR_STREAM* stream);
+
+// Loads an arena saved with yr_arena_save_mappable_stream by memory-mapping
+// the file. The arena starts at the given offset within the file. Only the
+// buffers holding relocatable pointers are copied to the heap and patched,
+// the rest are used directly from the mapping.
+int yr_arena_load_mapped(const char* filename, uint64_t offset, YR_ARENA** arena);
+
 #endif  // YR_ARENA_H
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef YR_COMPARE_H
+#define YR_COMPARE_H
+
+#include <stddef.h>
+#include <yara/integers.h>
+#include <yara/utils.h>
+
+// Kernels used for verifying nocase, wide and xor strings after the
+// Aho-Corasick automaton found one of their atoms. Each of them tells whether
+// the first "length" characters of "string" appear at "data", which must have
+// room for "length" bytes, or "length * 2" bytes for the wide variants. Wide
+// characters are the string's bytes followed by a zero, or by the key in the
+// xor case. Characters are compared case-insensitively using yr_lowercase.
+//
+// The kernels are vectorized with AVX2 or SSE2 when the CPU supports them, the
+// implementation is chosen by yr_compare_select_implementation, which must be
+// called once yr_lowercase has been filled. The _scalar variants are the
+// reference the vectorized ones must agree with.
+
+bool yr_compare_nocase(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_wide(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_wide_nocase(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_xor(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key);
+
+bool yr_compare_xor_wide(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key);
+
+bool yr_compare_nocase_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_wide_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_wide_nocase_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length);
+
+bool yr_compare_xor_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key);
+
+bool yr_compare_xor_wide_scalar(
+    const uint8_t* data,
+    const uint8_t* string,
+    size_t length,
+    uint8_t key);
+
+void yr_compare_select_implementation(void);
+
+YR_API const char* yr_compare_implementation(void);
+
+#endif
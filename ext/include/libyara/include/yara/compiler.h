@@ -66,10 +66,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_AC_STATE_MATCHES_TABLE   9
 #define YR_AC_STATE_MATCHES_POOL    10
 #define YR_SUMMARY_SECTION          11
+#define YR_MODULE_FIELDS_SECTION    12
 
 // This is the number of buffers used by the compiler, should match the number
 // of items in the list above.
-#define YR_NUM_SECTIONS 12
+#define YR_NUM_SECTIONS 13
 
 // Number of variables used by loops. This doesn't include user defined
 // variables.
@@ -137,6 +138,13 @@ typedef void (*YR_COMPILER_RE_AST_CALLBACK_FUNC)(
     const RE_AST* re_ast,
     void* user_data);
 
+typedef void (*YR_COMPILER_ATOM_QUALITY_CALLBACK_FUNC)(
+    const YR_RULE* rule,
+    const char* string_identifier,
+    int min_atom_quality,
+    int num_atoms,
+    void* user_data);
+
 typedef struct _YR_FIXUP
 {
   YR_ARENA_REF ref;
@@ -276,6 +284,12 @@ typedef struct _YR_COMPILER
   int loop_index;
   int loop_for_of_var_index;
 
+  // Start and end offsets in YR_CODE_SECTION of the last constant emitted by
+  // yr_parser_emit_push_const. Used for fusing the push with the comparison
+  // that consumes it, last_push_const_end is 0 if there's nothing to fuse.
+  yr_arena_off_t last_push_const_offset;
+  yr_arena_off_t last_push_const_end;
+
   char* file_name_stack[YR_MAX_INCLUDE_DEPTH];
   int file_name_stack_ptr;
 
@@ -293,13 +307,20 @@ typedef struct _YR_COMPILER
   void* user_data;
   void* incl_clbk_user_data;
   void* re_ast_clbk_user_data;
+  void* atom_quality_clbk_user_data;
 
   YR_COMPILER_CALLBACK_FUNC callback;
   YR_COMPILER_INCLUDE_CALLBACK_FUNC include_callback;
   YR_COMPILER_INCLUDE_FREE_FUNC include_free;
   YR_COMPILER_RE_AST_CALLBACK_FUNC re_ast_callback;
+  YR_COMPILER_ATOM_QUALITY_CALLBACK_FUNC atom_quality_callback;
   YR_ATOMS_CONFIG atoms_config;
 
+  // Worst atom quality and number of atoms of the string being declared,
+  // only tracked while an atom quality callback is set.
+  int string_atom_quality;
+  int string_num_atoms;
+
 } YR_COMPILER;
 
 #define yr_compiler_set_error_extra_info(compiler, info) \
@@ -360,6 +381,11 @@ YR_API void yr_compiler_set_re_ast_callback(
     YR_COMPILER_RE_AST_CALLBACK_FUNC re_ast_callback,
     void* user_data);
 
+YR_API void yr_compiler_set_atom_quality_callback(
+    YR_COMPILER* compiler,
+    YR_COMPILER_ATOM_QUALITY_CALLBACK_FUNC atom_quality_callback,
+    void* user_data);
+
 YR_API void yr_compiler_set_atom_quality_table(
     YR_COMPILER* compiler,
     const void* table,
@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef YR_DIGEST_H
+#define YR_DIGEST_H
+
+#include <stddef.h>
+#include <yara/integers.h>
+#include <yara/utils.h>
+
+#define YR_DIGEST_MD5    1
+#define YR_DIGEST_SHA1   2
+#define YR_DIGEST_SHA256 4
+
+#define YR_DIGEST_MD5_LENGTH    16
+#define YR_DIGEST_SHA1_LENGTH   20
+#define YR_DIGEST_SHA256_LENGTH 32
+
+// Hashes data with any combination of MD5, SHA-1 and SHA-256 in a single pass.
+// Data is fed to every requested algorithm a few kilobytes at a time, so each
+// slice is still in the L1 cache when the second and third algorithms read it.
+// SHA-1 and SHA-256 use the SHA extensions when the CPU has them.
+//
+// Usage:
+//
+//   YR_DIGEST_CTX ctx;
+//   YR_DIGEST digest;
+//
+//   yr_digest_init(&ctx, YR_DIGEST_MD5 | YR_DIGEST_SHA256);
+//   yr_digest_update(&ctx, data, length);
+//   yr_digest_final(&ctx, &digest);
+//
+typedef struct YR_DIGEST_CTX
+{
+  int algorithms;
+
+  uint32_t md5[4];
+  uint32_t sha1[5];
+  uint32_t sha256[8];
+
+  uint64_t length;
+
+  // Bytes that don't complete a 64-byte block yet.
+  uint8_t buffer[64];
+  size_t buffer_length;
+
+} YR_DIGEST_CTX;
+
+typedef struct YR_DIGEST
+{
+  uint8_t md5[YR_DIGEST_MD5_LENGTH];
+  uint8_t sha1[YR_DIGEST_SHA1_LENGTH];
+  uint8_t sha256[YR_DIGEST_SHA256_LENGTH];
+
+} YR_DIGEST;
+
+YR_API void yr_digest_init(YR_DIGEST_CTX* ctx, int algorithms);
+
+YR_API void yr_digest_update(
+    YR_DIGEST_CTX* ctx,
+    const void* data,
+    size_t length);
+
+// Only the digests of the algorithms passed to yr_digest_init are written.
+YR_API void yr_digest_final(YR_DIGEST_CTX* ctx, YR_DIGEST* digest);
+
+// Computes the SHA-256 of "count" independent buffers. Without the SHA
+// extensions the buffers are hashed eight at a time in the lanes of AVX2
+// registers, a lane that finishes is refilled with the next buffer.
+YR_API void yr_digest_sha256_multi(
+    const uint8_t* const* data,
+    const size_t* lengths,
+    size_t count,
+    uint8_t (*digests)[YR_DIGEST_SHA256_LENGTH]);
+
+// Same as calling yr_digest_update for every context with its own buffer, but
+// without the SHA extensions the SHA-256 of the whole blocks of up to
+// YR_DIGEST_MULTI_MAX contexts at a time is computed in the lanes of AVX2
+// registers. Meant for files hashed side by side a chunk at a time.
+#define YR_DIGEST_MULTI_MAX 64
+
+YR_API void yr_digest_update_multi(
+    YR_DIGEST_CTX* const* ctxs,
+    const uint8_t* const* data,
+    const size_t* lengths,
+    size_t count);
+
+void yr_digest_select_implementation(void);
+
+YR_API const char* yr_digest_implementation(void);
+
+#endif
@@ -125,6 +125,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OP_DEFINED                    77
 #define OP_ITER_START_TEXT_STRING_SET 78
 #define OP_OF_FOUND_AT                79
+#define OP_FOUND_STRING               80
 
 #define _OP_EQ    0
 #define _OP_NEQ   1
@@ -175,6 +176,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OP_STR_GE    (OP_STR_BEGIN + _OP_GE)
 #define OP_STR_END   OP_STR_GE
 
+// Integer comparisons where the right operand is a constant stored in the
+// instruction itself, instead of being pushed by a previous OP_PUSH_*.
+#define OP_INT_IMM_BEGIN 160
+#define OP_INT_EQ_IMM    (OP_INT_IMM_BEGIN + _OP_EQ)
+#define OP_INT_NEQ_IMM   (OP_INT_IMM_BEGIN + _OP_NEQ)
+#define OP_INT_LT_IMM    (OP_INT_IMM_BEGIN + _OP_LT)
+#define OP_INT_GT_IMM    (OP_INT_IMM_BEGIN + _OP_GT)
+#define OP_INT_LE_IMM    (OP_INT_IMM_BEGIN + _OP_LE)
+#define OP_INT_GE_IMM    (OP_INT_IMM_BEGIN + _OP_GE)
+#define OP_INT_IMM_END   OP_INT_GE_IMM
+
 #define IS_INT_OP(x) ((x) >= OP_INT_BEGIN && (x) <= OP_INT_END)
 #define IS_DBL_OP(x) ((x) >= OP_DBL_BEGIN && (x) <= OP_DBL_END)
 #define IS_STR_OP(x) ((x) >= OP_STR_BEGIN && (x) <= OP_STR_END)
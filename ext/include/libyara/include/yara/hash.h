@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stddef.h>
 #include <yara/integers.h>
+#include <yara/notebook.h>
 #include <yara/utils.h>
 
 typedef struct _YR_HASH_TABLE_ENTRY
@@ -50,6 +51,10 @@ typedef struct _YR_HASH_TABLE
 {
   int size;
 
+  // When not NULL the entries are allocated from this notebook and are never
+  // freed individually, see yr_hash_table_create_in_notebook.
+  YR_NOTEBOOK* notebook;
+
   YR_HASH_TABLE_ENTRY* buckets[1];
 
 } YR_HASH_TABLE;
@@ -66,6 +71,12 @@ uint32_t yr_hash(uint32_t seed, const void* buffer, size_t len);
 YR_API int yr_hash_table_create(int size, YR_HASH_TABLE** table);
 
 
+YR_API int yr_hash_table_create_in_notebook(
+    int size,
+    YR_NOTEBOOK* notebook,
+    YR_HASH_TABLE** table);
+
+
 YR_API void yr_hash_table_clean(
     YR_HASH_TABLE* table,
     YR_HASH_TABLE_FREE_VALUE_FUNC free_value);
@@ -72,6 +72,9 @@ typedef enum _YR_CONFIG_NAME
   YR_CONFIG_STACK_SIZE,
   YR_CONFIG_MAX_STRINGS_PER_RULE,
   YR_CONFIG_MAX_MATCH_DATA,
+  // the uint32_t options stay together ahead of the uint64_t one, otherwise
+  // gcc sees a path from yr_set_configuration_uint32 into the uint64_t case
+  YR_CONFIG_AC_COMPACT_LAYOUT,
   YR_CONFIG_MAX_PROCESS_MEMORY_CHUNK,
 
   YR_CONFIG_LAST  // End-of-enum marker, not a configuration
@@ -82,6 +85,7 @@ typedef enum _YR_CONFIG_NAME
 #define DEFAULT_MAX_STRINGS_PER_RULE     10000
 #define DEFAULT_MAX_MATCH_DATA           512
 #define DEFAULT_MAX_PROCESS_MEMORY_CHUNK 1073741824
+#define DEFAULT_AC_COMPACT_LAYOUT        0
 
 YR_API int yr_initialize(void);
 
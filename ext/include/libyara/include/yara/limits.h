@@ -41,12 +41,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_MAX_PATH 4096
 #endif
 
-// Maximum number of threads that can use a YR_RULES structure simultaneously.
-// Increasing this number also increase memory usage as each YR_STRING structure
-// has an array with YR_MAX_THREADS entries for storing pointers to YR_MATCH
-// structures.
-#ifndef YR_MAX_THREADS
-#define YR_MAX_THREADS 32
+// Size assumed for a CPU cache line. The state of each scanner is aligned and
+// padded to this size, so scanners running in different threads never write
+// to the same cache line.
+#ifndef YR_CACHE_LINE_SIZE
+#define YR_CACHE_LINE_SIZE 64
 #endif
 
 // Maximum number of buffers that an arena can have.
@@ -119,6 +118,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_SLOW_STRING_MATCHES 600000
 #endif
 
+// Minimum number of bytes scanned by each thread when a scanner splits a
+// single buffer in ranges scanned in parallel (see yr_scanner_set_threads).
+#ifndef YR_PARALLEL_SCAN_MIN_RANGE
+#define YR_PARALLEL_SCAN_MIN_RANGE (16 * 1024 * 1024)
+#endif
+
 // If size of the input is bigger then 0.2 MB and 0-length atoms are used
 // the scan will have a CALLBACK_MSG_TOO_SLOW_SCANNING.
 #ifndef YR_FILE_SIZE_THRESHOLD
@@ -174,9 +179,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_RE_SCAN_LIMIT 4096
 #endif
 
+// Hex strings whose jumps add up to less than this width are matched by
+// yr_re_hex_exec, which keeps the candidate positions in a fixed-size array
+// of this many entries.
+#ifndef YR_RE_HEX_MAX_POSITIONS
+#define YR_RE_HEX_MAX_POSITIONS 256
+#endif
+
 // Maximum number of fibers
 #ifndef RE_MAX_FIBERS
 #define RE_MAX_FIBERS 1024
 #endif
 
+// Memory budget in bytes for the DFA states built by yr_re_exec in each scan
+// context. When the budget is exhausted every cached state is discarded.
+#ifndef RE_DFA_CACHE_SIZE
+#define RE_DFA_CACHE_SIZE (4 * 1024 * 1024)
+#endif
+
+// Maximum size of a DFA state, in 32-bit words describing its fibers. Programs
+// producing bigger fiber sets are executed with fibers only.
+#ifndef RE_DFA_MAX_STATE_WORDS
+#define RE_DFA_MAX_STATE_WORDS 512
+#endif
+
 #endif
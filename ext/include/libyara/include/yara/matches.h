@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef YR_MATCHES_H
+#define YR_MATCHES_H
+
+#include <yara/integers.h>
+#include <yara/notebook.h>
+#include <yara/types.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The matches for a string are kept in chunks that double in size, chunk N
+// holds YR_MATCHES_FIRST_CHUNK_SIZE << N matches. Chunks are never moved or
+// reallocated, adding a match is appending it to the last chunk, and the
+// chunk holding match I can be computed from I alone, so the I-th match is
+// found in constant time.
+//
+// Matches are usually found in ascending offset order and duplicates, when
+// they happen, are found right after the original match. Both cases are
+// handled when the match is added by comparing it with the last one. A match
+// that goes before the last one marks the string as unsorted, and the
+// matches are sorted, and duplicates removed, by yr_matches_sort once the
+// scanning is finished.
+#define YR_MATCHES_FIRST_CHUNK_BITS 2
+#define YR_MATCHES_FIRST_CHUNK_SIZE (1 << YR_MATCHES_FIRST_CHUNK_BITS)
+
+// With 28 chunks a string can have up to 4 * (2^28 - 1) matches, far beyond
+// YR_MAX_STRING_MATCHES.
+#define YR_MATCHES_MAX_CHUNKS 28
+
+static inline int _yr_matches_log2(uint32_t x)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse(&index, x);
+  return (int) index;
+#else
+  return 31 - __builtin_clz(x);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the match with the given 0-based index, which must be lower than
+// matches->count.
+//
+static inline YR_MATCH* yr_matches_get(const YR_MATCHES* matches, int32_t index)
+{
+  int chunk = _yr_matches_log2(
+      ((uint32_t) index >> YR_MATCHES_FIRST_CHUNK_BITS) + 1);
+
+  return &matches->chunks[chunk][index - YR_MATCHES_FIRST_CHUNK_SIZE *
+                                             ((1 << chunk) - 1)];
+}
+
+int yr_matches_add(
+    YR_MATCHES* matches,
+    YR_NOTEBOOK* notebook,
+    const YR_MATCH* match,
+    bool replace_if_exists);
+
+int yr_matches_sort(YR_MATCHES* matches, bool replace_if_exists);
+
+int32_t yr_matches_lower_bound(const YR_MATCHES* matches, int64_t offset);
+
+#endif
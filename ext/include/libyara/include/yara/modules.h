@@ -322,6 +322,11 @@ int yr_modules_load(const char* module_name, YR_SCAN_CONTEXT* context);
 
 int yr_modules_unload_all(YR_SCAN_CONTEXT* context);
 
+YR_API bool yr_modules_is_field_referenced(
+    YR_SCAN_CONTEXT* context,
+    const char* module_name,
+    const char* field_name);
+
 YR_API YR_MODULE* yr_modules_get_table(void);
 
 #endif
@@ -69,6 +69,12 @@ int yr_object_create(
     YR_OBJECT* parent,
     YR_OBJECT** object);
 
+int yr_object_create_in_notebook(
+    int8_t type,
+    const char* identifier,
+    YR_NOTEBOOK* notebook,
+    YR_OBJECT** object);
+
 void yr_object_set_canary(YR_OBJECT* object, int canary);
 
 int yr_object_function_create(
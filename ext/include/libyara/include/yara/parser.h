@@ -130,6 +130,11 @@ int yr_parser_reduce_external(
 
 int yr_parser_reduce_import(yyscan_t yyscanner, SIZED_STRING* module_name);
 
+int yr_parser_reference_module_field(
+    yyscan_t yyscanner,
+    const char* module_name,
+    const char* field_name);
+
 int yr_parser_reduce_operation(
     yyscan_t yyscanner,
     const char* operation,
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef YR_PREFILTER_H
+#define YR_PREFILTER_H
+
+#include <yara/integers.h>
+#include <yara/types.h>
+#include <yara/utils.h>
+
+// While the Aho-Corasick automaton is in the root state, the only bytes that
+// take it somewhere else are the first bytes of the atoms. A YR_AC_PREFILTER
+// holds that set of bytes (and, when every atom is at least two bytes long,
+// the set of bytes that can follow them) so that the scanner can jump over
+// input that can't start an atom instead of feeding it byte by byte to the
+// automaton. Lookups are vectorized with AVX2 or SSE4.2 when the CPU supports
+// them, the implementation is selected at runtime.
+
+typedef struct YR_AC_PREFILTER YR_AC_PREFILTER;
+
+struct YR_AC_PREFILTER
+{
+  // Byte N is non-zero if byte N leaves the root state.
+  uint8_t first[256];
+
+  // Byte N is non-zero if byte N leaves some depth-1 state. Only used when
+  // use_second is true.
+  uint8_t second[256];
+
+  // Nibble tables used by the vectorized lookups. Entry L of the "low" table
+  // has bit H set if byte (H << 4 | L) belongs to the set, for H in 0..7.
+  // The "high" table does the same for H in 8..15.
+  uint8_t first_low[16];
+  uint8_t first_high[16];
+  uint8_t second_low[16];
+  uint8_t second_high[16];
+
+  bool use_second;
+};
+
+int yr_ac_prefilter_create(
+    const YR_AC_TRANSITION* transition_table,
+    const uint32_t* match_table,
+    YR_AC_PREFILTER** prefilter);
+
+void yr_ac_prefilter_destroy(YR_AC_PREFILTER* prefilter);
+
+size_t yr_ac_prefilter_skip(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size);
+
+size_t yr_ac_prefilter_skip_scalar(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size);
+
+YR_API const char* yr_ac_prefilter_implementation(void);
+
+#endif
@@ -122,6 +122,8 @@ SIZED_STRING* yr_re_ast_extract_literal(RE_AST* re_ast);
 
 int yr_re_ast_has_unbounded_quantifier_for_dot(RE_AST* re_ast);
 
+int64_t yr_re_ast_jump_width(RE_AST* re_ast);
+
 int yr_re_ast_split_at_chaining_point(
     RE_AST* re_ast,
     RE_AST** remainder_re_ast,
@@ -138,6 +140,10 @@ void yr_re_node_append_child(RE_NODE* node, RE_NODE* child);
 
 void yr_re_node_prepend_child(RE_NODE* node, RE_NODE* child);
 
+void yr_re_dfa_cache_destroy(RE_DFA_CACHE* cache);
+
+void yr_re_hex_cache_destroy(RE_HEX_CACHE* cache);
+
 int yr_re_exec(
     YR_SCAN_CONTEXT* context,
     const uint8_t* code,
@@ -160,6 +166,17 @@ int yr_re_fast_exec(
     void* callback_args,
     int* matches);
 
+int yr_re_hex_exec(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    const uint8_t* input_data,
+    size_t input_forwards_size,
+    size_t input_backwards_size,
+    int flags,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args,
+    int* matches);
+
 int yr_re_parse(const char* re_string, RE_AST** re_ast, RE_ERROR* error, int flags);
 
 int yr_re_parse_hex(const char* hex_string, RE_AST** re_ast, RE_ERROR* error);
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define YR_RULES_H
 
 #include <yara/filemap.h>
+#include <yara/matches.h>
 #include <yara/scanner.h>
 #include <yara/types.h>
 #include <yara/utils.h>
@@ -60,14 +61,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   for (string = rule->strings; string != NULL; \
        string = STRING_IS_LAST_IN_RULE(string) ? NULL : string + 1)
 
-#define yr_string_matches_foreach(context, string, match)         \
-  for (match = context->matches[string->idx].head; match != NULL; \
-       match = match->next)                                       \
-    /* private matches are skipped */                             \
-    if (match->is_private)                                        \
-    {                                                             \
-      continue;                                                   \
-    }                                                             \
+#define yr_string_matches_foreach(context, string, match)                    \
+  for (int32_t _match_idx = 0;                                               \
+       _match_idx < context->matches[string->idx].count &&                   \
+       (match = yr_matches_get(&context->matches[string->idx], _match_idx)); \
+       _match_idx++)                                                         \
+    /* private matches are skipped */                                        \
+    if (match->is_private)                                                   \
+    {                                                                        \
+      continue;                                                              \
+    }                                                                        \
     else /* user code block goes here */
 
 #define yr_rules_foreach(rules, rule) \
@@ -122,6 +125,17 @@ YR_API int yr_rules_load(const char* filename, YR_RULES** rules);
 
 YR_API int yr_rules_load_stream(YR_STREAM* stream, YR_RULES** rules);
 
+// Loads rules saved with yr_rules_save_mappable_stream by mapping the file
+// instead of reading it. The rules start at the given offset within the file.
+// The largest tables (Aho-Corasick automaton, string pool, regexp code) are
+// used directly from the read-only mapping and shared between processes.
+YR_API int yr_rules_load_mapped(
+    const char* filename,
+    uint64_t offset,
+    YR_RULES** rules);
+
+YR_API int yr_rules_save_mappable_stream(YR_RULES* rules, YR_STREAM* stream);
+
 YR_API int yr_rules_destroy(YR_RULES* rules);
 
 YR_API int yr_rules_define_integer_variable(
@@ -40,6 +40,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define SCAN_FLAGS_NO_TRYCATCH               4
 #define SCAN_FLAGS_REPORT_RULES_MATCHING     8
 #define SCAN_FLAGS_REPORT_RULES_NOT_MATCHING 16
+#define SCAN_FLAGS_NO_PREFILTER              32
+#define SCAN_FLAGS_NO_RE_DFA                 64
+#define SCAN_FLAGS_FULL_MODULE_DATA          128
 
 int yr_scan_verify_match(
     YR_SCAN_CONTEXT* context,
@@ -49,6 +49,8 @@ YR_API void yr_scanner_set_timeout(YR_SCANNER* scanner, int timeout);
 
 YR_API void yr_scanner_set_flags(YR_SCANNER* scanner, int flags);
 
+YR_API void yr_scanner_set_threads(YR_SCANNER* scanner, int threads);
+
 YR_API int yr_scanner_define_integer_variable(
     YR_SCANNER* scanner,
     const char* identifier,
@@ -91,6 +93,9 @@ YR_API YR_STRING* yr_scanner_last_error_string(YR_SCANNER* scanner);
 YR_API YR_RULE_PROFILING_INFO* yr_scanner_get_profiling_info(
     YR_SCANNER* scanner);
 
+YR_API YR_STRING_PROFILING_INFO* yr_scanner_get_string_profiling_info(
+    YR_SCANNER* scanner);
+
 YR_API void yr_scanner_reset_profiling_info(YR_SCANNER* scanner);
 
 YR_API int yr_scanner_print_profiling_info(YR_SCANNER* scanner);
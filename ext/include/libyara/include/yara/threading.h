@@ -37,6 +37,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 typedef DWORD YR_THREAD_ID;
 typedef DWORD YR_THREAD_STORAGE_KEY;
 typedef HANDLE YR_MUTEX;
+typedef HANDLE YR_THREAD;
+typedef DWORD YR_THREAD_RESULT;
+
+#define YR_THREAD_CALL WINAPI
 
 #define YR_TLS __declspec(thread)
 
@@ -47,13 +51,27 @@ typedef HANDLE YR_MUTEX;
 typedef pthread_t YR_THREAD_ID;
 typedef pthread_key_t YR_THREAD_STORAGE_KEY;
 typedef pthread_mutex_t YR_MUTEX;
+typedef pthread_t YR_THREAD;
+typedef void* YR_THREAD_RESULT;
+
+#define YR_THREAD_CALL
 
 #define YR_TLS __thread
 
 #endif
 
+// Functions passed to yr_thread_create are declared as:
+//
+//   static YR_THREAD_RESULT YR_THREAD_CALL func(void* args)
+//
+// and return 0.
+typedef YR_THREAD_RESULT(YR_THREAD_CALL* YR_THREAD_START_ROUTINE)(void*);
+
 YR_THREAD_ID yr_current_thread_id(void);
 
+int yr_thread_create(YR_THREAD*, YR_THREAD_START_ROUTINE, void*);
+int yr_thread_join(YR_THREAD*);
+
 int yr_mutex_create(YR_MUTEX*);
 int yr_mutex_destroy(YR_MUTEX*);
 int yr_mutex_lock(YR_MUTEX*);
@@ -86,6 +86,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define STRING_FLAGS_PRIVATE       0x100000
 #define STRING_FLAGS_BASE64        0x200000
 #define STRING_FLAGS_BASE64_WIDE   0x400000
+#define STRING_FLAGS_HEX_EXEC      0x800000
 
 #define STRING_IS_HEX(x) (((x)->flags) & STRING_FLAGS_HEXADECIMAL)
 
@@ -115,6 +116,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define STRING_IS_FAST_REGEXP(x) (((x)->flags) & STRING_FLAGS_FAST_REGEXP)
 
+#define STRING_IS_HEX_EXEC(x) (((x)->flags) & STRING_FLAGS_HEX_EXEC)
+
 #define STRING_IS_CHAIN_PART(x) (((x)->flags) & STRING_FLAGS_CHAIN_PART)
 
 #define STRING_IS_CHAIN_TAIL(x) (((x)->flags) & STRING_FLAGS_CHAIN_TAIL)
@@ -162,6 +165,8 @@ typedef struct RE_FIBER_POOL RE_FIBER_POOL;
 typedef struct RE_FAST_EXEC_POSITION RE_FAST_EXEC_POSITION;
 typedef struct RE_FAST_EXEC_POSITION_LIST RE_FAST_EXEC_POSITION_LIST;
 typedef struct RE_FAST_EXEC_POSITION_POOL RE_FAST_EXEC_POSITION_POOL;
+typedef struct RE_DFA_CACHE RE_DFA_CACHE;
+typedef struct RE_HEX_CACHE RE_HEX_CACHE;
 
 typedef struct YR_AC_STATE YR_AC_STATE;
 typedef struct YR_AC_AUTOMATON YR_AC_AUTOMATON;
@@ -172,13 +177,17 @@ typedef struct YR_AC_MATCH YR_AC_MATCH;
 typedef struct YR_NAMESPACE YR_NAMESPACE;
 typedef struct YR_META YR_META;
 typedef struct YR_MATCHES YR_MATCHES;
+typedef struct YR_MATCH_LIST YR_MATCH_LIST;
 typedef struct YR_STRING YR_STRING;
 typedef struct YR_RULE YR_RULE;
 typedef struct YR_RULES YR_RULES;
 typedef struct YR_SUMMARY YR_SUMMARY;
 typedef struct YR_RULES_STATS YR_RULES_STATS;
+typedef struct YR_AC_PREFILTER YR_AC_PREFILTER;
+typedef struct YR_AC_COMPACT YR_AC_COMPACT;
 typedef struct YR_PROFILING_INFO YR_PROFILING_INFO;
 typedef struct YR_RULE_PROFILING_INFO YR_RULE_PROFILING_INFO;
+typedef struct YR_STRING_PROFILING_INFO YR_STRING_PROFILING_INFO;
 typedef struct YR_EXTERNAL_VARIABLE YR_EXTERNAL_VARIABLE;
 typedef struct YR_MATCH YR_MATCH;
 typedef struct YR_SCAN_CONTEXT YR_SCAN_CONTEXT;
@@ -473,7 +482,25 @@ struct YR_MODIFIER
   SIZED_STRING* alphabet;
 };
 
+// Matches found for a string, sorted by offset. See yara/matches.h for how
+// they are stored and use yr_matches_get for accessing them.
 struct YR_MATCHES
+{
+  // Array of YR_MATCHES_MAX_CHUNKS pointers to chunks of matches, allocated
+  // when the first match is added.
+  YR_MATCH** chunks;
+
+  int32_t count;
+
+  // True if some match was added out of order, the matches must be sorted
+  // with yr_matches_sort before using them.
+  bool unsorted;
+};
+
+// Doubly linked list of unconfirmed matches, sorted by offset. Unlike the
+// confirmed ones, unconfirmed matches are removed from the list while the
+// scan progresses.
+struct YR_MATCH_LIST
 {
   YR_MATCH* head;
   YR_MATCH* tail;
@@ -493,6 +520,7 @@ struct YR_MATCH
   // to YR_CONFIG_MAX_MATCH_DATA bytes.
   const uint8_t* data;
 
+  // Used only by unconfirmed matches, which are kept in a YR_MATCH_LIST.
   YR_MATCH* prev;
   YR_MATCH* next;
 
@@ -613,11 +641,24 @@ struct YR_RULES
   // match resides.
   uint32_t* ac_match_table;
 
+  // Set of bytes that make the automaton leave its root state, used by the
+  // scanner to skip input. NULL if the automaton can't be prefiltered.
+  YR_AC_PREFILTER* ac_prefilter;
+
+  // Compact layout of the automaton, NULL unless YR_CONFIG_AC_COMPACT_LAYOUT
+  // was enabled when the rules were loaded. When present the scanner uses it
+  // instead of ac_transition_table and ac_match_table.
+  YR_AC_COMPACT* ac_compact;
+
   // Pointer to the first instruction that is executed whan evaluating the
   // conditions for all rules. The code is executed by yr_execute_code and
   // the instructions are defined by the OP_X macros in exec.h.
   const uint8_t* code_start;
 
+  // Sequence of null-terminated "module.field" strings, ending with an empty
+  // string, naming the top-level module fields read by the conditions.
+  const char* module_fields;
+
   // A bitmap with one bit per rule, bit N is set when the condition for rule
   // might evaluate to true even without any string matches.
   YR_BITMASK* no_required_strings;
@@ -692,6 +733,17 @@ struct YR_RULE_PROFILING_INFO
   uint64_t cost;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// YR_STRING_PROFILING_INFO is the structure returned by
+// yr_scanner_get_string_profiling_info
+//
+struct YR_STRING_PROFILING_INFO
+{
+  YR_STRING* string;
+  uint32_t atom_matches;
+  uint64_t cost;
+};
+
 typedef const uint8_t* (*YR_MEMORY_BLOCK_FETCH_DATA_FUNC)(
     YR_MEMORY_BLOCK* self);
 
@@ -771,6 +823,11 @@ struct YR_SCAN_CONTEXT
   // Scan timeout in nanoseconds.
   uint64_t timeout;
 
+  // Maximum number of threads used for scanning a single buffer, buffers
+  // smaller than 2 * YR_PARALLEL_SCAN_MIN_RANGE are always scanned by the
+  // calling thread alone. See yr_scanner_set_threads.
+  int threads;
+
   // Pointer to user-provided data passed to the callback function.
   void* user_data;
 
@@ -791,9 +848,10 @@ struct YR_SCAN_CONTEXT
   // contains entries for external variables and modules.
   YR_HASH_TABLE* objects_table;
 
-  // Notebook used for storing YR_MATCH structures associated to the matches
-  // found.
-  YR_NOTEBOOK* matches_notebook;
+  // Notebook holding the memory that lives as long as a scan: the YR_MATCH
+  // structures associated to the matches found, module objects, iterators
+  // and the evaluation stack. Reset at the start of every scan.
+  YR_NOTEBOOK* notebook;
 
   // Stopwatch used for measuring the time elapsed during the scan.
   YR_STOPWATCH stopwatch;
@@ -804,6 +862,14 @@ struct YR_SCAN_CONTEXT
   // Pool used by yr_re_fast_exec.
   RE_FAST_EXEC_POSITION_POOL re_fast_exec_position_pool;
 
+  // States of the lazily built DFAs used by yr_re_exec, created on the first
+  // regexp execution and kept across scans done with the same scanner.
+  RE_DFA_CACHE* re_dfa_cache;
+
+  // Hex strings decoded by yr_re_hex_exec, created on the first execution and
+  // kept across scans done with the same scanner.
+  RE_HEX_CACHE* re_hex_cache;
+
   // A bitmap with one bit per rule, bit N is set when the rule with index N
   // has matched.
   YR_BITMASK* rule_matches_flags;
@@ -816,8 +882,8 @@ struct YR_SCAN_CONTEXT
   // N has too many matches.
   YR_BITMASK* strings_temp_disabled;
 
-  // Array with pointers to lists of matches. Item N in the array has the
-  // list of matches for string with index N.
+  // Array with the matches of each string. Item N in the array has the
+  // matches for string with index N.
   YR_MATCHES* matches;
 
   // "unconfirmed_matches" is like "matches" but for strings that are part of
@@ -826,7 +892,7 @@ struct YR_SCAN_CONTEXT
   // until a match for S2 is found (within the range defined by chain_gap_min
   // and chain_gap_max), so the matches for S1 are put in "unconfirmed_matches"
   // until they can be confirmed or discarded.
-  YR_MATCHES* unconfirmed_matches;
+  YR_MATCH_LIST* unconfirmed_matches;
 
   // A bitmap with one bit per rule, bit N is set if the corresponding rule
   // must evaluated.
@@ -835,6 +901,14 @@ struct YR_SCAN_CONTEXT
   // profiling_info is a pointer to an array of YR_PROFILING_INFO structures,
   // one per rule. Entry N has the profiling information for rule with index N.
   YR_PROFILING_INFO* profiling_info;
+
+  // string_profiling_info is a pointer to an array of YR_PROFILING_INFO
+  // structures, one per string. Only atom_matches and match_time are used.
+  YR_PROFILING_INFO* string_profiling_info;
+
+  // Memory block returned by yr_calloc that holds this structure and all the
+  // per-rule and per-string arrays above, see yr_scanner_create.
+  void* allocation;
 };
 
 union YR_VALUE
@@ -861,6 +935,7 @@ struct YR_VALUE_STACK
   int8_t type;               \
   const char* identifier;    \
   YR_OBJECT* parent;         \
+  YR_NOTEBOOK* notebook;     \
   void* data;
 
 struct YR_OBJECT
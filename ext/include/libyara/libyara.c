@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include <yara/compare.h>
+#include <yara/digest.h>
 #include <yara/error.h>
 #include <yara/globals.h>
 #include <yara/mem.h>
@@ -246,6 +248,7 @@ YR_API int yr_initialize(void)
   uint32_t def_max_strings_per_rule = DEFAULT_MAX_STRINGS_PER_RULE;
   uint32_t def_max_match_data = DEFAULT_MAX_MATCH_DATA;
   uint64_t def_max_process_memory_chunk = DEFAULT_MAX_PROCESS_MEMORY_CHUNK;
+  uint32_t def_ac_compact_layout = DEFAULT_AC_COMPACT_LAYOUT;
 
   init_count++;
 
@@ -268,6 +271,9 @@ YR_API int yr_initialize(void)
     yr_lowercase[i] = tolower(i);
   }
 
+  yr_compare_select_implementation();
+  yr_digest_select_implementation();
+
   FAIL_ON_ERROR(yr_heap_alloc());
   FAIL_ON_ERROR(yr_thread_storage_create(&yr_yyfatal_trampoline_tls));
   FAIL_ON_ERROR(yr_thread_storage_create(&yr_trycatch_trampoline_tls));
@@ -312,6 +318,9 @@ YR_API int yr_initialize(void)
   FAIL_ON_ERROR(
       yr_set_configuration(YR_CONFIG_MAX_MATCH_DATA, &def_max_match_data));
 
+  FAIL_ON_ERROR(yr_set_configuration(
+      YR_CONFIG_AC_COMPACT_LAYOUT, &def_ac_compact_layout));
+
   YR_DEBUG_FPRINTF(2, stderr, "} // %s()\n", __FUNCTION__);
 
   return ERROR_SUCCESS;
@@ -384,6 +393,7 @@ YR_API int yr_finalize(void)
 //              YR_CONFIG_STACK_SIZE                data type: uint32_t
 //              YR_CONFIG_MAX_STRINGS_PER_RULE      data type: uint32_t
 //              YR_CONFIG_MAX_MATCH_DATA            data type: uint32_t
+//              YR_CONFIG_AC_COMPACT_LAYOUT         data type: uint32_t
 //              YR_CONFIG_MAX_PROCESS_MEMORY_CHUNK  data type: uint64_t
 //
 //   src: Pointer to the value being set for the option.
@@ -402,6 +412,7 @@ YR_API int yr_set_configuration(YR_CONFIG_NAME name, void *src)
   case YR_CONFIG_STACK_SIZE:
   case YR_CONFIG_MAX_STRINGS_PER_RULE:
   case YR_CONFIG_MAX_MATCH_DATA:
+  case YR_CONFIG_AC_COMPACT_LAYOUT:
     yr_cfgs[name].ui32 = *(uint32_t *) src;
     break;
 
@@ -436,6 +447,7 @@ YR_API int yr_set_configuration_uint32(YR_CONFIG_NAME name, uint32_t value)
   case YR_CONFIG_STACK_SIZE:
   case YR_CONFIG_MAX_STRINGS_PER_RULE:
   case YR_CONFIG_MAX_MATCH_DATA:
+  case YR_CONFIG_AC_COMPACT_LAYOUT:
     return yr_set_configuration(name, &value);
   default:
     return ERROR_INVALID_ARGUMENT;
@@ -474,6 +486,7 @@ YR_API int yr_set_configuration_uint64(YR_CONFIG_NAME name, uint64_t value)
 //              YR_CONFIG_STACK_SIZE                data type: uint32_t
 //              YR_CONFIG_MAX_STRINGS_PER_RULE      data type: uint32_t
 //              YR_CONFIG_MAX_MATCH_DATA            data type: uint32_t
+//              YR_CONFIG_AC_COMPACT_LAYOUT         data type: uint32_t
 //              YR_CONFIG_MAX_PROCESS_MEMORY_CHUNK  data type: uint64_t
 //
 //   dest: Pointer to a variable that will receive the value for the option.
@@ -492,6 +505,7 @@ YR_API int yr_get_configuration(YR_CONFIG_NAME name, void *dest)
   case YR_CONFIG_STACK_SIZE:
   case YR_CONFIG_MAX_STRINGS_PER_RULE:
   case YR_CONFIG_MAX_MATCH_DATA:
+  case YR_CONFIG_AC_COMPACT_LAYOUT:
     *(uint32_t *) dest = yr_cfgs[name].ui32;
     break;
 
@@ -526,6 +540,7 @@ YR_API int yr_get_configuration_uint32(YR_CONFIG_NAME name, uint32_t *dest)
   case YR_CONFIG_STACK_SIZE:
   case YR_CONFIG_MAX_STRINGS_PER_RULE:
   case YR_CONFIG_MAX_MATCH_DATA:
+  case YR_CONFIG_AC_COMPACT_LAYOUT:
     return yr_get_configuration(name, (void *) dest);
   default:
     return ERROR_INVALID_ARGUMENT;
@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#include <yara/error.h>
+#include <yara/limits.h>
+#include <yara/matches.h>
+#include <yara/mem.h>
+#include <yara/utils.h>
+
+#define MATCH_OFFSET(m) ((m)->base + (m)->offset)
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds a copy of a match to the string's matches. If a match at the same
+// offset already exists the new one is discarded, unless replace_if_exists is
+// true, in which case the length and data of the existing match are updated.
+// Duplicates are detected here only if the existing match is the last one,
+// the others are removed by yr_matches_sort.
+//
+// Args:
+//   matches: Pointer to the string's matches.
+//   notebook: Notebook from where the chunks are allocated.
+//   match: Match to be added.
+//   replace_if_exists: Whether a new match replaces an existing one.
+//
+// Returns:
+//   ERROR_SUCCESS
+//   ERROR_INSUFFICIENT_MEMORY
+//   ERROR_TOO_MANY_MATCHES
+//
+int yr_matches_add(
+    YR_MATCHES* matches,
+    YR_NOTEBOOK* notebook,
+    const YR_MATCH* match,
+    bool replace_if_exists)
+{
+  if (matches->count > 0)
+  {
+    YR_MATCH* last = yr_matches_get(matches, matches->count - 1);
+
+    if (MATCH_OFFSET(match) == MATCH_OFFSET(last))
+    {
+      if (replace_if_exists)
+      {
+        last->match_length = match->match_length;
+        last->data_length = match->data_length;
+        last->data = match->data;
+      }
+
+      return ERROR_SUCCESS;
+    }
+
+    if (MATCH_OFFSET(match) < MATCH_OFFSET(last))
+      matches->unsorted = true;
+  }
+
+  if (matches->count == YR_MAX_STRING_MATCHES)
+  {
+    if (!matches->unsorted)
+      return ERROR_TOO_MANY_MATCHES;
+
+    // Some of the matches may be duplicates that are removed when sorting,
+    // once sorted the match is added again against the remaining ones.
+    FAIL_ON_ERROR(yr_matches_sort(matches, replace_if_exists));
+
+    return yr_matches_add(matches, notebook, match, replace_if_exists);
+  }
+
+  if (matches->chunks == NULL)
+  {
+    matches->chunks = (YR_MATCH**) yr_notebook_alloc(
+        notebook, YR_MATCHES_MAX_CHUNKS * sizeof(YR_MATCH*));
+
+    if (matches->chunks == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
+
+    memset(matches->chunks, 0, YR_MATCHES_MAX_CHUNKS * sizeof(YR_MATCH*));
+  }
+
+  uint32_t index = (uint32_t) matches->count;
+  int chunk = _yr_matches_log2(
+      (index >> YR_MATCHES_FIRST_CHUNK_BITS) + 1);
+
+  if (chunk >= YR_MATCHES_MAX_CHUNKS)
+    return ERROR_TOO_MANY_MATCHES;
+
+  // The chunk may exist already if yr_matches_sort removed some duplicates.
+  if (matches->chunks[chunk] == NULL)
+  {
+    matches->chunks[chunk] = (YR_MATCH*) yr_notebook_alloc(
+        notebook,
+        (YR_MATCHES_FIRST_CHUNK_SIZE << chunk) * sizeof(YR_MATCH));
+
+    if (matches->chunks[chunk] == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
+  }
+
+  *yr_matches_get(matches, matches->count) = *match;
+  matches->count++;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the matches in ascending offset order and removes the duplicates. The
+// sort is stable, so among the matches at the same offset the one added first
+// is kept, with the length and data of the one added last if
+// replace_if_exists is true, exactly as if yr_matches_add had seen them in
+// order. Does nothing if the matches are already sorted.
+//
+// Returns:
+//   ERROR_SUCCESS
+//   ERROR_INSUFFICIENT_MEMORY
+//
+int yr_matches_sort(YR_MATCHES* matches, bool replace_if_exists)
+{
+  if (!matches->unsorted)
+    return ERROR_SUCCESS;
+
+  int32_t count = matches->count;
+
+  // The matches are copied out of the chunks and sorted through an array of
+  // pointers, "order" and "temp" are the two halves of the merge sort.
+  YR_MATCH* copy = (YR_MATCH*) yr_malloc(count * sizeof(YR_MATCH));
+  YR_MATCH** buffer = (YR_MATCH**) yr_malloc(2 * count * sizeof(YR_MATCH*));
+
+  if (copy == NULL || buffer == NULL)
+  {
+    yr_free(copy);
+    yr_free(buffer);
+    return ERROR_INSUFFICIENT_MEMORY;
+  }
+
+  YR_MATCH** order = buffer;
+  YR_MATCH** temp = buffer + count;
+
+  for (int32_t i = 0; i < count; i++)
+  {
+    copy[i] = *yr_matches_get(matches, i);
+    order[i] = &copy[i];
+  }
+
+  for (int32_t width = 1; width < count; width *= 2)
+  {
+    for (int32_t lo = 0; lo < count; lo += 2 * width)
+    {
+      int32_t mid = yr_min(lo + width, count);
+      int32_t hi = yr_min(lo + 2 * width, count);
+      int32_t i = lo, j = mid, k = lo;
+
+      while (i < mid && j < hi)
+      {
+        if (MATCH_OFFSET(order[j]) < MATCH_OFFSET(order[i]))
+          temp[k++] = order[j++];
+        else
+          temp[k++] = order[i++];
+      }
+
+      while (i < mid) temp[k++] = order[i++];
+      while (j < hi) temp[k++] = order[j++];
+    }
+
+    YR_MATCH** swap = order;
+    order = temp;
+    temp = swap;
+  }
+
+  YR_MATCH* last = NULL;
+  int32_t unique = 0;
+
+  for (int32_t i = 0; i < count; i++)
+  {
+    if (last != NULL && MATCH_OFFSET(order[i]) == MATCH_OFFSET(last))
+    {
+      if (replace_if_exists)
+      {
+        last->match_length = order[i]->match_length;
+        last->data_length = order[i]->data_length;
+        last->data = order[i]->data;
+      }
+
+      continue;
+    }
+
+    last = yr_matches_get(matches, unique++);
+    *last = *order[i];
+  }
+
+  matches->count = unique;
+  matches->unsorted = false;
+
+  yr_free(copy);
+  yr_free(buffer);
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the index of the first match whose offset is greater than or equal
+// to the given one, or matches->count if there's none. The matches must be
+// sorted.
+//
+int32_t yr_matches_lower_bound(const YR_MATCHES* matches, int64_t offset)
+{
+  int32_t lo = 0;
+  int32_t hi = matches->count;
+
+  while (lo < hi)
+  {
+    int32_t mid = lo + (hi - lo) / 2;
+
+    if (MATCH_OFFSET(yr_matches_get(matches, mid)) < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <yara/exec.h>
 #include <yara/libyara.h>
 #include <yara/modules.h>
+#include <yara/scan.h>
 
 #define MODULE(name)                             \
   int name##__declarations(YR_OBJECT* module);   \
@@ -119,8 +120,13 @@ int yr_modules_load(const char* module_name, YR_SCAN_CONTEXT* context)
 
   // not loaded yet
 
-  FAIL_ON_ERROR(yr_object_create(
-      OBJECT_TYPE_STRUCTURE, module_name, NULL, &module_structure));
+  // The module's objects are allocated from the scanner's notebook, they are
+  // discarded all at once when the next scan begins.
+  FAIL_ON_ERROR(yr_object_create_in_notebook(
+      OBJECT_TYPE_STRUCTURE,
+      module_name,
+      context->notebook,
+      &module_structure));
 
   // initialize canary for module's top-level structure, every other object
   // within the module inherits the same canary.
@@ -193,6 +199,33 @@ int yr_modules_unload_all(YR_SCAN_CONTEXT* context)
   return ERROR_SUCCESS;
 }
 
+// Tells a module whether the rules being evaluated read the given top-level
+// field, so that the module can skip parsing data nobody uses. Answers true
+// when the caller asked for full module data with SCAN_FLAGS_FULL_MODULE_DATA,
+// as every field ends up in the structure passed to CALLBACK_MSG_MODULE_IMPORTED.
+YR_API bool yr_modules_is_field_referenced(
+    YR_SCAN_CONTEXT* context,
+    const char* module_name,
+    const char* field_name)
+{
+  if (context->flags & SCAN_FLAGS_FULL_MODULE_DATA ||
+      context->rules == NULL || context->rules->module_fields == NULL)
+    return true;
+
+  size_t module_len = strlen(module_name);
+
+  for (const char* entry = context->rules->module_fields; *entry != '\0';
+       entry += strlen(entry) + 1)
+  {
+    if (strncmp(entry, module_name, module_len) == 0 &&
+        entry[module_len] == '.' &&
+        strcmp(entry + module_len + 1, field_name) == 0)
+      return true;
+  }
+
+  return false;
+}
+
 YR_MODULE* yr_modules_get_table(void)
 {
   return yr_modules_table;
@@ -27,13 +27,12 @@ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <yara/digest.h>
 #include <yara/globals.h>
 #include <yara/mem.h>
 #include <yara/modules.h>
 #include <yara/strutils.h>
 
-#include "../crypto.h"
-
 #define MODULE_NAME hash
 
 typedef struct _CACHE_KEY
@@ -138,7 +137,9 @@ static int add_to_cache(
   CACHE_KEY key;
   YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
 
-  char* copy = yr_strdup(digest);
+  // The cache lives in the scanner's notebook, and so do the digests.
+  size_t digest_length = strlen(digest) + 1;
+  char* copy = (char*) yr_notebook_alloc(hash_table->notebook, digest_length);
 
   key.offset = offset;
   key.length = length;
@@ -146,6 +147,8 @@ static int add_to_cache(
   if (copy == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
+  memcpy(copy, digest, digest_length);
+
   int result = yr_hash_table_add_raw_key(
       hash_table, &key, sizeof(key), ns, (void*) copy);
 
@@ -164,17 +167,17 @@ static int add_to_cache(
 
 define_function(string_md5)
 {
-  unsigned char digest[YR_MD5_LEN];
-  char digest_ascii[YR_MD5_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_MD5_LENGTH * 2 + 1];
 
-  yr_md5_ctx md5_context;
+  YR_DIGEST_CTX digest_context;
   SIZED_STRING* s = sized_string_argument(1);
 
-  yr_md5_init(&md5_context);
-  yr_md5_update(&md5_context, s->c_string, s->length);
-  yr_md5_final(digest, &md5_context);
+  yr_digest_init(&digest_context, YR_DIGEST_MD5);
+  yr_digest_update(&digest_context, s->c_string, s->length);
+  yr_digest_final(&digest_context, &digest);
 
-  digest_to_ascii(digest, digest_ascii, YR_MD5_LEN);
+  digest_to_ascii(digest.md5, digest_ascii, YR_DIGEST_MD5_LENGTH);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -189,17 +192,17 @@ define_function(string_md5)
 
 define_function(string_sha256)
 {
-  unsigned char digest[YR_SHA256_LEN];
-  char digest_ascii[YR_SHA256_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_SHA256_LENGTH * 2 + 1];
 
-  yr_sha256_ctx sha256_context;
+  YR_DIGEST_CTX digest_context;
   SIZED_STRING* s = sized_string_argument(1);
 
-  yr_sha256_init(&sha256_context);
-  yr_sha256_update(&sha256_context, s->c_string, s->length);
-  yr_sha256_final(digest, &sha256_context);
+  yr_digest_init(&digest_context, YR_DIGEST_SHA256);
+  yr_digest_update(&digest_context, s->c_string, s->length);
+  yr_digest_final(&digest_context, &digest);
 
-  digest_to_ascii(digest, digest_ascii, YR_SHA256_LEN);
+  digest_to_ascii(digest.sha256, digest_ascii, YR_DIGEST_SHA256_LENGTH);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -214,17 +217,17 @@ define_function(string_sha256)
 
 define_function(string_sha1)
 {
-  unsigned char digest[YR_SHA1_LEN];
-  char digest_ascii[YR_SHA1_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_SHA1_LENGTH * 2 + 1];
 
-  yr_sha1_ctx sha_context;
+  YR_DIGEST_CTX digest_context;
   SIZED_STRING* s = sized_string_argument(1);
 
-  yr_sha1_init(&sha_context);
-  yr_sha1_update(&sha_context, s->c_string, s->length);
-  yr_sha1_final(digest, &sha_context);
+  yr_digest_init(&digest_context, YR_DIGEST_SHA1);
+  yr_digest_update(&digest_context, s->c_string, s->length);
+  yr_digest_final(&digest_context, &digest);
 
-  digest_to_ascii(digest, digest_ascii, YR_SHA1_LEN);
+  digest_to_ascii(digest.sha1, digest_ascii, YR_DIGEST_SHA1_LENGTH);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -259,10 +262,10 @@ define_function(string_checksum32)
 
 define_function(data_md5)
 {
-  yr_md5_ctx md5_context;
+  YR_DIGEST_CTX digest_context;
 
-  unsigned char digest[YR_MD5_LEN];
-  char digest_ascii[YR_MD5_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_MD5_LENGTH * 2 + 1];
   char* cached_ascii_digest;
 
   bool past_first_block = false;
@@ -318,7 +321,7 @@ define_function(data_md5)
     return_string(cached_ascii_digest);
   }
 
-  yr_md5_init(&md5_context);
+  yr_digest_init(&digest_context, YR_DIGEST_MD5);
 
   foreach_memory_block(iterator, block)
   {
@@ -337,7 +340,7 @@ define_function(data_md5)
         offset += data_len;
         length -= data_len;
 
-        yr_md5_update(&md5_context, block_data + data_offset, data_len);
+        yr_digest_update(&digest_context, block_data + data_offset, data_len);
       }
 
       past_first_block = true;
@@ -356,8 +359,6 @@ define_function(data_md5)
           "} // %s() = YR_UNDEFINED // past_first_block\n",
           __FUNCTION__);
 
-      yr_md5_final(digest, &md5_context);
-
       return_string(YR_UNDEFINED);
     }
 
@@ -365,7 +366,7 @@ define_function(data_md5)
       break;
   }
 
-  yr_md5_final(digest, &md5_context);
+  yr_digest_final(&digest_context, &digest);
 
   if (!past_first_block)
   {
@@ -378,7 +379,7 @@ define_function(data_md5)
     return_string(YR_UNDEFINED);
   }
 
-  digest_to_ascii(digest, digest_ascii, YR_MD5_LEN);
+  digest_to_ascii(digest.md5, digest_ascii, YR_DIGEST_MD5_LENGTH);
 
   FAIL_ON_ERROR(
       add_to_cache(yr_module(), "md5", arg_offset, arg_length, digest_ascii));
@@ -389,10 +390,10 @@ define_function(data_md5)
 
 define_function(data_sha1)
 {
-  yr_sha1_ctx sha_context;
+  YR_DIGEST_CTX digest_context;
 
-  unsigned char digest[YR_SHA1_LEN];
-  char digest_ascii[YR_SHA1_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_SHA1_LENGTH * 2 + 1];
   char* cached_ascii_digest;
 
   int past_first_block = false;
@@ -449,7 +450,7 @@ define_function(data_sha1)
     return_string(cached_ascii_digest);
   }
 
-  yr_sha1_init(&sha_context);
+  yr_digest_init(&digest_context, YR_DIGEST_SHA1);
 
   foreach_memory_block(iterator, block)
   {
@@ -467,7 +468,7 @@ define_function(data_sha1)
         offset += data_len;
         length -= data_len;
 
-        yr_sha1_update(&sha_context, block_data + data_offset, data_len);
+        yr_digest_update(&digest_context, block_data + data_offset, data_len);
       }
 
       past_first_block = true;
@@ -486,7 +487,6 @@ define_function(data_sha1)
           "} // %s() = YR_UNDEFINED // past_first_block\n",
           __FUNCTION__);
 
-      yr_sha1_final(digest, &sha_context);
       return_string(YR_UNDEFINED);
     }
 
@@ -494,7 +494,7 @@ define_function(data_sha1)
       break;
   }
 
-  yr_sha1_final(digest, &sha_context);
+  yr_digest_final(&digest_context, &digest);
 
   if (!past_first_block)
   {
@@ -507,7 +507,7 @@ define_function(data_sha1)
     return_string(YR_UNDEFINED);
   }
 
-  digest_to_ascii(digest, digest_ascii, YR_SHA1_LEN);
+  digest_to_ascii(digest.sha1, digest_ascii, YR_DIGEST_SHA1_LENGTH);
 
   FAIL_ON_ERROR(
       add_to_cache(yr_module(), "sha1", arg_offset, arg_length, digest_ascii));
@@ -518,10 +518,10 @@ define_function(data_sha1)
 
 define_function(data_sha256)
 {
-  yr_sha256_ctx sha256_context;
+  YR_DIGEST_CTX digest_context;
 
-  unsigned char digest[YR_SHA256_LEN];
-  char digest_ascii[YR_SHA256_LEN * 2 + 1];
+  YR_DIGEST digest;
+  char digest_ascii[YR_DIGEST_SHA256_LENGTH * 2 + 1];
   char* cached_ascii_digest;
 
   int past_first_block = false;
@@ -578,7 +578,7 @@ define_function(data_sha256)
     return_string(cached_ascii_digest);
   }
 
-  yr_sha256_init(&sha256_context);
+  yr_digest_init(&digest_context, YR_DIGEST_SHA256);
 
   foreach_memory_block(iterator, block)
   {
@@ -595,7 +595,7 @@ define_function(data_sha256)
         offset += data_len;
         length -= data_len;
 
-        yr_sha256_update(&sha256_context, block_data + data_offset, data_len);
+        yr_digest_update(&digest_context, block_data + data_offset, data_len);
       }
 
       past_first_block = true;
@@ -614,7 +614,6 @@ define_function(data_sha256)
           "} // %s() = YR_UNDEFINED // past_first_block\n",
           __FUNCTION__);
 
-      yr_sha256_final(digest, &sha256_context);
       return_string(YR_UNDEFINED);
     }
 
@@ -622,7 +621,7 @@ define_function(data_sha256)
       break;
   }
 
-  yr_sha256_final(digest, &sha256_context);
+  yr_digest_final(&digest_context, &digest);
 
   if (!past_first_block)
   {
@@ -635,7 +634,7 @@ define_function(data_sha256)
     return_string(YR_UNDEFINED);
   }
 
-  digest_to_ascii(digest, digest_ascii, YR_SHA256_LEN);
+  digest_to_ascii(digest.sha256, digest_ascii, YR_DIGEST_SHA256_LENGTH);
 
   FAIL_ON_ERROR(
       add_to_cache(yr_module(), "sha256", arg_offset, arg_length, digest_ascii));
@@ -849,7 +848,8 @@ int module_load(
 
   YR_HASH_TABLE* hash_table;
 
-  FAIL_ON_ERROR(yr_hash_table_create(17, &hash_table));
+  FAIL_ON_ERROR(
+      yr_hash_table_create_in_notebook(17, context->notebook, &hash_table));
 
   module_object->data = hash_table;
 
@@ -863,7 +863,7 @@ int module_unload(YR_OBJECT* module_object)
   YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
 
   if (hash_table != NULL)
-    yr_hash_table_destroy(hash_table, (YR_HASH_TABLE_FREE_VALUE_FUNC) yr_free);
+    yr_hash_table_destroy(hash_table, NULL);
 
   return ERROR_SUCCESS;
 }
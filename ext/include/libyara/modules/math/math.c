@@ -29,6 +29,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <yara/cpu.h>
+#include <yara/hash.h>
 #include <yara/mem.h>
 #include <yara/modules.h>
 #include <yara/strutils.h>
@@ -50,28 +53,249 @@ static double log2(double n)
 }
 #endif
 
-uint32_t* get_distribution(
+typedef struct _STATS_KEY
+{
+  int64_t offset;
+  int64_t length;
+
+} STATS_KEY;
+
+// Byte statistics of a data range. Entropy, mean, deviation, count, percentage
+// and mode only need the distribution, serial correlation additionally needs
+// the sum of the products of consecutive bytes. All of them are collected in
+// a single pass over the data, the first time a rule asks for any of them, and
+// kept in the scanner's notebook until the scan ends.
+typedef struct _BYTE_STATS
+{
+  uint32_t distribution[256];
+
+  uint64_t length;
+  uint64_t sum;
+  uint64_t sum_squares;
+  uint64_t sum_products;
+
+  uint8_t first;
+  uint8_t last;
+
+} BYTE_STATS;
+
+// Counting every byte into the same histogram makes runs of equal bytes, which
+// are common in padding, wait for the previous increment of the same counter.
+// Four histograms are updated in rotation and merged afterwards.
+static void stats_count_scalar(
+    uint32_t counts[4][256],
+    const uint8_t* data,
+    size_t length,
+    uint64_t* sum_products)
+{
+  uint64_t products = 0;
+  uint32_t prev = 0;
+  size_t i = 0;
+
+  for (; i + 4 <= length; i += 4)
+  {
+    uint32_t a = data[i];
+    uint32_t b = data[i + 1];
+    uint32_t c = data[i + 2];
+    uint32_t d = data[i + 3];
+
+    counts[0][a]++;
+    counts[1][b]++;
+    counts[2][c]++;
+    counts[3][d]++;
+
+    products += prev * a + a * b + b * c + c * d;
+    prev = d;
+  }
+
+  for (; i < length; i++)
+  {
+    counts[0][data[i]]++;
+    products += prev * data[i];
+    prev = data[i];
+  }
+
+  *sum_products += products;
+}
+
+#if defined(YR_CPU_X86)
+
+// The products of consecutive bytes are computed 16 at a time while the same
+// 16 bytes are counted, so the data is read only once. Every iteration covers
+// the products of its 16 bytes with the byte that follows each of them, which
+// is why the loop stops with at least one byte left. Each iteration adds at
+// most 2 * 255 * 255 * 2 to a 32-bit lane, the lanes are flushed into the
+// 64-bit total before they can overflow.
+YR_TARGET("sse2")
+static void stats_count_sse2(
+    uint32_t counts[4][256],
+    const uint8_t* data,
+    size_t length,
+    uint64_t* sum_products)
+{
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t lanes[4];
+  size_t i = 0;
+
+  while (i + 17 <= length)
+  {
+    __m128i acc = _mm_setzero_si128();
+    size_t n = yr_min((length - i - 1) / 16, 8192);
+
+    for (; n > 0; n--, i += 16)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i*) (data + i));
+      __m128i b = _mm_loadu_si128((const __m128i*) (data + i + 1));
+
+      acc = _mm_add_epi32(
+          acc,
+          _mm_madd_epi16(
+              _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+
+      acc = _mm_add_epi32(
+          acc,
+          _mm_madd_epi16(
+              _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+
+      for (int j = 0; j < 16; j += 4)
+      {
+        counts[0][data[i + j]]++;
+        counts[1][data[i + j + 1]]++;
+        counts[2][data[i + j + 2]]++;
+        counts[3][data[i + j + 3]]++;
+      }
+    }
+
+    _mm_storeu_si128((__m128i*) lanes, acc);
+
+    *sum_products += (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+
+  stats_count_scalar(counts, data + i, length - i, sum_products);
+}
+
+#endif
+
+// Adds a contiguous piece of the range to the statistics. Pieces must be added
+// in order, the product of the last byte of the previous piece and the first
+// byte of this one is accounted for.
+static void stats_add(BYTE_STATS* stats, const uint8_t* data, size_t length)
+{
+  uint32_t counts[4][256];
+
+  if (length == 0)
+    return;
+
+  if (stats->length == 0)
+    stats->first = data[0];
+  else
+    stats->sum_products += (uint32_t) stats->last * data[0];
+
+  memset(counts, 0, sizeof(counts));
+
+#if defined(YR_CPU_X86)
+  if (yr_cpu_has_sse2())
+    stats_count_sse2(counts, data, length, &stats->sum_products);
+  else
+#endif
+    stats_count_scalar(counts, data, length, &stats->sum_products);
+
+  for (int i = 0; i < 256; i++)
+    stats->distribution[i] += counts[0][i] + counts[1][i] + counts[2][i] +
+                              counts[3][i];
+
+  stats->length += length;
+  stats->last = data[length - 1];
+}
+
+static void stats_finish(BYTE_STATS* stats)
+{
+  for (uint64_t i = 0; i < 256; i++)
+  {
+    stats->sum += i * stats->distribution[i];
+    stats->sum_squares += i * i * stats->distribution[i];
+  }
+}
+
+static BYTE_STATS* stats_from_cache(
+    YR_OBJECT* module_object,
+    const char* ns,
+    int64_t offset,
+    int64_t length)
+{
+  STATS_KEY key;
+  YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
+
+  key.offset = offset;
+  key.length = length;
+
+  return (BYTE_STATS*) yr_hash_table_lookup_raw_key(
+      hash_table, &key, sizeof(key), ns);
+}
+
+static BYTE_STATS* stats_create(YR_OBJECT* module_object)
+{
+  YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
+
+  BYTE_STATS* stats = (BYTE_STATS*) yr_notebook_alloc(
+      hash_table->notebook, sizeof(BYTE_STATS));
+
+  if (stats != NULL)
+    memset(stats, 0, sizeof(BYTE_STATS));
+
+  return stats;
+}
+
+static BYTE_STATS* stats_add_to_cache(
+    YR_OBJECT* module_object,
+    const char* ns,
+    int64_t offset,
+    int64_t length,
+    BYTE_STATS* stats)
+{
+  STATS_KEY key;
+  YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
+
+  key.offset = offset;
+  key.length = length;
+
+  stats_finish(stats);
+
+  if (yr_hash_table_add_raw_key(
+          hash_table, &key, sizeof(key), ns, (void*) stats) != ERROR_SUCCESS)
+    return NULL;
+
+  return stats;
+}
+
+// Returns the statistics of the given range, or NULL if the range is invalid
+// or spans non contiguous blocks.
+static BYTE_STATS* get_stats(
+    YR_OBJECT* module_object,
     int64_t offset,
     int64_t length,
     YR_SCAN_CONTEXT* context)
 {
   bool past_first_block = false;
 
-  size_t i;
+  int64_t arg_offset = offset;
+  int64_t arg_length = length;
 
-  uint32_t* data = (uint32_t*) yr_calloc(256, sizeof(uint32_t));
+  BYTE_STATS* stats = stats_from_cache(module_object, "range", offset, length);
 
-  if (data == NULL)
-    return NULL;
+  if (stats != NULL)
+    return stats;
 
   YR_MEMORY_BLOCK* block = first_memory_block(context);
   YR_MEMORY_BLOCK_ITERATOR* iterator = context->iterator;
 
   if (block == NULL || offset < 0 || length < 0 || offset < block->base)
-  {
-    yr_free(data);
     return NULL;
-  }
+
+  stats = stats_create(module_object);
+
+  if (stats == NULL)
+    return NULL;
 
   foreach_memory_block(iterator, block)
   {
@@ -84,19 +308,12 @@ uint32_t* get_distribution(
       const uint8_t* block_data = yr_fetch_block_data(block);
 
       if (block_data == NULL)
-      {
-        yr_free(data);
         return NULL;
-      }
 
       offset += data_len;
       length -= data_len;
 
-      for (i = 0; i < data_len; i++)
-      {
-        uint8_t c = *(block_data + data_offset + i);
-        data[c]++;
-      }
+      stats_add(stats, block_data + data_offset, data_len);
 
       past_first_block = true;
     }
@@ -107,8 +324,6 @@ uint32_t* get_distribution(
       // the distribution over a range of non contiguous blocks. As
       // range contains gaps of undefined data the distribution is
       // undefined.
-
-      yr_free(data);
       return NULL;
     }
 
@@ -117,22 +332,28 @@ uint32_t* get_distribution(
   }
 
   if (!past_first_block)
-  {
-    yr_free(data);
     return NULL;
-  }
-  return data;
+
+  return stats_add_to_cache(
+      module_object, "range", arg_offset, arg_length, stats);
 }
 
-uint32_t* get_distribution_global(YR_SCAN_CONTEXT* context)
+// Returns the statistics of the whole scanned data, or NULL if the data is not
+// contiguous.
+static BYTE_STATS* get_stats_global(
+    YR_OBJECT* module_object,
+    YR_SCAN_CONTEXT* context)
 {
-  size_t i;
-
   int64_t expected_next_offset = 0;
 
-  uint32_t* data = (uint32_t*) yr_calloc(256, sizeof(uint32_t));
+  BYTE_STATS* stats = stats_from_cache(module_object, "global", 0, 0);
 
-  if (data == NULL)
+  if (stats != NULL)
+    return stats;
+
+  stats = stats_create(module_object);
+
+  if (stats == NULL)
     return NULL;
 
   YR_MEMORY_BLOCK* block;
@@ -145,25 +366,19 @@ uint32_t* get_distribution_global(YR_SCAN_CONTEXT* context)
       // we are trying to compute the distribution over a range of non
       // contiguous blocks. As the range contains gaps of
       // undefined data the distribution is undefined.
-      yr_free(data);
       return NULL;
     }
     const uint8_t* block_data = yr_fetch_block_data(block);
 
     if (block_data == NULL)
-    {
-      yr_free(data);
       return NULL;
-    }
 
-    for (i = 0; i < block->size; i++)
-    {
-      uint8_t c = *(block_data + i);
-      data[c] += 1;
-    }
+    stats_add(stats, block_data, block->size);
+
     expected_next_offset = block->base + block->size;
   }
-  return data;
+
+  return stats_add_to_cache(module_object, "global", 0, 0, stats);
 }
 
 define_function(string_entropy)
@@ -208,28 +423,20 @@ define_function(data_entropy)
 
   size_t i;
 
-  size_t total_len = 0;
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  uint32_t* data = get_distribution(offset, length, context);
-
-  if (data == NULL)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
   for (i = 0; i < 256; i++)
   {
-    total_len += data[i];
-  }
-
-  for (i = 0; i < 256; i++)
-  {
-    if (data[i] != 0)
+    if (stats->distribution[i] != 0)
     {
-      double x = (double) (data[i]) / total_len;
+      double x = (double) (stats->distribution[i]) / stats->length;
       entropy -= x * log2(x);
     }
   }
 
-  yr_free(data);
   return_float(entropy);
 }
 
@@ -255,24 +462,19 @@ define_function(data_deviation)
   double mean = float_argument(3);
   double sum = 0.0;
 
-  size_t total_len = 0;
   size_t i;
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* data = get_distribution(offset, length, context);
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  if (data == NULL)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
   for (i = 0; i < 256; i++)
-  {
-    total_len += data[i];
-    sum += fabs(((double) i) - mean) * data[i];
-  }
+    sum += fabs(((double) i) - mean) * stats->distribution[i];
 
-  yr_free(data);
-  return_float(sum / total_len);
+  return_float(sum / stats->length);
 }
 
 define_function(string_mean)
@@ -289,117 +491,45 @@ define_function(string_mean)
 
 define_function(data_mean)
 {
-  double sum = 0.0;
-
   int64_t offset = integer_argument(1);
   int64_t length = integer_argument(2);
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  size_t total_len = 0;
-  size_t i;
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  uint32_t* data = get_distribution(offset, length, context);
-
-  if (data == NULL)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
-  for (i = 0; i < 256; i++)
-  {
-    total_len += data[i];
-    sum += ((double) i) * data[i];
-  }
-
-  yr_free(data);
-  return_float(sum / total_len);
+  return_float((double) stats->sum / stats->length);
 }
 
 define_function(data_serial_correlation)
 {
-  int past_first_block = false;
-
-  size_t total_len = 0;
-  size_t i;
-
   int64_t offset = integer_argument(1);
   int64_t length = integer_argument(2);
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
-  YR_MEMORY_BLOCK* block = first_memory_block(context);
-  YR_MEMORY_BLOCK_ITERATOR* iterator = context->iterator;
-
-  if (block == NULL)
-    return_float(YR_UNDEFINED);
 
-  double sccun = 0;
-  double sccfirst = 0;
-  double scclast = 0;
-  double scct1 = 0;
-  double scct2 = 0;
-  double scct3 = 0;
-  double scc = 0;
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  if (offset < 0 || length < 0 || offset < block->base)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
-  foreach_memory_block(iterator, block)
-  {
-    if (offset >= block->base && offset < block->base + block->size)
-    {
-      size_t data_offset = (size_t) (offset - block->base);
-      size_t data_len = (size_t) yr_min(
-          length, (size_t) (block->size - data_offset));
-
-      const uint8_t* block_data = yr_fetch_block_data(block);
-
-      if (block_data == NULL)
-        return_float(YR_UNDEFINED);
-
-      total_len += data_len;
-      offset += data_len;
-      length -= data_len;
-
-      for (i = 0; i < data_len; i++)
-      {
-        sccun = (double) *(block_data + data_offset + i);
-        if (i == 0)
-        {
-          sccfirst = sccun;
-        }
-        scct1 += scclast * sccun;
-        scct2 += sccun;
-        scct3 += sccun * sccun;
-        scclast = sccun;
-      }
-
-      past_first_block = true;
-    }
-    else if (past_first_block)
-    {
-      // If offset is not within current block and we already
-      // past the first block then the we are trying to compute
-      // the checksum over a range of non contiguous blocks. As
-      // range contains gaps of undefined data the checksum is
-      // undefined.
-      return_float(YR_UNDEFINED);
-    }
-
-    if (block->base + block->size >= offset + length)
-      break;
-  }
+  double scct1 = (double) stats->sum_products +
+                 (double) stats->last * stats->first;
+  double scct2 = (double) stats->sum;
+  double scct3 = (double) stats->sum_squares;
+  double scc;
 
-  if (!past_first_block)
-    return_float(YR_UNDEFINED);
-
-  scct1 += scclast * sccfirst;
   scct2 *= scct2;
 
-  scc = total_len * scct3 - scct2;
+  scc = stats->length * scct3 - scct2;
 
   if (scc == 0)
     scc = -100000;
   else
-    scc = (total_len * scct1 - scct2) / scc;
+    scc = (stats->length * scct1 - scct2) / scc;
 
   return_float(scc);
 }
@@ -627,13 +757,12 @@ define_function(count_range)
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution(offset, length, context);
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_integer(YR_UNDEFINED);
 
-  int64_t count = (int64_t) distribution[byte];
-  yr_free(distribution);
+  int64_t count = (int64_t) stats->distribution[byte];
   return_integer(count);
 }
 
@@ -646,13 +775,12 @@ define_function(count_global)
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution_global(context);
+  BYTE_STATS* stats = get_stats_global(yr_module(), context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_integer(YR_UNDEFINED);
 
-  int64_t count = (int64_t) distribution[byte];
-  yr_free(distribution);
+  int64_t count = (int64_t) stats->distribution[byte];
   return_integer(count);
 }
 
@@ -667,18 +795,13 @@ define_function(percentage_range)
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution(offset, length, context);
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
-  int64_t count = (int64_t) distribution[byte];
-  int64_t total_count = 0;
-  int64_t i;
-
-  for (i = 0; i < 256; i++) total_count += distribution[i];
-
-  yr_free(distribution);
+  int64_t count = (int64_t) stats->distribution[byte];
+  int64_t total_count = (int64_t) stats->length;
   return_float(((float) count) / ((float) total_count));
 }
 
@@ -691,18 +814,13 @@ define_function(percentage_global)
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution_global(context);
+  BYTE_STATS* stats = get_stats_global(yr_module(), context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_float(YR_UNDEFINED);
 
-  int64_t count = (int64_t) distribution[byte];
-  int64_t total_count = 0;
-  int64_t i;
-
-  for (i = 0; i < 256; i++) total_count += distribution[i];
-
-  yr_free(distribution);
+  int64_t count = (int64_t) stats->distribution[byte];
+  int64_t total_count = (int64_t) stats->length;
   return_float(((float) count) / ((float) total_count));
 }
 
@@ -713,9 +831,9 @@ define_function(mode_range)
 
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution(offset, length, context);
+  BYTE_STATS* stats = get_stats(yr_module(), offset, length, context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_integer(YR_UNDEFINED);
 
   int64_t most_common = 0;
@@ -723,11 +841,10 @@ define_function(mode_range)
 
   for (i = 0; i < 256; i++)
   {
-    if (distribution[i] > distribution[most_common])
+    if (stats->distribution[i] > stats->distribution[most_common])
       most_common = (int64_t) i;
   }
 
-  yr_free(distribution);
   return_integer(most_common);
 }
 
@@ -735,9 +852,9 @@ define_function(mode_global)
 {
   YR_SCAN_CONTEXT* context = yr_scan_context();
 
-  uint32_t* distribution = get_distribution_global(context);
+  BYTE_STATS* stats = get_stats_global(yr_module(), context);
 
-  if (distribution == NULL)
+  if (stats == NULL)
     return_integer(YR_UNDEFINED);
 
   int64_t most_common = 0;
@@ -745,11 +862,10 @@ define_function(mode_global)
 
   for (i = 0; i < 256; i++)
   {
-    if (distribution[i] > distribution[most_common])
+    if (stats->distribution[i] > stats->distribution[most_common])
       most_common = (int64_t) i;
   }
 
-  yr_free(distribution);
   return_integer(most_common);
 }
 
@@ -828,11 +944,23 @@ int module_load(
     void* module_data,
     size_t module_data_size)
 {
+  YR_HASH_TABLE* hash_table;
+
+  FAIL_ON_ERROR(
+      yr_hash_table_create_in_notebook(17, context->notebook, &hash_table));
+
+  module_object->data = hash_table;
+
   yr_set_float(127.5, module_object, "MEAN_BYTES");
   return ERROR_SUCCESS;
 }
 
 int module_unload(YR_OBJECT* module_object)
 {
+  YR_HASH_TABLE* hash_table = (YR_HASH_TABLE*) module_object->data;
+
+  if (hash_table != NULL)
+    yr_hash_table_destroy(hash_table, NULL);
+
   return ERROR_SUCCESS;
 }
@@ -37,8 +37,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/evp.h>
 #endif
 
+#include <yara/digest.h>
 #include <yara/dotnet.h>
 #include <yara/endian.h>
+#include <yara/fingerprint.h>
 #include <yara/limits.h>
 #include <yara/mem.h>
 #include <yara/modules.h>
@@ -132,37 +134,36 @@ static int wide_string_fits_in_pe(PE* pe, char* data)
   return 0;
 }
 
-// Parse the rich signature.
+// Locate the rich signature, returns its start, its length in bytes and the
+// XOR key, or NULL when the file has none.
 // http://www.ntcore.com/files/richsign.htm
 
-static void pe_parse_rich_signature(PE* pe, uint64_t base_address)
+static PRICH_SIGNATURE pe_find_rich_signature(
+    PE* pe,
+    size_t* rich_len,
+    uint32_t* rich_key)
 {
   PIMAGE_DOS_HEADER mz_header;
   PRICH_SIGNATURE rich_signature = NULL;
 
   DWORD* rich_ptr = NULL;
-  BYTE* raw_data = NULL;
-  BYTE* clear_data = NULL;
-  BYTE* version_data = NULL;
   DWORD* p = NULL;
   uint32_t nthdr_offset = 0;
   uint32_t key = 0;
-  size_t rich_len = 0;
-  int64_t rich_count = 0;
 
   if (pe->data_size < sizeof(IMAGE_DOS_HEADER))
-    return;
+    return NULL;
 
   mz_header = (PIMAGE_DOS_HEADER) pe->data;
 
   if (yr_le16toh(mz_header->e_magic) != IMAGE_DOS_SIGNATURE)
-    return;
+    return NULL;
 
   // To find the Rich marker we start at the NT header and work backwards, so
   // make sure we have at least enough data to get to the NT header.
   nthdr_offset = yr_le32toh(mz_header->e_lfanew);
   if (nthdr_offset > pe->data_size + sizeof(uint32_t) || nthdr_offset < 4)
-    return;
+    return NULL;
 
   // Most files have the Rich header at offset 0x80, but that is not always
   // true. 582ce3eea9c97d5e89f7d83953a6d518b16770e635a19a456c0225449c6967a4 is
@@ -188,7 +189,7 @@ static void pe_parse_rich_signature(PE* pe, uint64_t base_address)
 
   // If we haven't found a key we can skip processing the rest.
   if (key == 0)
-    return;
+    return NULL;
 
   // If we have found the key we need to now find the start (DanS).
   while (p >= (DWORD*) (pe->data + sizeof(IMAGE_DOS_HEADER)))
@@ -203,10 +204,34 @@ static void pe_parse_rich_signature(PE* pe, uint64_t base_address)
   }
 
   if (rich_signature == NULL)
-    return;
+    return NULL;
 
   // Multiply by 4 because we are counting in DWORDs.
-  rich_len = (rich_ptr - (DWORD*) rich_signature) * 4;
+  *rich_len = (rich_ptr - (DWORD*) rich_signature) * 4;
+  *rich_key = key;
+
+  return rich_signature;
+}
+
+// Parse the rich signature.
+
+static void pe_parse_rich_signature(PE* pe, uint64_t base_address)
+{
+  PRICH_SIGNATURE rich_signature = NULL;
+
+  DWORD* rich_ptr = NULL;
+  BYTE* raw_data = NULL;
+  BYTE* clear_data = NULL;
+  BYTE* version_data = NULL;
+  uint32_t key = 0;
+  size_t rich_len = 0;
+  int64_t rich_count = 0;
+
+  rich_signature = pe_find_rich_signature(pe, &rich_len, &key);
+
+  if (rich_signature == NULL)
+    return;
+
   raw_data = (BYTE*) yr_malloc(rich_len);
 
   if (!raw_data)
@@ -1127,9 +1152,13 @@ static IMPORTED_DLL* pe_parse_imports(PE* pe)
   PIMAGE_IMPORT_DESCRIPTOR imports;
   PIMAGE_DATA_DIRECTORY directory;
 
-  // Default to 0 imports until we know there are any
-  yr_set_integer(0, pe->object, "number_of_imports");
-  yr_set_integer(0, pe->object, "number_of_imported_functions");
+  // Default to 0 imports until we know there are any. The object is NULL
+  // when the imports are only parsed for yr_pe_fingerprints.
+  if (pe->object != NULL)
+  {
+    yr_set_integer(0, pe->object, "number_of_imports");
+    yr_set_integer(0, pe->object, "number_of_imported_functions");
+  }
 
   directory = pe_get_directory_entry(pe, IMAGE_DIRECTORY_ENTRY_IMPORT);
 
@@ -1203,6 +1232,9 @@ static IMPORTED_DLL* pe_parse_imports(PE* pe)
     imports++;
   }
 
+  if (pe->object == NULL)
+    return head;
+
   yr_set_integer(num_imports, pe->object, "number_of_imports");
   yr_set_integer(
       num_function_imports, pe->object, "number_of_imported_functions");
@@ -2075,7 +2107,11 @@ const char* pe_get_section_full_name(
   return NULL;
 }
 
-static void pe_parse_header(PE* pe, uint64_t base_address, int flags)
+static void pe_parse_header(
+    PE* pe,
+    uint64_t base_address,
+    int flags,
+    bool parse_resources)
 {
   PIMAGE_SECTION_HEADER section;
   PIMAGE_DATA_DIRECTORY data_dir;
@@ -2301,11 +2337,14 @@ static void pe_parse_header(PE* pe, uint64_t base_address, int flags)
     data_dir++;
   }
 
-  pe_iterate_resources(
-      pe, (RESOURCE_CALLBACK_FUNC) pe_collect_resources, (void*) pe);
+  if (parse_resources)
+  {
+    pe_iterate_resources(
+        pe, (RESOURCE_CALLBACK_FUNC) pe_collect_resources, (void*) pe);
 
-  yr_set_integer(pe->resources, pe->object, "number_of_resources");
-  yr_set_integer(pe->version_infos, pe->object, "number_of_version_infos");
+    yr_set_integer(pe->resources, pe->object, "number_of_resources");
+    yr_set_integer(pe->version_infos, pe->object, "number_of_version_infos");
+  }
 
   section = IMAGE_FIRST_SECTION(pe->header);
 
@@ -2713,9 +2752,6 @@ define_function(exports_index_regex)
   return_integer(YR_UNDEFINED);
 }
 
-#if defined(HAVE_LIBCRYPTO) || defined(HAVE_WINCRYPT_H) || \
-    defined(HAVE_COMMONCRYPTO_COMMONCRYPTO_H)
-
 //
 // Generate an import hash:
 // https://www.mandiant.com/blog/tracking-malware-import-hashing/
@@ -2723,35 +2759,17 @@ define_function(exports_index_regex)
 // to alter the contents of the parsed import structures.
 //
 
-define_function(imphash)
+static int pe_imphash_digest(
+    IMPORTED_DLL* dll,
+    uint8_t digest[YR_DIGEST_MD5_LENGTH])
 {
-  YR_OBJECT* module = yr_module();
-
-  IMPORTED_DLL* dll;
-  yr_md5_ctx ctx;
-
-  unsigned char digest[YR_MD5_LEN];
-  char* digest_ascii;
+  YR_DIGEST_CTX ctx;
+  YR_DIGEST result;
 
   size_t i;
   bool first = true;
 
-  PE* pe = (PE*) module->data;
-
-  // If not a PE, return YR_UNDEFINED.
-
-  if (!pe)
-    return_string(YR_UNDEFINED);
-
-  // Lookup in cache first.
-  digest_ascii = (char*) yr_hash_table_lookup(pe->hash_table, "imphash", NULL);
-
-  if (digest_ascii != NULL)
-    return_string(digest_ascii);
-
-  yr_md5_init(&ctx);
-
-  dll = pe->imported_dlls;
+  yr_digest_init(&ctx, YR_DIGEST_MD5);
 
   while (dll)
   {
@@ -2806,7 +2824,7 @@ define_function(imphash)
       for (i = 0; i < final_name_len; i++)
         final_name[i] = tolower(final_name[i]);
 
-      yr_md5_update(&ctx, final_name, final_name_len);
+      yr_digest_update(&ctx, final_name, final_name_len);
 
       yr_free(final_name);
 
@@ -2819,21 +2837,53 @@ define_function(imphash)
     dll = dll->next;
   }
 
-  yr_md5_final(digest, &ctx);
+  yr_digest_final(&ctx, &result);
+  memcpy(digest, result.md5, YR_DIGEST_MD5_LENGTH);
 
-  digest_ascii = (char*) yr_malloc(YR_MD5_LEN * 2 + 1);
+  return ERROR_SUCCESS;
+}
+
+static void pe_digest_to_hex(const uint8_t* digest, size_t length, char* hex)
+{
+  for (size_t i = 0; i < length; i++)
+    sprintf(hex + (i * 2), "%02x", digest[i]);
+
+  hex[length * 2] = '\0';
+}
+
+#if defined(HAVE_LIBCRYPTO) || defined(HAVE_WINCRYPT_H) || \
+    defined(HAVE_COMMONCRYPTO_COMMONCRYPTO_H)
+
+define_function(imphash)
+{
+  YR_OBJECT* module = yr_module();
+
+  unsigned char digest[YR_DIGEST_MD5_LENGTH];
+  char* digest_ascii;
+
+  PE* pe = (PE*) module->data;
+
+  // If not a PE, return YR_UNDEFINED.
+
+  if (!pe)
+    return_string(YR_UNDEFINED);
+
+  // Lookup in cache first.
+  digest_ascii = (char*) yr_hash_table_lookup(pe->hash_table, "imphash", NULL);
+
+  if (digest_ascii != NULL)
+    return_string(digest_ascii);
+
+  FAIL_ON_ERROR(pe_imphash_digest(pe->imported_dlls, digest));
+
+  digest_ascii = (char*) yr_malloc(YR_DIGEST_MD5_LENGTH * 2 + 1);
 
   if (digest_ascii == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
   // Transform the binary digest to ascii
 
-  for (i = 0; i < YR_MD5_LEN; i++)
-  {
-    sprintf(digest_ascii + (i * 2), "%02x", digest[i]);
-  }
-
-  digest_ascii[YR_MD5_LEN * 2] = '\0';
+  pe_digest_to_hex(digest, YR_DIGEST_MD5_LENGTH, digest_ascii);
 
   yr_hash_table_add(pe->hash_table, "imphash", NULL, digest_ascii);
 
@@ -4002,6 +4052,68 @@ int module_finalize(YR_MODULE* module)
   return ERROR_SUCCESS;
 }
 
+// Top-level fields filled by each of the optional parsing steps. A step only
+// runs when the rules read at least one of its fields, rules that just check
+// pe.is_pe or header values don't pay for resources, signatures and imports.
+static const char* pe_resource_fields[] = {
+    "resources",
+    "number_of_resources",
+    "resource_timestamp",
+    "resource_version",
+    "version_info",
+    "version_info_list",
+    "number_of_version_infos",
+    "locale",
+    "language",
+    NULL};
+
+static const char* pe_rich_signature_fields[] = {"rich_signature", NULL};
+
+static const char* pe_debug_fields[] = {"pdb_path", NULL};
+
+static const char* pe_certificate_fields[] = {
+    "signatures",
+    "number_of_signatures",
+    "is_signed",
+    NULL};
+
+static const char* pe_import_fields[] = {
+    "imports",
+    "import_rva",
+    "imphash",
+    "import_details",
+    "number_of_imports",
+    "number_of_imported_functions",
+    NULL};
+
+static const char* pe_delayed_import_fields[] = {
+    "imports",
+    "delayed_import_rva",
+    "delayed_import_details",
+    "number_of_delayed_imports",
+    "number_of_delayed_imported_functions",
+    NULL};
+
+static const char* pe_export_fields[] = {
+    "exports",
+    "exports_index",
+    "export_details",
+    "export_timestamp",
+    "number_of_exports",
+    "dll_name",
+    NULL};
+
+static bool pe_fields_referenced(YR_SCAN_CONTEXT* context, const char** fields)
+{
+  for (; *fields != NULL; fields++)
+  {
+    if (yr_modules_is_field_referenced(context, "pe", *fields))
+      return true;
+  }
+
+  return false;
+}
+
 int module_load(
     YR_SCAN_CONTEXT* context,
     YR_OBJECT* module_object,
@@ -4382,20 +4494,36 @@ int module_load(
         pe->object = module_object;
         pe->resources = 0;
         pe->version_infos = 0;
+        pe->imported_dlls = NULL;
+        pe->delay_imported_dlls = NULL;
 
         module_object->data = pe;
 
-        pe_parse_header(pe, block->base, context->flags);
-        pe_parse_rich_signature(pe, block->base);
-        pe_parse_debug_directory(pe);
+        pe_parse_header(
+            pe,
+            block->base,
+            context->flags,
+            pe_fields_referenced(context, pe_resource_fields));
+
+        if (pe_fields_referenced(context, pe_rich_signature_fields))
+          pe_parse_rich_signature(pe, block->base);
+
+        if (pe_fields_referenced(context, pe_debug_fields))
+          pe_parse_debug_directory(pe);
 
 #if defined(HAVE_LIBCRYPTO) && !defined(BORINGSSL)
-        pe_parse_certificates(pe);
+        if (pe_fields_referenced(context, pe_certificate_fields))
+          pe_parse_certificates(pe);
 #endif
 
-        pe->imported_dlls = pe_parse_imports(pe);
-        pe->delay_imported_dlls = pe_parse_delayed_imports(pe);
-        pe_parse_exports(pe);
+        if (pe_fields_referenced(context, pe_import_fields))
+          pe->imported_dlls = pe_parse_imports(pe);
+
+        if (pe_fields_referenced(context, pe_delayed_import_fields))
+          pe->delay_imported_dlls = pe_parse_delayed_imports(pe);
+
+        if (pe_fields_referenced(context, pe_export_fields))
+          pe_parse_exports(pe);
 
         break;
       }
@@ -4434,6 +4562,75 @@ void free_dlls(IMPORTED_DLL* dll)
   }
 }
 
+//
+// Imphash and rich header hash of a PE without loading the module: the same
+// import and rich signature parsers run over the buffer, no object is filled.
+// The rich header hash is the MD5 of the decoded block from DanS up to the Rich
+// marker. Either string is left empty when the file has no imports or no rich
+// signature.
+//
+
+YR_API int yr_pe_fingerprints(
+    const uint8_t* data,
+    size_t data_size,
+    char imphash[YR_PE_FINGERPRINT_HEX_LENGTH],
+    char rich_hash[YR_PE_FINGERPRINT_HEX_LENGTH])
+{
+  PE pe;
+  PRICH_SIGNATURE rich_signature;
+  IMPORTED_DLL* dlls;
+  uint8_t digest[YR_DIGEST_MD5_LENGTH];
+  size_t rich_len = 0;
+  uint32_t key = 0;
+  int result = ERROR_SUCCESS;
+
+  imphash[0] = '\0';
+  rich_hash[0] = '\0';
+
+  memset(&pe, 0, sizeof(pe));
+  pe.header = pe_get_header(data, data_size);
+
+  if (pe.header == NULL)
+    return ERROR_SUCCESS;
+
+  pe.data = data;
+  pe.data_size = data_size;
+
+  rich_signature = pe_find_rich_signature(&pe, &rich_len, &key);
+
+  if (rich_signature != NULL)
+  {
+    YR_DIGEST_CTX ctx;
+    YR_DIGEST rich_digest;
+    DWORD* rich_ptr = (DWORD*) rich_signature;
+
+    yr_digest_init(&ctx, YR_DIGEST_MD5);
+
+    for (size_t i = 0; i < rich_len / sizeof(DWORD); i++)
+    {
+      DWORD clear = rich_ptr[i] ^ key;
+      yr_digest_update(&ctx, &clear, sizeof(clear));
+    }
+
+    yr_digest_final(&ctx, &rich_digest);
+    pe_digest_to_hex(rich_digest.md5, YR_DIGEST_MD5_LENGTH, rich_hash);
+  }
+
+  dlls = pe_parse_imports(&pe);
+
+  if (dlls != NULL)
+  {
+    result = pe_imphash_digest(dlls, digest);
+
+    if (result == ERROR_SUCCESS)
+      pe_digest_to_hex(digest, YR_DIGEST_MD5_LENGTH, imphash);
+
+    free_dlls(dlls);
+  }
+
+  return result;
+}
+
 int module_unload(YR_OBJECT* module_object)
 {
   PE* pe = (PE*) module_object->data;
@@ -45,14 +45,19 @@ typedef struct YR_NOTEBOOK_PAGE YR_NOTEBOOK_PAGE;
 // 4x the size of the buffers you plan to allocate with yr_notebook_alloc().
 //
 // Once the notebook is destroyed all the pages are freed, and consequently
-// all the buffers allocated via yr_notebook_alloc().
+// all the buffers allocated via yr_notebook_alloc(). A notebook can also be
+// reset with yr_notebook_reset(), which invalidates every buffer but keeps the
+// pages, so that a notebook used once per scan stops calling malloc after the
+// first few scans.
 struct YR_NOTEBOOK
 {
   // The mininum size of each page in the notebook.
   size_t min_page_size;
-  // Pointer to the first page in the book, this is also the most recently
-  // created page, the one that is being filled.
+  // Pointer to the first page in the book.
   YR_NOTEBOOK_PAGE* page_list_head;
+  // Pointer to the page that is being filled. Pages after this one are free
+  // pages kept by yr_notebook_reset().
+  YR_NOTEBOOK_PAGE* current_page;
 };
 
 struct YR_NOTEBOOK_PAGE
@@ -102,6 +107,7 @@ int yr_notebook_create(size_t min_page_size, YR_NOTEBOOK** notebook)
   new_notebook->page_list_head->size = min_page_size;
   new_notebook->page_list_head->used = 0;
   new_notebook->page_list_head->next = NULL;
+  new_notebook->current_page = new_notebook->page_list_head;
 
   *notebook = new_notebook;
 
@@ -153,34 +159,54 @@ void* yr_notebook_alloc(YR_NOTEBOOK* notebook, size_t size)
   // deferrencing pointers to types larger than a byte.
   size = (size + 7) & ~0x7;
 
-  YR_NOTEBOOK_PAGE* current_page = notebook->page_list_head;
+  YR_NOTEBOOK_PAGE* current_page = notebook->current_page;
 
-  // If the requested size doesn't fit in current page's free space, allocate
-  // a new page.
+  // If the requested size doesn't fit in current page's free space, move to
+  // the next page, which is a page kept by a previous reset if there's one
+  // big enough, or a newly allocated page otherwise.
   if (current_page->size - current_page->used < size)
   {
-    size_t min_size = notebook->min_page_size;
+    YR_NOTEBOOK_PAGE* next_page = current_page->next;
 
-    // The new page must be able to fit the requested buffer, so find the
-    // multiple of notebook->min_page_size that is larger or equal than than
-    // size.
-    size_t page_size = (size / min_size) * min_size + min_size;
+    if (next_page == NULL || next_page->size < size)
+    {
+      size_t min_size = notebook->min_page_size;
 
-    YR_NOTEBOOK_PAGE* new_page = yr_malloc(
-        sizeof(YR_NOTEBOOK_PAGE) + page_size);
+      // The new page must be able to fit the requested buffer, so find the
+      // multiple of notebook->min_page_size that is larger or equal than than
+      // size.
+      size_t page_size = (size / min_size) * min_size + min_size;
 
-    if (new_page == NULL)
-      return NULL;
+      next_page = yr_malloc(sizeof(YR_NOTEBOOK_PAGE) + page_size);
 
-    new_page->size = page_size;
-    new_page->used = 0;
-    new_page->next = notebook->page_list_head;
-    notebook->page_list_head = new_page;
+      if (next_page == NULL)
+        return NULL;
+
+      next_page->size = page_size;
+      next_page->next = current_page->next;
+      current_page->next = next_page;
+    }
+
+    next_page->used = 0;
+    notebook->current_page = next_page;
   }
 
-  void* ptr = notebook->page_list_head->data + notebook->page_list_head->used;
+  void* ptr = notebook->current_page->data + notebook->current_page->used;
 
-  notebook->page_list_head->used += size;
+  notebook->current_page->used += size;
 
   return ptr;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Discards every buffer allocated from the notebook in constant time. The
+// pages are kept and filled again by subsequent calls to yr_notebook_alloc().
+//
+// Args:
+//   notebook: Pointer to the notebook.
+//
+void yr_notebook_reset(YR_NOTEBOOK* notebook)
+{
+  notebook->current_page = notebook->page_list_head;
+  notebook->current_page->used = 0;
+}
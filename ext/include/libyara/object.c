@@ -38,20 +38,74 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <yara/exec.h>
 #include <yara/globals.h>
 #include <yara/mem.h>
+#include <yara/notebook.h>
 #include <yara/object.h>
 #include <yara/strutils.h>
 #include <yara/utils.h>
 
 ////////////////////////////////////////////////////////////////////////////////
-// Creates a new object with the given type and identifier. If a parent is
-// specified the new object is owned by the parent and it will be destroyed when
-// the parent is destroyed. You must not call yr_object_destroy on an objected
-// that has a parent, you should destroy the parent instead.
+// Objects that belong to a notebook take every buffer they need from it, and
+// those buffers are never freed one by one. The whole object tree goes away
+// at once when the notebook is reset or destroyed. Objects without a notebook
+// use yr_malloc and yr_free as usual.
 //
-int yr_object_create(
+static void* _yr_object_alloc(YR_NOTEBOOK* notebook, size_t size)
+{
+  if (notebook != NULL)
+    return yr_notebook_alloc(notebook, size);
+
+  return yr_malloc(size);
+}
+
+static void* _yr_object_realloc(
+    YR_NOTEBOOK* notebook,
+    void* ptr,
+    size_t old_size,
+    size_t new_size)
+{
+  if (notebook == NULL)
+    return yr_realloc(ptr, new_size);
+
+  void* new_ptr = yr_notebook_alloc(notebook, new_size);
+
+  if (new_ptr != NULL)
+    memcpy(new_ptr, ptr, old_size);
+
+  return new_ptr;
+}
+
+static void _yr_object_free(YR_NOTEBOOK* notebook, void* ptr)
+{
+  if (notebook == NULL)
+    yr_free(ptr);
+}
+
+static SIZED_STRING* _yr_object_sized_string(
+    YR_NOTEBOOK* notebook,
+    const char* value,
+    size_t len,
+    uint32_t flags)
+{
+  SIZED_STRING* ss = (SIZED_STRING*) _yr_object_alloc(
+      notebook, len + sizeof(SIZED_STRING));
+
+  if (ss == NULL)
+    return NULL;
+
+  ss->length = (uint32_t) len;
+  ss->flags = flags;
+
+  memcpy(ss->c_string, value, len);
+  ss->c_string[len] = '\0';
+
+  return ss;
+}
+
+static int _yr_object_create(
     int8_t type,
     const char* identifier,
     YR_OBJECT* parent,
+    YR_NOTEBOOK* notebook,
     YR_OBJECT** object)
 {
   YR_OBJECT* obj;
@@ -87,15 +141,22 @@ int yr_object_create(
     assert(false);
   }
 
-  obj = (YR_OBJECT*) yr_malloc(object_size);
+  obj = (YR_OBJECT*) _yr_object_alloc(notebook, object_size);
 
   if (obj == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
 
+  size_t identifier_size = strlen(identifier) + 1;
+  char* identifier_copy = (char*) _yr_object_alloc(notebook, identifier_size);
+
+  if (identifier_copy != NULL)
+    memcpy(identifier_copy, identifier, identifier_size);
+
   obj->type = type;
-  obj->identifier = yr_strdup(identifier);
+  obj->identifier = identifier_copy;
   obj->parent = parent;
   obj->data = NULL;
+  obj->notebook = notebook;
 
   switch (type)
   {
@@ -131,7 +192,7 @@ int yr_object_create(
 
   if (obj->identifier == NULL)
   {
-    yr_free(obj);
+    _yr_object_free(notebook, obj);
     return ERROR_INSUFFICIENT_MEMORY;
   }
 
@@ -150,8 +211,8 @@ int yr_object_create(
     {
     case OBJECT_TYPE_STRUCTURE:
       FAIL_ON_ERROR_WITH_CLEANUP(yr_object_structure_set_member(parent, obj), {
-        yr_free((void*) obj->identifier);
-        yr_free(obj);
+        _yr_object_free(notebook, (void*) obj->identifier);
+        _yr_object_free(notebook, obj);
       });
       break;
 
@@ -175,6 +236,42 @@ int yr_object_create(
   return ERROR_SUCCESS;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Creates a new object with the given type and identifier. If a parent is
+// specified the new object is owned by the parent and it will be destroyed when
+// the parent is destroyed. You must not call yr_object_destroy on an objected
+// that has a parent, you should destroy the parent instead. The new object
+// belongs to the same notebook as its parent, if any.
+//
+int yr_object_create(
+    int8_t type,
+    const char* identifier,
+    YR_OBJECT* parent,
+    YR_OBJECT** object)
+{
+  return _yr_object_create(
+      type,
+      identifier,
+      parent,
+      parent != NULL ? parent->notebook : NULL,
+      object);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Creates a new object without parent whose memory, and the memory of every
+// object created under it, is taken from the given notebook. Calling
+// yr_object_destroy on it is allowed but doesn't release anything, the memory
+// is reclaimed when the notebook is reset or destroyed.
+//
+int yr_object_create_in_notebook(
+    int8_t type,
+    const char* identifier,
+    YR_NOTEBOOK* notebook,
+    YR_OBJECT** object)
+{
+  return _yr_object_create(type, identifier, NULL, notebook, object);
+}
+
 void yr_object_set_canary(YR_OBJECT* object, int canary)
 {
   object->canary = canary;
@@ -324,7 +421,8 @@ void yr_object_destroy(YR_OBJECT* object)
   YR_ARRAY_ITEMS* array_items;
   YR_DICTIONARY_ITEMS* dict_items;
 
-  if (object == NULL)
+  // Objects in a notebook are released all at once with the notebook.
+  if (object == NULL || object->notebook != NULL)
     return;
 
   switch (object->type)
@@ -542,8 +640,8 @@ int yr_object_copy(YR_OBJECT* object, YR_OBJECT** object_copy)
 
   *object_copy = NULL;
 
-  FAIL_ON_ERROR(
-      yr_object_create(object->type, object->identifier, NULL, &copy));
+  FAIL_ON_ERROR(_yr_object_create(
+      object->type, object->identifier, NULL, object->notebook, &copy));
 
   copy->canary = object->canary;
 
@@ -560,9 +658,23 @@ int yr_object_copy(YR_OBJECT* object, YR_OBJECT** object_copy)
   case OBJECT_TYPE_STRING:
 
     if (object->value.ss != NULL)
-      copy->value.ss = ss_dup(object->value.ss);
+    {
+      copy->value.ss = _yr_object_sized_string(
+          copy->notebook,
+          object->value.ss->c_string,
+          object->value.ss->length,
+          object->value.ss->flags);
+
+      if (copy->value.ss == NULL)
+      {
+        yr_object_destroy(copy);
+        return ERROR_INSUFFICIENT_MEMORY;
+      }
+    }
     else
+    {
       copy->value.ss = NULL;
+    }
 
     break;
 
@@ -593,7 +705,7 @@ int yr_object_copy(YR_OBJECT* object, YR_OBJECT** object_copy)
 
       FAIL_ON_ERROR_WITH_CLEANUP(yr_object_structure_set_member(copy, o),
                                  // cleanup
-                                 yr_free(o);
+                                 yr_object_destroy(o);
                                  yr_object_destroy(copy));
 
       structure_member = structure_member->next;
@@ -641,7 +753,8 @@ int yr_object_structure_set_member(YR_OBJECT* object, YR_OBJECT* member)
   if (yr_object_lookup_field(object, member->identifier) != NULL)
     return ERROR_DUPLICATED_STRUCTURE_MEMBER;
 
-  sm = (YR_STRUCTURE_MEMBER*) yr_malloc(sizeof(YR_STRUCTURE_MEMBER));
+  sm = (YR_STRUCTURE_MEMBER*) _yr_object_alloc(
+      object->notebook, sizeof(YR_STRUCTURE_MEMBER));
 
   if (sm == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
@@ -712,7 +825,8 @@ int yr_object_array_set_item(YR_OBJECT* object, YR_OBJECT* item, int index)
 
     while (capacity <= index) capacity *= 2;
 
-    array->items = (YR_ARRAY_ITEMS*) yr_malloc(
+    array->items = (YR_ARRAY_ITEMS*) _yr_object_alloc(
+        object->notebook,
         sizeof(YR_ARRAY_ITEMS) + capacity * sizeof(YR_OBJECT*));
 
     if (array->items == NULL)
@@ -729,8 +843,11 @@ int yr_object_array_set_item(YR_OBJECT* object, YR_OBJECT* item, int index)
 
     while (capacity <= index) capacity *= 2;
 
-    array->items = (YR_ARRAY_ITEMS*) yr_realloc(
-        array->items, sizeof(YR_ARRAY_ITEMS) + capacity * sizeof(YR_OBJECT*));
+    array->items = (YR_ARRAY_ITEMS*) _yr_object_realloc(
+        object->notebook,
+        array->items,
+        sizeof(YR_ARRAY_ITEMS) + array->items->capacity * sizeof(YR_OBJECT*),
+        sizeof(YR_ARRAY_ITEMS) + capacity * sizeof(YR_OBJECT*));
 
     if (array->items == NULL)
       return ERROR_INSUFFICIENT_MEMORY;
@@ -796,7 +913,8 @@ int yr_object_dict_set_item(YR_OBJECT* object, YR_OBJECT* item, const char* key)
   {
     count = 64;
 
-    dict->items = (YR_DICTIONARY_ITEMS*) yr_malloc(
+    dict->items = (YR_DICTIONARY_ITEMS*) _yr_object_alloc(
+        object->notebook,
         sizeof(YR_DICTIONARY_ITEMS) + count * sizeof(dict->items->objects[0]));
 
     if (dict->items == NULL)
@@ -810,8 +928,11 @@ int yr_object_dict_set_item(YR_OBJECT* object, YR_OBJECT* item, const char* key)
   else if (dict->items->free == 0)
   {
     count = dict->items->used * 2;
-    dict->items = (YR_DICTIONARY_ITEMS*) yr_realloc(
+    dict->items = (YR_DICTIONARY_ITEMS*) _yr_object_realloc(
+        object->notebook,
         dict->items,
+        sizeof(YR_DICTIONARY_ITEMS) +
+            dict->items->used * sizeof(dict->items->objects[0]),
         sizeof(YR_DICTIONARY_ITEMS) + count * sizeof(dict->items->objects[0]));
 
     if (dict->items == NULL)
@@ -828,7 +949,8 @@ int yr_object_dict_set_item(YR_OBJECT* object, YR_OBJECT* item, const char* key)
 
   item->parent = object;
 
-  dict->items->objects[dict->items->used].key = ss_new(key);
+  dict->items->objects[dict->items->used].key = _yr_object_sized_string(
+      object->notebook, key, strlen(key), 0);
   dict->items->objects[dict->items->used].obj = item;
 
   dict->items->used++;
@@ -1034,21 +1156,15 @@ int yr_object_set_string(
   assert(string_obj->type == OBJECT_TYPE_STRING);
 
   if (string_obj->value.ss != NULL)
-    yr_free(string_obj->value.ss);
+    _yr_object_free(string_obj->notebook, string_obj->value.ss);
 
   if (value != NULL)
   {
-    string_obj->value.ss = (SIZED_STRING*) yr_malloc(
-        len + sizeof(SIZED_STRING));
+    string_obj->value.ss = _yr_object_sized_string(
+        string_obj->notebook, value, len, 0);
 
     if (string_obj->value.ss == NULL)
       return ERROR_INSUFFICIENT_MEMORY;
-
-    string_obj->value.ss->length = (uint32_t) len;
-    string_obj->value.ss->flags = 0;
-
-    memcpy(string_obj->value.ss->c_string, value, len);
-    string_obj->value.ss->c_string[len] = '\0';
   }
   else
   {
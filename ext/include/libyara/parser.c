@@ -42,6 +42,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <yara/parser.h>
 #include <yara/re.h>
 #include <yara/strutils.h>
+#include <yara/unaligned.h>
 #include <yara/utils.h>
 
 #define todigit(x)                                        \
@@ -338,8 +339,63 @@ int yr_parser_emit_push_const(yyscan_t yyscanner, uint64_t argument)
     opcode_len += sizeof(uint64_t);
   }
 
-  return yr_arena_write_data(
-      yyget_extra(yyscanner)->arena, YR_CODE_SECTION, opcode, opcode_len, NULL);
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+  compiler->last_push_const_offset =
+      yr_arena_get_current_offset(compiler->arena, YR_CODE_SECTION);
+
+  FAIL_ON_ERROR(yr_arena_write_data(
+      compiler->arena, YR_CODE_SECTION, opcode, opcode_len, NULL));
+
+  compiler->last_push_const_end =
+      yr_arena_get_current_offset(compiler->arena, YR_CODE_SECTION);
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks if the last thing emitted into the code section is the constant
+// pushed by yr_parser_emit_push_const, and if that constant is the given
+// value.
+//
+// Args:
+//   compiler: Pointer to the YR_COMPILER.
+//   value: Value the pushed constant is expected to have.
+//
+// Returns:
+//   true if the push of the constant can be replaced by an immediate operand.
+//
+static bool _yr_parser_ends_with_push_const(YR_COMPILER* compiler, int64_t value)
+{
+  if (value == YR_UNDEFINED || compiler->last_push_const_end == 0 ||
+      compiler->last_push_const_end !=
+          yr_arena_get_current_offset(compiler->arena, YR_CODE_SECTION))
+    return false;
+
+  const uint8_t* code = (const uint8_t*) yr_arena_get_ptr(
+      compiler->arena, YR_CODE_SECTION, compiler->last_push_const_offset);
+
+  uint64_t argument;
+
+  switch (code[0])
+  {
+  case OP_PUSH_8:
+    argument = code[1];
+    break;
+  case OP_PUSH_16:
+    argument = yr_unaligned_u16(code + 1);
+    break;
+  case OP_PUSH_32:
+    argument = yr_unaligned_u32(code + 1);
+    break;
+  case OP_PUSH:
+    argument = yr_unaligned_u64(code + 1);
+    break;
+  default:
+    return false;
+  }
+
+  return argument == (uint64_t) value;
 }
 
 int yr_parser_check_types(
@@ -540,6 +596,13 @@ static int _yr_parser_write_string(
     // variable-length portions.
     modifier.flags &= ~STRING_FLAGS_FIXED_OFFSET;
 
+    // Hex strings without alternatives are verified by yr_re_hex_exec if the
+    // set of positions it must track can't outgrow its fixed-size array,
+    // otherwise they are left to yr_re_fast_exec.
+    if ((modifier.flags & STRING_FLAGS_FAST_REGEXP) &&
+        yr_re_ast_jump_width(re_ast) < YR_RE_HEX_MAX_POSITIONS)
+      modifier.flags |= STRING_FLAGS_HEX_EXEC;
+
     // Save the position where the RE forward code starts for later reference.
     yr_arena_off_t forward_code_start = yr_arena_get_current_offset(
         compiler->arena, YR_RE_CODE_SECTION);
@@ -593,6 +656,17 @@ static int _yr_parser_write_string(
 
   string->flags = modifier.flags;
 
+  if (compiler->atom_quality_callback != NULL)
+  {
+    int quality = yr_atoms_min_quality(&compiler->atoms_config, atom_list);
+
+    if (quality < compiler->string_atom_quality)
+      compiler->string_atom_quality = quality;
+
+    for (atom = atom_list; atom != NULL; atom = atom->next)
+      compiler->string_num_atoms++;
+  }
+
   // Add the string to Aho-Corasick automaton.
   result = yr_ac_add_string(
       compiler->automaton, string, string->idx, atom_list, compiler->arena);
@@ -703,6 +777,9 @@ int yr_parser_reduce_string_declaration(
   YR_RULE* current_rule = _yr_compiler_get_rule_by_idx(
       compiler, compiler->current_rule_idx);
 
+  compiler->string_atom_quality = YR_MAX_ATOM_QUALITY;
+  compiler->string_num_atoms = 0;
+
   // Determine if a string with the same identifier was already defined
   // by searching for the identifier in strings_table.
   uint32_t string_idx = yr_hash_table_lookup_uint32(
@@ -950,6 +1027,16 @@ int yr_parser_reduce_string_declaration(
     yywarning(yyscanner, "string \"%s\" may slow down scanning", identifier);
   }
 
+  if (compiler->atom_quality_callback != NULL)
+  {
+    compiler->atom_quality_callback(
+        current_rule,
+        identifier,
+        compiler->string_atom_quality,
+        compiler->string_num_atoms,
+        compiler->atom_quality_clbk_user_data);
+  }
+
 _exit:
 
   if (re_ast != NULL)
@@ -1223,8 +1310,15 @@ int yr_parser_reduce_string_identifier(
   {
     FAIL_ON_ERROR(yr_parser_lookup_string(yyscanner, identifier, &string));
 
-    FAIL_ON_ERROR(
-        yr_parser_emit_with_arg_reloc(yyscanner, OP_PUSH, string, NULL, NULL));
+    // A plain "$a" is the most common string reference in a condition, it
+    // gets a single instruction with the string as argument instead of an
+    // OP_PUSH followed by OP_FOUND.
+    FAIL_ON_ERROR(yr_parser_emit_with_arg_reloc(
+        yyscanner,
+        instruction == OP_FOUND ? OP_FOUND_STRING : OP_PUSH,
+        string,
+        NULL,
+        NULL));
 
     if (instruction != OP_FOUND)
       string->flags &= ~STRING_FLAGS_SINGLE_MATCH;
@@ -1251,7 +1345,10 @@ int yr_parser_reduce_string_identifier(
       string->flags &= ~STRING_FLAGS_FIXED_OFFSET;
     }
 
-    FAIL_ON_ERROR(yr_parser_emit(yyscanner, instruction, NULL));
+    if (instruction != OP_FOUND)
+    {
+      FAIL_ON_ERROR(yr_parser_emit(yyscanner, instruction, NULL));
+    }
 
     string->flags |= STRING_FLAGS_REFERENCED;
   }
@@ -1373,6 +1470,54 @@ int yr_parser_reduce_import(yyscan_t yyscanner, SIZED_STRING* module_name)
   return ERROR_SUCCESS;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Records that the rules read the given top-level field of a module, the
+// module can skip populating fields that nobody references. Each field is
+// stored once in YR_MODULE_FIELDS_SECTION as a "module.field" string.
+//
+int yr_parser_reference_module_field(
+    yyscan_t yyscanner,
+    const char* module_name,
+    const char* field_name)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+  size_t module_len = strlen(module_name);
+  size_t field_len = strlen(field_name);
+
+  yr_arena_off_t used = yr_arena_get_current_offset(
+      compiler->arena, YR_MODULE_FIELDS_SECTION);
+
+  for (yr_arena_off_t offset = 0; offset < used;)
+  {
+    const char* entry = (const char*) yr_arena_get_ptr(
+        compiler->arena, YR_MODULE_FIELDS_SECTION, offset);
+
+    if (strncmp(entry, module_name, module_len) == 0 &&
+        entry[module_len] == '.' &&
+        strcmp(entry + module_len + 1, field_name) == 0)
+      return ERROR_SUCCESS;
+
+    offset += (yr_arena_off_t) strlen(entry) + 1;
+  }
+
+  char* reference = (char*) yr_malloc(module_len + field_len + 2);
+
+  if (reference == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
+
+  memcpy(reference, module_name, module_len);
+  reference[module_len] = '.';
+  memcpy(reference + module_len + 1, field_name, field_len + 1);
+
+  int result = yr_arena_write_string(
+      compiler->arena, YR_MODULE_FIELDS_SECTION, reference, NULL);
+
+  yr_free(reference);
+
+  return result;
+}
+
 static int _yr_parser_operator_to_opcode(const char* op, int expression_type)
 {
   int opcode = 0;
@@ -1474,8 +1619,34 @@ int yr_parser_reduce_operation(
       expression_type = EXPRESSION_TYPE_INTEGER;
     }
 
-    FAIL_ON_ERROR(yr_parser_emit(
-        yyscanner, _yr_parser_operator_to_opcode(op, expression_type), NULL));
+    int opcode = _yr_parser_operator_to_opcode(op, expression_type);
+
+    // Comparing an integer against a constant, like in "uint16(0) == 0x5A4D"
+    // or "#a > 2", is by far the most common operation in conditions. The
+    // OP_PUSH_* that was just emitted for the constant is dropped and the
+    // constant goes into the comparison itself.
+    if (opcode >= OP_INT_EQ && opcode <= OP_INT_GE &&
+        _yr_parser_ends_with_push_const(
+            compiler, right_operand.value.integer))
+    {
+      FAIL_ON_ERROR(yr_arena_truncate(
+          compiler->arena,
+          YR_CODE_SECTION,
+          compiler->last_push_const_offset));
+
+      compiler->last_push_const_end = 0;
+
+      FAIL_ON_ERROR(yr_parser_emit_with_arg(
+          yyscanner,
+          OP_INT_IMM_BEGIN + (opcode - OP_INT_BEGIN),
+          right_operand.value.integer,
+          NULL,
+          NULL));
+    }
+    else
+    {
+      FAIL_ON_ERROR(yr_parser_emit(yyscanner, opcode, NULL));
+    }
   }
   else if (
       left_operand.type == EXPRESSION_TYPE_STRING &&
@@ -0,0 +1,360 @@
+/*
+Copyright (c) 2026. The YARA Authors. All Rights Reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software without
+specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+#include <yara/ahocorasick.h>
+#include <yara/cpu.h>
+#include <yara/error.h>
+#include <yara/mem.h>
+#include <yara/prefilter.h>
+
+typedef size_t (*YR_PREFILTER_SKIP_FUNC)(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size);
+
+static YR_PREFILTER_SKIP_FUNC _yr_prefilter_skip_func = NULL;
+static const char* _yr_prefilter_implementation = "scalar";
+
+static int _yr_prefilter_ctz(uint32_t mask)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int) index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+static void _yr_prefilter_build_nibbles(
+    const uint8_t* set,
+    uint8_t* low,
+    uint8_t* high)
+{
+  memset(low, 0, 16);
+  memset(high, 0, 16);
+
+  for (int c = 0; c < 256; c++)
+  {
+    if (!set[c])
+      continue;
+
+    if (c < 128)
+      low[c & 0x0F] |= 1 << (c >> 4);
+    else
+      high[c & 0x0F] |= 1 << ((c >> 4) - 8);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the first offset in [offset, size) where the automaton could leave
+// the root state, or size if there's none. This is the reference the
+// vectorized versions must agree with.
+//
+size_t yr_ac_prefilter_skip_scalar(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size)
+{
+  for (size_t i = offset; i < size; i++)
+  {
+    if (prefilter->first[data[i]] &&
+        (!prefilter->use_second || i + 1 >= size ||
+         prefilter->second[data[i + 1]]))
+      return i;
+  }
+
+  return size;
+}
+
+#if defined(YR_CPU_X86)
+
+// Each byte of the result is non-zero if the corresponding byte of "v" is in
+// the set described by the nibble tables. The low 7 bits of the byte select
+// the entry in one of the tables, pshufb returns zero for indexes with the
+// high bit set so only one of the two lookups contributes; the high nibble
+// selects the bit within the entry.
+#define PREFILTER_LOOKUP(BITS, SHUFFLE, AND, OR, XOR, SRLI, SET1, v, lo, hi) \
+  AND(                                                                      \
+      OR(SHUFFLE(lo, AND(v, SET1(0x8F))),                                   \
+         SHUFFLE(hi, XOR(AND(v, SET1(0x8F)), SET1(0x80)))),                 \
+      SHUFFLE(BITS, AND(SRLI(v, 4), SET1(0x0F))))
+
+YR_TARGET("sse4.2")
+static uint32_t _yr_prefilter_mask_sse(
+    const uint8_t* data,
+    __m128i bits,
+    __m128i lo,
+    __m128i hi)
+{
+  __m128i v = _mm_loadu_si128((const __m128i*) data);
+  __m128i m = PREFILTER_LOOKUP(
+      bits,
+      _mm_shuffle_epi8,
+      _mm_and_si128,
+      _mm_or_si128,
+      _mm_xor_si128,
+      _mm_srli_epi16,
+      _mm_set1_epi8,
+      v,
+      lo,
+      hi);
+
+  return ~(uint32_t) _mm_movemask_epi8(
+             _mm_cmpeq_epi8(m, _mm_setzero_si128())) &
+         0xFFFF;
+}
+
+YR_TARGET("sse4.2")
+static size_t _yr_prefilter_skip_sse(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size)
+{
+  const __m128i bits = _mm_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m128i first_lo = _mm_loadu_si128(
+      (const __m128i*) prefilter->first_low);
+  const __m128i first_hi = _mm_loadu_si128(
+      (const __m128i*) prefilter->first_high);
+  const __m128i second_lo = _mm_loadu_si128(
+      (const __m128i*) prefilter->second_low);
+  const __m128i second_hi = _mm_loadu_si128(
+      (const __m128i*) prefilter->second_high);
+
+  size_t i = offset;
+
+  // The second byte of the last position in a block is loaded from i + 16,
+  // so the loop stops one byte earlier than the data allows.
+  while (i + 17 <= size)
+  {
+    uint32_t mask = _yr_prefilter_mask_sse(data + i, bits, first_lo, first_hi);
+
+    if (mask != 0 && prefilter->use_second)
+      mask &= _yr_prefilter_mask_sse(
+          data + i + 1, bits, second_lo, second_hi);
+
+    if (mask != 0)
+      return i + _yr_prefilter_ctz(mask);
+
+    i += 16;
+  }
+
+  return yr_ac_prefilter_skip_scalar(prefilter, data, i, size);
+}
+
+YR_TARGET("avx2")
+static uint32_t _yr_prefilter_mask_avx2(
+    const uint8_t* data,
+    __m256i bits,
+    __m256i lo,
+    __m256i hi)
+{
+  __m256i v = _mm256_loadu_si256((const __m256i*) data);
+  __m256i m = PREFILTER_LOOKUP(
+      bits,
+      _mm256_shuffle_epi8,
+      _mm256_and_si256,
+      _mm256_or_si256,
+      _mm256_xor_si256,
+      _mm256_srli_epi16,
+      _mm256_set1_epi8,
+      v,
+      lo,
+      hi);
+
+  return ~(uint32_t) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(m, _mm256_setzero_si256()));
+}
+
+YR_TARGET("avx2")
+static size_t _yr_prefilter_skip_avx2(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size)
+{
+  // vpshufb works on each 128-bit lane independently, so every table is
+  // repeated in both lanes.
+  const __m256i bits = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m256i first_lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*) prefilter->first_low));
+  const __m256i first_hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*) prefilter->first_high));
+  const __m256i second_lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*) prefilter->second_low));
+  const __m256i second_hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*) prefilter->second_high));
+
+  size_t i = offset;
+
+  while (i + 33 <= size)
+  {
+    uint32_t mask = _yr_prefilter_mask_avx2(
+        data + i, bits, first_lo, first_hi);
+
+    if (mask != 0 && prefilter->use_second)
+      mask &= _yr_prefilter_mask_avx2(
+          data + i + 1, bits, second_lo, second_hi);
+
+    if (mask != 0)
+      return i + _yr_prefilter_ctz(mask);
+
+    i += 32;
+  }
+
+  return _yr_prefilter_skip_sse(prefilter, data, i, size);
+}
+
+#endif
+
+static void _yr_prefilter_select_implementation(void)
+{
+  YR_PREFILTER_SKIP_FUNC func = yr_ac_prefilter_skip_scalar;
+  const char* name = "scalar";
+
+#if defined(YR_CPU_X86)
+  if (yr_cpu_has_avx2())
+  {
+    func = _yr_prefilter_skip_avx2;
+    name = "avx2";
+  }
+  else if (yr_cpu_has_sse42())
+  {
+    func = _yr_prefilter_skip_sse;
+    name = "sse4.2";
+  }
+#endif
+
+  // Every thread computes the same values, so a race here is harmless.
+  _yr_prefilter_implementation = name;
+  _yr_prefilter_skip_func = func;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Builds the prefilter for an automaton. If the root state has matches
+// (which happens when some string has no atoms and a zero-length atom was
+// added instead) every offset is a candidate and *prefilter is set to NULL.
+//
+// Args:
+//   transition_table: The automaton's transition table.
+//   match_table: The automaton's match table.
+//   prefilter: Receives the new prefilter, or NULL if it can't be used.
+//
+// Returns:
+//   ERROR_SUCCESS or ERROR_INSUFFICIENT_MEMORY.
+//
+int yr_ac_prefilter_create(
+    const YR_AC_TRANSITION* transition_table,
+    const uint32_t* match_table,
+    YR_AC_PREFILTER** prefilter)
+{
+  *prefilter = NULL;
+
+  if (transition_table == NULL || match_table == NULL ||
+      match_table[YR_AC_ROOT_STATE] != 0)
+    return ERROR_SUCCESS;
+
+  YR_AC_PREFILTER* new_prefilter = (YR_AC_PREFILTER*) yr_calloc(
+      1, sizeof(YR_AC_PREFILTER));
+
+  if (new_prefilter == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
+
+  new_prefilter->use_second = true;
+
+  for (int c = 0; c < 256; c++)
+  {
+    YR_AC_TRANSITION transition =
+        transition_table[YR_AC_ROOT_STATE + c + 1];
+
+    if (YR_AC_INVALID_TRANSITION(transition, c + 1))
+      continue;
+
+    uint32_t state = YR_AC_NEXT_STATE(transition);
+
+    new_prefilter->first[c] = 1;
+
+    // An atom of length one matches in a depth-1 state, the byte after it
+    // can't be used for filtering.
+    if (match_table[state] != 0)
+      new_prefilter->use_second = false;
+
+    for (int d = 0; d < 256; d++)
+    {
+      if (!YR_AC_INVALID_TRANSITION(transition_table[state + d + 1], d + 1))
+        new_prefilter->second[d] = 1;
+    }
+  }
+
+  _yr_prefilter_build_nibbles(
+      new_prefilter->first,
+      new_prefilter->first_low,
+      new_prefilter->first_high);
+
+  _yr_prefilter_build_nibbles(
+      new_prefilter->second,
+      new_prefilter->second_low,
+      new_prefilter->second_high);
+
+  if (_yr_prefilter_skip_func == NULL)
+    _yr_prefilter_select_implementation();
+
+  *prefilter = new_prefilter;
+
+  return ERROR_SUCCESS;
+}
+
+void yr_ac_prefilter_destroy(YR_AC_PREFILTER* prefilter)
+{
+  yr_free(prefilter);
+}
+
+size_t yr_ac_prefilter_skip(
+    const YR_AC_PREFILTER* prefilter,
+    const uint8_t* data,
+    size_t offset,
+    size_t size)
+{
+  return _yr_prefilter_skip_func(prefilter, data, offset, size);
+}
+
+YR_API const char* yr_ac_prefilter_implementation(void)
+{
+  if (_yr_prefilter_skip_func == NULL)
+    _yr_prefilter_select_implementation();
+
+  return _yr_prefilter_implementation;
+}
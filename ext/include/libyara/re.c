@@ -40,6 +40,7 @@ order to avoid confusion with operating system threads.
 #include <assert.h>
 #include <string.h>
 #include <yara/compiler.h>
+#include <yara/cpu.h>
 #include <yara/error.h>
 #include <yara/globals.h>
 #include <yara/hex_lexer.h>
@@ -47,6 +48,7 @@ order to avoid confusion with operating system threads.
 #include <yara/mem.h>
 #include <yara/re.h>
 #include <yara/re_lexer.h>
+#include <yara/scan.h>
 #include <yara/strutils.h>
 #include <yara/threading.h>
 #include <yara/unaligned.h>
@@ -398,6 +400,32 @@ int yr_re_ast_has_unbounded_quantifier_for_dot(RE_AST* re_ast)
   return _yr_re_node_has_unbounded_quantifier_for_dot(re_ast->root_node);
 }
 
+static int64_t _yr_re_node_jump_width(RE_NODE* re_node)
+{
+  int64_t width = 0;
+
+  if (re_node->type == RE_NODE_RANGE_ANY)
+    width = (int64_t) re_node->end - re_node->start;
+
+  for (RE_NODE* child = re_node->children_head; child != NULL;
+       child = child->next_sibling)
+  {
+    width += _yr_re_node_jump_width(child);
+  }
+
+  return width;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the sum of the widths (max - min) of all the jumps in a hex string,
+// which bounds the number of different lengths a match of the string can
+// have. For { 01 [2-4] 02 [0-1] 03 } the result is 3.
+//
+int64_t yr_re_ast_jump_width(RE_AST* re_ast)
+{
+  return _yr_re_node_jump_width(re_ast->root_node);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // In some cases splitting a regular expression (or hex string) in two parts is
 // convenient for increasing performance. This happens when the pattern contains
@@ -1662,226 +1690,1102 @@ static int _yr_re_fiber_sync(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Executes a regular expression. The specified regular expression will try to
-// match the data starting at the address specified by "input". The "input"
-// pointer can point to any address inside a memory buffer. Arguments
-// "input_forwards_size" and "input_backwards_size" indicate how many bytes
-// can be accessible starting at "input" and going forwards and backwards
-// respectively.
+// Lazy DFA used by yr_re_exec.
 //
-//   <--- input_backwards_size -->|<----------- input_forwards_size -------->
-//  |--------  memory buffer  -----------------------------------------------|
-//                                ^
-//                              input
+// At the start of every input position the fiber list of yr_re_exec is fully
+// determined by the fibers that were alive at the previous position and the
+// byte that was read, as long as the program doesn't have instructions that
+// look at the position itself (anchors and word boundaries). For such programs
+// each distinct fiber list is a DFA state, identified by a snapshot of its
+// fibers in order (ip, rc and stack), and transitions are computed on demand
+// by running the same steps as the fiber engine over a single byte. Once a
+// transition is known, consuming a byte costs a table lookup instead of a walk
+// over every live fiber.
+//
+// The snapshot only keeps the fibers that survive the processing of MATCH
+// instructions at that position: without RE_FLAGS_EXHAUSTIVE those after the
+// first MATCH fiber are killed, with it only the MATCH fibers themselves.
+//
+// Programs with bounded repetitions like [a-z]{1,200} keep a counter in their
+// fibers and may produce a new state at almost every position. A DFA that
+// builds many states but rarely reuses them is abandoned and its program runs
+// with fibers only. yr_re_exec also resumes with fibers, created from the
+// current state, when a state can't be built.
 //
-// Args:
-//   YR_SCAN_CONTEXT *context         - Scan context.
-//   const uint8_t* code              - Regexp code be executed
-//   const uint8_t* input             - Pointer to input data
-//   size_t input_forwards_size       - Number of accessible bytes starting at
-//                                      "input" and going forwards.
-//   size_t input_backwards_size      - Number of accessible bytes starting at
-//                                      "input" and going backwards
-//   int flags                        - Flags:
-//      RE_FLAGS_SCAN
-//      RE_FLAGS_BACKWARDS
-//      RE_FLAGS_EXHAUSTIVE
-//      RE_FLAGS_WIDE
-//      RE_FLAGS_NO_CASE
-//      RE_FLAGS_DOT_ALL
-//   RE_MATCH_CALLBACK_FUNC callback  - Callback function
-//   void* callback_args              - Callback argument
-//   int*  matches                    - Pointer to an integer receiving the
-//                                      number of matching bytes. Notice that
-//                                      0 means a zero-length match, while no
-//                                      matches is -1.
-// Returns:
-//    ERROR_SUCCESS or any other error code.
 
-int yr_re_exec(
-    YR_SCAN_CONTEXT* context,
-    const uint8_t* code,
-    const uint8_t* input_data,
-    size_t input_forwards_size,
-    size_t input_backwards_size,
-    int flags,
-    RE_MATCH_CALLBACK_FUNC callback,
-    void* callback_args,
-    int* matches)
+#define RE_DFA_PROGRAM_BUCKETS 1024
+#define RE_DFA_STATE_BUCKETS   4096
+
+// A DFA is abandoned once it has built RE_DFA_MIN_BUILT transitions and it
+// took less than RE_DFA_MIN_REUSE cached transitions per transition built.
+#define RE_DFA_MIN_BUILT 512
+#define RE_DFA_MIN_REUSE 8
+
+// Programs with more reachable instructions than this run with fibers.
+#define RE_DFA_MAX_INSTRUCTIONS 1024
+
+// Flags that change the transitions of a program. RE_FLAGS_WIDE and
+// RE_FLAGS_BACKWARDS only change how the input is walked.
+#define RE_DFA_FLAGS (RE_FLAGS_NO_CASE | RE_FLAGS_DOT_ALL | RE_FLAGS_EXHAUSTIVE)
+
+typedef struct _RE_DFA RE_DFA;
+typedef struct _RE_DFA_STATE RE_DFA_STATE;
+
+struct _RE_DFA_STATE
 {
-  const uint8_t* input;
-  const uint8_t* ip;
+  // Next state in the same bucket of the cache's state table.
+  RE_DFA_STATE* next;
+  RE_DFA* dfa;
 
-  uint16_t opcode_args;
-  uint8_t mask;
-  uint8_t value;
-  uint8_t character_size;
+  uint32_t hash;
 
-  RE_FIBER_LIST fibers;
-  RE_FIBER* fiber;
-  RE_FIBER* next_fiber;
+  // Number of MATCH fibers at this position.
+  uint32_t matches;
 
-  int bytes_matched;
-  int max_bytes_matched;
+  // Number of fibers still alive after the MATCH fibers were processed, 0
+  // means that the state is a dead end.
+  uint32_t num_fibers;
 
-  int match;
-  int input_incr;
-  int kill;
-  int action;
+  // Number of words in "fibers". Each fiber is stored as its ip relative to
+  // the start of the program, rc, sp and the sp + 1 values in its stack.
+  uint32_t num_words;
+  int32_t* fibers;
 
-  bool prev_is_word_char = false;
-  bool input_is_word_char = false;
+  // One entry per byte class of the DFA, followed by the fiber words.
+  RE_DFA_STATE* transitions[1];
+};
 
-#define ACTION_NONE      0
-#define ACTION_CONTINUE  1
-#define ACTION_KILL      2
-#define ACTION_KILL_TAIL 3
+struct _RE_DFA
+{
+  const uint8_t* code;
+  int flags;
 
-#define prolog                                      \
-  {                                                 \
-    if ((bytes_matched >= max_bytes_matched) ||     \
-        (character_size == 2 && *(input + 1) != 0)) \
-    {                                               \
-      action = ACTION_KILL;                         \
-      break;                                        \
-    }                                               \
-  }
+  // Set for programs with instructions the DFA can't handle, programs whose
+  // fiber lists are too large to be snapshotted and DFAs that were abandoned.
+  bool unsupported;
 
-  if (matches != NULL)
-    *matches = -1;
+  // Bytes that no instruction in the program can tell apart share a class,
+  // and states have one transition per class.
+  uint8_t classes[256];
+  uint32_t num_classes;
 
-  if (flags & RE_FLAGS_WIDE)
-    character_size = 2;
-  else
-    character_size = 1;
+  // Transitions built and transitions taken from the cache.
+  uint64_t built;
+  uint64_t reused;
 
-  input = input_data;
-  input_incr = character_size;
+  RE_DFA_STATE* start;
+  RE_DFA* next;
+};
 
-  if (flags & RE_FLAGS_BACKWARDS)
+struct RE_DFA_CACHE
+{
+  RE_DFA* programs[RE_DFA_PROGRAM_BUCKETS];
+  RE_DFA_STATE* states[RE_DFA_STATE_BUCKETS];
+
+  // Bytes used by the states in the cache.
+  size_t size;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the size of the instruction at "ip", or 0 if the DFA can't handle
+// it. Anchors and word boundaries depend on the position in the input.
+//
+static size_t _yr_re_dfa_instruction_size(const uint8_t* ip)
+{
+  switch (*ip)
   {
-    // Signedness conversion is sound as long as YR_RE_SCAN_LIMIT <= INT_MAX
-    max_bytes_matched = (int) yr_min(input_backwards_size, YR_RE_SCAN_LIMIT);
-    input -= character_size;
-    input_incr = -input_incr;
+  case RE_OPCODE_MATCH:
+  case RE_OPCODE_ANY:
+  case RE_OPCODE_WORD_CHAR:
+  case RE_OPCODE_NON_WORD_CHAR:
+  case RE_OPCODE_SPACE:
+  case RE_OPCODE_NON_SPACE:
+  case RE_OPCODE_DIGIT:
+  case RE_OPCODE_NON_DIGIT:
+    return 1;
+
+  case RE_OPCODE_LITERAL:
+  case RE_OPCODE_NOT_LITERAL:
+    return 2;
+
+  case RE_OPCODE_MASKED_LITERAL:
+  case RE_OPCODE_MASKED_NOT_LITERAL:
+  case RE_OPCODE_JUMP:
+    return 3;
+
+  case RE_OPCODE_CLASS:
+    return sizeof(RE_CLASS) + 1;
+
+  case RE_OPCODE_REPEAT_ANY_GREEDY:
+  case RE_OPCODE_REPEAT_ANY_UNGREEDY:
+    return 1 + sizeof(RE_REPEAT_ANY_ARGS);
+
+  case RE_OPCODE_SPLIT_A:
+  case RE_OPCODE_SPLIT_B:
+    return sizeof(RE_SPLIT_ID_TYPE) + 3;
+
+  case RE_OPCODE_REPEAT_START_GREEDY:
+  case RE_OPCODE_REPEAT_START_UNGREEDY:
+  case RE_OPCODE_REPEAT_END_GREEDY:
+  case RE_OPCODE_REPEAT_END_UNGREEDY:
+    return 1 + sizeof(RE_REPEAT_ARGS);
   }
-  else
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns true if "byte" is accepted by the instruction at "ip", which must
+// be one that consumes input. This is the same test done by yr_re_exec once
+// the prolog has checked that there is input left. With wide strings the
+// byte after a character is always zero at that point, so the result only
+// depends on the character itself.
+//
+static bool _yr_re_dfa_instruction_matches(
+    const uint8_t* ip,
+    uint8_t byte,
+    int flags)
+{
+  uint16_t opcode_args;
+
+  switch (*ip)
   {
-    // Signedness conversion is sound as long as YR_RE_SCAN_LIMIT <= INT_MAX
-    max_bytes_matched = (int) yr_min(input_forwards_size, YR_RE_SCAN_LIMIT);
+  case RE_OPCODE_ANY:
+  case RE_OPCODE_REPEAT_ANY_GREEDY:
+  case RE_OPCODE_REPEAT_ANY_UNGREEDY:
+    return (flags & RE_FLAGS_DOT_ALL) || (byte != 0x0A);
+
+  case RE_OPCODE_LITERAL:
+    if (flags & RE_FLAGS_NO_CASE)
+      return yr_lowercase[byte] == yr_lowercase[*(ip + 1)];
+    return byte == *(ip + 1);
+
+  case RE_OPCODE_NOT_LITERAL:
+    return byte != *(ip + 1);
+
+  case RE_OPCODE_MASKED_LITERAL:
+    opcode_args = yr_unaligned_u16(ip + 1);
+    return (byte & (opcode_args >> 8)) == (opcode_args & 0xFF);
+
+  case RE_OPCODE_MASKED_NOT_LITERAL:
+    opcode_args = yr_unaligned_u16(ip + 1);
+    return (byte & (opcode_args >> 8)) != (opcode_args & 0xFF);
+
+  case RE_OPCODE_CLASS:
+    return _yr_re_is_char_in_class(
+        (RE_CLASS*) (ip + 1), byte, flags & RE_FLAGS_NO_CASE);
+
+  case RE_OPCODE_WORD_CHAR:
+    return _yr_re_is_word_char(&byte, 1);
+
+  case RE_OPCODE_NON_WORD_CHAR:
+    return !_yr_re_is_word_char(&byte, 1);
+
+  case RE_OPCODE_SPACE:
+  case RE_OPCODE_NON_SPACE:
+    return (byte == ' ' || byte == '\t' || byte == '\r' || byte == '\n' ||
+            byte == '\v' || byte == '\f') == (*ip == RE_OPCODE_SPACE);
+
+  case RE_OPCODE_DIGIT:
+    return isdigit(byte);
+
+  case RE_OPCODE_NON_DIGIT:
+    return !isdigit(byte);
   }
 
-  // Round down max_bytes_matched to a multiple of character_size, this way if
-  // character_size is 2 and max_bytes_matched is odd we are ignoring the
-  // extra byte which can't match anyways.
+  assert(false);
+  return false;
+}
 
-  max_bytes_matched = max_bytes_matched - max_bytes_matched % character_size;
-  bytes_matched = 0;
+////////////////////////////////////////////////////////////////////////////////
+// Splits the 256 byte values into classes of bytes accepted by exactly the
+// same instructions, over every instruction reachable from the start of the
+// program. Reachability must follow jumps, splits and repeats: the code of an
+// atom's backward or forward verification usually starts in the middle of a
+// larger program, and a loop like (ab|cd)+ jumps back to instructions placed
+// before that start. Returns false if the program has instructions the DFA
+// can't handle or more than RE_DFA_MAX_INSTRUCTIONS reachable instructions.
+//
+static bool _yr_re_dfa_compute_classes(RE_DFA* dfa)
+{
+  const uint8_t** visited;
+  const uint8_t** pending;
+  uint32_t num_visited = 0;
+  uint32_t num_pending = 0;
+  bool supported = true;
 
-  FAIL_ON_ERROR(_yr_re_fiber_create(&context->re_fiber_pool, &fiber));
+  visited = (const uint8_t**) yr_malloc(
+      3 * RE_DFA_MAX_INSTRUCTIONS * sizeof(const uint8_t*));
 
-  fiber->ip = code;
-  fibers.head = fiber;
-  fibers.tail = fiber;
+  if (visited == NULL)
+    return false;
 
-  FAIL_ON_ERROR_WITH_CLEANUP(
-      _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
-      _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+  // Every visited instruction adds at most two pending ones.
+  pending = visited + RE_DFA_MAX_INSTRUCTIONS;
+  pending[num_pending++] = dfa->code;
 
-  while (fibers.head != NULL)
+  memset(dfa->classes, 0, sizeof(dfa->classes));
+  dfa->num_classes = 1;
+
+  while (num_pending > 0 && supported)
   {
-    fiber = fibers.head;
+    const uint8_t* ip = pending[--num_pending];
+    size_t size;
+    bool seen = false;
 
-    while (fiber != NULL)
-    {
-      next_fiber = fiber->next;
+    for (uint32_t i = 0; i < num_visited && !seen; i++)
+      seen = visited[i] == ip;
 
-      if (_yr_re_fiber_exists(&fibers, fiber, fiber->prev))
-        _yr_re_fiber_kill(&fibers, &context->re_fiber_pool, fiber);
+    if (seen)
+      continue;
 
-      fiber = next_fiber;
+    size = _yr_re_dfa_instruction_size(ip);
+
+    if (size == 0 || num_visited == RE_DFA_MAX_INSTRUCTIONS)
+    {
+      supported = false;
+      break;
     }
 
-    fiber = fibers.head;
+    visited[num_visited++] = ip;
 
-    while (fiber != NULL)
+    switch (*ip)
     {
-      ip = fiber->ip;
-      action = ACTION_NONE;
+    case RE_OPCODE_MATCH:
+      break;
 
-      switch (*ip)
-      {
-      case RE_OPCODE_ANY:
-        prolog;
-        match = (flags & RE_FLAGS_DOT_ALL) || (*input != 0x0A);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+    case RE_OPCODE_JUMP:
+      pending[num_pending++] = ip + yr_unaligned_i16(ip + 1);
+      break;
 
-      case RE_OPCODE_REPEAT_ANY_GREEDY:
-      case RE_OPCODE_REPEAT_ANY_UNGREEDY:
-        prolog;
-        match = (flags & RE_FLAGS_DOT_ALL) || (*input != 0x0A);
-        action = match ? ACTION_NONE : ACTION_KILL;
+    case RE_OPCODE_SPLIT_A:
+    case RE_OPCODE_SPLIT_B:
+      pending[num_pending++] = ip + size;
+      pending[num_pending++] =
+          ip + yr_unaligned_i16(ip + 1 + sizeof(RE_SPLIT_ID_TYPE));
+      break;
 
-        // The instruction pointer is not incremented here. The current fiber
-        // spins in this instruction until reaching the required number of
-        // repetitions. The code controlling the number of repetitions is in
-        // _yr_re_fiber_sync.
+    case RE_OPCODE_REPEAT_START_GREEDY:
+    case RE_OPCODE_REPEAT_START_UNGREEDY:
+    case RE_OPCODE_REPEAT_END_GREEDY:
+    case RE_OPCODE_REPEAT_END_UNGREEDY:
+      pending[num_pending++] = ip + size;
+      pending[num_pending++] = ip + ((RE_REPEAT_ARGS*) (ip + 1))->offset;
+      break;
 
-        break;
+    default:
+    {
+      // Every existing class is split into the bytes accepted by the
+      // instruction and the bytes rejected by it.
+      int16_t accepted[256];
+      int16_t rejected[256];
+      uint32_t num_classes = 0;
 
-      case RE_OPCODE_LITERAL:
-        prolog;
-        if (flags & RE_FLAGS_NO_CASE)
-          match = yr_lowercase[*input] == yr_lowercase[*(ip + 1)];
-        else
-          match = (*input == *(ip + 1));
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 2;
-        break;
+      memset(accepted, -1, sizeof(accepted));
+      memset(rejected, -1, sizeof(rejected));
 
-      case RE_OPCODE_NOT_LITERAL:
-        prolog;
+      for (int c = 0; c < 256; c++)
+      {
+        int16_t* split = _yr_re_dfa_instruction_matches(ip, c, dfa->flags)
+                             ? accepted
+                             : rejected;
 
-        // We don't need to take into account the case-insensitive
-        // case because this opcode is only used with hex strings,
-        // which can't be case-insensitive.
+        if (split[dfa->classes[c]] == -1)
+          split[dfa->classes[c]] = num_classes++;
 
-        match = (*input != *(ip + 1));
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 2;
-        break;
+        dfa->classes[c] = (uint8_t) split[dfa->classes[c]];
+      }
 
-      case RE_OPCODE_MASKED_LITERAL:
-        prolog;
-        opcode_args = yr_unaligned_u16(ip + 1);
-        mask = opcode_args >> 8;
-        value = opcode_args & 0xFF;
+      dfa->num_classes = num_classes;
+      pending[num_pending++] = ip + size;
+    }
+    }
+  }
 
-        // We don't need to take into account the case-insensitive
-        // case because this opcode is only used with hex strings,
-        // which can't be case-insensitive.
+  yr_free(visited);
 
-        match = ((*input & mask) == value);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 3;
-        break;
+  return supported;
+}
 
-      case RE_OPCODE_MASKED_NOT_LITERAL:
-        prolog;
-        opcode_args = yr_unaligned_u16(ip + 1);
-        mask = opcode_args >> 8;
-        value = opcode_args & 0xFF;
+////////////////////////////////////////////////////////////////////////////////
+// Frees every state in the cache. Programs are kept, but their start states
+// must be built again.
+//
+static void _yr_re_dfa_cache_flush(RE_DFA_CACHE* cache)
+{
+  for (int i = 0; i < RE_DFA_STATE_BUCKETS; i++)
+  {
+    RE_DFA_STATE* state = cache->states[i];
 
-        // We don't need to take into account the case-insensitive
-        // case because this opcode is only used with hex strings,
-        // which can't be case-insensitive.
+    while (state != NULL)
+    {
+      RE_DFA_STATE* next = state->next;
+      yr_free(state);
+      state = next;
+    }
 
-        match = ((*input & mask) != value);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 3;
-        break;
+    cache->states[i] = NULL;
+  }
+
+  for (int i = 0; i < RE_DFA_PROGRAM_BUCKETS; i++)
+  {
+    for (RE_DFA* dfa = cache->programs[i]; dfa != NULL; dfa = dfa->next)
+      dfa->start = NULL;
+  }
+
+  cache->size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroys a DFA cache created by yr_re_exec.
+//
+// Args:
+//   RE_DFA_CACHE* cache  - Pointer to the cache, can be NULL.
+//
+void yr_re_dfa_cache_destroy(RE_DFA_CACHE* cache)
+{
+  if (cache == NULL)
+    return;
+
+  _yr_re_dfa_cache_flush(cache);
+
+  for (int i = 0; i < RE_DFA_PROGRAM_BUCKETS; i++)
+  {
+    RE_DFA* dfa = cache->programs[i];
+
+    while (dfa != NULL)
+    {
+      RE_DFA* next = dfa->next;
+      yr_free(dfa);
+      dfa = next;
+    }
+  }
+
+  yr_free(cache);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the DFA for the given program and flags, creating it if needed.
+// The DFA is NULL if the program must be executed with fibers.
+//
+static int _yr_re_dfa_get(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    int flags,
+    RE_DFA** dfa)
+{
+  RE_DFA_CACHE* cache = context->re_dfa_cache;
+  uint32_t bucket;
+
+  flags &= RE_DFA_FLAGS;
+
+  if (cache == NULL)
+  {
+    cache = (RE_DFA_CACHE*) yr_calloc(1, sizeof(RE_DFA_CACHE));
+
+    if (cache == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
+
+    context->re_dfa_cache = cache;
+  }
+
+  bucket = (uint32_t) (((uintptr_t) code >> 2) ^ flags) % RE_DFA_PROGRAM_BUCKETS;
+
+  for (*dfa = cache->programs[bucket]; *dfa != NULL; *dfa = (*dfa)->next)
+  {
+    if ((*dfa)->code == code && (*dfa)->flags == flags)
+      break;
+  }
+
+  if (*dfa == NULL)
+  {
+    *dfa = (RE_DFA*) yr_calloc(1, sizeof(RE_DFA));
+
+    if (*dfa == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
+
+    (*dfa)->code = code;
+    (*dfa)->flags = flags;
+    (*dfa)->unsupported = !_yr_re_dfa_compute_classes(*dfa);
+    (*dfa)->next = cache->programs[bucket];
+
+    cache->programs[bucket] = *dfa;
+  }
+
+  if ((*dfa)->unsupported)
+    *dfa = NULL;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Takes the fibers alive at the start of a position and writes the snapshot
+// that identifies the corresponding DFA state into "words". The fiber list
+// is emptied. Returns false if the snapshot doesn't fit in
+// RE_DFA_MAX_STATE_WORDS words.
+//
+static bool _yr_re_dfa_snapshot(
+    RE_DFA* dfa,
+    RE_FIBER_LIST* fibers,
+    RE_FIBER_POOL* fiber_pool,
+    int32_t* words,
+    uint32_t* num_words,
+    uint32_t* num_fibers,
+    uint32_t* matches)
+{
+  RE_FIBER* fiber = fibers->head;
+  bool fits = true;
+
+  *num_words = 0;
+  *num_fibers = 0;
+  *matches = 0;
+
+  while (fiber != NULL && fits)
+  {
+    if (*fiber->ip == RE_OPCODE_MATCH)
+    {
+      (*matches)++;
+
+      // Without RE_FLAGS_EXHAUSTIVE the first MATCH fiber kills every fiber
+      // after it, see ACTION_KILL_TAIL in yr_re_exec.
+      if (!(dfa->flags & RE_FLAGS_EXHAUSTIVE))
+        break;
+    }
+    else if (*num_words + 4 + fiber->sp > RE_DFA_MAX_STATE_WORDS)
+    {
+      fits = false;
+    }
+    else
+    {
+      words[(*num_words)++] = (int32_t) (fiber->ip - dfa->code);
+      words[(*num_words)++] = fiber->rc;
+      words[(*num_words)++] = fiber->sp;
+
+      for (int32_t i = 0; i <= fiber->sp; i++)
+        words[(*num_words)++] = fiber->stack[i];
+
+      (*num_fibers)++;
+    }
+
+    fiber = fiber->next;
+  }
+
+  _yr_re_fiber_kill_all(fibers, fiber_pool);
+
+  return fits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Creates the fibers described by a state, in the same order. These are the
+// fibers that are still alive after MATCH instructions were processed.
+//
+static int _yr_re_dfa_materialize(
+    YR_SCAN_CONTEXT* context,
+    RE_DFA_STATE* state,
+    RE_FIBER_LIST* fibers)
+{
+  RE_FIBER* fiber;
+  uint32_t w = 0;
+
+  for (uint32_t f = 0; f < state->num_fibers; f++)
+  {
+    FAIL_ON_ERROR_WITH_CLEANUP(
+        _yr_re_fiber_create(&context->re_fiber_pool, &fiber),
+        _yr_re_fiber_kill_all(fibers, &context->re_fiber_pool));
+
+    fiber->ip = state->dfa->code + state->fibers[w++];
+    fiber->rc = state->fibers[w++];
+    fiber->sp = state->fibers[w++];
+
+    for (int32_t i = 0; i <= fiber->sp; i++)
+      fiber->stack[i] = (uint16_t) state->fibers[w++];
+
+    _yr_re_fiber_append(fibers, fiber);
+  }
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Kills the fibers that are equal to some previous fiber in the list, like
+// yr_re_exec does at the start of every position.
+//
+static void _yr_re_dfa_dedup(RE_FIBER_LIST* fibers, RE_FIBER_POOL* fiber_pool)
+{
+  RE_FIBER* fiber = fibers->head;
+
+  while (fiber != NULL)
+  {
+    RE_FIBER* next_fiber = fiber->next;
+
+    if (_yr_re_fiber_exists(fibers, fiber, fiber->prev))
+      _yr_re_fiber_kill(fibers, fiber_pool, fiber);
+
+    fiber = next_fiber;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns the state with the given snapshot, adding it to the cache if it is
+// not there yet. When the cache is full all its states are discarded first,
+// unless "may_flush" is false, in which case "state" is set to NULL.
+//
+static int _yr_re_dfa_intern(
+    RE_DFA_CACHE* cache,
+    RE_DFA* dfa,
+    const int32_t* words,
+    uint32_t num_words,
+    uint32_t num_fibers,
+    uint32_t matches,
+    bool may_flush,
+    bool* flushed,
+    RE_DFA_STATE** state)
+{
+  uint32_t hash = 2166136261u ^ (uint32_t) ((uintptr_t) dfa >> 4) ^ matches;
+  size_t state_size;
+
+  for (uint32_t i = 0; i < num_words; i++)
+    hash = (hash ^ (uint32_t) words[i]) * 16777619u;
+
+  *flushed = false;
+
+  for (*state = cache->states[hash % RE_DFA_STATE_BUCKETS]; *state != NULL;
+       *state = (*state)->next)
+  {
+    if ((*state)->hash == hash && (*state)->dfa == dfa &&
+        (*state)->matches == matches && (*state)->num_words == num_words &&
+        memcmp((*state)->fibers, words, num_words * sizeof(int32_t)) == 0)
+      return ERROR_SUCCESS;
+  }
+
+  state_size = sizeof(RE_DFA_STATE) +
+               (dfa->num_classes - 1) * sizeof(RE_DFA_STATE*) +
+               num_words * sizeof(int32_t);
+
+  if (cache->size + state_size > RE_DFA_CACHE_SIZE)
+  {
+    if (!may_flush)
+      return ERROR_SUCCESS;
+
+    _yr_re_dfa_cache_flush(cache);
+    *flushed = true;
+  }
+
+  *state = (RE_DFA_STATE*) yr_calloc(1, state_size);
+
+  if (*state == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
+
+  (*state)->dfa = dfa;
+  (*state)->hash = hash;
+  (*state)->matches = matches;
+  (*state)->num_fibers = num_fibers;
+  (*state)->num_words = num_words;
+  (*state)->fibers = (int32_t*) &(*state)->transitions[dfa->num_classes];
+
+  if (num_words > 0)
+    memcpy((*state)->fibers, words, num_words * sizeof(int32_t));
+
+  (*state)->next = cache->states[hash % RE_DFA_STATE_BUCKETS];
+  cache->states[hash % RE_DFA_STATE_BUCKETS] = *state;
+  cache->size += state_size;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Builds the start state of a DFA. The DFA is marked as unsupported when the
+// initial fiber list is too large for a snapshot.
+//
+static int _yr_re_dfa_start(YR_SCAN_CONTEXT* context, RE_DFA* dfa)
+{
+  int32_t words[RE_DFA_MAX_STATE_WORDS];
+  uint32_t num_words, num_fibers, matches;
+  bool flushed;
+
+  RE_FIBER_LIST fibers;
+  RE_FIBER* fiber;
+
+  FAIL_ON_ERROR(_yr_re_fiber_create(&context->re_fiber_pool, &fiber));
+
+  fiber->ip = dfa->code;
+  fibers.head = fiber;
+  fibers.tail = fiber;
+
+  FAIL_ON_ERROR_WITH_CLEANUP(
+      _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
+      _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+
+  _yr_re_dfa_dedup(&fibers, &context->re_fiber_pool);
+
+  if (!_yr_re_dfa_snapshot(
+          dfa,
+          &fibers,
+          &context->re_fiber_pool,
+          words,
+          &num_words,
+          &num_fibers,
+          &matches))
+  {
+    dfa->unsupported = true;
+    return ERROR_SUCCESS;
+  }
+
+  return _yr_re_dfa_intern(
+      context->re_dfa_cache,
+      dfa,
+      words,
+      num_words,
+      num_fibers,
+      matches,
+      true,
+      &flushed,
+      &dfa->start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Computes the state reached from "state" after reading "byte". This is the
+// body of the main loop in yr_re_exec for the instructions that consume
+// input, followed by the deduplication done at the start of the next
+// position. "next" is NULL if the state can't be built, either because the
+// snapshot is too large or because the cache was already flushed during the
+// current execution and is full again.
+//
+static int _yr_re_dfa_transition(
+    YR_SCAN_CONTEXT* context,
+    RE_DFA_STATE* state,
+    uint8_t byte,
+    bool* flushed,
+    RE_DFA_STATE** next)
+{
+  RE_DFA* dfa = state->dfa;
+  RE_FIBER_POOL* fiber_pool = &context->re_fiber_pool;
+  RE_FIBER_LIST fibers;
+  RE_FIBER* fiber;
+  RE_FIBER* next_fiber;
+
+  int32_t words[RE_DFA_MAX_STATE_WORDS];
+  uint32_t num_words, num_fibers, matches;
+  bool may_flush = !*flushed;
+
+  fibers.head = NULL;
+  fibers.tail = NULL;
+
+  *next = NULL;
+
+  FAIL_ON_ERROR(_yr_re_dfa_materialize(context, state, &fibers));
+
+  fiber = fibers.head;
+
+  while (fiber != NULL)
+  {
+    if (_yr_re_dfa_instruction_matches(fiber->ip, byte, dfa->flags))
+    {
+      // Fibers in a RE_OPCODE_REPEAT_ANY_* instruction spin in it, the
+      // number of repetitions is handled by _yr_re_fiber_sync.
+      if (*fiber->ip != RE_OPCODE_REPEAT_ANY_GREEDY &&
+          *fiber->ip != RE_OPCODE_REPEAT_ANY_UNGREEDY)
+        fiber->ip += _yr_re_dfa_instruction_size(fiber->ip);
+
+      next_fiber = fiber->next;
+
+      FAIL_ON_ERROR_WITH_CLEANUP(
+          _yr_re_fiber_sync(&fibers, fiber_pool, fiber),
+          _yr_re_fiber_kill_all(&fibers, fiber_pool));
+
+      fiber = next_fiber;
+    }
+    else
+    {
+      fiber = _yr_re_fiber_kill(&fibers, fiber_pool, fiber);
+    }
+  }
+
+  _yr_re_dfa_dedup(&fibers, fiber_pool);
+
+  if (!_yr_re_dfa_snapshot(
+          dfa, &fibers, fiber_pool, words, &num_words, &num_fibers, &matches))
+  {
+    dfa->unsupported = true;
+    return ERROR_SUCCESS;
+  }
+
+  FAIL_ON_ERROR(_yr_re_dfa_intern(
+      context->re_dfa_cache,
+      dfa,
+      words,
+      num_words,
+      num_fibers,
+      matches,
+      may_flush,
+      flushed,
+      next));
+
+  // A flush frees "state", the transition can only be recorded if it is
+  // still there.
+  if (*next != NULL && !*flushed)
+    state->transitions[dfa->classes[byte]] = *next;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs a program with its DFA. "handled" is set to true if the DFA went over
+// the whole input. Otherwise the caller must run the fiber engine: from the
+// start when "fibers" is empty, or else with the given fibers from the
+// position indicated by "input" and "bytes_matched".
+//
+static int _yr_re_dfa_exec(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    const uint8_t* input_data,
+    int flags,
+    uint8_t character_size,
+    int max_bytes_matched,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args,
+    int* matches,
+    RE_FIBER_LIST* fibers,
+    const uint8_t** input,
+    int* bytes_matched,
+    bool* handled)
+{
+  RE_DFA* dfa;
+  RE_DFA_STATE* state;
+  RE_DFA_STATE* next;
+
+  int input_incr = (flags & RE_FLAGS_BACKWARDS) ? -character_size
+                                                 : character_size;
+  uint64_t reused = 0;
+  bool flushed = false;
+
+  *handled = false;
+
+  FAIL_ON_ERROR(_yr_re_dfa_get(context, code, flags, &dfa));
+
+  if (dfa == NULL)
+    return ERROR_SUCCESS;
+
+  if (dfa->start == NULL)
+    FAIL_ON_ERROR(_yr_re_dfa_start(context, dfa));
+
+  if (dfa->start == NULL)
+    return ERROR_SUCCESS;
+
+  state = dfa->start;
+
+  for (;;)
+  {
+    for (uint32_t i = 0; i < state->matches; i++)
+    {
+      if (matches != NULL)
+        *matches = *bytes_matched;
+
+      if ((flags & RE_FLAGS_EXHAUSTIVE) && callback != NULL)
+      {
+        if (flags & RE_FLAGS_BACKWARDS)
+        {
+          FAIL_ON_ERROR(callback(
+              *input + character_size, *bytes_matched, flags, callback_args));
+        }
+        else
+        {
+          FAIL_ON_ERROR(
+              callback(input_data, *bytes_matched, flags, callback_args));
+        }
+      }
+    }
+
+    // Every fiber is killed at the end of the input, and in wide mode when
+    // the second byte of a character is not zero.
+    if (state->num_fibers == 0 || *bytes_matched >= max_bytes_matched ||
+        (character_size == 2 && *(*input + 1) != 0))
+      break;
+
+    next = state->transitions[dfa->classes[**input]];
+
+    if (next != NULL)
+    {
+      reused++;
+    }
+    else
+    {
+      dfa->reused += reused;
+      reused = 0;
+
+      if (++dfa->built >= RE_DFA_MIN_BUILT &&
+          dfa->reused < dfa->built * RE_DFA_MIN_REUSE)
+        dfa->unsupported = true;
+      else
+        FAIL_ON_ERROR(
+            _yr_re_dfa_transition(context, state, **input, &flushed, &next));
+
+      if (next == NULL)
+        return _yr_re_dfa_materialize(context, state, fibers);
+    }
+
+    state = next;
+    *input += input_incr;
+    *bytes_matched += character_size;
+  }
+
+  dfa->reused += reused;
+  *handled = true;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Executes a regular expression. The specified regular expression will try to
+// match the data starting at the address specified by "input". The "input"
+// pointer can point to any address inside a memory buffer. Arguments
+// "input_forwards_size" and "input_backwards_size" indicate how many bytes
+// can be accessible starting at "input" and going forwards and backwards
+// respectively.
+//
+//   <--- input_backwards_size -->|<----------- input_forwards_size -------->
+//  |--------  memory buffer  -----------------------------------------------|
+//                                ^
+//                              input
+//
+// Args:
+//   YR_SCAN_CONTEXT *context         - Scan context.
+//   const uint8_t* code              - Regexp code be executed
+//   const uint8_t* input             - Pointer to input data
+//   size_t input_forwards_size       - Number of accessible bytes starting at
+//                                      "input" and going forwards.
+//   size_t input_backwards_size      - Number of accessible bytes starting at
+//                                      "input" and going backwards
+//   int flags                        - Flags:
+//      RE_FLAGS_SCAN
+//      RE_FLAGS_BACKWARDS
+//      RE_FLAGS_EXHAUSTIVE
+//      RE_FLAGS_WIDE
+//      RE_FLAGS_NO_CASE
+//      RE_FLAGS_DOT_ALL
+//   RE_MATCH_CALLBACK_FUNC callback  - Callback function
+//   void* callback_args              - Callback argument
+//   int*  matches                    - Pointer to an integer receiving the
+//                                      number of matching bytes. Notice that
+//                                      0 means a zero-length match, while no
+//                                      matches is -1.
+// Returns:
+//    ERROR_SUCCESS or any other error code.
+
+int yr_re_exec(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    const uint8_t* input_data,
+    size_t input_forwards_size,
+    size_t input_backwards_size,
+    int flags,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args,
+    int* matches)
+{
+  const uint8_t* input;
+  const uint8_t* ip;
+
+  uint16_t opcode_args;
+  uint8_t mask;
+  uint8_t value;
+  uint8_t character_size;
+
+  RE_FIBER_LIST fibers;
+  RE_FIBER* fiber;
+  RE_FIBER* next_fiber;
+
+  int bytes_matched;
+  int max_bytes_matched;
+
+  int match;
+  int input_incr;
+  int kill;
+  int action;
+
+  bool prev_is_word_char = false;
+  bool input_is_word_char = false;
+  bool dfa_handled = false;
+
+#define ACTION_NONE      0
+#define ACTION_CONTINUE  1
+#define ACTION_KILL      2
+#define ACTION_KILL_TAIL 3
+
+#define prolog                                      \
+  {                                                 \
+    if ((bytes_matched >= max_bytes_matched) ||     \
+        (character_size == 2 && *(input + 1) != 0)) \
+    {                                               \
+      action = ACTION_KILL;                         \
+      break;                                        \
+    }                                               \
+  }
+
+  if (matches != NULL)
+    *matches = -1;
+
+  if (flags & RE_FLAGS_WIDE)
+    character_size = 2;
+  else
+    character_size = 1;
+
+  input = input_data;
+  input_incr = character_size;
+
+  if (flags & RE_FLAGS_BACKWARDS)
+  {
+    // Signedness conversion is sound as long as YR_RE_SCAN_LIMIT <= INT_MAX
+    max_bytes_matched = (int) yr_min(input_backwards_size, YR_RE_SCAN_LIMIT);
+    input -= character_size;
+    input_incr = -input_incr;
+  }
+  else
+  {
+    // Signedness conversion is sound as long as YR_RE_SCAN_LIMIT <= INT_MAX
+    max_bytes_matched = (int) yr_min(input_forwards_size, YR_RE_SCAN_LIMIT);
+  }
+
+  // Round down max_bytes_matched to a multiple of character_size, this way if
+  // character_size is 2 and max_bytes_matched is odd we are ignoring the
+  // extra byte which can't match anyways.
+
+  max_bytes_matched = max_bytes_matched - max_bytes_matched % character_size;
+  bytes_matched = 0;
+
+  fibers.head = NULL;
+  fibers.tail = NULL;
+
+  // RE_FLAGS_SCAN adds a new fiber at every position, these programs are
+  // always run with fibers.
+  if (!(flags & RE_FLAGS_SCAN) && !(context->flags & SCAN_FLAGS_NO_RE_DFA))
+  {
+    FAIL_ON_ERROR(_yr_re_dfa_exec(
+        context,
+        code,
+        input_data,
+        flags,
+        character_size,
+        max_bytes_matched,
+        callback,
+        callback_args,
+        matches,
+        &fibers,
+        &input,
+        &bytes_matched,
+        &dfa_handled));
+
+    if (dfa_handled)
+      return ERROR_SUCCESS;
+  }
+
+  if (fibers.head == NULL)
+  {
+    FAIL_ON_ERROR(_yr_re_fiber_create(&context->re_fiber_pool, &fiber));
+
+    fiber->ip = code;
+    fibers.head = fiber;
+    fibers.tail = fiber;
+
+    FAIL_ON_ERROR_WITH_CLEANUP(
+        _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
+        _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+  }
+
+  while (fibers.head != NULL)
+  {
+    fiber = fibers.head;
+
+    while (fiber != NULL)
+    {
+      next_fiber = fiber->next;
+
+      if (_yr_re_fiber_exists(&fibers, fiber, fiber->prev))
+        _yr_re_fiber_kill(&fibers, &context->re_fiber_pool, fiber);
+
+      fiber = next_fiber;
+    }
+
+    fiber = fibers.head;
+
+    while (fiber != NULL)
+    {
+      ip = fiber->ip;
+      action = ACTION_NONE;
+
+      switch (*ip)
+      {
+      case RE_OPCODE_ANY:
+        prolog;
+        match = (flags & RE_FLAGS_DOT_ALL) || (*input != 0x0A);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_REPEAT_ANY_GREEDY:
+      case RE_OPCODE_REPEAT_ANY_UNGREEDY:
+        prolog;
+        match = (flags & RE_FLAGS_DOT_ALL) || (*input != 0x0A);
+        action = match ? ACTION_NONE : ACTION_KILL;
+
+        // The instruction pointer is not incremented here. The current fiber
+        // spins in this instruction until reaching the required number of
+        // repetitions. The code controlling the number of repetitions is in
+        // _yr_re_fiber_sync.
+
+        break;
+
+      case RE_OPCODE_LITERAL:
+        prolog;
+        if (flags & RE_FLAGS_NO_CASE)
+          match = yr_lowercase[*input] == yr_lowercase[*(ip + 1)];
+        else
+          match = (*input == *(ip + 1));
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 2;
+        break;
+
+      case RE_OPCODE_NOT_LITERAL:
+        prolog;
+
+        // We don't need to take into account the case-insensitive
+        // case because this opcode is only used with hex strings,
+        // which can't be case-insensitive.
+
+        match = (*input != *(ip + 1));
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 2;
+        break;
+
+      case RE_OPCODE_MASKED_LITERAL:
+        prolog;
+        opcode_args = yr_unaligned_u16(ip + 1);
+        mask = opcode_args >> 8;
+        value = opcode_args & 0xFF;
+
+        // We don't need to take into account the case-insensitive
+        // case because this opcode is only used with hex strings,
+        // which can't be case-insensitive.
+
+        match = ((*input & mask) == value);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 3;
+        break;
+
+      case RE_OPCODE_MASKED_NOT_LITERAL:
+        prolog;
+        opcode_args = yr_unaligned_u16(ip + 1);
+        mask = opcode_args >> 8;
+        value = opcode_args & 0xFF;
+
+        // We don't need to take into account the case-insensitive
+        // case because this opcode is only used with hex strings,
+        // which can't be case-insensitive.
+
+        match = ((*input & mask) != value);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 3;
+        break;
 
       case RE_OPCODE_CLASS:
         prolog;
@@ -1891,605 +2795,1204 @@ int yr_re_exec(
         fiber->ip += (sizeof(RE_CLASS) + 1);
         break;
 
-      case RE_OPCODE_WORD_CHAR:
-        prolog;
-        match = _yr_re_is_word_char(input, character_size);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+      case RE_OPCODE_WORD_CHAR:
+        prolog;
+        match = _yr_re_is_word_char(input, character_size);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_NON_WORD_CHAR:
+        prolog;
+        match = !_yr_re_is_word_char(input, character_size);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_SPACE:
+      case RE_OPCODE_NON_SPACE:
+
+        prolog;
+
+        switch (*input)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case '\v':
+        case '\f':
+          match = true;
+          break;
+        default:
+          match = false;
+        }
+
+        if (*ip == RE_OPCODE_NON_SPACE)
+          match = !match;
+
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_DIGIT:
+        prolog;
+        match = isdigit(*input);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_NON_DIGIT:
+        prolog;
+        match = !isdigit(*input);
+        action = match ? ACTION_NONE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_WORD_BOUNDARY:
+      case RE_OPCODE_NON_WORD_BOUNDARY:
+        if (input - input_incr + character_size <=
+                input_data + input_forwards_size &&
+            input - input_incr >= input_data - input_backwards_size)
+        {
+          prev_is_word_char = _yr_re_is_word_char(
+              input - input_incr, character_size);
+        }
+        else
+        {
+          prev_is_word_char = false;
+        }
+
+        if (input + character_size <= input_data + input_forwards_size &&
+            input >= input_data - input_backwards_size)
+        {
+          input_is_word_char = _yr_re_is_word_char(input, character_size);
+        }
+        else
+        {
+          input_is_word_char = false;
+        }
+
+        match = (prev_is_word_char && !input_is_word_char) ||
+                (!prev_is_word_char && input_is_word_char);
+
+        if (*ip == RE_OPCODE_NON_WORD_BOUNDARY)
+          match = !match;
+
+        action = match ? ACTION_CONTINUE : ACTION_KILL;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_MATCH_AT_START:
+        if (flags & RE_FLAGS_BACKWARDS)
+          kill = input_backwards_size > (size_t) bytes_matched;
+        else
+          kill = input_backwards_size > 0 || (bytes_matched != 0);
+        action = kill ? ACTION_KILL : ACTION_CONTINUE;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_MATCH_AT_END:
+        kill = flags & RE_FLAGS_BACKWARDS ||
+               input_forwards_size > (size_t) bytes_matched;
+        action = kill ? ACTION_KILL : ACTION_CONTINUE;
+        fiber->ip += 1;
+        break;
+
+      case RE_OPCODE_MATCH:
+
+        if (matches != NULL)
+          *matches = bytes_matched;
+
+        if (flags & RE_FLAGS_EXHAUSTIVE)
+        {
+          if (callback != NULL)
+          {
+            if (flags & RE_FLAGS_BACKWARDS)
+            {
+              FAIL_ON_ERROR_WITH_CLEANUP(
+                  callback(
+                      input + character_size,
+                      bytes_matched,
+                      flags,
+                      callback_args),
+                  _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+            }
+            else
+            {
+              FAIL_ON_ERROR_WITH_CLEANUP(
+                  callback(input_data, bytes_matched, flags, callback_args),
+                  _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+            }
+          }
+
+          action = ACTION_KILL;
+        }
+        else
+        {
+          action = ACTION_KILL_TAIL;
+        }
+
+        break;
+
+      default:
+        assert(false);
+      }
+
+      switch (action)
+      {
+      case ACTION_KILL:
+        fiber = _yr_re_fiber_kill(&fibers, &context->re_fiber_pool, fiber);
+        break;
+
+      case ACTION_KILL_TAIL:
+        _yr_re_fiber_kill_tail(&fibers, &context->re_fiber_pool, fiber);
+        fiber = NULL;
+        break;
+
+      case ACTION_CONTINUE:
+        FAIL_ON_ERROR_WITH_CLEANUP(
+            _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
+            _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+        break;
+
+      default:
+        next_fiber = fiber->next;
+        FAIL_ON_ERROR_WITH_CLEANUP(
+            _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
+            _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+        fiber = next_fiber;
+      }
+    }
+
+    input += input_incr;
+    bytes_matched += character_size;
+
+    if (flags & RE_FLAGS_SCAN && bytes_matched < max_bytes_matched)
+    {
+      FAIL_ON_ERROR_WITH_CLEANUP(
+          _yr_re_fiber_create(&context->re_fiber_pool, &fiber),
+          _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+
+      fiber->ip = code;
+      _yr_re_fiber_append(&fibers, fiber);
+
+      FAIL_ON_ERROR_WITH_CLEANUP(
+          _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
+          _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+    }
+  }
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper function that creates a RE_FAST_EXEC_POSITION by either allocating it
+// or reusing a previously allocated one from a pool.
+//
+static int _yr_re_fast_exec_position_create(
+    RE_FAST_EXEC_POSITION_POOL* pool,
+    RE_FAST_EXEC_POSITION** new_position)
+{
+  RE_FAST_EXEC_POSITION* position;
+
+  if (pool->head != NULL)
+  {
+    position = pool->head;
+    pool->head = position->next;
+  }
+  else
+  {
+    position = (RE_FAST_EXEC_POSITION*) yr_malloc(
+        sizeof(RE_FAST_EXEC_POSITION));
+
+    if (position == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
+  }
+
+  position->input = NULL;
+  position->round = 0;
+  position->next = NULL;
+  position->prev = NULL;
+
+  *new_position = position;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper function that moves a list of RE_FAST_EXEC_POSITION structures to a
+// pool represented by a RE_FAST_EXEC_POSITION_POOL. Receives pointers to the
+// pool, the first item, and last item in the list.
+//
+static void _yr_re_fast_exec_destroy_position_list(
+    RE_FAST_EXEC_POSITION_POOL* pool,
+    RE_FAST_EXEC_POSITION* first,
+    RE_FAST_EXEC_POSITION* last)
+{
+  last->next = pool->head;
+
+  if (pool->head != NULL)
+    pool->head->prev = last;
+
+  pool->head = first;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// This function replaces yr_re_exec for regular expressions marked with flag
+// RE_FLAGS_FAST_REGEXP. These regular expressions are derived from hex strings
+// that don't contain alternatives, like for example:
+//
+//   { 01 02 03 04 [0-2] 04 05 06 07 }
+//
+// The regexp's code produced by such strings can be matched by a faster, less
+// general algorithm, and it contains only the following opcodes:
+//
+//   * RE_OPCODE_LITERAL
+//   * RE_OPCODE_MASKED_LITERAL,
+//   * RE_OPCODE_NOT_LITERAL
+//   * RE_OPCODE_MASKED_NOT_LITERAL
+//   * RE_OPCODE_ANY
+//   * RE_OPCODE_REPEAT_ANY_UNGREEDY
+//   * RE_OPCODE_MATCH.
+//
+// The regexp's code is executed one instruction at time, and the function
+// maintains a list of positions within the input for tracking different
+// matching alternatives, these positions are described by an instance of
+// RE_FAST_EXEC_POSITION. With each instruction the list of positions is
+// updated, removing those where the input data doesn't match the current
+// instruction, or adding new positions if the instruction is
+// RE_OPCODE_REPEAT_ANY_UNGREEDY. The list of positions is maintained sorted
+// by the value of the pointer they hold to the input, and it doesn't contain
+// duplicated pointer values.
+//
+int yr_re_fast_exec(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    const uint8_t* input_data,
+    size_t input_forwards_size,
+    size_t input_backwards_size,
+    int flags,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args,
+    int* matches)
+{
+  RE_REPEAT_ANY_ARGS* repeat_any_args;
+
+  // Pointers to the first and last position in the list.
+  RE_FAST_EXEC_POSITION* first;
+  RE_FAST_EXEC_POSITION* last;
+
+  int input_incr = flags & RE_FLAGS_BACKWARDS ? -1 : 1;
+  int bytes_matched;
+  int max_bytes_matched;
+
+  if (flags & RE_FLAGS_BACKWARDS)
+    max_bytes_matched = (int) yr_min(input_backwards_size, YR_RE_SCAN_LIMIT);
+  else
+    max_bytes_matched = (int) yr_min(input_forwards_size, YR_RE_SCAN_LIMIT);
+
+  const uint8_t* ip = code;
+
+  // Create the first position in the list, which points to the start of the
+  // input data. Intially this is the only position, more positions will be
+  // created every time RE_OPCODE_REPEAT_ANY_UNGREEDY is executed.
+  FAIL_ON_ERROR(_yr_re_fast_exec_position_create(
+      &context->re_fast_exec_position_pool, &first));
+
+  first->round = 0;
+  first->input = input_data;
+  first->prev = NULL;
+  first->next = NULL;
+
+  if (flags & RE_FLAGS_BACKWARDS)
+    first->input--;
+
+  // As we are starting with a single position, the last one and the first one
+  // are the same.
+  last = first;
+
+  // Round is incremented with every regxp instruction.
+  int round = 0;
+
+  // Keep in the loop until the list of positions gets empty. Positions are
+  // removed from the list when they don't match the current instruction in
+  // the code.
+  while (first != NULL)
+  {
+    RE_FAST_EXEC_POSITION* current = first;
+
+    // Iterate over all the positions, executing the current instruction at
+    // all of them.
+    while (current != NULL)
+    {
+      RE_FAST_EXEC_POSITION* next = current->next;
+
+      // Ignore any position in the list whose round number is different from
+      // the current round. This prevents new positions added to the list in
+      // this round from being taken into account in this same round.
+      if (current->round != round)
+      {
+        current = next;
+        continue;
+      }
+
+      bytes_matched = flags & RE_FLAGS_BACKWARDS
+                          ? (int) (input_data - current->input - 1)
+                          : (int) (current->input - input_data);
+
+      uint16_t opcode_args;
+      uint8_t mask;
+      uint8_t value;
+
+      bool match = false;
+
+      switch (*ip)
+      {
+      case RE_OPCODE_ANY:
+        if (bytes_matched >= max_bytes_matched)
+          break;
+
+        match = true;
+        current->input += input_incr;
+        break;
+
+      case RE_OPCODE_LITERAL:
+        if (bytes_matched >= max_bytes_matched)
+          break;
+
+        if (*current->input == *(ip + 1))
+        {
+          match = true;
+          current->input += input_incr;
+        }
+        break;
+
+      case RE_OPCODE_NOT_LITERAL:
+        if (bytes_matched >= max_bytes_matched)
+          break;
+
+        if (*current->input != *(ip + 1))
+        {
+          match = true;
+          current->input += input_incr;
+        }
+        break;
+
+      case RE_OPCODE_MASKED_LITERAL:
+        if (bytes_matched >= max_bytes_matched)
+          break;
+
+        opcode_args = yr_unaligned_u16(ip + 1);
+        mask = opcode_args >> 8;
+        value = opcode_args & 0xFF;
+
+        if ((*current->input & mask) == value)
+        {
+          match = true;
+          current->input += input_incr;
+        }
+        break;
+
+      case RE_OPCODE_MASKED_NOT_LITERAL:
+        if (bytes_matched >= max_bytes_matched)
+          break;
+
+        opcode_args = yr_unaligned_u16(ip + 1);
+        mask = opcode_args >> 8;
+        value = opcode_args & 0xFF;
+
+        if ((*current->input & mask) != value)
+        {
+          match = true;
+          current->input += input_incr;
+        }
+        break;
+
+      case RE_OPCODE_REPEAT_ANY_UNGREEDY:
+        repeat_any_args = (RE_REPEAT_ANY_ARGS*) (ip + 1);
+
+        if (bytes_matched + repeat_any_args->min >= max_bytes_matched)
+          break;
+
+        match = true;
+
+        const uint8_t* next_opcode = ip + 1 + sizeof(RE_REPEAT_ANY_ARGS);
+
+        // insertion_point indicates the item in the list of inputs after which
+        // the newly created inputs will be inserted.
+        RE_FAST_EXEC_POSITION* insertion_point = current;
+
+        for (int j = repeat_any_args->min + 1; j <= repeat_any_args->max; j++)
+        {
+          // bytes_matched is the number of bytes matched so far, and j is the
+          // minimum number of bytes that are still pending to match. If these
+          // two numbers sum more than the maximum number of bytes that can be
+          // matched the loop can be aborted. The position that we were about
+          // to create can't lead to a match without exceeding
+          // max_bytes_matched.
+          if (bytes_matched + j >= max_bytes_matched)
+            break;
 
-      case RE_OPCODE_NON_WORD_CHAR:
-        prolog;
-        match = !_yr_re_is_word_char(input, character_size);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+          const uint8_t* next_input = current->input + j * input_incr;
 
-      case RE_OPCODE_SPACE:
-      case RE_OPCODE_NON_SPACE:
+          // Find the point where next_input should be inserted. The list is
+          // kept sorted by pointer in increasing order, the insertion point is
+          // an item that has a pointer lower or equal than next_input, but
+          // whose next item have a pointer that is larger.
+          while (insertion_point->next != NULL &&
+                 insertion_point->next->input <= next_input)
+          {
+            insertion_point = insertion_point->next;
+          }
 
-        prolog;
+          // If the input already exists for the next round, we don't need to
+          // insert it.
+          if (insertion_point->round == round + 1 &&
+              insertion_point->input == next_input)
+            continue;
 
-        switch (*input)
-        {
-        case ' ':
-        case '\t':
-        case '\r':
-        case '\n':
-        case '\v':
-        case '\f':
-          match = true;
-          break;
-        default:
-          match = false;
-        }
+          // The next opcode is RE_OPCODE_LITERAL, but the literal doesn't
+          // match with the byte at next_input, we don't need to add this
+          // input to the list as we already know that it won't match in the
+          // next round and will be deleted from the list anyways.
+          if (*(next_opcode) == RE_OPCODE_LITERAL &&
+              *(next_opcode + 1) != *next_input)
+            continue;
 
-        if (*ip == RE_OPCODE_NON_SPACE)
-          match = !match;
+          RE_FAST_EXEC_POSITION* new_input;
 
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+          FAIL_ON_ERROR_WITH_CLEANUP(
+              _yr_re_fast_exec_position_create(
+                  &context->re_fast_exec_position_pool, &new_input),
+              // Cleanup
+              _yr_re_fast_exec_destroy_position_list(
+                  &context->re_fast_exec_position_pool, first, last));
 
-      case RE_OPCODE_DIGIT:
-        prolog;
-        match = isdigit(*input);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+          new_input->input = next_input;
+          new_input->round = round + 1;
+          new_input->prev = insertion_point;
+          new_input->next = insertion_point->next;
+          insertion_point->next = new_input;
 
-      case RE_OPCODE_NON_DIGIT:
-        prolog;
-        match = !isdigit(*input);
-        action = match ? ACTION_NONE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+          if (new_input->next != NULL)
+            new_input->next->prev = new_input;
 
-      case RE_OPCODE_WORD_BOUNDARY:
-      case RE_OPCODE_NON_WORD_BOUNDARY:
-        if (input - input_incr + character_size <=
-                input_data + input_forwards_size &&
-            input - input_incr >= input_data - input_backwards_size)
-        {
-          prev_is_word_char = _yr_re_is_word_char(
-              input - input_incr, character_size);
-        }
-        else
-        {
-          prev_is_word_char = false;
+          if (insertion_point == last)
+            last = new_input;
         }
 
-        if (input + character_size <= input_data + input_forwards_size &&
-            input >= input_data - input_backwards_size)
+        current->input += input_incr * repeat_any_args->min;
+        break;
+
+      case RE_OPCODE_MATCH:
+
+        if (flags & RE_FLAGS_EXHAUSTIVE)
         {
-          input_is_word_char = _yr_re_is_word_char(input, character_size);
+          FAIL_ON_ERROR_WITH_CLEANUP(
+              callback(
+                  // When matching forwards the matching data always starts at
+                  // input_data, when matching backwards it starts at input + 1
+                  // or input_data - input_backwards_size if input + 1 is
+                  // outside the buffer.
+                  flags & RE_FLAGS_BACKWARDS
+                      ? yr_max(
+                            current->input + 1,
+                            input_data - input_backwards_size)
+                      : input_data,
+                  // The number of matched bytes should not be larger than
+                  // max_bytes_matched.
+                  yr_min(bytes_matched, max_bytes_matched),
+                  flags,
+                  callback_args),
+              // Cleanup
+              _yr_re_fast_exec_destroy_position_list(
+                  &context->re_fast_exec_position_pool, first, last));
         }
         else
         {
-          input_is_word_char = false;
+          if (matches != NULL)
+            *matches = bytes_matched;
+
+          _yr_re_fast_exec_destroy_position_list(
+              &context->re_fast_exec_position_pool, first, last);
+
+          return ERROR_SUCCESS;
         }
+        break;
 
-        match = (prev_is_word_char && !input_is_word_char) ||
-                (!prev_is_word_char && input_is_word_char);
+      default:
+        printf("non-supported opcode: %d\n", *ip);
+        assert(false);
+      }
 
-        if (*ip == RE_OPCODE_NON_WORD_BOUNDARY)
-          match = !match;
+      if (match)
+      {
+        current->round = round + 1;
+      }
+      else
+      {
+        // Remove current from the list. If the item being removed is the first
+        // one or the last one, the first and last pointers should be updated.
+        // The removed item is put into the pool for later reuse.
 
-        action = match ? ACTION_CONTINUE : ACTION_KILL;
-        fiber->ip += 1;
-        break;
+        if (current == first)
+          first = current->next;
 
-      case RE_OPCODE_MATCH_AT_START:
-        if (flags & RE_FLAGS_BACKWARDS)
-          kill = input_backwards_size > (size_t) bytes_matched;
-        else
-          kill = input_backwards_size > 0 || (bytes_matched != 0);
-        action = kill ? ACTION_KILL : ACTION_CONTINUE;
-        fiber->ip += 1;
-        break;
+        if (current == last)
+          last = current->prev;
 
-      case RE_OPCODE_MATCH_AT_END:
-        kill = flags & RE_FLAGS_BACKWARDS ||
-               input_forwards_size > (size_t) bytes_matched;
-        action = kill ? ACTION_KILL : ACTION_CONTINUE;
-        fiber->ip += 1;
-        break;
+        if (current->prev != NULL)
+          current->prev->next = current->next;
 
-      case RE_OPCODE_MATCH:
+        if (current->next != NULL)
+          current->next->prev = current->prev;
 
-        if (matches != NULL)
-          *matches = bytes_matched;
+        current->prev = NULL;
+        current->next = context->re_fast_exec_position_pool.head;
 
-        if (flags & RE_FLAGS_EXHAUSTIVE)
-        {
-          if (callback != NULL)
-          {
-            if (flags & RE_FLAGS_BACKWARDS)
-            {
-              FAIL_ON_ERROR_WITH_CLEANUP(
-                  callback(
-                      input + character_size,
-                      bytes_matched,
-                      flags,
-                      callback_args),
-                  _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
-            }
-            else
-            {
-              FAIL_ON_ERROR_WITH_CLEANUP(
-                  callback(input_data, bytes_matched, flags, callback_args),
-                  _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
-            }
-          }
+        if (current->next != NULL)
+          current->next->prev = current;
+
+        context->re_fast_exec_position_pool.head = current;
+      }
+
+      current = next;
+
+    }  // while (current != NULL)
+
+    // Move instruction pointer (ip) to next instruction. Each opcode has
+    // a different size.
+    switch (*ip)
+    {
+    case RE_OPCODE_ANY:
+      ip += 1;
+      break;
+    case RE_OPCODE_LITERAL:
+    case RE_OPCODE_NOT_LITERAL:
+      ip += 2;
+      break;
+    case RE_OPCODE_MASKED_LITERAL:
+    case RE_OPCODE_MASKED_NOT_LITERAL:
+      ip += 3;
+      break;
+    case RE_OPCODE_REPEAT_ANY_UNGREEDY:
+      ip += 1 + sizeof(RE_REPEAT_ANY_ARGS);
+      break;
+    case RE_OPCODE_MATCH:
+      break;
+    default:
+      assert(false);
+    }
+
+    round++;
+  }
+
+  // If this point is reached no matches were found.
+
+  if (matches != NULL)
+    *matches = -1;
+
+  return ERROR_SUCCESS;
+}
+
+// Maximum number of instructions checked at once by yr_re_hex_exec, longer
+// runs of fixed-length instructions are checked in pieces.
+#define RE_HEX_MAX_RUN 32
+
+// A run of consecutive fixed-length instructions (literals, masked literals,
+// their negated forms and RE_OPCODE_ANY) that yr_re_hex_exec checks as a
+// whole. Byte i of the input matches if (byte & mask[i]) == value[i], or if
+// it doesn't when negate[i] is 0xFF. The arrays are padded with entries that
+// match anything. When matching backwards the run is stored reversed, so that
+// it can always be compared with the input in increasing address order.
+typedef struct _RE_HEX_RUN
+{
+  uint8_t value[RE_HEX_MAX_RUN];
+  uint8_t mask[RE_HEX_MAX_RUN];
+  uint8_t negate[RE_HEX_MAX_RUN];
 
-          action = ACTION_KILL;
-        }
-        else
-        {
-          action = ACTION_KILL_TAIL;
-        }
+  int length;
 
-        break;
+  // Index of an entry that must be equal to its value, used for finding
+  // candidate positions within a range. -1 if there is no such entry.
+  int anchor;
 
-      default:
-        assert(false);
-      }
+} RE_HEX_RUN;
 
-      switch (action)
-      {
-      case ACTION_KILL:
-        fiber = _yr_re_fiber_kill(&fibers, &context->re_fiber_pool, fiber);
-        break;
+// Range of positions, expressed as the number of bytes matched so far.
+typedef struct _RE_HEX_RANGE
+{
+  uint16_t first;
+  uint16_t last;
 
-      case ACTION_KILL_TAIL:
-        _yr_re_fiber_kill_tail(&fibers, &context->re_fiber_pool, fiber);
-        fiber = NULL;
-        break;
+} RE_HEX_RANGE;
 
-      case ACTION_CONTINUE:
-        FAIL_ON_ERROR_WITH_CLEANUP(
-            _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
-            _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
-        break;
+// The code of a hex string decoded into runs and jumps. A step with a run of
+// length zero is a jump of min to max bytes. The code ends with a match after
+// the last step.
+typedef struct _RE_HEX_STEP
+{
+  RE_HEX_RUN run;
 
-      default:
-        next_fiber = fiber->next;
-        FAIL_ON_ERROR_WITH_CLEANUP(
-            _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
-            _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
-        fiber = next_fiber;
-      }
-    }
+  uint16_t min;
+  uint16_t max;
 
-    input += input_incr;
-    bytes_matched += character_size;
+} RE_HEX_STEP;
 
-    if (flags & RE_FLAGS_SCAN && bytes_matched < max_bytes_matched)
-    {
-      FAIL_ON_ERROR_WITH_CLEANUP(
-          _yr_re_fiber_create(&context->re_fiber_pool, &fiber),
-          _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
+typedef struct _RE_HEX_PROGRAM RE_HEX_PROGRAM;
 
-      fiber->ip = code;
-      _yr_re_fiber_append(&fibers, fiber);
+struct _RE_HEX_PROGRAM
+{
+  const uint8_t* code;
+  bool backwards;
 
-      FAIL_ON_ERROR_WITH_CLEANUP(
-          _yr_re_fiber_sync(&fibers, &context->re_fiber_pool, fiber),
-          _yr_re_fiber_kill_all(&fibers, &context->re_fiber_pool));
-    }
-  }
+  // Set if the code contains instructions that yr_re_hex_exec doesn't
+  // handle, the code is executed by yr_re_fast_exec instead.
+  bool unsupported;
 
-  return ERROR_SUCCESS;
-}
+  RE_HEX_PROGRAM* next;
 
-////////////////////////////////////////////////////////////////////////////////
-// Helper function that creates a RE_FAST_EXEC_POSITION by either allocating it
-// or reusing a previously allocated one from a pool.
-//
-static int _yr_re_fast_exec_position_create(
-    RE_FAST_EXEC_POSITION_POOL* pool,
-    RE_FAST_EXEC_POSITION** new_position)
+  int num_steps;
+  RE_HEX_STEP steps[1];
+};
+
+#define RE_HEX_PROGRAM_BUCKETS 1024
+
+struct RE_HEX_CACHE
 {
-  RE_FAST_EXEC_POSITION* position;
+  RE_HEX_PROGRAM* programs[RE_HEX_PROGRAM_BUCKETS];
+};
 
-  if (pool->head != NULL)
+static const uint8_t* _yr_re_hex_decode_run(
+    const uint8_t* ip,
+    bool backwards,
+    RE_HEX_RUN* run)
+{
+  uint16_t opcode_args;
+  int n = 0;
+
+  memset(run, 0, sizeof(RE_HEX_RUN));
+
+  while (n < RE_HEX_MAX_RUN)
   {
-    position = pool->head;
-    pool->head = position->next;
+    switch (*ip)
+    {
+    case RE_OPCODE_ANY:
+      ip += 1;
+      break;
+
+    case RE_OPCODE_LITERAL:
+    case RE_OPCODE_NOT_LITERAL:
+      run->value[n] = *(ip + 1);
+      run->mask[n] = 0xFF;
+      run->negate[n] = (*ip == RE_OPCODE_NOT_LITERAL) ? 0xFF : 0x00;
+      ip += 2;
+      break;
+
+    case RE_OPCODE_MASKED_LITERAL:
+    case RE_OPCODE_MASKED_NOT_LITERAL:
+      opcode_args = yr_unaligned_u16(ip + 1);
+      run->value[n] = opcode_args & 0xFF;
+      run->mask[n] = opcode_args >> 8;
+      run->negate[n] = (*ip == RE_OPCODE_MASKED_NOT_LITERAL) ? 0xFF : 0x00;
+      ip += 3;
+      break;
+
+    default:
+      goto _exit;
+    }
+
+    n++;
   }
-  else
+
+_exit:
+
+  run->length = n;
+
+  if (backwards)
   {
-    position = (RE_FAST_EXEC_POSITION*) yr_malloc(
-        sizeof(RE_FAST_EXEC_POSITION));
+    for (int i = 0; i < n / 2; i++)
+    {
+      int j = n - 1 - i;
+      uint8_t t;
 
-    if (position == NULL)
-      return ERROR_INSUFFICIENT_MEMORY;
+      t = run->value[i], run->value[i] = run->value[j], run->value[j] = t;
+      t = run->mask[i], run->mask[i] = run->mask[j], run->mask[j] = t;
+      t = run->negate[i], run->negate[i] = run->negate[j], run->negate[j] = t;
+    }
   }
 
-  position->input = NULL;
-  position->round = 0;
-  position->next = NULL;
-  position->prev = NULL;
+  // Zeroes and 0xFF are everywhere in executables, prefer any other byte as
+  // the anchor.
+  run->anchor = -1;
 
-  *new_position = position;
+  for (int i = 0; i < n; i++)
+  {
+    if (run->mask[i] != 0xFF || run->negate[i])
+      continue;
 
-  return ERROR_SUCCESS;
+    if (run->anchor == -1 ||
+        (run->value[run->anchor] == 0x00 || run->value[run->anchor] == 0xFF))
+      run->anchor = i;
+  }
+
+  return ip;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Helper function that moves a list of RE_FAST_EXEC_POSITION structures to a
-// pool represented by a RE_FAST_EXEC_POSITION_POOL. Receives pointers to the
-// pool, the first item, and last item in the list.
+// Decodes the code into steps. If steps is NULL the steps are only counted.
+// Returns the number of steps, or -1 if the code has instructions other than
+// the ones produced by hex strings without alternatives.
 //
-static void _yr_re_fast_exec_destroy_position_list(
-    RE_FAST_EXEC_POSITION_POOL* pool,
-    RE_FAST_EXEC_POSITION* first,
-    RE_FAST_EXEC_POSITION* last)
+static int _yr_re_hex_decode(
+    const uint8_t* code,
+    bool backwards,
+    RE_HEX_STEP* steps)
 {
-  last->next = pool->head;
+  const uint8_t* ip = code;
+  int num_steps = 0;
 
-  if (pool->head != NULL)
-    pool->head->prev = last;
+  while (*ip != RE_OPCODE_MATCH)
+  {
+    RE_HEX_STEP step;
 
-  pool->head = first;
+    if (*ip == RE_OPCODE_REPEAT_ANY_UNGREEDY)
+    {
+      memset(&step.run, 0, sizeof(step.run));
+      step.min = yr_unaligned_u16(ip + 1);
+      step.max = yr_unaligned_u16(ip + 3);
+      ip += 5;
+    }
+    else
+    {
+      ip = _yr_re_hex_decode_run(ip, backwards, &step.run);
+      step.min = 0;
+      step.max = 0;
+
+      if (step.run.length == 0)
+        return -1;
+    }
+
+    if (steps != NULL)
+      steps[num_steps] = step;
+
+    num_steps++;
+  }
+
+  return num_steps;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// This function replaces yr_re_exec for regular expressions marked with flag
-// RE_FLAGS_FAST_REGEXP. These regular expressions are derived from hex strings
-// that don't contain alternatives, like for example:
-//
-//   { 01 02 03 04 [0-2] 04 05 06 07 }
-//
-// The regexp's code produced by such strings can be matched by a faster, less
-// general algorithm, and it contains only the following opcodes:
-//
-//   * RE_OPCODE_LITERAL
-//   * RE_OPCODE_MASKED_LITERAL,
-//   * RE_OPCODE_NOT_LITERAL
-//   * RE_OPCODE_MASKED_NOT_LITERAL
-//   * RE_OPCODE_ANY
-//   * RE_OPCODE_REPEAT_ANY_UNGREEDY
-//   * RE_OPCODE_MATCH.
-//
-// The regexp's code is executed one instruction at time, and the function
-// maintains a list of positions within the input for tracking different
-// matching alternatives, these positions are described by an instance of
-// RE_FAST_EXEC_POSITION. With each instruction the list of positions is
-// updated, removing those where the input data doesn't match the current
-// instruction, or adding new positions if the instruction is
-// RE_OPCODE_REPEAT_ANY_UNGREEDY. The list of positions is maintained sorted
-// by the value of the pointer they hold to the input, and it doesn't contain
-// duplicated pointer values.
+// Returns the decoded program for the given code and direction, decoding it
+// the first time it's used with this scan context.
 //
-int yr_re_fast_exec(
+static int _yr_re_hex_get(
     YR_SCAN_CONTEXT* context,
     const uint8_t* code,
-    const uint8_t* input_data,
-    size_t input_forwards_size,
-    size_t input_backwards_size,
-    int flags,
-    RE_MATCH_CALLBACK_FUNC callback,
-    void* callback_args,
-    int* matches)
+    bool backwards,
+    RE_HEX_PROGRAM** program)
 {
-  RE_REPEAT_ANY_ARGS* repeat_any_args;
+  RE_HEX_CACHE* cache = context->re_hex_cache;
+  uint32_t bucket;
+  int num_steps;
 
-  // Pointers to the first and last position in the list.
-  RE_FAST_EXEC_POSITION* first;
-  RE_FAST_EXEC_POSITION* last;
+  if (cache == NULL)
+  {
+    cache = (RE_HEX_CACHE*) yr_calloc(1, sizeof(RE_HEX_CACHE));
 
-  int input_incr = flags & RE_FLAGS_BACKWARDS ? -1 : 1;
-  int bytes_matched;
-  int max_bytes_matched;
+    if (cache == NULL)
+      return ERROR_INSUFFICIENT_MEMORY;
 
-  if (flags & RE_FLAGS_BACKWARDS)
-    max_bytes_matched = (int) yr_min(input_backwards_size, YR_RE_SCAN_LIMIT);
-  else
-    max_bytes_matched = (int) yr_min(input_forwards_size, YR_RE_SCAN_LIMIT);
+    context->re_hex_cache = cache;
+  }
 
-  const uint8_t* ip = code;
+  bucket = (uint32_t) (((uintptr_t) code >> 2) ^ backwards) %
+           RE_HEX_PROGRAM_BUCKETS;
 
-  // Create the first position in the list, which points to the start of the
-  // input data. Intially this is the only position, more positions will be
-  // created every time RE_OPCODE_REPEAT_ANY_UNGREEDY is executed.
-  FAIL_ON_ERROR(_yr_re_fast_exec_position_create(
-      &context->re_fast_exec_position_pool, &first));
+  for (*program = cache->programs[bucket]; *program != NULL;
+       *program = (*program)->next)
+  {
+    if ((*program)->code == code && (*program)->backwards == backwards)
+      return ERROR_SUCCESS;
+  }
 
-  first->round = 0;
-  first->input = input_data;
-  first->prev = NULL;
-  first->next = NULL;
+  num_steps = _yr_re_hex_decode(code, backwards, NULL);
 
-  if (flags & RE_FLAGS_BACKWARDS)
-    first->input--;
+  *program = (RE_HEX_PROGRAM*) yr_malloc(
+      sizeof(RE_HEX_PROGRAM) +
+      sizeof(RE_HEX_STEP) * (num_steps > 0 ? num_steps - 1 : 0));
 
-  // As we are starting with a single position, the last one and the first one
-  // are the same.
-  last = first;
+  if (*program == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
 
-  // Round is incremented with every regxp instruction.
-  int round = 0;
+  (*program)->code = code;
+  (*program)->backwards = backwards;
+  (*program)->unsupported = num_steps < 0;
+  (*program)->num_steps = num_steps < 0 ? 0 : num_steps;
+  (*program)->next = cache->programs[bucket];
 
-  // Keep in the loop until the list of positions gets empty. Positions are
-  // removed from the list when they don't match the current instruction in
-  // the code.
-  while (first != NULL)
+  if (num_steps > 0)
+    _yr_re_hex_decode(code, backwards, (*program)->steps);
+
+  cache->programs[bucket] = *program;
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destroys the cache of decoded programs used by yr_re_hex_exec.
+//
+// Args:
+//   RE_HEX_CACHE* cache  - Pointer to the cache, can be NULL.
+//
+void yr_re_hex_cache_destroy(RE_HEX_CACHE* cache)
+{
+  if (cache == NULL)
+    return;
+
+  for (int i = 0; i < RE_HEX_PROGRAM_BUCKETS; i++)
   {
-    RE_FAST_EXEC_POSITION* current = first;
+    RE_HEX_PROGRAM* program = cache->programs[i];
 
-    // Iterate over all the positions, executing the current instruction at
-    // all of them.
-    while (current != NULL)
+    while (program != NULL)
     {
-      RE_FAST_EXEC_POSITION* next = current->next;
+      RE_HEX_PROGRAM* next = program->next;
+      yr_free(program);
+      program = next;
+    }
+  }
 
-      // Ignore any position in the list whose round number is different from
-      // the current round. This prevents new positions added to the list in
-      // this round from being taken into account in this same round.
-      if (current->round != round)
-      {
-        current = next;
-        continue;
-      }
+  yr_free(cache);
+}
 
-      bytes_matched = flags & RE_FLAGS_BACKWARDS
-                          ? (int) (input_data - current->input - 1)
-                          : (int) (current->input - input_data);
+static bool _yr_re_hex_run_matches_scalar(
+    const RE_HEX_RUN* run,
+    const uint8_t* input)
+{
+  for (int i = 0; i < run->length; i++)
+  {
+    if (((input[i] & run->mask[i]) == run->value[i]) == (run->negate[i] != 0))
+      return false;
+  }
 
-      uint16_t opcode_args;
-      uint8_t mask;
-      uint8_t value;
+  return true;
+}
 
-      bool match = false;
+#if defined(YR_CPU_X86)
 
-      switch (*ip)
-      {
-      case RE_OPCODE_ANY:
-        if (bytes_matched >= max_bytes_matched)
-          break;
+static int _yr_re_hex_sse2 = -1;
+
+YR_TARGET("sse2")
+static bool _yr_re_hex_run_matches_sse2(
+    const RE_HEX_RUN* run,
+    const uint8_t* input)
+{
+  for (int i = 0; i < run->length; i += 16)
+  {
+    __m128i d = _mm_loadu_si128((const __m128i*) (input + i));
+    __m128i v = _mm_loadu_si128((const __m128i*) (run->value + i));
+    __m128i m = _mm_loadu_si128((const __m128i*) (run->mask + i));
+    __m128i n = _mm_loadu_si128((const __m128i*) (run->negate + i));
+    __m128i ok = _mm_xor_si128(_mm_cmpeq_epi8(_mm_and_si128(d, m), v), n);
+
+    if (_mm_movemask_epi8(ok) != 0xFFFF)
+      return false;
+  }
+
+  return true;
+}
+
+YR_TARGET("sse2")
+static uint32_t _yr_re_hex_find_sse2(const uint8_t* input, uint8_t value)
+{
+  __m128i d = _mm_loadu_si128((const __m128i*) input);
 
-        match = true;
-        current->input += input_incr;
-        break;
+  return (uint32_t) _mm_movemask_epi8(
+      _mm_cmpeq_epi8(d, _mm_set1_epi8((char) value)));
+}
 
-      case RE_OPCODE_LITERAL:
-        if (bytes_matched >= max_bytes_matched)
-          break;
+static uint32_t _yr_re_hex_reverse_16(uint32_t x)
+{
+  x = ((x >> 1) & 0x5555) | ((x & 0x5555) << 1);
+  x = ((x >> 2) & 0x3333) | ((x & 0x3333) << 2);
+  x = ((x >> 4) & 0x0F0F) | ((x & 0x0F0F) << 4);
+  x = ((x >> 8) & 0x00FF) | ((x & 0x00FF) << 8);
 
-        if (*current->input == *(ip + 1))
-        {
-          match = true;
-          current->input += input_incr;
-        }
-        break;
+  return x;
+}
 
-      case RE_OPCODE_NOT_LITERAL:
-        if (bytes_matched >= max_bytes_matched)
-          break;
+#endif
 
-        if (*current->input != *(ip + 1))
-        {
-          match = true;
-          current->input += input_incr;
-        }
-        break;
+static int _yr_re_hex_ctz(uint32_t mask)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int) index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
 
-      case RE_OPCODE_MASKED_LITERAL:
-        if (bytes_matched >= max_bytes_matched)
-          break;
+////////////////////////////////////////////////////////////////////////////////
+// Tells whether the run matches the input starting at offset, relative to
+// input_data. The input is readable in [lower, upper), also relative to
+// input_data, and [offset, offset + run->length) is known to be inside it.
+// When the padded run fits in the readable input it's compared with SIMD
+// loads, the padding entries match anything.
+//
+static bool _yr_re_hex_run_matches(
+    const RE_HEX_RUN* run,
+    const uint8_t* input_data,
+    int64_t offset,
+    int64_t upper)
+{
+#if defined(YR_CPU_X86)
+  if (_yr_re_hex_sse2 && offset + ((run->length + 15) & ~15) <= upper)
+    return _yr_re_hex_run_matches_sse2(run, input_data + offset);
+#endif
 
-        opcode_args = yr_unaligned_u16(ip + 1);
-        mask = opcode_args >> 8;
-        value = opcode_args & 0xFF;
+  return _yr_re_hex_run_matches_scalar(run, input_data + offset);
+}
 
-        if ((*current->input & mask) == value)
-        {
-          match = true;
-          current->input += input_incr;
-        }
-        break;
+////////////////////////////////////////////////////////////////////////////////
+// Returns a mask where bit i is set if the run could start at position
+// position + i because the anchor byte is there. Every bit is set if the
+// positions can't be filtered this way.
+//
+static uint32_t _yr_re_hex_candidates(
+    const RE_HEX_RUN* run,
+    const uint8_t* input_data,
+    bool backwards,
+    int position,
+    int64_t lower,
+    int64_t upper)
+{
+#if defined(YR_CPU_X86)
+  if (_yr_re_hex_sse2 && run->anchor >= 0)
+  {
+    // When matching backwards consecutive positions put the anchor at
+    // decreasing addresses, the first load lane is for position + 15.
+    int64_t offset = backwards
+                         ? -(int64_t) position - 15 - run->length + run->anchor
+                         : (int64_t) position + run->anchor;
 
-      case RE_OPCODE_MASKED_NOT_LITERAL:
-        if (bytes_matched >= max_bytes_matched)
-          break;
+    if (offset >= lower && offset + 16 <= upper)
+    {
+      uint32_t mask = _yr_re_hex_find_sse2(
+          input_data + offset, run->value[run->anchor]);
 
-        opcode_args = yr_unaligned_u16(ip + 1);
-        mask = opcode_args >> 8;
-        value = opcode_args & 0xFF;
+      return backwards ? _yr_re_hex_reverse_16(mask) : mask;
+    }
+  }
+#endif
 
-        if ((*current->input & mask) != value)
-        {
-          match = true;
-          current->input += input_incr;
-        }
-        break;
+  return 0xFFFF;
+}
 
-      case RE_OPCODE_REPEAT_ANY_UNGREEDY:
-        repeat_any_args = (RE_REPEAT_ANY_ARGS*) (ip + 1);
+////////////////////////////////////////////////////////////////////////////////
+// Appends a position to a sorted list of ranges, extending the last range
+// when the position follows it. Returns false if the list is full.
+//
+static bool _yr_re_hex_add_position(
+    RE_HEX_RANGE* ranges,
+    int* count,
+    int position)
+{
+  if (*count > 0 && ranges[*count - 1].last + 1 == position)
+  {
+    ranges[*count - 1].last = (uint16_t) position;
+    return true;
+  }
 
-        if (bytes_matched + repeat_any_args->min >= max_bytes_matched)
-          break;
+  if (*count == YR_RE_HEX_MAX_POSITIONS)
+    return false;
 
-        match = true;
+  ranges[*count].first = (uint16_t) position;
+  ranges[*count].last = (uint16_t) position;
+  (*count)++;
 
-        const uint8_t* next_opcode = ip + 1 + sizeof(RE_REPEAT_ANY_ARGS);
+  return true;
+}
 
-        // insertion_point indicates the item in the list of inputs after which
-        // the newly created inputs will be inserted.
-        RE_FAST_EXEC_POSITION* insertion_point = current;
+////////////////////////////////////////////////////////////////////////////////
+// This function replaces yr_re_fast_exec for hex strings that the compiler
+// flagged with STRING_FLAGS_HEX_EXEC. It accepts the same code and produces
+// the same results, but instead of executing one instruction at a time at
+// every position it decodes the code once per scan context and keeps the
+// positions as a sorted list of ranges:
+//
+//   * Each run of fixed-length instructions is checked as a whole at every
+//     position, with SIMD loads when possible. Within ranges, the candidate
+//     positions are first narrowed down by looking for the run's anchor byte
+//     at 16 consecutive positions at once.
+//
+//   * RE_OPCODE_REPEAT_ANY_UNGREEDY turns every range [a, b] into
+//     [a + min, b + max], merging the ranges that overlap.
+//
+// As in yr_re_exec the match found without RE_FLAGS_EXHAUSTIVE is the
+// shortest one. The compiler only selects this function when the jumps in the
+// string add up to less than YR_RE_HEX_MAX_POSITIONS, which bounds the number
+// of positions. If the list fills up anyway the code is handed over to
+// yr_re_fast_exec.
+//
+int yr_re_hex_exec(
+    YR_SCAN_CONTEXT* context,
+    const uint8_t* code,
+    const uint8_t* input_data,
+    size_t input_forwards_size,
+    size_t input_backwards_size,
+    int flags,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args,
+    int* matches)
+{
+  RE_HEX_RANGE buffers[2][YR_RE_HEX_MAX_POSITIONS];
+  RE_HEX_PROGRAM* program;
 
-        for (int j = repeat_any_args->min + 1; j <= repeat_any_args->max; j++)
-        {
-          // bytes_matched is the number of bytes matched so far, and j is the
-          // minimum number of bytes that are still pending to match. If these
-          // two numbers sum more than the maximum number of bytes that can be
-          // matched the loop can be aborted. The position that we were about
-          // to create can't lead to a match without exceeding
-          // max_bytes_matched.
-          if (bytes_matched + j >= max_bytes_matched)
-            break;
+  bool backwards = (flags & RE_FLAGS_BACKWARDS) != 0;
 
-          const uint8_t* next_input = current->input + j * input_incr;
+  int max_bytes_matched = (int) yr_min(
+      backwards ? input_backwards_size : input_forwards_size,
+      YR_RE_SCAN_LIMIT);
 
-          // Find the point where next_input should be inserted. The list is
-          // kept sorted by pointer in increasing order, the insertion point is
-          // an item that has a pointer lower or equal than next_input, but
-          // whose next item have a pointer that is larger.
-          while (insertion_point->next != NULL &&
-                 insertion_point->next->input <= next_input)
-          {
-            insertion_point = insertion_point->next;
-          }
+  // Readable input relative to input_data.
+  int64_t lower = -(int64_t) input_backwards_size;
+  int64_t upper = (int64_t) input_forwards_size;
 
-          // If the input already exists for the next round, we don't need to
-          // insert it.
-          if (insertion_point->round == round + 1 &&
-              insertion_point->input == next_input)
-            continue;
+  RE_HEX_RANGE* ranges = buffers[0];
+  RE_HEX_RANGE* next_ranges = buffers[1];
 
-          // The next opcode is RE_OPCODE_LITERAL, but the literal doesn't
-          // match with the byte at next_input, we don't need to add this
-          // input to the list as we already know that it won't match in the
-          // next round and will be deleted from the list anyways.
-          if (*(next_opcode) == RE_OPCODE_LITERAL &&
-              *(next_opcode + 1) != *next_input)
-            continue;
+  int count = 1;
+  int next_count;
 
-          RE_FAST_EXEC_POSITION* new_input;
+  FAIL_ON_ERROR(_yr_re_hex_get(context, code, backwards, &program));
 
-          FAIL_ON_ERROR_WITH_CLEANUP(
-              _yr_re_fast_exec_position_create(
-                  &context->re_fast_exec_position_pool, &new_input),
-              // Cleanup
-              _yr_re_fast_exec_destroy_position_list(
-                  &context->re_fast_exec_position_pool, first, last));
+  if (program->unsupported)
+    goto _fast_exec;
 
-          new_input->input = next_input;
-          new_input->round = round + 1;
-          new_input->prev = insertion_point;
-          new_input->next = insertion_point->next;
-          insertion_point->next = new_input;
+#if defined(YR_CPU_X86)
+  if (_yr_re_hex_sse2 == -1)
+    _yr_re_hex_sse2 = yr_cpu_has_sse2();
+#endif
 
-          if (new_input->next != NULL)
-            new_input->next->prev = new_input;
+  ranges[0].first = 0;
+  ranges[0].last = 0;
 
-          if (insertion_point == last)
-            last = new_input;
-        }
+  for (int s = 0; s < program->num_steps && count > 0; s++)
+  {
+    const RE_HEX_STEP* step = &program->steps[s];
+    const RE_HEX_RUN* run = &step->run;
 
-        current->input += input_incr * repeat_any_args->min;
-        break;
+    next_count = 0;
 
-      case RE_OPCODE_MATCH:
+    if (run->length == 0)
+    {
+      // A position survives the jump if at least one byte is left after
+      // skipping the minimum.
+      for (int i = 0;
+           i < count && ranges[i].first + step->min < max_bytes_matched;
+           i++)
+      {
+        int first = ranges[i].first + step->min;
+        int last = yr_min(ranges[i].last + step->max, max_bytes_matched - 1);
 
-        if (flags & RE_FLAGS_EXHAUSTIVE)
+        if (next_count > 0 && first <= next_ranges[next_count - 1].last + 1)
         {
-          FAIL_ON_ERROR_WITH_CLEANUP(
-              callback(
-                  // When matching forwards the matching data always starts at
-                  // input_data, when matching backwards it starts at input + 1
-                  // or input_data - input_backwards_size if input + 1 is
-                  // outside the buffer.
-                  flags & RE_FLAGS_BACKWARDS
-                      ? yr_max(
-                            current->input + 1,
-                            input_data - input_backwards_size)
-                      : input_data,
-                  // The number of matched bytes should not be larger than
-                  // max_bytes_matched.
-                  yr_min(bytes_matched, max_bytes_matched),
-                  flags,
-                  callback_args),
-              // Cleanup
-              _yr_re_fast_exec_destroy_position_list(
-                  &context->re_fast_exec_position_pool, first, last));
+          next_ranges[next_count - 1].last = (uint16_t) yr_max(
+              next_ranges[next_count - 1].last, last);
         }
         else
         {
-          if (matches != NULL)
-            *matches = bytes_matched;
-
-          _yr_re_fast_exec_destroy_position_list(
-              &context->re_fast_exec_position_pool, first, last);
-
-          return ERROR_SUCCESS;
+          next_ranges[next_count].first = (uint16_t) first;
+          next_ranges[next_count].last = (uint16_t) last;
+          next_count++;
         }
-        break;
-
-      default:
-        printf("non-supported opcode: %d\n", *ip);
-        assert(false);
       }
+    }
+    else
+    {
+      int last_start = max_bytes_matched - run->length;
 
-      if (match)
-      {
-        current->round = round + 1;
-      }
-      else
+      for (int i = 0; i < count && ranges[i].first <= last_start; i++)
       {
-        // Remove current from the list. If the item being removed is the first
-        // one or the last one, the first and last pointers should be updated.
-        // The removed item is put into the pool for later reuse.
+        int last = yr_min(ranges[i].last, last_start);
 
-        if (current == first)
-          first = current->next;
+        for (int p = ranges[i].first; p <= last; p += 16)
+        {
+          uint32_t candidates = 1;
 
-        if (current == last)
-          last = current->prev;
+          if (p < last)
+          {
+            candidates = _yr_re_hex_candidates(
+                run, input_data, backwards, p, lower, upper);
 
-        if (current->prev != NULL)
-          current->prev->next = current->next;
+            if (last - p < 15)
+              candidates &= (1 << (last - p + 1)) - 1;
+          }
 
-        if (current->next != NULL)
-          current->next->prev = current->prev;
+          while (candidates != 0)
+          {
+            int position = p + _yr_re_hex_ctz(candidates);
 
-        current->prev = NULL;
-        current->next = context->re_fast_exec_position_pool.head;
+            candidates &= candidates - 1;
 
-        if (current->next != NULL)
-          current->next->prev = current;
+            if (!_yr_re_hex_run_matches(
+                    run,
+                    input_data,
+                    backwards ? -(int64_t) position - run->length : position,
+                    upper))
+              continue;
 
-        context->re_fast_exec_position_pool.head = current;
+            if (!_yr_re_hex_add_position(
+                    next_ranges, &next_count, position + run->length))
+              goto _fast_exec;
+          }
+        }
       }
+    }
 
-      current = next;
+    RE_HEX_RANGE* t = ranges;
+    ranges = next_ranges;
+    next_ranges = t;
+    count = next_count;
+  }
 
-    }  // while (current != NULL)
+  if (count > 0 && !(flags & RE_FLAGS_EXHAUSTIVE))
+  {
+    if (matches != NULL)
+      *matches = ranges[0].first;
 
-    // Move instruction pointer (ip) to next instruction. Each opcode has
-    // a different size.
-    switch (*ip)
+    return ERROR_SUCCESS;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    for (int n = ranges[i].first; n <= ranges[i].last; n++)
     {
-    case RE_OPCODE_ANY:
-      ip += 1;
-      break;
-    case RE_OPCODE_LITERAL:
-    case RE_OPCODE_NOT_LITERAL:
-      ip += 2;
-      break;
-    case RE_OPCODE_MASKED_LITERAL:
-    case RE_OPCODE_MASKED_NOT_LITERAL:
-      ip += 3;
-      break;
-    case RE_OPCODE_REPEAT_ANY_UNGREEDY:
-      ip += 1 + sizeof(RE_REPEAT_ANY_ARGS);
-      break;
-    case RE_OPCODE_MATCH:
-      break;
-    default:
-      assert(false);
+      FAIL_ON_ERROR(callback(
+          backwards ? input_data - n : input_data, n, flags, callback_args));
     }
-
-    round++;
   }
 
-  // If this point is reached no matches were found.
-
   if (matches != NULL)
     *matches = -1;
 
   return ERROR_SUCCESS;
+
+_fast_exec:
+
+  return yr_re_fast_exec(
+      context,
+      code,
+      input_data,
+      input_forwards_size,
+      input_backwards_size,
+      flags,
+      callback,
+      callback_args,
+      matches);
 }
 
 static void _yr_re_print_node(RE_NODE* re_node, uint32_t indent)
@@ -31,10 +31,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <ctype.h>
 #include <string.h>
 #include <yara/compiler.h>
+#include <yara/ac_compact.h>
 #include <yara/error.h>
 #include <yara/filemap.h>
 #include <yara/globals.h>
+#include <yara/libyara.h>
 #include <yara/mem.h>
+#include <yara/prefilter.h>
 #include <yara/proc.h>
 #include <yara/rules.h>
 #include <yara/scan.h>
@@ -373,6 +376,35 @@ int yr_rules_from_arena(YR_ARENA* arena, YR_RULES** rules)
 
   new_rules->code_start = yr_arena_get_ptr(arena, YR_CODE_SECTION, 0);
 
+  new_rules->module_fields = yr_arena_get_ptr(
+      arena, YR_MODULE_FIELDS_SECTION, 0);
+
+  new_rules->ac_compact = NULL;
+
+  uint32_t compact_layout = 0;
+  yr_get_configuration_uint32(YR_CONFIG_AC_COMPACT_LAYOUT, &compact_layout);
+
+  int result = yr_ac_prefilter_create(
+      new_rules->ac_transition_table,
+      new_rules->ac_match_table,
+      &new_rules->ac_prefilter);
+
+  if (result == ERROR_SUCCESS && compact_layout)
+    result = yr_ac_compact_create(
+        new_rules->ac_transition_table,
+        new_rules->ac_match_table,
+        arena->buffers[YR_AC_TRANSITION_TABLE].used / sizeof(YR_AC_TRANSITION),
+        &new_rules->ac_compact);
+
+  if (result != ERROR_SUCCESS)
+  {
+    yr_ac_prefilter_destroy(new_rules->ac_prefilter);
+    yr_arena_release(arena);
+    yr_free(new_rules->no_required_strings);
+    yr_free(new_rules);
+    return result;
+  }
+
   // If a rule has no required_strings, this means that the condition might
   // evaluate to true without any matching strings, and we therefore have to
   // mark it as "to be evaluated" from the beginning.
@@ -424,11 +456,35 @@ YR_API int yr_rules_load(const char* filename, YR_RULES** rules)
   return result;
 }
 
+YR_API int yr_rules_load_mapped(
+    const char* filename,
+    uint64_t offset,
+    YR_RULES** rules)
+{
+  YR_ARENA* arena;
+
+  // The arena keeps the file mapped for as long as it lives, which is the
+  // lifetime of the YR_RULES object.
+  FAIL_ON_ERROR(yr_arena_load_mapped(filename, offset, &arena));
+
+  FAIL_ON_ERROR_WITH_CLEANUP(
+      yr_rules_from_arena(arena, rules), yr_arena_release(arena));
+
+  yr_arena_release(arena);
+
+  return ERROR_SUCCESS;
+}
+
 YR_API int yr_rules_save_stream(YR_RULES* rules, YR_STREAM* stream)
 {
   return yr_arena_save_stream(rules->arena, stream);
 }
 
+YR_API int yr_rules_save_mappable_stream(YR_RULES* rules, YR_STREAM* stream)
+{
+  return yr_arena_save_mappable_stream(rules->arena, stream);
+}
+
 YR_API int yr_rules_save(YR_RULES* rules, const char* filename)
 {
   int result;
@@ -542,6 +598,8 @@ YR_API int yr_rules_destroy(YR_RULES* rules)
     external++;
   }
 
+  yr_ac_prefilter_destroy(rules->ac_prefilter);
+  yr_ac_compact_destroy(rules->ac_compact);
   yr_free(rules->no_required_strings);
   yr_arena_release(rules->arena);
   yr_free(rules);
@@ -32,10 +32,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <yara/bitmask.h>
+#include <yara/compare.h>
 #include <yara/error.h>
 #include <yara/globals.h>
 #include <yara/libyara.h>
 #include <yara/limits.h>
+#include <yara/matches.h>
 #include <yara/re.h>
 #include <yara/rules.h>
 #include <yara/scan.h>
@@ -67,23 +69,18 @@ static int _yr_scan_xor_compare(
     uint8_t* xor_key)
 {
   int result = 0;
-  const uint8_t* s1 = data;
-  const uint8_t* s2 = string;
   uint8_t k = 0;
 
-  size_t i = 0;
-
   if (data_size < string_length)
     goto _exit;
 
-  // Calculate the xor key to compare with. *s1 is the start of the string we
-  // matched on and *s2 is the "plaintext" string, so *s1 ^ *s2 is the key to
-  // every *s2 as we compare.
-  k = *s1 ^ *s2;
+  // Calculate the xor key to compare with. *data is the start of the string
+  // we matched on and *string is the "plaintext" string, so *data ^ *string
+  // is the key to every byte of string as we compare.
+  k = *data ^ *string;
 
-  while (i < string_length && *s1++ == ((*s2++) ^ k)) i++;
-
-  result = (int) ((i == string_length) ? i : 0);
+  if (yr_compare_xor(data, string, string_length, k))
+    result = (int) string_length;
 
 _exit:;
 
@@ -110,28 +107,18 @@ static int _yr_scan_xor_wcompare(
     uint8_t* xor_key)
 {
   int result = 0;
-  const uint8_t* s1 = data;
-  const uint8_t* s2 = string;
   uint8_t k = 0;
 
-  size_t i = 0;
-
   if (data_size < string_length * 2)
     return 0;
 
-  // Calculate the xor key to compare with. *s1 is the start of the string we
-  // matched on and *s2 is the "plaintext" string, so *s1 ^ *s2 is the key to
-  // every *s2 as we compare.
-  k = *s1 ^ *s2;
+  // Calculate the xor key to compare with. *data is the start of the string
+  // we matched on and *string is the "plaintext" string, so *data ^ *string
+  // is the key to every byte of string as we compare.
+  k = *data ^ *string;
 
-  while (i < string_length && *s1 == ((*s2) ^ k) && ((*(s1 + 1)) ^ k) == 0x00)
-  {
-    s1 += 2;
-    s2++;
-    i++;
-  }
-
-  result = (int) ((i == string_length) ? i * 2 : 0);
+  if (yr_compare_xor_wide(data, string, string_length, k))
+    result = (int) string_length * 2;
 
   if (result > 0)
     *xor_key = k;
@@ -164,17 +151,13 @@ static int _yr_scan_icompare(
     uint8_t* string,
     size_t string_length)
 {
-  const uint8_t* s1 = data;
-  const uint8_t* s2 = string;
-
-  size_t i = 0;
-
   if (data_size < string_length)
     return 0;
 
-  while (i < string_length && yr_lowercase[*s1++] == yr_lowercase[*s2++]) i++;
+  if (!yr_compare_nocase(data, string, string_length))
+    return 0;
 
-  return (int) ((i == string_length) ? i : 0);
+  return (int) string_length;
 }
 
 static int _yr_scan_wcompare(
@@ -184,22 +167,12 @@ static int _yr_scan_wcompare(
     size_t string_length)
 {
   int result = 0;
-  const uint8_t* s1 = data;
-  const uint8_t* s2 = string;
-
-  size_t i = 0;
 
   if (data_size < string_length * 2)
     goto _exit;
 
-  while (i < string_length && *s1 == *s2 && *(s1 + 1) == 0x00)
-  {
-    s1 += 2;
-    s2++;
-    i++;
-  }
-
-  result = (int) ((i == string_length) ? i * 2 : 0);
+  if (yr_compare_wide(data, string, string_length))
+    result = (int) string_length * 2;
 
 _exit:;
 
@@ -222,23 +195,12 @@ static int _yr_scan_wicompare(
     size_t string_length)
 {
   int result = 0;
-  const uint8_t* s1 = data;
-  const uint8_t* s2 = string;
-
-  size_t i = 0;
 
   if (data_size < string_length * 2)
     goto _exit;
 
-  while (i < string_length && yr_lowercase[*s1] == yr_lowercase[*s2] &&
-         *(s1 + 1) == 0x00)
-  {
-    s1 += 2;
-    s2++;
-    i++;
-  }
-
-  result = (int) ((i == string_length) ? i * 2 : 0);
+  if (yr_compare_wide_nocase(data, string, string_length))
+    result = (int) string_length * 2;
 
 _exit:;
 
@@ -289,8 +251,7 @@ static void _yr_scan_update_match_chain_length(
 
 static int _yr_scan_add_match_to_list(
     YR_MATCH* match,
-    YR_MATCHES* matches_list,
-    int replace_if_exists)
+    YR_MATCH_LIST* matches_list)
 {
   int result = ERROR_SUCCESS;
 
@@ -310,16 +271,7 @@ static int _yr_scan_add_match_to_list(
   {
     if ((match->base + match->offset) ==
         (insertion_point->base + insertion_point->offset))
-    {
-      if (replace_if_exists)
-      {
-        insertion_point->match_length = match->match_length;
-        insertion_point->data_length = match->data_length;
-        insertion_point->data = match->data;
-      }
-
       goto _exit;  // return ERROR_SUCCESS
-    }
 
     if ((match->base + match->offset) >
         (insertion_point->base + insertion_point->offset))
@@ -353,11 +305,10 @@ _exit:;
   YR_DEBUG_FPRINTF(
       2,
       stderr,
-      "- %s(replace_if_exists=%d) {} = %d //"
+      "- %s() {} = %d //"
       " match->base=0x%" PRIx64 " match->offset=%" PRIi64
       " matches_list->count=%u += %u\n",
       __FUNCTION__,
-      replace_if_exists,
       result,
       match->base,
       match->offset,
@@ -369,7 +320,7 @@ _exit:;
 
 static void _yr_scan_remove_match_from_list(
     YR_MATCH* match,
-    YR_MATCHES* matches_list)
+    YR_MATCH_LIST* matches_list)
 {
   if (match->prev != NULL)
     match->prev->next = match->next;
@@ -565,7 +516,7 @@ static int _yr_scan_verify_chained_string_match(
               match->match_length, (int32_t) max_match_data);
 
           match->data = yr_notebook_alloc(
-              context->matches_notebook, match->data_length);
+              context->notebook, match->data_length);
 
           if (match->data == NULL)
             return ERROR_INSUFFICIENT_MEMORY;
@@ -579,8 +530,8 @@ static int _yr_scan_verify_chained_string_match(
           // required to be evaluated.
           yr_bitmask_set(context->required_eval, string->rule_idx);
 
-          FAIL_ON_ERROR(_yr_scan_add_match_to_list(
-              match, &context->matches[string->idx], false));
+          FAIL_ON_ERROR(yr_matches_add(
+              &context->matches[string->idx], context->notebook, match, false));
         }
 
         match = next_match;
@@ -589,7 +540,7 @@ static int _yr_scan_verify_chained_string_match(
     else  // It's a part of a chain, but not the tail.
     {
       new_match = yr_notebook_alloc(
-          context->matches_notebook, sizeof(YR_MATCH));
+          context->notebook, sizeof(YR_MATCH));
 
       if (new_match == NULL)
         return ERROR_INSUFFICIENT_MEMORY;
@@ -610,7 +561,7 @@ static int _yr_scan_verify_chained_string_match(
       if (new_match->data_length > 0)
       {
         new_match->data = yr_notebook_alloc(
-            context->matches_notebook, new_match->data_length);
+            context->notebook, new_match->data_length);
 
         if (new_match->data == NULL)
           return ERROR_INSUFFICIENT_MEMORY;
@@ -626,9 +577,7 @@ static int _yr_scan_verify_chained_string_match(
       // is part of a chain but not its tail, so we can't be sure the this is
       // an actual match until finding the remaining parts of the chain.
       FAIL_ON_ERROR(_yr_scan_add_match_to_list(
-          new_match,
-          &context->unconfirmed_matches[matching_string->idx],
-          false));
+          new_match, &context->unconfirmed_matches[matching_string->idx]));
     }
   }
 
@@ -644,7 +593,7 @@ static int _yr_scan_match_callback(
   CALLBACK_ARGS* callback_args = (CALLBACK_ARGS*) args;
 
   YR_STRING* string = callback_args->string;
-  YR_MATCH* new_match;
+  YR_MATCH new_match;
 
   int result = ERROR_SUCCESS;
 
@@ -715,52 +664,44 @@ static int _yr_scan_match_callback(
     FAIL_ON_ERROR(
         yr_get_configuration_uint32(YR_CONFIG_MAX_MATCH_DATA, &max_match_data));
 
-    new_match = yr_notebook_alloc(
-        callback_args->context->matches_notebook, sizeof(YR_MATCH));
+    // The match is copied into the string's matches, only the data needs
+    // its own buffer.
+    new_match.data_length = yr_min(match_length, (int32_t) max_match_data);
 
-    if (new_match == NULL)
+    if (new_match.data_length > 0)
     {
-      result = ERROR_INSUFFICIENT_MEMORY;
-      goto _exit;
-    }
-
-    new_match->data_length = yr_min(match_length, (int32_t) max_match_data);
+      new_match.data = yr_notebook_alloc(
+          callback_args->context->notebook, new_match.data_length);
 
-    if (new_match->data_length > 0)
-    {
-      new_match->data = yr_notebook_alloc(
-          callback_args->context->matches_notebook, new_match->data_length);
-
-      if (new_match->data == NULL)
+      if (new_match.data == NULL)
       {
         result = ERROR_INSUFFICIENT_MEMORY;
         goto _exit;
       }
 
-      memcpy((void*) new_match->data, match_data, new_match->data_length);
+      memcpy((void*) new_match.data, match_data, new_match.data_length);
     }
     else
     {
-      new_match->data = NULL;
+      new_match.data = NULL;
     }
 
-    if (result == ERROR_SUCCESS)
-    {
-      new_match->base = callback_args->data_base;
-      new_match->offset = match_offset;
-      new_match->match_length = match_length;
-      new_match->prev = NULL;
-      new_match->next = NULL;
-      new_match->is_private = STRING_IS_PRIVATE(string);
-      new_match->xor_key = callback_args->xor_key;
-
-      yr_bitmask_set(callback_args->context->required_eval, string->rule_idx);
-
-      FAIL_ON_ERROR(_yr_scan_add_match_to_list(
-          new_match,
-          &callback_args->context->matches[string->idx],
-          STRING_IS_GREEDY_REGEXP(string)));
-    }
+    new_match.base = callback_args->data_base;
+    new_match.offset = match_offset;
+    new_match.match_length = match_length;
+    new_match.prev = NULL;
+    new_match.next = NULL;
+    new_match.chain_length = 0;
+    new_match.is_private = STRING_IS_PRIVATE(string);
+    new_match.xor_key = callback_args->xor_key;
+
+    yr_bitmask_set(callback_args->context->required_eval, string->rule_idx);
+
+    FAIL_ON_ERROR(yr_matches_add(
+        &callback_args->context->matches[string->idx],
+        callback_args->context->notebook,
+        &new_match,
+        STRING_IS_GREEDY_REGEXP(string)));
   }
 
 _exit:;
@@ -813,7 +754,9 @@ static int _yr_scan_verify_re_match(
   if (STRING_IS_DOT_ALL(ac_match->string))
     flags |= RE_FLAGS_DOT_ALL;
 
-  if (STRING_IS_FAST_REGEXP(ac_match->string))
+  if (STRING_IS_HEX_EXEC(ac_match->string))
+    exec = yr_re_hex_exec;
+  else if (STRING_IS_FAST_REGEXP(ac_match->string))
     exec = yr_re_fast_exec;
   else
     exec = yr_re_exec;
@@ -1059,7 +1002,7 @@ int yr_scan_verify_match(
     return ERROR_SUCCESS;
 
   if (context->flags & SCAN_FLAGS_FAST_MODE && STRING_IS_SINGLE_MATCH(string) &&
-      context->matches[string->idx].head != NULL)
+      context->matches[string->idx].count > 0)
     return ERROR_SUCCESS;
 
   if (STRING_IS_FIXED_OFFSET(string) &&
@@ -1072,7 +1015,12 @@ int yr_scan_verify_match(
                     YR_MATCH_VERIFICATION_PROFILING_RATE ==
                 0;
 
-  if (sample)
+  bool sample_string =
+      context->string_profiling_info[string->idx].atom_matches %
+          YR_MATCH_VERIFICATION_PROFILING_RATE ==
+      0;
+
+  if (sample || sample_string)
     start_time = yr_stopwatch_elapsed_ns(&context->stopwatch);
 #endif
 
@@ -1113,13 +1061,20 @@ int yr_scan_verify_match(
   }
 
 #ifdef YR_PROFILING_ENABLED
-  if (sample)
+  if (sample || sample_string)
   {
     uint64_t finish_time = yr_stopwatch_elapsed_ns(&context->stopwatch);
-    context->profiling_info[string->rule_idx].match_time +=
-        (finish_time - start_time);
+
+    if (sample)
+      context->profiling_info[string->rule_idx].match_time +=
+          (finish_time - start_time);
+
+    if (sample_string)
+      context->string_profiling_info[string->idx].match_time +=
+          (finish_time - start_time);
   }
   context->profiling_info[string->rule_idx].atom_matches++;
+  context->string_profiling_info[string->idx].atom_matches++;
 #endif
 
   if (result != ERROR_SUCCESS)
@@ -28,16 +28,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <stdlib.h>
+#include <yara/ac_compact.h>
 #include <yara/ahocorasick.h>
 #include <yara/error.h>
 #include <yara/exec.h>
 #include <yara/exefiles.h>
 #include <yara/libyara.h>
+#include <yara/matches.h>
 #include <yara/mem.h>
 #include <yara/object.h>
+#include <yara/prefilter.h>
 #include <yara/proc.h>
+#include <yara/re.h>
 #include <yara/scanner.h>
 #include <yara/strutils.h>
+#include <yara/threading.h>
 #include <yara/types.h>
 
 #include "exception.h"
@@ -60,12 +65,22 @@ static int _yr_scanner_scan_mem_block(
 
   YR_RULES* rules = scanner->rules;
   YR_AC_TRANSITION* transition_table = rules->ac_transition_table;
-  uint32_t* match_table = rules->ac_match_table;
+  const YR_AC_COMPACT* compact = rules->ac_compact;
+
+  // The compact layout numbers states differently, so it has its own match
+  // table pointing into the same pool.
+  uint32_t* match_table = compact != NULL ? compact->match_table
+                                          : rules->ac_match_table;
+
+  const YR_AC_PREFILTER* prefilter = (scanner->flags & SCAN_FLAGS_NO_PREFILTER)
+                                         ? NULL
+                                         : rules->ac_prefilter;
 
   YR_AC_MATCH* match;
   YR_AC_TRANSITION transition;
 
   size_t i = 0;
+  size_t next_timeout_check = 0;
   uint32_t state = YR_AC_ROOT_STATE;
   uint16_t index;
   YR_STRING* report_string = NULL;
@@ -73,8 +88,22 @@ static int _yr_scanner_scan_mem_block(
 
   while (i < block->size)
   {
-    if (i % 4096 == 0 && scanner->timeout > 0)
+    // The root state has no matches when there's a prefilter, so the input
+    // can be skipped up to the next byte that would leave it.
+    if (state == YR_AC_ROOT_STATE && prefilter != NULL)
+    {
+      i = yr_ac_prefilter_skip(prefilter, block_data, i, block->size);
+
+      if (i == block->size)
+        break;
+    }
+
+    // The prefilter can jump over multiples of 4096, so the next check is
+    // tracked explicitly.
+    if (i >= next_timeout_check && scanner->timeout > 0)
     {
+      next_timeout_check = i + 4096;
+
       if (yr_stopwatch_elapsed_ns(&scanner->stopwatch) > scanner->timeout)
       {
         result = ERROR_SCAN_TIMEOUT;
@@ -131,6 +160,12 @@ static int _yr_scanner_scan_mem_block(
       }
     }
 
+    if (compact != NULL)
+    {
+      state = yr_ac_compact_next(compact, state, block_data[i++]);
+      continue;
+    }
+
     index = block_data[i++] + 1;
     transition = transition_table[state + index];
 
@@ -232,7 +267,15 @@ static void _yr_scanner_clean_matches(YR_SCANNER* scanner)
   memset(
       scanner->unconfirmed_matches,
       0,
-      sizeof(YR_MATCHES) * scanner->rules->num_strings);
+      sizeof(YR_MATCH_LIST) * scanner->rules->num_strings);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rounds size up to the next multiple of YR_CACHE_LINE_SIZE.
+//
+static size_t _yr_scanner_cache_line_align(size_t size)
+{
+  return (size + YR_CACHE_LINE_SIZE - 1) & ~((size_t) YR_CACHE_LINE_SIZE - 1);
 }
 
 YR_API int yr_scanner_create(YR_RULES* rules, YR_SCANNER** scanner)
@@ -242,66 +285,111 @@ YR_API int yr_scanner_create(YR_RULES* rules, YR_SCANNER** scanner)
   YR_EXTERNAL_VARIABLE* external;
   YR_SCANNER* new_scanner;
 
-  new_scanner = (YR_SCANNER*) yr_calloc(1, sizeof(YR_SCANNER));
+  // The scanner and every per-rule and per-string array it needs live in a
+  // single block, each one starting at its own cache line. The block is also
+  // padded to a whole number of cache lines, so any number of scanners can
+  // share the same YR_RULES from different threads without writing to each
+  // other's cache lines, and a scan does a single allocation for them.
+  size_t scanner_size = _yr_scanner_cache_line_align(sizeof(YR_SCANNER));
 
-  if (new_scanner == NULL)
-    return ERROR_INSUFFICIENT_MEMORY;
+  size_t rules_bitmask_size = _yr_scanner_cache_line_align(
+      sizeof(YR_BITMASK) * YR_BITMASK_SIZE(rules->num_rules));
 
-  FAIL_ON_ERROR_WITH_CLEANUP(
-      yr_hash_table_create(64, &new_scanner->objects_table),
-      yr_free(new_scanner));
+  size_t namespaces_bitmask_size = _yr_scanner_cache_line_align(
+      sizeof(YR_BITMASK) * YR_BITMASK_SIZE(rules->num_namespaces));
 
-  new_scanner->rules = rules;
-  new_scanner->entry_point = YR_UNDEFINED;
-  new_scanner->file_size = YR_UNDEFINED;
-  new_scanner->canary = rand();
+  size_t strings_bitmask_size = _yr_scanner_cache_line_align(
+      sizeof(YR_BITMASK) * YR_BITMASK_SIZE(rules->num_strings));
 
-  // By default report both matching and non-matching rules.
-  new_scanner->flags = SCAN_FLAGS_REPORT_RULES_MATCHING |
-                       SCAN_FLAGS_REPORT_RULES_NOT_MATCHING;
+  size_t matches_size = _yr_scanner_cache_line_align(
+      sizeof(YR_MATCHES) * rules->num_strings);
 
-  new_scanner->rule_matches_flags = (YR_BITMASK*) yr_calloc(
-      sizeof(YR_BITMASK), YR_BITMASK_SIZE(rules->num_rules));
+  size_t unconfirmed_matches_size = _yr_scanner_cache_line_align(
+      sizeof(YR_MATCH_LIST) * rules->num_strings);
 
-  new_scanner->required_eval = (YR_BITMASK*) yr_calloc(
-      sizeof(YR_BITMASK), YR_BITMASK_SIZE(rules->num_rules));
+  size_t size = scanner_size + 2 * rules_bitmask_size +
+                namespaces_bitmask_size + strings_bitmask_size + matches_size +
+                unconfirmed_matches_size;
 
-  new_scanner->ns_unsatisfied_flags = (YR_BITMASK*) yr_calloc(
-      sizeof(YR_BITMASK), YR_BITMASK_SIZE(rules->num_namespaces));
+#ifdef YR_PROFILING_ENABLED
+  size_t rules_profiling_size = _yr_scanner_cache_line_align(
+      sizeof(YR_PROFILING_INFO) * rules->num_rules);
 
-  new_scanner->strings_temp_disabled = (YR_BITMASK*) yr_calloc(
-      sizeof(YR_BITMASK), YR_BITMASK_SIZE(rules->num_strings));
+  size_t strings_profiling_size = _yr_scanner_cache_line_align(
+      sizeof(YR_PROFILING_INFO) * rules->num_strings);
 
-  new_scanner->matches = (YR_MATCHES*) yr_calloc(
-      rules->num_strings, sizeof(YR_MATCHES));
+  size += rules_profiling_size + strings_profiling_size;
+#endif
 
-  new_scanner->unconfirmed_matches = (YR_MATCHES*) yr_calloc(
-      rules->num_strings, sizeof(YR_MATCHES));
+  // The extra cache line leaves room for aligning the start of the block.
+  void* allocation = yr_calloc(1, size + YR_CACHE_LINE_SIZE);
 
-  if (new_scanner->rule_matches_flags == NULL ||
-      new_scanner->required_eval == NULL ||
-      new_scanner->ns_unsatisfied_flags == NULL ||
-      new_scanner->strings_temp_disabled == NULL ||
-      (new_scanner->matches == NULL && rules->num_strings > 0) ||
-      (new_scanner->unconfirmed_matches == NULL && rules->num_strings > 0))
-  {
-    yr_scanner_destroy(new_scanner);
+  if (allocation == NULL)
     return ERROR_INSUFFICIENT_MEMORY;
-  }
+
+  uint8_t* ptr = (uint8_t*) _yr_scanner_cache_line_align((size_t) allocation);
+
+  new_scanner = (YR_SCANNER*) ptr;
+  new_scanner->allocation = allocation;
+  ptr += scanner_size;
+
+  new_scanner->rule_matches_flags = (YR_BITMASK*) ptr;
+  ptr += rules_bitmask_size;
+
+  new_scanner->required_eval = (YR_BITMASK*) ptr;
+  ptr += rules_bitmask_size;
+
+  new_scanner->ns_unsatisfied_flags = (YR_BITMASK*) ptr;
+  ptr += namespaces_bitmask_size;
+
+  new_scanner->strings_temp_disabled = (YR_BITMASK*) ptr;
+  ptr += strings_bitmask_size;
+
+  new_scanner->matches = (YR_MATCHES*) ptr;
+  ptr += matches_size;
+
+  new_scanner->unconfirmed_matches = (YR_MATCH_LIST*) ptr;
+  ptr += unconfirmed_matches_size;
 
 #ifdef YR_PROFILING_ENABLED
-  new_scanner->profiling_info = yr_calloc(
-      rules->num_rules, sizeof(YR_PROFILING_INFO));
+  new_scanner->profiling_info = (YR_PROFILING_INFO*) ptr;
+  ptr += rules_profiling_size;
 
-  if (new_scanner->profiling_info == NULL && rules->num_rules > 0)
-  {
-    yr_scanner_destroy(new_scanner);
-    return ERROR_INSUFFICIENT_MEMORY;
-  }
+  new_scanner->string_profiling_info = (YR_PROFILING_INFO*) ptr;
+  ptr += strings_profiling_size;
 #else
   new_scanner->profiling_info = NULL;
 #endif
 
+  FAIL_ON_ERROR_WITH_CLEANUP(
+      yr_hash_table_create(64, &new_scanner->objects_table),
+      yr_free(allocation));
+
+  // The notebook holds everything that lives as long as a single scan: the
+  // YR_MATCH structures and their data snippets, the objects created by the
+  // modules, the loop iterators and the evaluation stack. It's reset at the
+  // start of each scan and keeps its pages, so scanning files one after
+  // another doesn't allocate and free the same memory over and over. Each
+  // notebook's page can store up to 1024 matches.
+  uint32_t max_match_data;
+
+  yr_get_configuration_uint32(YR_CONFIG_MAX_MATCH_DATA, &max_match_data);
+
+  FAIL_ON_ERROR_WITH_CLEANUP(
+      yr_notebook_create(
+          1024 * (sizeof(YR_MATCH) + max_match_data), &new_scanner->notebook),
+      yr_hash_table_destroy(new_scanner->objects_table, NULL);
+      yr_free(allocation));
+
+  new_scanner->rules = rules;
+  new_scanner->entry_point = YR_UNDEFINED;
+  new_scanner->file_size = YR_UNDEFINED;
+  new_scanner->canary = rand();
+
+  // By default report both matching and non-matching rules.
+  new_scanner->flags = SCAN_FLAGS_REPORT_RULES_MATCHING |
+                       SCAN_FLAGS_REPORT_RULES_NOT_MATCHING;
+
   external = rules->ext_vars_table;
 
   while (!EXTERNAL_VARIABLE_IS_NULL(external))
@@ -344,6 +432,9 @@ YR_API void yr_scanner_destroy(YR_SCANNER* scanner)
     fiber = next;
   }
 
+  yr_re_dfa_cache_destroy(scanner->re_dfa_cache);
+  yr_re_hex_cache_destroy(scanner->re_hex_cache);
+
   RE_FAST_EXEC_POSITION* position = scanner->re_fast_exec_position_pool.head;
 
   while (position != NULL)
@@ -360,17 +451,10 @@ YR_API void yr_scanner_destroy(YR_SCANNER* scanner)
         (YR_HASH_TABLE_FREE_VALUE_FUNC) yr_object_destroy);
   }
 
-#ifdef YR_PROFILING_ENABLED
-  yr_free(scanner->profiling_info);
-#endif
+  if (scanner->notebook != NULL)
+    yr_notebook_destroy(scanner->notebook);
 
-  yr_free(scanner->rule_matches_flags);
-  yr_free(scanner->ns_unsatisfied_flags);
-  yr_free(scanner->required_eval);
-  yr_free(scanner->strings_temp_disabled);
-  yr_free(scanner->matches);
-  yr_free(scanner->unconfirmed_matches);
-  yr_free(scanner);
+  yr_free(scanner->allocation);
 }
 
 YR_API void yr_scanner_set_callback(
@@ -403,6 +487,11 @@ YR_API void yr_scanner_set_flags(YR_SCANNER* scanner, int flags)
   scanner->flags = flags;
 }
 
+YR_API void yr_scanner_set_threads(YR_SCANNER* scanner, int threads)
+{
+  scanner->threads = threads;
+}
+
 YR_API int yr_scanner_define_integer_variable(
     YR_SCANNER* scanner,
     const char* identifier,
@@ -462,17 +551,117 @@ YR_API int yr_scanner_define_string_variable(
   return yr_object_set_string(value, strlen(value), obj, NULL);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Prepares the scanner for a new scan, discarding whatever the previous scan
+// left in the notebook.
+//
+static int _yr_scanner_begin_scan(YR_SCANNER* scanner)
+{
+  yr_notebook_reset(scanner->notebook);
+
+  // Every rule that doesn't require a matching string must be evaluated
+  // regardless of whether a string matched or not.
+  memcpy(
+      scanner->required_eval,
+      scanner->rules->no_required_strings,
+      sizeof(YR_BITMASK) * YR_BITMASK_SIZE(scanner->rules->num_rules));
+
+  yr_stopwatch_start(&scanner->stopwatch);
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Releases the matches found during the last scan.
+//
+static void _yr_scanner_end_scan(YR_SCANNER* scanner)
+{
+  _yr_scanner_clean_matches(scanner);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the matches of every string that got some match out of order. Must be
+// called once all the blocks are scanned, before the matches are used.
+//
+static int _yr_scanner_sort_matches(YR_SCANNER* scanner)
+{
+  YR_RULES* rules = scanner->rules;
+
+  for (uint32_t i = 0; i < rules->num_strings; i++)
+  {
+    FAIL_ON_ERROR(yr_matches_sort(
+        &scanner->matches[i],
+        STRING_IS_GREEDY_REGEXP(&rules->strings_table[i])));
+  }
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Evaluates the conditions once all the matches are known and invokes the
+// callback for every rule.
+//
+static int _yr_scanner_evaluate_rules(YR_SCANNER* scanner)
+{
+  YR_RULE* rule;
+
+  int i, result = ERROR_SUCCESS;
+
+  FAIL_ON_ERROR(_yr_scanner_sort_matches(scanner));
+
+  YR_TRYCATCH(
+      !(scanner->flags & SCAN_FLAGS_NO_TRYCATCH),
+      { result = yr_execute_code(scanner); },
+      { result = ERROR_COULD_NOT_MAP_FILE; });
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  for (i = 0, rule = scanner->rules->rules_table; !RULE_IS_NULL(rule);
+       i++, rule++)
+  {
+    int message = 0;
+
+    if (yr_bitmask_is_set(scanner->rule_matches_flags, i) &&
+        yr_bitmask_is_not_set(scanner->ns_unsatisfied_flags, rule->ns->idx))
+    {
+      if (scanner->flags & SCAN_FLAGS_REPORT_RULES_MATCHING)
+        message = CALLBACK_MSG_RULE_MATCHING;
+    }
+    else
+    {
+      if (scanner->flags & SCAN_FLAGS_REPORT_RULES_NOT_MATCHING)
+        message = CALLBACK_MSG_RULE_NOT_MATCHING;
+    }
+
+    if (message != 0 && !RULE_IS_PRIVATE(rule))
+    {
+      switch (scanner->callback(scanner, message, rule, scanner->user_data))
+      {
+      case CALLBACK_ABORT:
+        return ERROR_SUCCESS;
+
+      case CALLBACK_ERROR:
+        return ERROR_CALLBACK_ERROR;
+      }
+    }
+  }
+
+  scanner->callback(
+      scanner, CALLBACK_MSG_SCAN_FINISHED, NULL, scanner->user_data);
+
+  return ERROR_SUCCESS;
+}
+
 YR_API int yr_scanner_scan_mem_blocks(
     YR_SCANNER* scanner,
     YR_MEMORY_BLOCK_ITERATOR* iterator)
 {
   YR_DEBUG_FPRINTF(2, stderr, "+ %s() {\n", __FUNCTION__);
 
-  YR_RULES* rules;
-  YR_RULE* rule;
   YR_MEMORY_BLOCK* block;
 
-  int i, result = ERROR_SUCCESS;
+  int result = ERROR_SUCCESS;
 
   if (scanner->callback == NULL)
   {
@@ -481,7 +670,6 @@ YR_API int yr_scanner_scan_mem_blocks(
   }
 
   scanner->iterator = iterator;
-  rules = scanner->rules;
 
   if (iterator->last_error == ERROR_BLOCK_NOT_READY)
   {
@@ -491,31 +679,11 @@ YR_API int yr_scanner_scan_mem_blocks(
   }
   else
   {
-    // Create the notebook that will hold the YR_MATCH structures representing
-    // each match found. This notebook will also contain snippets of the
-    // matching data (the "data" field in YR_MATCH points to the snippet
-    // corresponding to the match). Each notebook's page can store up to 1024
-    // matches.
-    uint32_t max_match_data;
-
-    FAIL_ON_ERROR(
-        yr_get_configuration_uint32(YR_CONFIG_MAX_MATCH_DATA, &max_match_data));
-
-    result = yr_notebook_create(
-        1024 * (sizeof(YR_MATCH) + max_match_data), &scanner->matches_notebook);
+    result = _yr_scanner_begin_scan(scanner);
 
     if (result != ERROR_SUCCESS)
       goto _exit;
 
-    // Every rule that doesn't require a matching string must be evaluated
-    // regardless of whether a string matched or not.
-    memcpy(
-        scanner->required_eval,
-        scanner->rules->no_required_strings,
-        sizeof(YR_BITMASK) * YR_BITMASK_SIZE(rules->num_rules));
-
-    yr_stopwatch_start(&scanner->stopwatch);
-
     block = iterator->first(iterator);
   }
 
@@ -567,63 +735,15 @@ YR_API int yr_scanner_scan_mem_blocks(
   else
     scanner->file_size = YR_UNDEFINED;
 
-  YR_TRYCATCH(
-      !(scanner->flags & SCAN_FLAGS_NO_TRYCATCH),
-      { result = yr_execute_code(scanner); },
-      { result = ERROR_COULD_NOT_MAP_FILE; });
-
-  if (result != ERROR_SUCCESS)
-    goto _exit;
-
-  for (i = 0, rule = rules->rules_table; !RULE_IS_NULL(rule); i++, rule++)
-  {
-    int message = 0;
-
-    if (yr_bitmask_is_set(scanner->rule_matches_flags, i) &&
-        yr_bitmask_is_not_set(scanner->ns_unsatisfied_flags, rule->ns->idx))
-    {
-      if (scanner->flags & SCAN_FLAGS_REPORT_RULES_MATCHING)
-        message = CALLBACK_MSG_RULE_MATCHING;
-    }
-    else
-    {
-      if (scanner->flags & SCAN_FLAGS_REPORT_RULES_NOT_MATCHING)
-        message = CALLBACK_MSG_RULE_NOT_MATCHING;
-    }
-
-    if (message != 0 && !RULE_IS_PRIVATE(rule))
-    {
-      switch (scanner->callback(scanner, message, rule, scanner->user_data))
-      {
-      case CALLBACK_ABORT:
-        result = ERROR_SUCCESS;
-        goto _exit;
-
-      case CALLBACK_ERROR:
-        result = ERROR_CALLBACK_ERROR;
-        goto _exit;
-      }
-    }
-  }
-
-  scanner->callback(
-      scanner, CALLBACK_MSG_SCAN_FINISHED, NULL, scanner->user_data);
+  result = _yr_scanner_evaluate_rules(scanner);
 
 _exit:
 
-  // If error is ERROR_BLOCK_NOT_READY we don't clean the matches and don't
-  // destroy the notebook yet. ERROR_BLOCK_NOT_READY is not a permament error,
-  // the caller can still call this function again for a retry.
+  // If error is ERROR_BLOCK_NOT_READY we don't clean the matches yet.
+  // ERROR_BLOCK_NOT_READY is not a permament error, the caller can still call
+  // this function again for a retry.
   if (result != ERROR_BLOCK_NOT_READY)
-  {
-    _yr_scanner_clean_matches(scanner);
-
-    if (scanner->matches_notebook != NULL)
-    {
-      yr_notebook_destroy(scanner->matches_notebook);
-      scanner->matches_notebook = NULL;
-    }
-  }
+    _yr_scanner_end_scan(scanner);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -702,6 +822,323 @@ YR_API const uint8_t* yr_fetch_block_data(YR_MEMORY_BLOCK* block)
   return data;
 }
 
+// A range of a buffer scanned by its own scanner, see
+// _yr_scanner_scan_mem_parallel.
+typedef struct _YR_SCAN_RANGE
+{
+  YR_SCANNER* scanner;
+  YR_THREAD thread;
+  bool thread_started;
+
+  // Matches starting at offsets in [start, end) belong to this range. The
+  // block extends past both ends so that strings crossing them are verified
+  // with the same surrounding data a whole-buffer scan would see.
+  uint64_t start;
+  uint64_t end;
+  YR_MEMORY_BLOCK block;
+
+  int result;
+} YR_SCAN_RANGE;
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns an upper bound for the number of bytes spanned by a match of any
+// string in the rules. A literal string spans at most twice its length (wide),
+// regexps and hex strings are verified up to YR_RE_SCAN_LIMIT bytes in each
+// direction from the atom, and the parts of a chain are at most chain_gap_max
+// bytes apart.
+//
+static uint64_t _yr_scanner_max_match_span(YR_RULES* rules)
+{
+  uint64_t max_span = 0;
+
+  for (uint32_t i = 0; i < rules->num_strings; i++)
+  {
+    YR_STRING* string = &rules->strings_table[i];
+    uint64_t span = 0;
+
+    // Chains are measured from their tail, other parts add nothing new.
+    if (STRING_IS_CHAIN_PART(string) && !STRING_IS_CHAIN_TAIL(string))
+      continue;
+
+    for (; string != NULL; string = string->chained_to)
+    {
+      if (STRING_IS_LITERAL(string))
+        span += 2 * (uint64_t) string->length;
+      else
+        span += 2 * YR_RE_SCAN_LIMIT;
+
+      span += string->chain_gap_max;
+    }
+
+    max_span = yr_max(max_span, span);
+  }
+
+  return max_span;
+}
+
+static int _yr_scanner_range_callback(
+    YR_SCAN_CONTEXT* context,
+    int message,
+    void* message_data,
+    void* user_data)
+{
+  // Ranges are scanned in other threads, where the user's callback can't be
+  // invoked. Too many matches for some string are reported when merging the
+  // matches of all ranges.
+  return CALLBACK_CONTINUE;
+}
+
+static YR_THREAD_RESULT YR_THREAD_CALL _yr_scanner_scan_range(void* args)
+{
+  YR_SCAN_RANGE* range = (YR_SCAN_RANGE*) args;
+  YR_SCANNER* scanner = range->scanner;
+
+  range->result = _yr_scanner_begin_scan(scanner);
+
+  if (range->result != ERROR_SUCCESS)
+    return 0;
+
+  YR_TRYCATCH(
+      !(scanner->flags & SCAN_FLAGS_NO_TRYCATCH),
+      {
+        range->result = _yr_scanner_scan_mem_block(
+            scanner, yr_fetch_block_data(&range->block), &range->block);
+      },
+      { range->result = ERROR_COULD_NOT_MAP_FILE; });
+
+  if (range->result == ERROR_SUCCESS)
+    range->result = _yr_scanner_sort_matches(scanner);
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Moves the matches found by the scanners of each range into the main
+// scanner. Every range keeps only the matches starting within its own limits,
+// which makes them unique and, as ranges are sorted, already in ascending
+// offset order.
+//
+static int _yr_scanner_merge_ranges(
+    YR_SCANNER* scanner,
+    YR_SCAN_RANGE* ranges,
+    int num_ranges)
+{
+  YR_RULES* rules = scanner->rules;
+
+  for (uint32_t i = 0; i < rules->num_strings; i++)
+  {
+    YR_STRING* string = &rules->strings_table[i];
+    YR_MATCHES* matches = &scanner->matches[i];
+    bool full = false;
+
+    for (int r = 0; r < num_ranges && !full; r++)
+    {
+      YR_MATCHES* range_matches = &ranges[r].scanner->matches[i];
+
+      for (int32_t m = 0; m < range_matches->count; m++)
+      {
+        YR_MATCH* match = yr_matches_get(range_matches, m);
+        uint64_t offset = match->base + match->offset;
+
+        if (offset < ranges[r].start)
+          continue;
+
+        if (offset >= ranges[r].end)
+          break;
+
+        // With fast mode a single match is enough for these strings.
+        if (scanner->flags & SCAN_FLAGS_FAST_MODE &&
+            STRING_IS_SINGLE_MATCH(string) && matches->count > 0)
+          break;
+
+        if (matches->count == YR_MAX_STRING_MATCHES)
+        {
+          if (scanner->callback(
+                  scanner,
+                  CALLBACK_MSG_TOO_MANY_MATCHES,
+                  (void*) string,
+                  scanner->user_data) != CALLBACK_CONTINUE)
+          {
+            scanner->last_error_string = string;
+            return ERROR_TOO_MANY_MATCHES;
+          }
+
+          full = true;
+          break;
+        }
+
+        YR_MATCH new_match = *match;
+
+        // The whole buffer is a single block with base 0.
+        new_match.base = 0;
+        new_match.offset = (int64_t) offset;
+
+        if (match->data_length > 0)
+        {
+          new_match.data = yr_notebook_alloc(
+              scanner->notebook, match->data_length);
+
+          if (new_match.data == NULL)
+            return ERROR_INSUFFICIENT_MEMORY;
+
+          memcpy((void*) new_match.data, match->data, match->data_length);
+        }
+
+        FAIL_ON_ERROR(yr_matches_add(
+            matches, scanner->notebook, &new_match, false));
+
+        yr_bitmask_set(scanner->required_eval, string->rule_idx);
+      }
+    }
+  }
+
+#ifdef YR_PROFILING_ENABLED
+  for (int r = 0; r < num_ranges; r++)
+  {
+    for (uint32_t i = 0; i < rules->num_rules; i++)
+    {
+      scanner->profiling_info[i].atom_matches +=
+          ranges[r].scanner->profiling_info[i].atom_matches;
+      scanner->profiling_info[i].match_time +=
+          ranges[r].scanner->profiling_info[i].match_time;
+    }
+
+    for (uint32_t i = 0; i < rules->num_strings; i++)
+    {
+      scanner->string_profiling_info[i].atom_matches +=
+          ranges[r].scanner->string_profiling_info[i].atom_matches;
+      scanner->string_profiling_info[i].match_time +=
+          ranges[r].scanner->string_profiling_info[i].match_time;
+    }
+  }
+#endif
+
+  return ERROR_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Scans a single-block buffer by splitting it in ranges that are scanned in
+// parallel, each one by its own scanner in its own thread. Ranges overlap by
+// the maximum span of a match, so every match is found entirely by the range
+// where it starts. Once all the ranges are done their matches are merged into
+// this scanner and the conditions are evaluated once, as if the buffer was
+// scanned by a single thread.
+//
+static int _yr_scanner_scan_mem_parallel(
+    YR_SCANNER* scanner,
+    YR_MEMORY_BLOCK_ITERATOR* iterator)
+{
+  YR_MEMORY_BLOCK* block = iterator->first(iterator);
+  YR_SCAN_RANGE* ranges;
+
+  int result = ERROR_SUCCESS;
+  int num_ranges = (int) yr_min(
+      (uint64_t) scanner->threads,
+      (uint64_t) block->size / YR_PARALLEL_SCAN_MIN_RANGE);
+
+  if (num_ranges < 2)
+    return yr_scanner_scan_mem_blocks(scanner, iterator);
+
+  if (scanner->callback == NULL)
+    return ERROR_CALLBACK_REQUIRED;
+
+  const uint8_t* data = block->fetch_data(block);
+
+  // A match can be verified up to its span away from its atom in both
+  // directions, plus the bytes checked by fullword at both ends.
+  uint64_t overlap = 2 * _yr_scanner_max_match_span(scanner->rules) + 2;
+  uint64_t range_size = block->size / num_ranges;
+
+  ranges = (YR_SCAN_RANGE*) yr_calloc(num_ranges, sizeof(YR_SCAN_RANGE));
+
+  if (ranges == NULL)
+    return ERROR_INSUFFICIENT_MEMORY;
+
+  for (int r = 0; r < num_ranges; r++)
+  {
+    YR_SCAN_RANGE* range = &ranges[r];
+
+    range->start = r * range_size;
+    range->end = (r == num_ranges - 1) ? block->size : range->start + range_size;
+
+    uint64_t block_start = range->start > overlap ? range->start - overlap : 0;
+    uint64_t block_end = yr_min(range->end + overlap, (uint64_t) block->size);
+
+    range->block.base = block_start;
+    range->block.size = (size_t) (block_end - block_start);
+    range->block.context = (void*) (data + block_start);
+    range->block.fetch_data = _yr_fetch_block_data;
+
+    result = yr_scanner_create(scanner->rules, &range->scanner);
+
+    if (result != ERROR_SUCCESS)
+      goto _exit;
+
+    range->scanner->flags = scanner->flags;
+    range->scanner->timeout = scanner->timeout;
+    range->scanner->callback = _yr_scanner_range_callback;
+  }
+
+  scanner->iterator = iterator;
+
+  result = _yr_scanner_begin_scan(scanner);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  scanner->entry_point = yr_get_entry_point_offset(data, block->size);
+
+  // The first range is scanned by the calling thread. If some thread can't be
+  // created its range is scanned by the calling thread too.
+  for (int r = 1; r < num_ranges; r++)
+  {
+    ranges[r].thread_started =
+        yr_thread_create(
+            &ranges[r].thread, _yr_scanner_scan_range, &ranges[r]) ==
+        ERROR_SUCCESS;
+  }
+
+  _yr_scanner_scan_range(&ranges[0]);
+
+  for (int r = 1; r < num_ranges; r++)
+  {
+    if (ranges[r].thread_started)
+      yr_thread_join(&ranges[r].thread);
+    else
+      _yr_scanner_scan_range(&ranges[r]);
+  }
+
+  for (int r = 0; r < num_ranges && result == ERROR_SUCCESS; r++)
+    result = ranges[r].result;
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_scanner_merge_ranges(scanner, ranges, num_ranges);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  scanner->file_size = iterator->file_size(iterator);
+
+  result = _yr_scanner_evaluate_rules(scanner);
+
+_exit:
+
+  _yr_scanner_end_scan(scanner);
+
+  for (int r = 0; r < num_ranges; r++)
+  {
+    if (ranges[r].scanner != NULL)
+    {
+      _yr_scanner_end_scan(ranges[r].scanner);
+      yr_scanner_destroy(ranges[r].scanner);
+    }
+  }
+
+  yr_free(ranges);
+
+  return result;
+}
+
 YR_API int yr_scanner_scan_mem(
     YR_SCANNER* scanner,
     const uint8_t* buffer,
@@ -746,7 +1183,11 @@ YR_API int yr_scanner_scan_mem(
       return ERROR_TOO_SLOW_SCANNING;
   }
 
-  result = yr_scanner_scan_mem_blocks(scanner, &iterator);
+  if (scanner->threads > 1 &&
+      buffer_size >= 2 * (size_t) YR_PARALLEL_SCAN_MIN_RANGE)
+    result = _yr_scanner_scan_mem_parallel(scanner, &iterator);
+  else
+    result = yr_scanner_scan_mem_blocks(scanner, &iterator);
 
   YR_DEBUG_FPRINTF(
       2,
@@ -878,6 +1319,71 @@ YR_API YR_RULE_PROFILING_INFO* yr_scanner_get_profiling_info(
   return profiling_info;
 }
 
+static int sort_strings_by_cost_desc(
+    const struct YR_STRING_PROFILING_INFO* s1,
+    const struct YR_STRING_PROFILING_INFO* s2)
+{
+  if (s1->cost < s2->cost)
+    return 1;
+
+  if (s1->cost > s2->cost)
+    return -1;
+
+  return 0;
+}
+
+//
+// yr_scanner_get_string_profiling_info
+//
+// Same as yr_scanner_get_profiling_info but with one entry per string. The
+// cost of a string is the estimated time spent verifying its atom matches:
+// only one out of YR_MATCH_VERIFICATION_PROFILING_RATE matches is timed, so
+// the measured time is scaled up by the number of matches that weren't. The
+// last item in the array has string == NULL and the caller must free the
+// array with yr_free.
+//
+YR_API YR_STRING_PROFILING_INFO* yr_scanner_get_string_profiling_info(
+    YR_SCANNER* scanner)
+{
+  YR_STRING_PROFILING_INFO* profiling_info = yr_malloc(
+      (scanner->rules->num_strings + 1) * sizeof(YR_STRING_PROFILING_INFO));
+
+  if (profiling_info == NULL)
+    return NULL;
+
+  for (uint32_t i = 0; i < scanner->rules->num_strings; i++)
+  {
+    profiling_info[i].string = &scanner->rules->strings_table[i];
+#ifdef YR_PROFILING_ENABLED
+    uint32_t atom_matches = scanner->string_profiling_info[i].atom_matches;
+    uint32_t samples = (atom_matches + YR_MATCH_VERIFICATION_PROFILING_RATE -
+                        1) /
+                       YR_MATCH_VERIFICATION_PROFILING_RATE;
+
+    profiling_info[i].atom_matches = atom_matches;
+    profiling_info[i].cost =
+        samples > 0 ? scanner->string_profiling_info[i].match_time *
+                          atom_matches / samples
+                    : 0;
+#else
+    profiling_info[i].atom_matches = 0;
+    profiling_info[i].cost = 0;
+#endif
+  }
+
+  qsort(
+      profiling_info,
+      scanner->rules->num_strings,
+      sizeof(YR_STRING_PROFILING_INFO),
+      (int (*)(const void*, const void*)) sort_strings_by_cost_desc);
+
+  profiling_info[scanner->rules->num_strings].string = NULL;
+  profiling_info[scanner->rules->num_strings].atom_matches = 0;
+  profiling_info[scanner->rules->num_strings].cost = 0;
+
+  return profiling_info;
+}
+
 YR_API void yr_scanner_reset_profiling_info(YR_SCANNER* scanner)
 {
 #ifdef YR_PROFILING_ENABLED
@@ -885,6 +1391,11 @@ YR_API void yr_scanner_reset_profiling_info(YR_SCANNER* scanner)
       scanner->profiling_info,
       0,
       scanner->rules->num_rules * sizeof(YR_PROFILING_INFO));
+
+  memset(
+      scanner->string_profiling_info,
+      0,
+      scanner->rules->num_strings * sizeof(YR_PROFILING_INFO));
 #endif
 }
 
@@ -38,6 +38,32 @@ YR_THREAD_ID yr_current_thread_id(void)
 }
 
 
+int yr_thread_create(
+    YR_THREAD* thread,
+    YR_THREAD_START_ROUTINE start_routine,
+    void* args)
+{
+  *thread = CreateThread(NULL, 0, start_routine, args, 0, NULL);
+
+  if (*thread == NULL)
+    return ERROR_INTERNAL_FATAL_ERROR;
+
+  return ERROR_SUCCESS;
+}
+
+
+int yr_thread_join(YR_THREAD* thread)
+{
+  if (WaitForSingleObject(*thread, INFINITE) == WAIT_FAILED)
+    return ERROR_INTERNAL_FATAL_ERROR;
+
+  if (CloseHandle(*thread) == FALSE)
+    return ERROR_INTERNAL_FATAL_ERROR;
+
+  return ERROR_SUCCESS;
+}
+
+
 int yr_mutex_create(YR_MUTEX* mutex)
 {
   *mutex = CreateMutex(NULL, FALSE, NULL);
@@ -120,6 +146,27 @@ YR_THREAD_ID yr_current_thread_id(void)
 }
 
 
+int yr_thread_create(
+    YR_THREAD* thread,
+    YR_THREAD_START_ROUTINE start_routine,
+    void* args)
+{
+  if (pthread_create(thread, NULL, start_routine, args) != 0)
+    return ERROR_INTERNAL_FATAL_ERROR;
+
+  return ERROR_SUCCESS;
+}
+
+
+int yr_thread_join(YR_THREAD* thread)
+{
+  if (pthread_join(*thread, NULL) != 0)
+    return ERROR_INTERNAL_FATAL_ERROR;
+
+  return ERROR_SUCCESS;
+}
+
+
 int yr_mutex_create(YR_MUTEX* mutex)
 {
   if (pthread_mutex_init(mutex, NULL) != 0)
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <Windows.h>
+#include <yara.h>
+#include <tlshc/tlsh.h>
+#include "cert_store.hh"
+
+// every target binary is mapped once and its bytes are pushed through all
+// consumers chunk by chunk, so each chunk is hashed by everyone while it is hot
+constexpr size_t file_pipeline_chunk_size = 1 << 20;
+
+// binaries mapped together so their sha256 can share simd lanes, twice the
+// eight avx2 lanes so a lane that finishes early has a file to pick up
+constexpr size_t file_pipeline_batch_size = 16;
+
+class file_consumer {
+public:
+    virtual ~file_consumer() = default;
+    virtual void begin(const std::uint8_t* head, size_t head_size, std::uint64_t total_size) {}
+    virtual void update(std::uint64_t offset, const std::uint8_t* data, size_t size) = 0;
+    virtual void finish() {}
+};
+
+// md5, sha1 and sha256 in any combination from libyara's digest service, which
+// feeds each chunk to all of them a few kilobytes at a time
+class hash_consumer : public file_consumer {
+    YR_DIGEST_CTX context{};
+    YR_DIGEST result{};
+
+public:
+    explicit hash_consumer(int algorithms) {
+        yr_digest_init(&context, algorithms);
+    }
+
+    void update(std::uint64_t, const std::uint8_t* data, size_t size) override {
+        yr_digest_update(&context, data, size);
+    }
+
+    void finish() override {
+        yr_digest_final(&context, &result);
+    }
+
+    std::vector<std::uint8_t> digest(int algorithm) const {
+        switch (algorithm) {
+        case YR_DIGEST_MD5: return { result.md5, result.md5 + sizeof(result.md5) };
+        case YR_DIGEST_SHA1: return { result.sha1, result.sha1 + sizeof(result.sha1) };
+        case YR_DIGEST_SHA256: return { result.sha256, result.sha256 + sizeof(result.sha256) };
+        default: return {};
+        }
+    }
+
+    std::string hex(int algorithm) const {
+        const auto bytes = digest(algorithm);
+        return thumbprint_to_hex(bytes.data(), bytes.size());
+    }
+};
+
+// tlsh digest from libyara's tlshc, empty for files too small or too uniform to
+// have one
+class tlsh_consumer : public file_consumer {
+    Tlsh* tlsh = tlsh_new();
+    std::string result;
+
+public:
+    tlsh_consumer() = default;
+
+    ~tlsh_consumer() override {
+        tlsh_free(tlsh);
+    }
+
+    tlsh_consumer(const tlsh_consumer&) = delete;
+    tlsh_consumer& operator=(const tlsh_consumer&) = delete;
+
+    void update(std::uint64_t, const std::uint8_t* data, size_t size) override {
+        if (tlsh)
+            tlsh_update(tlsh, data, static_cast<unsigned int>(size));
+    }
+
+    void finish() override {
+        if (!tlsh || tlsh_final(tlsh, nullptr, 0, 0) != 0)
+            return;
+        const char* hash = tlsh_get_hash(tlsh, true);
+        result = hash ? hash : "";
+    }
+
+    const std::string& digest() const {
+        return result;
+    }
+};
+
+// sha1 authenticode image digest, the same value CryptCATAdminCalcHashFromFileHandle
+// produces: the checksum, the security directory entry and the certificate table
+// are left out of the hash. anything that is not a pe image is hashed flat.
+class authenticode_consumer : public hash_consumer {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> excluded;
+
+public:
+    authenticode_consumer() : hash_consumer(YR_DIGEST_SHA1) {}
+
+    void begin(const std::uint8_t* head, size_t head_size, std::uint64_t total_size) override {
+        excluded.clear();
+
+        const auto read_u16 = [&](size_t offset) { std::uint16_t v; std::memcpy(&v, head + offset, sizeof(v)); return v; };
+        const auto read_u32 = [&](size_t offset) { std::uint32_t v; std::memcpy(&v, head + offset, sizeof(v)); return v; };
+
+        if (head_size < 0x40 || head[0] != 'M' || head[1] != 'Z')
+            return;
+
+        const size_t nt_headers = read_u32(0x3C);
+        const size_t optional_header = nt_headers + 24;
+        if (optional_header + 2 > head_size || read_u32(nt_headers) != 0x00004550)
+            return;
+
+        const auto magic = read_u16(optional_header);
+        size_t rva_count_offset = 0;
+        if (magic == 0x10b)
+            rva_count_offset = optional_header + 92;
+        else if (magic == 0x20b)
+            rva_count_offset = optional_header + 108;
+        else
+            return;
+
+        const size_t security_entry = rva_count_offset + 4 + 4 * 8;
+        if (security_entry + 8 > head_size || read_u32(rva_count_offset) <= 4)
+            return;
+
+        excluded.emplace_back(optional_header + 64, optional_header + 68);
+        excluded.emplace_back(security_entry, security_entry + 8);
+
+        const std::uint64_t cert_offset = read_u32(security_entry);
+        const std::uint64_t cert_size = read_u32(security_entry + 4);
+        if (cert_offset != 0 && cert_size != 0 && cert_offset >= security_entry + 8 && cert_offset + cert_size <= total_size)
+            excluded.emplace_back(cert_offset, cert_offset + cert_size);
+    }
+
+    void update(std::uint64_t offset, const std::uint8_t* data, size_t size) override {
+        std::uint64_t position = offset;
+        const std::uint64_t end = offset + size;
+
+        for (const auto& [from, to] : excluded) {
+            if (to <= position || from >= end)
+                continue;
+            if (from > position)
+                hash_consumer::update(position, data + (position - offset), static_cast<size_t>(from - position));
+            position = (std::min)(to, end);
+        }
+
+        if (position < end)
+            hash_consumer::update(position, data + (position - offset), static_cast<size_t>(end - position));
+    }
+};
+
+// read-only view over a whole target binary, shared by every consumer and by yara
+class mapped_file {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const std::uint8_t* view = nullptr;
+    std::uint64_t length = 0;
+
+public:
+    explicit mapped_file(const std::wstring& path) {
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+            return;
+
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+            return;
+
+        view = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (view)
+            length = static_cast<std::uint64_t>(size.QuadPart);
+    }
+
+    ~mapped_file() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    bool valid() const { return view != nullptr; }
+    const std::uint8_t* data() const { return view; }
+    std::uint64_t size() const { return length; }
+};
+
+// the files of a batch advance together a chunk at a time: each chunk goes
+// through the file's own consumers, and when `sha256` is given the chunks of the
+// whole row are hashed by one yr_digest_update_multi call, which runs eight
+// files per avx2 register on cpus without the sha extensions. every file is
+// still read once. returns the bytes pulled from each file, `sha256` gets an
+// empty string for files that could not be mapped
+inline std::vector<std::uint64_t> run_batch_pipeline(const std::vector<const mapped_file*>& files,
+    const std::vector<std::vector<file_consumer*>>& consumers, std::vector<std::string>* sha256) {
+    std::vector<std::uint64_t> offsets(files.size(), 0);
+    std::vector<YR_DIGEST_CTX> contexts(sha256 ? files.size() : 0);
+
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files[i]->valid())
+            continue;
+        const size_t head_size = static_cast<size_t>((std::min<std::uint64_t>)(files[i]->size(), file_pipeline_chunk_size));
+        for (auto* consumer : consumers[i])
+            consumer->begin(files[i]->data(), head_size, files[i]->size());
+        if (sha256)
+            yr_digest_init(&contexts[i], YR_DIGEST_SHA256);
+    }
+
+    std::vector<YR_DIGEST_CTX*> row_contexts;
+    std::vector<const std::uint8_t*> row_data;
+    std::vector<size_t> row_sizes;
+    for (bool more = true; more;) {
+        more = false;
+        row_contexts.clear();
+        row_data.clear();
+        row_sizes.clear();
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (!files[i]->valid() || offsets[i] >= files[i]->size())
+                continue;
+
+            const size_t size = static_cast<size_t>((std::min<std::uint64_t>)(files[i]->size() - offsets[i], file_pipeline_chunk_size));
+            const std::uint8_t* chunk = files[i]->data() + offsets[i];
+            for (auto* consumer : consumers[i])
+                consumer->update(offsets[i], chunk, size);
+            if (sha256) {
+                row_contexts.push_back(&contexts[i]);
+                row_data.push_back(chunk);
+                row_sizes.push_back(size);
+            }
+            offsets[i] += size;
+            more = true;
+        }
+
+        if (!row_contexts.empty())
+            yr_digest_update_multi(row_contexts.data(), row_data.data(), row_sizes.data(), row_contexts.size());
+    }
+
+    if (sha256)
+        sha256->assign(files.size(), std::string());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files[i]->valid())
+            continue;
+        for (auto* consumer : consumers[i])
+            consumer->finish();
+        if (sha256) {
+            YR_DIGEST digest;
+            yr_digest_final(&contexts[i], &digest);
+            (*sha256)[i] = thumbprint_to_hex(digest.sha256, sizeof(digest.sha256));
+        }
+    }
+
+    return offsets;
+}
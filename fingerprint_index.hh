@@ -0,0 +1,304 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+// imphash and rich header hash of every scanned binary, kept across hosts:
+// fingerprint -> (host, prefetch entry, path). the file is a sorted array of
+// fixed size records followed by a string pool, so its bytes can be searched
+// in place without parsing anything:
+//   header    magic, record count, pool size
+//   records   sorted by kind then digest, 32 bytes each
+//   pool      nul terminated strings, each stored once
+enum class fingerprint_kind : std::uint8_t {
+    imphash = 1,
+    rich = 2,
+};
+
+#pragma pack(push, 1)
+struct fingerprint_index_header {
+    char magic[8];
+    std::uint32_t record_count;
+    std::uint32_t pool_size;
+};
+
+struct fingerprint_record {
+    std::uint8_t kind;
+    std::uint8_t reserved[3];
+    std::uint32_t host;
+    std::uint32_t entry;
+    std::uint32_t path;
+    std::array<std::uint8_t, 16> digest;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(fingerprint_record) == 32, "records are read in place");
+
+constexpr char fingerprint_index_magic[8] = { 'P', 'F', 'F', 'P', 'I', 'D', 'X', '1' };
+
+inline bool fingerprint_less(const fingerprint_record& a, const fingerprint_record& b) {
+    if (a.kind != b.kind)
+        return a.kind < b.kind;
+    return a.digest < b.digest;
+}
+
+// 32 hex characters, as pe.imphash() and the rich hash are reported
+inline bool parse_fingerprint(const std::string& hex, std::array<std::uint8_t, 16>& out) {
+    if (hex.size() != 32)
+        return false;
+    for (size_t i = 0; i < out.size(); i++) {
+        int value = 0;
+        for (int n = 0; n < 2; n++) {
+            const char c = hex[i * 2 + n];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        out[i] = static_cast<std::uint8_t>(value);
+    }
+    return true;
+}
+
+struct fingerprint_hit {
+    std::string_view host;
+    std::string_view entry;
+    std::string_view path;
+};
+
+// read-only view over a serialized index, the bytes are not copied and must
+// outlive the view
+class fingerprint_index_view {
+    const fingerprint_record* records = nullptr;
+    size_t count = 0;
+    const char* pool = nullptr;
+    size_t pool_size = 0;
+
+    std::string_view string_at(std::uint32_t offset) const {
+        return offset < pool_size ? std::string_view(pool + offset) : std::string_view();
+    }
+
+public:
+    bool open(const std::uint8_t* data, size_t size) {
+        *this = {};
+        fingerprint_index_header header;
+        if (size < sizeof(header))
+            return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, fingerprint_index_magic, sizeof(header.magic)) != 0)
+            return false;
+
+        const size_t records_size = static_cast<size_t>(header.record_count) * sizeof(fingerprint_record);
+        if (size - sizeof(header) < records_size || size - sizeof(header) - records_size < header.pool_size)
+            return false;
+        // the pool ends with a terminator so a corrupt offset cannot run off it
+        if (header.pool_size != 0 && data[sizeof(header) + records_size + header.pool_size - 1] != 0)
+            return false;
+
+        records = reinterpret_cast<const fingerprint_record*>(data + sizeof(header));
+        count = header.record_count;
+        pool = reinterpret_cast<const char*>(data + sizeof(header) + records_size);
+        pool_size = header.pool_size;
+        return true;
+    }
+
+    std::vector<fingerprint_hit> lookup(fingerprint_kind kind, const std::array<std::uint8_t, 16>& digest) const {
+        fingerprint_record key{};
+        key.kind = static_cast<std::uint8_t>(kind);
+        key.digest = digest;
+
+        std::vector<fingerprint_hit> hits;
+        const auto range = std::equal_range(records, records + count, key, fingerprint_less);
+        for (auto it = range.first; it != range.second; ++it)
+            hits.push_back({ string_at(it->host), string_at(it->entry), string_at(it->path) });
+        return hits;
+    }
+
+    template <typename Visit>
+    void for_each(Visit visit) const {
+        for (size_t i = 0; i < count; i++)
+            visit(static_cast<fingerprint_kind>(records[i].kind), records[i].digest,
+                fingerprint_hit{ string_at(records[i].host), string_at(records[i].entry), string_at(records[i].path) });
+    }
+
+    size_t size() const {
+        return count;
+    }
+};
+
+// collects records, sorts them and lays out the file. strings are pooled so a
+// host name is stored once however many binaries it contributed
+class fingerprint_index_builder {
+    std::vector<fingerprint_record> records;
+    std::string pool;
+    std::unordered_map<std::string, std::uint32_t> offsets;
+
+    std::uint32_t intern(std::string_view text) {
+        const auto found = offsets.find(std::string(text));
+        if (found != offsets.end())
+            return found->second;
+        const auto offset = static_cast<std::uint32_t>(pool.size());
+        pool.append(text);
+        pool.push_back('\0');
+        offsets.emplace(std::string(text), offset);
+        return offset;
+    }
+
+public:
+    void add(fingerprint_kind kind, const std::array<std::uint8_t, 16>& digest, std::string_view host, std::string_view entry, std::string_view path) {
+        fingerprint_record record{};
+        record.kind = static_cast<std::uint8_t>(kind);
+        record.host = intern(host);
+        record.entry = intern(entry);
+        record.path = intern(path);
+        record.digest = digest;
+        records.push_back(record);
+    }
+
+    // every record of another index except those of `skip_host`, which is how a
+    // host replaces its own previous contribution in a shared file
+    void merge(const fingerprint_index_view& other, std::string_view skip_host = {}) {
+        other.for_each([&](fingerprint_kind kind, const std::array<std::uint8_t, 16>& digest, const fingerprint_hit& hit) {
+            if (skip_host.empty() || hit.host != skip_host)
+                add(kind, digest, hit.host, hit.entry, hit.path);
+        });
+    }
+
+    std::vector<std::uint8_t> serialize() {
+        std::stable_sort(records.begin(), records.end(), fingerprint_less);
+
+        fingerprint_index_header header{};
+        std::memcpy(header.magic, fingerprint_index_magic, sizeof(header.magic));
+        header.record_count = static_cast<std::uint32_t>(records.size());
+        header.pool_size = static_cast<std::uint32_t>(pool.size());
+
+        std::vector<std::uint8_t> out(sizeof(header) + records.size() * sizeof(fingerprint_record) + pool.size());
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!records.empty())
+            std::memcpy(out.data() + sizeof(header), records.data(), records.size() * sizeof(fingerprint_record));
+        if (!pool.empty())
+            std::memcpy(out.data() + sizeof(header) + records.size() * sizeof(fingerprint_record), pool.data(), pool.size());
+        return out;
+    }
+
+    size_t size() const {
+        return records.size();
+    }
+};
+
+// writes next to the index and renames over it. on windows the rename fails
+// while another process has the old file open, which a reader does only for a
+// moment, so it is retried for a while before the error is handed back
+inline bool write_fingerprint_index(const std::filesystem::path& path, const std::vector<std::uint8_t>& bytes, std::error_code& ec) {
+    auto temporary = path;
+    temporary += ".tmp";
+
+    bool written;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        written = static_cast<bool>(file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+    }
+
+    std::error_code ignored;
+    if (!written) {
+        std::filesystem::remove(temporary, ignored);
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    for (int attempt = 0; attempt < 20; attempt++) {
+        ec.clear();
+        std::filesystem::rename(temporary, path, ec);
+        if (!ec)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::filesystem::remove(temporary, ignored);
+    return false;
+}
+
+// exclusive lock on <index>.lock, held across read, merge and write so hosts
+// that finish together take turns instead of dropping each other's records.
+// gives up after `timeout` rather than hanging the sweep on a stuck host
+class fingerprint_index_lock {
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+    bool held = false;
+
+public:
+    explicit fingerprint_index_lock(const std::filesystem::path& index, std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+        auto path = index;
+        path += ".lock";
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+#if defined(_WIN32)
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        do {
+            OVERLAPPED overlapped{};
+            held = LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != FALSE;
+            if (!held)
+                Sleep(50);
+        } while (!held && std::chrono::steady_clock::now() < deadline);
+#else
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return;
+
+        do {
+            held = flock(fd, LOCK_EX | LOCK_NB) == 0;
+            if (!held)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        } while (!held && std::chrono::steady_clock::now() < deadline);
+#endif
+    }
+
+    ~fingerprint_index_lock() {
+#if defined(_WIN32)
+        if (held) {
+            OVERLAPPED overlapped{};
+            UnlockFileEx(file, 0, 1, 0, &overlapped);
+        }
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (held)
+            flock(fd, LOCK_UN);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    fingerprint_index_lock(const fingerprint_index_lock&) = delete;
+    fingerprint_index_lock& operator=(const fingerprint_index_lock&) = delete;
+
+    bool locked() const {
+        return held;
+    }
+};
@@ -4,6 +4,41 @@
 class c_globals {
 public:
 	bool active = true;
+	// map each target binary once and share it between hashing, the catalog
+	// digest and yara. off runs the old per-api reads for comparison
+	bool single_read_pipeline = true;
+	// hash a batch of binaries with sha256 side by side before the pipeline
+	// runs, so files share simd lanes on cpus without the sha extensions
+	bool batch_sha256 = true;
+	// tlsh digest of every binary in the pipeline pass, unsigned ones are
+	// looked up in tlsh_families.txt
+	bool similarity_index = true;
+	// keep the imphash and rich header hash of every scanned binary in
+	// fingerprints.idx, shared by every host that runs from the same folder
+	bool pe_fingerprints = true;
+	// scan through long-lived per-thread scanners and rank rules and strings
+	// by cost; needs a libyara built with YR_PROFILING_ENABLED
+	bool rule_profiling = false;
+	// compile the generic rules into tiers and run a later tier only on the
+	// files the tier before it passed on, see rule_tiers.hh
+	bool tiered_scanning = true;
+	// untagged rules whose mean cost per scan in the last rule_profile.txt is
+	// above this many microseconds go to tier 2, where they only see files the
+	// gate passes on. 0 (the default) keeps every untagged rule in tier 1
+	double tier_cost_threshold_us = 0.0;
+	// time a later tier may spend in one sweep before it stops taking files,
+	// 0 is no limit
+	double tier_budget_ms = 0.0;
+	// rewrite regex strings that are plain text into text strings before compiling
+	bool optimize_rules = true;
+	// compile the generic set both ways and write rule_lint.txt
+	bool lint_rules = false;
+	// lay the aho-corasick automaton out breadth first with dense rows for the
+	// shallow states and bitmap rows for the rest
+	bool compact_ac_layout = true;
+	// split binaries of 32 MB and more into overlapping ranges scanned on all
+	// cores, so one huge file does not keep a sweep waiting on a single thread
+	bool split_large_files = true;
 };
 
 inline c_globals globals;
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <string>
 #include <array>
 #include "prefetch_parser.hh"
+#include "prefetch_reader.hh"
 #include <chrono>
 #include <Windows.h>
 #include <iomanip>
@@ -24,6 +25,7 @@
 #include <filesystem>
 #include <system_error>
 #include <thread>
+#include <mutex>
 #include <ntsecapi.h>
 #include <ntstatus.h>
 
@@ -33,6 +35,13 @@
 #pragma comment(lib, "wintrust.lib")
 #pragma comment(lib, "crypt32.lib")
 
+// imphash and rich header hash of a scanned pe, lower-case hex md5s, empty when
+// the binary has no imports or no rich header
+struct PeFingerprints {
+    std::string imphash;
+    std::string rich_hash;
+};
+
 struct PrefetchFileInfo {
     std::string filename;
     long long executed_time;
@@ -45,6 +54,16 @@ struct PrefetchFileInfo {
     std::wstring proper_path;
     bool signature_checked = false;
     bool isInInstance;
+    std::string md5;
+    std::string sha1;
+    std::string sha256;
+    unsigned long long bytes_read = 0;
+    double process_ms = 0.0;
+    std::string tlsh;
+    // closest known family within tlsh_similarity_threshold, empty when none
+    std::string similar_to;
+    int similar_distance = -1;
+    PeFingerprints fingerprints;
 };
 
 struct LogonSessionInfo {
@@ -56,9 +75,12 @@ struct LogonSessionInfo {
 std::string ConvertExecutedTime(long long executed_time);
 std::wstring GetDriveLetterFromVolumePath(const std::wstring& volumePath);
 bool IsFileSignatureValid(const std::wstring& filePath);
+bool IsFileSignatureValid(const std::wstring& filePath, const std::vector<BYTE>& catalogHash);
+void InitializeSignerBlocklist();
+void InitializeTlshLibrary();
 std::wstring StringToWString(const std::string& str);
 std::string WStringToString(const std::wstring& wstr);
-std::vector<PrefetchFileInfo> GetPrefetchFileInfos();
+std::vector<PrefetchFileInfo> GetPrefetchFileInfos(prefetch_read_stats& stats);
 std::string GetFileTimeString(const FILETIME& fileTime);
 std::string getOwnPath();
 std::wstring ToUpperCase(const std::wstring& str);
@@ -66,6 +88,8 @@ std::wstring ToUpperCase(const std::wstring& str);
 struct GenericRule {
     std::string name;
     std::string rule;
+    // set by loadGenericRules, see rule_tiers.hh
+    int tier = 1;
 };
 
 extern std::vector<GenericRule> genericRules;
@@ -74,4 +98,93 @@ void addGenericRule(const std::string& name, const std::string& rule);
 
 void initializeGenericRules();
 
+struct RuleLoadStats {
+    bool from_bundle = false;
+    double load_ms = 0.0;
+    // untagged rule sources the rule profile moved out of tier 1
+    std::vector<std::string> moved_by_cost;
+};
+
+extern RuleLoadStats ruleLoadStats;
+
+bool loadGenericRules();
+void unloadGenericRules();
+std::string getRuleBundlePath();
+bool saveRuleBundle(const std::string& path);
+
+struct RuleProfileEntry {
+    std::string name;
+    uint64_t cost_ns = 0;
+    uint32_t atom_matches = 0;
+    // scans of the tier the rule runs in, which is fewer than the sweep's for
+    // a later tier
+    size_t scans = 0;
+};
+
+// files a tier scanned and how many of them it passed on to the next tier
+struct RuleTierStats {
+    int tier = 1;
+    size_t files = 0;
+    size_t advanced = 0;
+    // files the tier before passed on that were not scanned, the tier had
+    // spent its time budget
+    size_t over_budget = 0;
+    double scan_ms = 0.0;
+};
+
+struct RuleProfileReport {
+    std::vector<RuleProfileEntry> rules;
+    std::vector<RuleProfileEntry> strings;
+    std::vector<RuleTierStats> tiers;
+    size_t scans = 0;
+    uint64_t total_cost_ns = 0;
+};
+
+struct RuleLintString {
+    std::string name;
+    int quality_before = 0;
+    int quality_after = 0;
+    int atoms_before = 0;
+    int atoms_after = 0;
+    std::vector<std::string> rewritten;
+};
+
+// one optimizer equivalence case, the rule must match the same buffer the
+// same way as written and as rewritten
+struct RuleLintCheck {
+    std::string name;
+    bool passed = false;
+};
+
+struct RuleLintReport {
+    std::vector<RuleLintString> strings;
+    std::vector<RuleLintCheck> checks;
+    // regexp dfa against the fiber engine, see checkRegexDfa
+    std::vector<RuleLintCheck> dfa_checks;
+    size_t rewritten = 0;
+    size_t sample_bytes = 0;
+    double mb_per_s_before = 0.0;
+    double mb_per_s_after = 0.0;
+};
+
+RuleLintReport lintGenericRules();
+std::string getRuleLintPath();
+bool writeRuleLintReport(const RuleLintReport& report, const std::string& path);
+
+void resetRuleProfile();
+RuleProfileReport buildRuleProfileReport();
+std::string getRuleProfilePath();
+bool writeRuleProfileReport(const RuleProfileReport& report, const std::string& path);
+
+std::vector<RuleTierStats> getRuleTierStats();
+void resetRuleTierStats();
+
+// what yara_callback fills in
+struct ScanOutput {
+    std::vector<std::string>* matched_rules;
+    // a rule tagged candidate matched, the file goes on to the next tier
+    bool candidate = false;
+};
+
 bool scan_with_yara(const std::string& path, std::vector<std::string>& matched_rules);
+bool scan_memory_with_yara(const uint8_t* data, size_t size, std::vector<std::string>& matched_rules);
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef _WIN32
+#include <cwctype>
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+// times are FILETIME ticks (100ns since 1601) on every platform so the ui can
+// keep using GetFileTimeString
+struct file_metadata {
+    std::uint64_t size = 0;
+    std::uint64_t creation_time = 0;
+    std::uint64_t access_time = 0;
+    std::uint64_t write_time = 0;
+    bool is_directory = false;
+};
+
+// answers existence/size/time queries for many paths. on windows each parent
+// directory with several asked-for names is enumerated once instead of stat-ing
+// every path on its own, the enumeration carries sizes and times, and a
+// directory asked for a single name gets one GetFileAttributesExW instead.
+// elsewhere the enumeration would carry names only and every asked-for name
+// needed a statx on top, so the probe just stats the names relative to the
+// parent opened once
+class metadata_probe {
+public:
+    using path_string = std::filesystem::path::string_type;
+    using char_type = path_string::value_type;
+
+private:
+    struct directory_entries {
+        bool exists = false;
+        // every name of the directory is in `entries`, a name not there is absent
+        bool complete = false;
+        std::unordered_map<path_string, file_metadata> entries;
+        std::unordered_set<path_string> missing;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<path_string, directory_entries> directories;
+    size_t enumerated = 0;
+    size_t lookups = 0;
+    size_t stat_calls = 0;
+    double elapsed_ms = 0.0;
+
+    static bool is_separator(char_type c) {
+        return c == '\\' || c == '/';
+    }
+
+    static path_string fold(path_string text) {
+#ifdef _WIN32
+        for (auto& c : text)
+            c = static_cast<char_type>(std::towupper(c));
+#endif
+        return text;
+    }
+
+    static void split(const path_string& path, path_string& directory, path_string& name) {
+        size_t end = path.size();
+        while (end > 1 && is_separator(path[end - 1]))
+            end--;
+
+        size_t slash = end;
+        while (slash > 0 && !is_separator(path[slash - 1]))
+            slash--;
+
+        name = path.substr(slash, end - slash);
+        directory = slash > 1 ? path.substr(0, slash - 1) : path.substr(0, slash);
+    }
+
+#ifdef _WIN32
+    static std::uint64_t ticks(const FILETIME& time) {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    // WIN32_FIND_DATAW and WIN32_FILE_ATTRIBUTE_DATA share these fields
+    template <typename attributes>
+    static file_metadata from_attributes(const attributes& data) {
+        file_metadata metadata;
+        metadata.size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        metadata.creation_time = ticks(data.ftCreationTime);
+        metadata.access_time = ticks(data.ftLastAccessTime);
+        metadata.write_time = ticks(data.ftLastWriteTime);
+        metadata.is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        return metadata;
+    }
+
+    void enumerate(const path_string& directory, directory_entries& out, const std::unordered_set<path_string>& wanted) {
+        // listing a whole directory (system32, winsxs) for a single name costs far
+        // more than asking for that name, later names are stat-ed one at a time too
+        if (wanted.size() == 1) {
+            const path_string key = fold(*wanted.begin());
+            file_metadata metadata;
+            out.exists = true;
+            if (load_stat(directory, *wanted.begin(), metadata))
+                out.entries.emplace(key, metadata);
+            else
+                out.missing.insert(key);
+            return;
+        }
+
+        WIN32_FIND_DATAW data;
+        const path_string pattern = directory + L"\\*";
+        HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+        if (find == INVALID_HANDLE_VALUE)
+            return;
+
+        out.exists = true;
+        out.complete = true;
+        do {
+            out.entries.emplace(fold(data.cFileName), from_attributes(data));
+        } while (FindNextFileW(find, &data));
+
+        FindClose(find);
+    }
+
+    bool load_stat(const path_string& directory, const path_string& name, file_metadata& metadata) {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        const path_string path = directory + L"\\" + name;
+        stat_calls++;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+            return false;
+
+        metadata = from_attributes(data);
+        return true;
+    }
+#else
+    static std::uint64_t ticks(const struct statx_timestamp& time) {
+        return static_cast<std::uint64_t>(time.tv_sec + 11644473600LL) * 10000000ULL + time.tv_nsec / 100;
+    }
+
+    bool fill(int directory_fd, const char* name, file_metadata& metadata) {
+        struct statx info;
+        stat_calls++;
+        if (statx(directory_fd, name, 0, STATX_TYPE | STATX_SIZE | STATX_ATIME | STATX_MTIME | STATX_BTIME, &info) != 0)
+            return false;
+
+        metadata.size = info.stx_size;
+        metadata.access_time = ticks(info.stx_atime);
+        metadata.write_time = ticks(info.stx_mtime);
+        metadata.creation_time = (info.stx_mask & STATX_BTIME) ? ticks(info.stx_btime) : metadata.write_time;
+        metadata.is_directory = S_ISDIR(info.stx_mode);
+        return true;
+    }
+
+    void enumerate(const path_string& directory, directory_entries& out, const std::unordered_set<path_string>& wanted) {
+        const int fd = open(directory.empty() ? "/" : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        out.exists = true;
+        for (const auto& name : wanted) {
+            file_metadata metadata;
+            if (fill(fd, name.c_str(), metadata))
+                out.entries.emplace(name, metadata);
+            else
+                out.missing.insert(name);
+        }
+
+        close(fd);
+    }
+
+    bool load_stat(const path_string& directory, const path_string& name, file_metadata& metadata) {
+        const int fd = open(directory.empty() ? "/" : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        const bool found = fill(fd, name.c_str(), metadata);
+        close(fd);
+        return found;
+    }
+#endif
+
+    directory_entries& directory_locked(const path_string& directory, const std::unordered_set<path_string>& wanted) {
+        const path_string key = fold(directory);
+        auto it = directories.find(key);
+        if (it != directories.end())
+            return it->second;
+
+        const auto started = std::chrono::steady_clock::now();
+        auto& entries = directories[key];
+        enumerate(directory, entries, wanted);
+        enumerated++;
+        elapsed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return entries;
+    }
+
+public:
+    // groups the candidates by parent directory and enumerates every directory once
+    void prefetch(const std::vector<path_string>& paths) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::unordered_map<path_string, std::pair<path_string, std::unordered_set<path_string>>> groups;
+        for (const auto& path : paths) {
+            path_string directory, name;
+            split(path, directory, name);
+            auto& group = groups[fold(directory)];
+            group.first = directory;
+            group.second.insert(name);
+        }
+
+        for (const auto& [key, group] : groups)
+            directory_locked(group.first, group.second);
+    }
+
+    std::optional<file_metadata> lookup(const path_string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        path_string directory, name;
+        split(path, directory, name);
+
+        lookups++;
+        auto& entries = directory_locked(directory, { name });
+        const path_string key = fold(name);
+
+        auto it = entries.entries.find(key);
+        if (it != entries.entries.end())
+            return it->second;
+        if (!entries.exists || entries.complete || entries.missing.count(key))
+            return std::nullopt;
+
+        // a name the directory was not first probed for
+        const auto started = std::chrono::steady_clock::now();
+        file_metadata metadata;
+        const bool found = load_stat(directory, name, metadata);
+        elapsed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (!found) {
+            entries.missing.insert(key);
+            return std::nullopt;
+        }
+        return entries.entries.emplace(key, metadata).first->second;
+    }
+
+    bool exists(const path_string& path) {
+        return lookup(path).has_value();
+    }
+
+    // drops what was cached for one directory, the next lookup in it enumerates
+    // it again. for a directory the caller has just re-scanned itself
+    void invalidate(const path_string& directory) {
+        std::lock_guard<std::mutex> lock(mutex);
+        directories.erase(fold(directory));
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        directories.clear();
+        enumerated = 0;
+        lookups = 0;
+        stat_calls = 0;
+        elapsed_ms = 0.0;
+    }
+
+    size_t directories_enumerated() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return enumerated;
+    }
+
+    // paths answered, each of which would otherwise have been a stat of its own
+    size_t paths_looked_up() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lookups;
+    }
+
+    // stats actually made: on windows only names in directories that were not
+    // enumerated, elsewhere one statx per asked-for name
+    size_t stats_made() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stat_calls;
+    }
+
+    double probe_ms() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return elapsed_ms;
+    }
+};
+
+inline metadata_probe file_probe;
@@ -5,7 +5,13 @@
 #include <fstream>
 #include <span>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 inline bool read_file(const std::string& name, std::vector<char>& out) {
     std::ifstream file(name.data(), std::ios::binary);
@@ -32,13 +38,12 @@ inline bool read_file(const std::string& name, std::vector<char>& out) {
 class prefetch_parser {
     std::vector<char> data;
 
-public:
-    explicit prefetch_parser(const std::string& file_path) {
-        std::vector<char> content;
-        if (!read_file(file_path, content) || content.size() < 0x100)
+    void load(std::vector<char> content) {
+        if (content.size() < 0x100)
             return;
 
         if (content.at(0) == 'M' && content.at(1) == 'A' && content.at(2) == 'M') {
+#ifdef _WIN32
             using RtlDecompressBufferEx = NTSTATUS(__stdcall*)(
                 USHORT CompressionFormat,
                 PUCHAR UncompressedBuffer,
@@ -101,9 +106,27 @@ public:
             free(workspace);
 
             data = decompressed_data;
+#endif
         }
         else if (content.at(4) == 'S' && content.at(5) == 'C' && content.at(6) == 'C' && content.at(7) == 'A')
-            data = content;
+            data = std::move(content);
+    }
+
+    // filetime ticks to unix seconds, written out so the parser also builds off windows
+    static time_t filetime_to_timet(std::uint64_t ticks) {
+        return static_cast<time_t>(ticks / 10000000ULL - 11644473600ULL);
+    }
+
+public:
+    explicit prefetch_parser(const std::string& file_path) {
+        std::vector<char> content;
+        if (read_file(file_path, content))
+            load(std::move(content));
+    }
+
+    // used by the bulk reader, which already has the file contents in memory
+    explicit prefetch_parser(std::span<const char> content) {
+        load(std::vector<char>(content.begin(), content.end()));
     }
 
     SETUP_VARIABLE(int, version(), data.data(), 0x0)
@@ -115,7 +138,7 @@ public:
         SETUP_VARIABLE(int, volumes_count(), data.data(), 0x70)
         SETUP_VARIABLE(int, volumes_information_size(), data.data(), 0x74)
         SETUP_VARIABLE(int, run_count(), data.data(), 0xd0)
-        SETUP_VARIABLE(uintptr_t, executed_timestamp(), data.data(), 0x80)
+        SETUP_VARIABLE(std::uint64_t, executed_timestamp(), data.data(), 0x80)
 
         bool success() const {
         return !data.empty();
@@ -146,12 +169,6 @@ public:
 
     std::array<time_t, 8> last_eight_execution_times() const {
         std::array<time_t, 8> times{};
-        const auto filetime_to_timet = [](const FILETIME& ft) {
-            ULARGE_INTEGER ull{};
-            ull.LowPart = ft.dwLowDateTime;
-            ull.HighPart = ft.dwHighDateTime;
-            return static_cast<time_t>(ull.QuadPart / 10000000ULL - 11644473600ULL);
-            };
         constexpr size_t execution_times_offset = 0x80;
 
         if (data.size() <= execution_times_offset) {
@@ -159,22 +176,17 @@ public:
         }
 
         size_t available_data = data.size() - execution_times_offset;
-        size_t num_times = (std::min)(static_cast<size_t>(8), available_data / sizeof(ULARGE_INTEGER));
+        size_t num_times = (std::min)(static_cast<size_t>(8), available_data / sizeof(std::uint64_t));
 
         for (size_t i = 0; i < num_times; ++i) {
-            const size_t current_offset = execution_times_offset + (i * sizeof(ULARGE_INTEGER));
-
-            if (current_offset + sizeof(ULARGE_INTEGER) <= data.size()) {
-                ULARGE_INTEGER file_time{};
-                std::memcpy(&file_time.QuadPart, data.data() + current_offset, sizeof(ULARGE_INTEGER));
-
-                if (file_time.QuadPart != 0) {
-                    const auto file_time_ptr = reinterpret_cast<const FILETIME*>(&file_time);
-                    try {
-                        times[i] = filetime_to_timet(*file_time_ptr);
-                    }
-                    catch (...) {
-                    }
+            const size_t current_offset = execution_times_offset + (i * sizeof(std::uint64_t));
+
+            if (current_offset + sizeof(std::uint64_t) <= data.size()) {
+                std::uint64_t file_time = 0;
+                std::memcpy(&file_time, data.data() + current_offset, sizeof(std::uint64_t));
+
+                if (file_time != 0) {
+                    times[i] = filetime_to_timet(file_time);
                 }
             }
             else {
@@ -187,18 +199,6 @@ public:
 
 
     time_t executed_time() const {
-        const auto filetime_to_timet = [](const FILETIME& ft) {
-            ULARGE_INTEGER ull{};
-            ull.LowPart = ft.dwLowDateTime;
-            ull.HighPart = ft.dwHighDateTime;
-
-            return ull.QuadPart / 10000000ULL - 11644473600ULL;
-            };
-
-        ULARGE_INTEGER file_time{};
-        file_time.QuadPart = executed_timestamp();
-
-        const auto file_time_ptr = reinterpret_cast<const FILETIME*>(&file_time);
-        return filetime_to_timet(*file_time_ptr);
+        return filetime_to_timet(executed_timestamp());
     }
 };
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include "prefetch_parser.hh"
+#if defined(__linux__)
+#include <fcntl.h>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+struct prefetch_read_stats {
+    size_t files = 0;
+    size_t failed = 0;
+    std::uint64_t bytes = 0;
+    // only counted on linux, the windows path goes through ifstream
+    std::uint64_t syscalls = 0;
+    double elapsed_ms = 0.0;
+    bool used_io_uring = false;
+
+    double syscalls_per_file() const {
+        return files ? static_cast<double>(syscalls) / files : 0.0;
+    }
+
+    double files_per_second() const {
+        return elapsed_ms > 0.0 ? files * 1000.0 / elapsed_ms : 0.0;
+    }
+};
+
+// called once per successfully read file with the index into the path list.
+// the span is only valid during the call, the parser copies what it keeps
+using prefetch_read_callback = std::function<void(size_t index, std::span<const char> content)>;
+
+#if defined(__linux__)
+// bare io_uring wrapper over the raw syscalls, just the parts the bulk reader needs
+class io_uring_queue {
+    int ring_fd = -1;
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned sq_entries = 0;
+    unsigned queued = 0;
+
+public:
+    std::uint64_t syscalls = 0;
+
+    ~io_uring_queue() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        syscalls++;
+        if (ring_fd < 0)
+            return false;
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sq_ring_size = cq_ring_size = (std::max)(sq_ring_size, cq_ring_size);
+
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED)
+            return false;
+
+        cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring
+            : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED)
+            return false;
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (sqes_map == MAP_FAILED)
+            return false;
+        sqes = static_cast<io_uring_sqe*>(sqes_map);
+
+        auto* sq = static_cast<char*>(sq_ring);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        sq_entries = params.sq_entries;
+        return true;
+    }
+
+    bool register_buffers(const std::vector<iovec>& buffers) {
+        syscalls++;
+        return syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+    }
+
+    // io_uring itself is 5.1 but openat, statx, read and close came in 5.6, and
+    // a seccomp or lsm policy can filter single opcodes. the probe is 5.6 too,
+    // so a kernel without it cannot have the opcodes either
+    bool supports(std::initializer_list<unsigned> opcodes) {
+        constexpr unsigned probe_ops = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        syscalls++;
+        if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+            return false;
+
+        for (const unsigned opcode : opcodes) {
+            if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    // makes room for `count` sqes, submitting what is queued when the sq is full
+    bool reserve(unsigned count) {
+        if (*sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) + count <= sq_entries)
+            return true;
+        submit(0);
+        return *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) + count <= sq_entries;
+    }
+
+    // only valid after a successful reserve
+    io_uring_sqe* next_sqe() {
+        const unsigned tail = *sq_tail;
+        const unsigned index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        queued++;
+        return sqe;
+    }
+
+    int submit(unsigned wait) {
+        const unsigned to_submit = queued;
+        queued = 0;
+        syscalls++;
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    }
+
+    template <typename Handler>
+    void drain(Handler&& handler) {
+        unsigned head = *cq_head;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe cqe = cqes[head & *cq_mask];
+            head++;
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            handler(cqe);
+        }
+    }
+};
+
+// every in-flight file owns one registered buffer. a file goes through
+// openat + statx (queued together), then read_fixed, then close; the read
+// completion hands the buffer to the callback and the slot takes the next path.
+// paths the ring cannot serve are handed back to the caller for plain reads
+class io_uring_prefetch_reader {
+    static constexpr size_t slot_count = 64;
+    static constexpr size_t buffer_size = 256 * 1024;
+    // between two submits a slot queues at most close + openat + statx, so the
+    // sq cannot fill up; reserve() still checks in case the kernel lags behind
+    static constexpr unsigned ring_entries = slot_count * 4;
+
+    enum op : std::uint64_t { op_open, op_statx, op_read, op_close };
+
+    struct slot {
+        size_t index = 0;
+        int fd = -1;
+        int pending = 0;
+        bool failed = false;
+        bool retry = false;
+        struct statx info {};
+    };
+
+    io_uring_queue ring;
+    std::vector<char> buffers;
+    std::vector<slot> slots;
+    bool fixed_buffers = false;
+
+    static std::uint64_t tag(size_t slot_index, op kind) {
+        return (static_cast<std::uint64_t>(slot_index) << 8) | kind;
+    }
+
+public:
+    bool init() {
+        if (!ring.init(ring_entries))
+            return false;
+        if (!ring.supports({ IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE }))
+            return false;
+
+        buffers.resize(slot_count * buffer_size);
+        slots.resize(slot_count);
+
+        std::vector<iovec> vectors(slot_count);
+        for (size_t i = 0; i < slot_count; i++)
+            vectors[i] = { buffers.data() + i * buffer_size, buffer_size };
+
+        // older kernels cap locked memory; plain reads into the same buffers still work
+        fixed_buffers = ring.register_buffers(vectors);
+        return true;
+    }
+
+    // returns the indices of the paths left for the sequential reader: all that
+    // were not started once an opcode came back unsupported, plus the ones that hit it
+    std::vector<size_t> read(const std::vector<std::string>& paths, const prefetch_read_callback& callback, prefetch_read_stats& stats) {
+        size_t next_path = 0;
+        size_t active = 0;
+        bool stalled = false;
+        std::vector<size_t> leftover;
+
+        const auto unsupported = [](int res) {
+            return res == -EINVAL || res == -EOPNOTSUPP;
+        };
+
+        const auto start_slot = [&](size_t slot_index) {
+            if (stalled || next_path >= paths.size())
+                return;
+            if (!ring.reserve(2)) {
+                stalled = true;
+                return;
+            }
+
+            auto& s = slots[slot_index];
+            s = slot{};
+            s.index = next_path++;
+            s.pending = 2;
+            active++;
+
+            io_uring_sqe* open_sqe = ring.next_sqe();
+            open_sqe->opcode = IORING_OP_OPENAT;
+            open_sqe->fd = AT_FDCWD;
+            open_sqe->addr = reinterpret_cast<std::uint64_t>(paths[s.index].c_str());
+            open_sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            open_sqe->user_data = tag(slot_index, op_open);
+
+            io_uring_sqe* statx_sqe = ring.next_sqe();
+            statx_sqe->opcode = IORING_OP_STATX;
+            statx_sqe->fd = AT_FDCWD;
+            statx_sqe->addr = reinterpret_cast<std::uint64_t>(paths[s.index].c_str());
+            statx_sqe->len = STATX_SIZE;
+            statx_sqe->off = reinterpret_cast<std::uint64_t>(&s.info);
+            statx_sqe->user_data = tag(slot_index, op_statx);
+        };
+
+        const auto queue_close = [&](int fd) {
+            if (!ring.reserve(1)) {
+                close(fd);
+                ring.syscalls++;
+                return;
+            }
+            io_uring_sqe* sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fd;
+            sqe->user_data = tag(0, op_close);
+        };
+
+        const auto finish_slot = [&](size_t slot_index) {
+            auto& s = slots[slot_index];
+            if (s.retry)
+                leftover.push_back(s.index);
+            else if (s.failed)
+                stats.failed++;
+            if (s.fd >= 0)
+                queue_close(s.fd);
+            active--;
+            start_slot(slot_index);
+        };
+
+        for (size_t i = 0; i < slot_count; i++)
+            start_slot(i);
+
+        while (active > 0) {
+            ring.submit(1);
+            ring.drain([&](const io_uring_cqe& cqe) {
+                const auto kind = static_cast<op>(cqe.user_data & 0xFF);
+                if (kind == op_close)
+                    return;
+
+                const size_t slot_index = static_cast<size_t>(cqe.user_data >> 8);
+                auto& s = slots[slot_index];
+                char* buffer = buffers.data() + slot_index * buffer_size;
+
+                if (cqe.res < 0 && unsupported(cqe.res)) {
+                    s.retry = true;
+                    stalled = true;
+                }
+
+                if (kind == op_open || kind == op_statx) {
+                    if (cqe.res < 0)
+                        s.failed = true;
+                    else if (kind == op_open)
+                        s.fd = cqe.res;
+
+                    if (--s.pending != 0)
+                        return;
+
+                    if (s.failed || !ring.reserve(1)) {
+                        s.retry |= !s.failed;
+                        finish_slot(slot_index);
+                        return;
+                    }
+
+                    io_uring_sqe* sqe = ring.next_sqe();
+                    sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                    sqe->fd = s.fd;
+                    sqe->addr = reinterpret_cast<std::uint64_t>(buffer);
+                    sqe->len = static_cast<unsigned>((std::min<std::uint64_t>)(s.info.stx_size, buffer_size));
+                    sqe->off = 0;
+                    sqe->buf_index = static_cast<std::uint16_t>(slot_index);
+                    sqe->user_data = tag(slot_index, op_read);
+                    return;
+                }
+
+                if (cqe.res < 0) {
+                    s.failed = true;
+                    finish_slot(slot_index);
+                    return;
+                }
+
+                const size_t got = static_cast<size_t>(cqe.res);
+                if (s.info.stx_size <= buffer_size) {
+                    callback(s.index, std::span<const char>(buffer, got));
+                    stats.bytes += got;
+                }
+                else {
+                    // rare oversized .pf, finish it with a plain pread
+                    std::vector<char> content(static_cast<size_t>(s.info.stx_size));
+                    std::memcpy(content.data(), buffer, got);
+                    const ssize_t rest = pread(s.fd, content.data() + got, content.size() - got, static_cast<off_t>(got));
+                    ring.syscalls++;
+                    if (rest >= 0) {
+                        content.resize(got + static_cast<size_t>(rest));
+                        callback(s.index, content);
+                        stats.bytes += content.size();
+                    }
+                    else {
+                        s.failed = true;
+                    }
+                }
+
+                finish_slot(slot_index);
+            });
+        }
+
+        // flush the trailing closes
+        ring.submit(0);
+        stats.syscalls += ring.syscalls;
+        stats.used_io_uring = true;
+
+        for (; next_path < paths.size(); next_path++)
+            leftover.push_back(next_path);
+        return leftover;
+    }
+};
+#endif
+
+// portable path: one open/size/read/close per file
+inline void read_prefetch_files_sequential(const std::vector<std::string>& paths, const prefetch_read_callback& callback, prefetch_read_stats& stats) {
+    std::vector<char> content;
+    for (size_t i = 0; i < paths.size(); i++) {
+#if defined(__linux__)
+        const int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+        stats.syscalls++;
+        if (fd < 0) {
+            stats.failed++;
+            continue;
+        }
+
+        struct stat info {};
+        bool ok = fstat(fd, &info) == 0;
+        stats.syscalls++;
+        if (ok) {
+            content.resize(static_cast<size_t>(info.st_size));
+            ok = ::read(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size());
+            stats.syscalls++;
+        }
+        close(fd);
+        stats.syscalls++;
+#else
+        const bool ok = read_file(paths[i], content);
+#endif
+        if (!ok) {
+            stats.failed++;
+            continue;
+        }
+
+        callback(i, content);
+        stats.bytes += content.size();
+    }
+}
+
+// reads many .pf files and hands each one to the callback as soon as it is in memory
+inline prefetch_read_stats read_prefetch_files(const std::vector<std::string>& paths, const prefetch_read_callback& callback) {
+    prefetch_read_stats stats;
+    stats.files = paths.size();
+    const auto started = std::chrono::steady_clock::now();
+
+#if defined(__linux__)
+    io_uring_prefetch_reader reader;
+    if (reader.init()) {
+        const std::vector<size_t> leftover = reader.read(paths, callback, stats);
+        if (!leftover.empty()) {
+            std::vector<std::string> rest;
+            for (const size_t index : leftover)
+                rest.push_back(paths[index]);
+            read_prefetch_files_sequential(rest, [&](size_t index, std::span<const char> content) {
+                callback(leftover[index], content);
+            }, stats);
+        }
+    }
+    else {
+        read_prefetch_files_sequential(paths, callback, stats);
+    }
+#else
+    read_prefetch_files_sequential(paths, callback, stats);
+#endif
+
+    stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <istream>
+#include <functional>
+#include <filesystem>
+
+// a value built from a text file next to the executable, rebuilt when the
+// file's write time changes or the file appears or disappears (checked every
+// couple of seconds). the check and the build run outside the lock, which is
+// only held to swap the pointer, so a caller that asks during a rebuild gets
+// the previous value without waiting.
+// the build function gets nullptr when the file is missing or unreadable.
+template <typename T>
+class reloading_file {
+public:
+    using build_function = std::function<std::shared_ptr<const T>(std::istream* file)>;
+
+private:
+    mutable std::mutex mutex;
+    std::filesystem::path path;
+    build_function build;
+    // write time of the file the current value was built from, empty when it
+    // was built without one
+    std::optional<std::filesystem::file_time_type> loaded_time;
+    std::chrono::steady_clock::time_point last_check{};
+    std::shared_ptr<const T> current;
+    bool reloading = false;
+
+    // called with the lock held and returns with it held. get() skips its
+    // check while a reload runs; `force` rebuilds even if the file did not change
+    void reload_unlocked(std::unique_lock<std::mutex>& lock, bool force) {
+        reloading = true;
+        const auto file_path = path;
+        const auto previous_time = loaded_time;
+        const auto build_value = build;
+        lock.unlock();
+
+        std::shared_ptr<const T> value;
+        std::error_code ec;
+        const auto write_time = std::filesystem::last_write_time(file_path, ec);
+        std::optional<std::filesystem::file_time_type> seen_time;
+        if (!ec)
+            seen_time = write_time;
+
+        // a file that was deleted is a change too, the value is rebuilt without it
+        if (force || seen_time != previous_time) {
+            std::ifstream file;
+            if (!ec)
+                file.open(file_path);
+            value = build_value(file.good() ? &file : nullptr);
+        }
+
+        lock.lock();
+        if (value) {
+            current = std::move(value);
+            loaded_time = seen_time;
+        }
+        reloading = false;
+    }
+
+public:
+    void configure(const std::filesystem::path& file_path, build_function build_value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        path = file_path;
+        build = std::move(build_value);
+        reload_unlocked(lock, true);
+    }
+
+    void reload() {
+        std::unique_lock<std::mutex> lock(mutex);
+        reload_unlocked(lock, true);
+    }
+
+    std::shared_ptr<const T> get() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (current && (reloading || now - last_check < std::chrono::seconds(2)))
+            return current;
+        last_check = now;
+
+        reload_unlocked(lock, !current);
+        return current;
+    }
+};
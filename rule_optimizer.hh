@@ -0,0 +1,311 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_set>
+
+// most generic strings are written as regexes although they are plain text,
+// /clicker/i ascii wide. a regex string is verified by the re engine on every
+// atom hit and its atoms are picked from the re ast; the same text written as a
+// "clicker" nocase ascii wide string is verified with a memcmp and gets the
+// best atom window of the literal. this pass rewrites the sources before they
+// are compiled, regexes that are not plain text are left alone.
+
+struct rule_rewrite {
+    std::string rule;
+    std::string identifier;
+    std::string before;
+    std::vector<std::string> after;
+};
+
+// decodes one regex escape that stands for a literal byte, false for classes
+// like \w or \d and for anything else that is not a single known byte
+inline bool decode_regex_escape(const std::string& body, size_t& i, std::string& out) {
+    if (i + 1 >= body.size())
+        return false;
+
+    const char c = body[++i];
+    switch (c) {
+    case 'n': out += '\n'; return true;
+    case 't': out += '\t'; return true;
+    case 'r': out += '\r'; return true;
+    case 'f': out += '\f'; return true;
+    case 'x': {
+        if (i + 2 >= body.size() || !std::isxdigit(static_cast<unsigned char>(body[i + 1])) ||
+            !std::isxdigit(static_cast<unsigned char>(body[i + 2])))
+            return false;
+        out += static_cast<char>(std::stoi(body.substr(i + 1, 2), nullptr, 16));
+        i += 2;
+        return true;
+    }
+    default:
+        if (std::string(".^$|()[]{}*+?\\/-\"").find(c) == std::string::npos)
+            return false;
+        out += c;
+        return true;
+    }
+}
+
+inline bool regex_piece_to_literal(const std::string& body, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < body.size(); i++) {
+        const char c = body[i];
+        if (c == '\\') {
+            if (!decode_regex_escape(body, i, out))
+                return false;
+        }
+        else if (std::string(".^$|()[]{}*+?").find(c) != std::string::npos) {
+            return false;
+        }
+        else {
+            out += c;
+        }
+    }
+    return !out.empty();
+}
+
+// accepts "text", "a|b|c" and "(a|b|c)" where every branch is plain text
+inline bool regex_to_literals(std::string body, std::vector<std::string>& literals) {
+    literals.clear();
+
+    if (body.size() >= 2 && body.front() == '(' && body.back() == ')') {
+        int depth = 0;
+        bool wraps = true;
+        for (size_t i = 0; i < body.size(); i++) {
+            if (body[i] == '\\') { i++; continue; }
+            if (body[i] == '(') depth++;
+            if (body[i] == ')' && --depth == 0 && i + 1 != body.size()) { wraps = false; break; }
+        }
+        if (wraps)
+            body = body.substr(1, body.size() - 2);
+    }
+
+    size_t start = 0;
+    for (size_t i = 0; i <= body.size(); i++) {
+        if (i < body.size() && body[i] == '\\') {
+            i++;
+            continue;
+        }
+        if (i == body.size() || body[i] == '|') {
+            std::string literal;
+            if (!regex_piece_to_literal(body.substr(start, i - start), literal))
+                return false;
+            literals.push_back(std::move(literal));
+            start = i + 1;
+        }
+    }
+    return !literals.empty();
+}
+
+inline std::string yara_text_string(const std::string& literal) {
+    std::string out = "\"";
+    for (unsigned char c : literal) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x20 || c >= 0x7F) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\x%02X", c);
+            out += escaped;
+        }
+        else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+inline bool is_identifier_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// name declared by a `[private] [global] rule name` line, empty otherwise
+inline std::string declared_rule_name(const std::string& line) {
+    size_t i = 0;
+    for (;;) {
+        i = line.find_first_not_of(" \t", i);
+        if (i == std::string::npos)
+            return {};
+        size_t end = i;
+        while (end < line.size() && is_identifier_char(line[end]))
+            end++;
+        const std::string word = line.substr(i, end - i);
+        i = end;
+        if (word == "private" || word == "global")
+            continue;
+        if (word != "rule")
+            return {};
+
+        i = line.find_first_not_of(" \t", i);
+        if (i == std::string::npos)
+            return {};
+        end = i;
+        while (end < line.size() && is_identifier_char(line[end]))
+            end++;
+        return line.substr(i, end - i);
+    }
+}
+
+// true when $id, #id, @id or !id appear anywhere outside the declaration, an
+// alternation split into $id_0.. $id_n is only safe when nothing names $id
+inline bool string_referenced(const std::string& source, const std::string& identifier, size_t declaration) {
+    for (size_t at = 0; (at = source.find(identifier, at)) != std::string::npos; at += identifier.size()) {
+        if (at == 0 || at == declaration || std::string("$#@!").find(source[at - 1]) == std::string::npos)
+            continue;
+        const size_t end = at + identifier.size();
+        if (end < source.size() && is_identifier_char(source[end]))
+            continue;
+        return true;
+    }
+    return false;
+}
+
+// true when the condition of the rule declared at `rule_start` can count $id as
+// one of a set: `them`, or a `$prefix*` wildcard that covers it. `all of them`,
+// `2 of ($x*)` and `for any of ($*)` would see $id_0.. $id_n as several strings,
+// so an alternation is only split when the condition names no such set
+inline bool string_counted(const std::string& source, const std::string& identifier, size_t rule_start) {
+    size_t end = source.size();
+    for (size_t at = source.find('\n', rule_start); at != std::string::npos; at = source.find('\n', at + 1)) {
+        size_t next = source.find('\n', at + 1);
+        if (!declared_rule_name(source.substr(at + 1, next == std::string::npos ? std::string::npos : next - at - 1)).empty()) {
+            end = at;
+            break;
+        }
+    }
+
+    size_t condition = source.find("condition:", rule_start);
+    if (condition == std::string::npos || condition >= end)
+        return true;
+
+    for (size_t i = condition; i < end; i++) {
+        if (source[i] == '$') {
+            size_t e = i + 1;
+            while (e < end && is_identifier_char(source[e]))
+                e++;
+            if (e < end && source[e] == '*' && identifier.compare(0, e - i - 1, source, i + 1, e - i - 1) == 0)
+                return true;
+            i = e - 1;
+        }
+        else if (is_identifier_char(source[i])) {
+            size_t e = i;
+            while (e < end && is_identifier_char(source[e]))
+                e++;
+            if (source.compare(i, e - i, "them") == 0)
+                return true;
+            i = e - 1;
+        }
+    }
+    return false;
+}
+
+// rewrites every `$id = /regex/flags modifiers` line whose regex is plain text.
+// modifiers are kept, /i becomes nocase, other regex flags only affect
+// constructs a literal cannot contain. each rewrite is recorded in `rewrites`.
+inline std::string optimize_rule_source(const std::string& source, std::vector<rule_rewrite>* rewrites = nullptr) {
+    static const std::unordered_set<std::string> text_modifiers = { "ascii", "wide", "nocase", "fullword", "private" };
+
+    std::string out;
+    std::string rule;
+    size_t rule_start = 0;
+    size_t line_start = 0;
+    while (line_start < source.size()) {
+        size_t line_end = source.find('\n', line_start);
+        if (line_end == std::string::npos)
+            line_end = source.size();
+        const std::string line = source.substr(line_start, line_end - line_start);
+
+        const std::string declared = declared_rule_name(line);
+        if (!declared.empty()) {
+            rule = declared;
+            rule_start = line_start;
+        }
+
+        std::string rewritten;
+        [&] {
+            size_t i = line.find_first_not_of(" \t");
+            if (i == std::string::npos || line[i] != '$')
+                return;
+
+            const size_t id_start = i;
+            for (i++; i < line.size() && is_identifier_char(line[i]); i++) {}
+            const std::string identifier = line.substr(id_start, i - id_start);
+
+            i = line.find_first_not_of(" \t", i);
+            if (i == std::string::npos || line[i] != '=')
+                return;
+            i = line.find_first_not_of(" \t", i + 1);
+            if (i == std::string::npos || line[i] != '/')
+                return;
+
+            size_t close = std::string::npos;
+            for (size_t j = i + 1; j < line.size(); j++) {
+                if (line[j] == '\\') { j++; continue; }
+                if (line[j] == '/') { close = j; break; }
+            }
+            if (close == std::string::npos)
+                return;
+
+            const std::string body = line.substr(i + 1, close - i - 1);
+            size_t k = close + 1;
+            bool nocase = false;
+            for (; k < line.size() && std::isalpha(static_cast<unsigned char>(line[k])); k++) {
+                if (line[k] == 'i') nocase = true;
+                else if (line[k] != 's') return;
+            }
+
+            std::vector<std::string> modifiers;
+            std::string tail = line.substr(k);
+            for (size_t m = 0; m < tail.size();) {
+                m = tail.find_first_not_of(" \t\r", m);
+                if (m == std::string::npos)
+                    break;
+                size_t e = tail.find_first_of(" \t\r", m);
+                if (e == std::string::npos)
+                    e = tail.size();
+                const std::string modifier = tail.substr(m, e - m);
+                if (!text_modifiers.count(modifier))
+                    return;
+                if (modifier != "nocase")
+                    modifiers.push_back(modifier);
+                m = e;
+            }
+            if (nocase)
+                modifiers.push_back("nocase");
+
+            std::vector<std::string> literals;
+            if (!regex_to_literals(body, literals))
+                return;
+
+            const std::string id_name = identifier.substr(1);
+            if (literals.size() > 1 && (id_name.empty() || string_referenced(source, id_name, line_start + id_start + 1) ||
+                string_counted(source, id_name, rule_start)))
+                return;
+
+            std::string suffix;
+            for (const auto& modifier : modifiers)
+                suffix += " " + modifier;
+
+            const std::string indent = line.substr(0, id_start);
+            rule_rewrite rewrite{ rule, identifier, line.substr(id_start), {} };
+            for (size_t n = 0; n < literals.size(); n++) {
+                const std::string name = literals.size() > 1 ? identifier + "_" + std::to_string(n) : identifier;
+                rewrite.after.push_back(name + " = " + yara_text_string(literals[n]) + suffix);
+                rewritten += (n ? "\n" : "") + indent + rewrite.after.back();
+            }
+
+            if (rewrites)
+                rewrites->push_back(std::move(rewrite));
+        }();
+
+        out += rewritten.empty() ? line : rewritten;
+        if (line_end < source.size())
+            out += '\n';
+        line_start = line_end + 1;
+    }
+    return out;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+#include "rule_optimizer.hh"
+
+// generic rules are compiled into one set per tier. tier 1 runs on every
+// unsigned binary, a later tier only on the files the tier before it passed
+// on: a rule tagged `candidate` that matches is a gate, not a verdict, and
+// advances the file. a tier that has no candidate rule passes every file on.
+// a rule is placed by a `tierN` tag (`tier0` pins it to tier 1 like `tier1`
+// does). an untagged rule goes to tier 1, or to tier 2 when placement by cost
+// is turned on and the last rule profile measured it above the threshold. every
+// rule of one generic rule source shares its tier (they may reference each
+// other), a source with a candidate rule keeps the tier its tags give it
+constexpr const char* rule_candidate_tag = "candidate";
+
+struct declared_rule {
+    std::string name;
+    std::vector<std::string> tags;
+};
+
+// tags after the colon of a `rule name : tag1 tag2 {` line
+inline std::vector<std::string> declared_rule_tags(const std::string& line, const std::string& name) {
+    std::vector<std::string> tags;
+    size_t i = line.find("rule");
+    while (i != std::string::npos) {
+        const size_t at = line.find_first_not_of(" \t", i + 4);
+        const size_t end = at == std::string::npos ? at : at + name.size();
+        if (at != std::string::npos && line.compare(at, name.size(), name) == 0 && (end == line.size() || !is_identifier_char(line[end]))) {
+            i = end;
+            break;
+        }
+        i = line.find("rule", i + 4);
+    }
+    if (i == std::string::npos)
+        return tags;
+    i = line.find_first_not_of(" \t", i);
+    if (i == std::string::npos || line[i] != ':')
+        return tags;
+
+    for (i++; i < line.size();) {
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string::npos || !is_identifier_char(line[i]))
+            break;
+        size_t end = i;
+        while (end < line.size() && is_identifier_char(line[end]))
+            end++;
+        tags.push_back(line.substr(i, end - i));
+        i = end;
+    }
+    return tags;
+}
+
+inline std::vector<declared_rule> declared_rules(const std::string& source) {
+    std::vector<declared_rule> rules;
+    std::istringstream stream(source);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::string name = declared_rule_name(line);
+        if (!name.empty())
+            rules.push_back({ name, declared_rule_tags(line, name) });
+    }
+    return rules;
+}
+
+// 2 for `tier2`, -1 when no tag names a tier
+inline int tagged_rule_tier(const std::vector<std::string>& tags) {
+    int tier = -1;
+    for (const auto& tag : tags) {
+        if (tag.size() > 4 && tag.compare(0, 4, "tier") == 0 && std::all_of(tag.begin() + 4, tag.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+            tier = (std::max)(tier, std::atoi(tag.c_str() + 4));
+    }
+    return tier;
+}
+
+inline bool is_candidate_rule(const declared_rule& rule) {
+    return std::find(rule.tags.begin(), rule.tags.end(), rule_candidate_tag) != rule.tags.end();
+}
+
+// mean cost per scan in microseconds of every rule in a rule profile report,
+// keyed by identifier without the namespace
+inline std::unordered_map<std::string, double> parse_rule_costs(std::istream& stream) {
+    std::unordered_map<std::string, double> costs;
+    std::string line;
+    bool in_rules = false;
+    while (std::getline(stream, line)) {
+        if (!in_rules) {
+            in_rules = line.find("us/scan") != std::string::npos;
+            continue;
+        }
+        std::istringstream row(line);
+        double cost_ms, per_scan_us;
+        unsigned atom_matches;
+        std::string name;
+        if (!(row >> cost_ms >> per_scan_us >> atom_matches >> name))
+            break;
+        const auto separator = name.find(':');
+        costs[separator == std::string::npos ? name : name.substr(separator + 1)] = per_scan_us;
+    }
+    return costs;
+}
+
+// `by_cost` is set when the tier comes from the profile rather than from a tag,
+// so the caller can say which sources it moved
+inline int assign_rule_tier(const std::string& source, const std::unordered_map<std::string, double>& costs, double cost_threshold_us,
+    bool* by_cost = nullptr) {
+    int tier = -1;
+    bool candidate = false;
+    bool expensive = false;
+    for (const auto& rule : declared_rules(source)) {
+        tier = (std::max)(tier, tagged_rule_tier(rule.tags));
+        candidate |= is_candidate_rule(rule);
+        const auto cost = costs.find(rule.name);
+        expensive |= cost_threshold_us > 0 && cost != costs.end() && cost->second > cost_threshold_us;
+    }
+
+    const bool moved = tier < 0 && expensive && !candidate;
+    if (by_cost)
+        *by_cost = moved;
+    if (tier < 0)
+        return moved ? 2 : 1;
+    return (std::max)(tier, 1);
+}
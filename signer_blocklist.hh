@@ -0,0 +1,200 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <queue>
+#include <memory>
+#include <istream>
+#include <cstdint>
+#include <filesystem>
+#include "cert_store.hh"
+#include "reloading_file.hh"
+
+// blocklist file format, one entry per line, '#' starts a comment:
+//   subject: manthe industries, llc
+//   thumbprint: 0123...ABCD
+//   serial: 33 00 00 ...
+// lines without a prefix are treated as subject substrings
+struct signer_blocklist_entries {
+    std::vector<std::string> subjects;
+    thumbprint_set thumbprints;
+    thumbprint_set serials;
+};
+
+inline std::string trim_blocklist_field(const std::string& text) {
+    const auto begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return {};
+    const auto end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+inline void parse_signer_blocklist(std::istream& stream, signer_blocklist_entries& out) {
+    std::string line;
+    while (std::getline(stream, line)) {
+        const auto comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        line = trim_blocklist_field(line);
+        if (line.empty())
+            continue;
+
+        const auto colon = line.find(':');
+        const std::string kind = colon != std::string::npos ? trim_blocklist_field(line.substr(0, colon)) : std::string();
+        const std::string value = colon != std::string::npos ? trim_blocklist_field(line.substr(colon + 1)) : line;
+
+        if (kind == "thumbprint") {
+            std::string thumbprint = normalize_thumbprint(value);
+            if (!thumbprint.empty())
+                out.thumbprints.insert(std::move(thumbprint));
+        }
+        else if (kind == "serial") {
+            std::string serial = normalize_thumbprint(value);
+            if (!serial.empty())
+                out.serials.insert(std::move(serial));
+        }
+        else if (kind == "subject") {
+            if (!value.empty())
+                out.subjects.push_back(value);
+        }
+        else {
+            out.subjects.push_back(line);
+        }
+    }
+}
+
+// case-insensitive aho-corasick over every blocked subject, compiled to a full
+// dfa so a lookup is one table step per subject byte whatever the list size.
+// bytes are folded into classes (only bytes used by some pattern get their own
+// column) which keeps the table small for lists of thousands of names.
+class signer_matcher {
+    std::array<std::uint8_t, 256> byte_class{};
+    size_t class_count = 1;
+    std::vector<std::uint32_t> transitions;
+    std::vector<std::uint8_t> accepting;
+    thumbprint_set thumbprints;
+    thumbprint_set serials;
+
+    static std::uint8_t fold(std::uint8_t c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<std::uint8_t>(c - 'A' + 'a') : c;
+    }
+
+public:
+    explicit signer_matcher(const signer_blocklist_entries& entries)
+        : thumbprints(entries.thumbprints), serials(entries.serials) {
+        constexpr std::uint32_t missing = UINT32_MAX;
+
+        for (const auto& subject : entries.subjects) {
+            for (unsigned char c : subject) {
+                auto& cls = byte_class[fold(c)];
+                if (cls == 0 && class_count < 256)
+                    cls = static_cast<std::uint8_t>(class_count++);
+            }
+        }
+        for (int c = 'A'; c <= 'Z'; c++)
+            byte_class[c] = byte_class[fold(static_cast<std::uint8_t>(c))];
+
+        transitions.assign(class_count, missing);
+        accepting.assign(1, 0);
+
+        for (const auto& subject : entries.subjects) {
+            if (subject.empty())
+                continue;
+
+            std::uint32_t state = 0;
+            for (unsigned char c : subject) {
+                const size_t slot = state * class_count + byte_class[c];
+                if (transitions[slot] == missing) {
+                    transitions[slot] = static_cast<std::uint32_t>(accepting.size());
+                    accepting.push_back(0);
+                    transitions.resize(transitions.size() + class_count, missing);
+                }
+                state = transitions[slot];
+            }
+            accepting[state] = 1;
+        }
+
+        std::vector<std::uint32_t> failure(accepting.size(), 0);
+        std::queue<std::uint32_t> pending;
+
+        // class 0 never appears in a pattern so it always resolves to the root
+        for (size_t cls = 0; cls < class_count; cls++) {
+            auto& next = transitions[cls];
+            if (next == missing) {
+                next = 0;
+            }
+            else {
+                failure[next] = 0;
+                pending.push(next);
+            }
+        }
+
+        while (!pending.empty()) {
+            const std::uint32_t state = pending.front();
+            pending.pop();
+            accepting[state] |= accepting[failure[state]];
+
+            for (size_t cls = 0; cls < class_count; cls++) {
+                auto& next = transitions[state * class_count + cls];
+                const std::uint32_t fallback = transitions[failure[state] * class_count + cls];
+                if (next == missing) {
+                    next = fallback;
+                }
+                else {
+                    failure[next] = fallback;
+                    pending.push(next);
+                }
+            }
+        }
+    }
+
+    bool subject_matches(const std::string& subject) const {
+        std::uint32_t state = 0;
+        for (unsigned char c : subject) {
+            state = transitions[state * class_count + byte_class[c]];
+            if (accepting[state])
+                return true;
+        }
+        return false;
+    }
+
+    bool thumbprint_blocked(const std::string& thumbprint) const {
+        return thumbprints.count(thumbprint) != 0;
+    }
+
+    bool serial_blocked(const std::string& serial) const {
+        return serials.count(serial) != 0;
+    }
+
+    size_t state_count() const {
+        return accepting.size();
+    }
+};
+
+// owns the compiled matcher for one blocklist file, built-in entries plus the
+// file's. lookups share the current matcher while a reload compiles the next
+class signer_blocklist {
+    reloading_file<signer_matcher> file;
+
+public:
+    void configure(const std::filesystem::path& file_path, const signer_blocklist_entries& defaults) {
+        file.configure(file_path, [defaults](std::istream* stream) {
+            signer_blocklist_entries entries = defaults;
+            if (stream)
+                parse_signer_blocklist(*stream, entries);
+            return std::make_shared<const signer_matcher>(entries);
+        });
+    }
+
+    void reload() {
+        file.reload();
+    }
+
+    std::shared_ptr<const signer_matcher> matcher() {
+        return file.get();
+    }
+};
+
+inline signer_blocklist signer_blocks;
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <istream>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include "reloading_file.hh"
+
+// tlsh digests of known cheat clients and loaders, one per line with the family
+// after it, '#' starts a comment:
+//   T1A3B2...  vape lite
+// digests are the "T1" strings libyara's tlshc produces (128 buckets, one byte
+// checksum), the T1 prefix is optional
+constexpr size_t tlsh_hex_length = 70;
+
+// files within this distance of a known digest get a "similar to" verdict. the
+// tlsh authors put the false positive rate at well under 1% below 40
+constexpr int tlsh_similarity_threshold = 40;
+
+struct tlsh_digest {
+    std::uint8_t checksum = 0;
+    std::uint8_t lvalue = 0;
+    std::uint8_t q1ratio = 0;
+    std::uint8_t q2ratio = 0;
+    // 128 bucket quartiles, four 2-bit values per byte
+    std::array<std::uint8_t, 32> body{};
+};
+
+// header bytes are stored with their nibbles swapped, the body as is
+inline bool parse_tlsh_digest(const std::string& text, tlsh_digest& out) {
+    size_t start = 0;
+    if (text.size() >= 2 && text[0] == 'T' && text[1] == '1')
+        start = 2;
+    if (text.size() - start != tlsh_hex_length)
+        return false;
+
+    const auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    std::array<std::uint8_t, tlsh_hex_length / 2> raw{};
+    for (size_t i = 0; i < raw.size(); i++) {
+        const int high = nibble(text[start + i * 2]);
+        const int low = nibble(text[start + i * 2 + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        raw[i] = static_cast<std::uint8_t>(high << 4 | low);
+    }
+
+    const auto swapped = [](std::uint8_t b) { return static_cast<std::uint8_t>(b << 4 | b >> 4); };
+    out.checksum = swapped(raw[0]);
+    out.lvalue = swapped(raw[1]);
+    out.q1ratio = swapped(raw[2]) & 0xF;
+    out.q2ratio = swapped(raw[2]) >> 4;
+    std::copy(raw.begin() + 3, raw.end(), out.body.begin());
+    return true;
+}
+
+// distance between the quartiles packed in two body bytes, a bucket that moved
+// by three quartiles costs 6
+inline const std::array<std::array<std::uint8_t, 256>, 256>& tlsh_body_diff_table() {
+    static const auto table = [] {
+        std::array<std::array<std::uint8_t, 256>, 256> t{};
+        for (int x = 0; x < 256; x++) {
+            for (int y = 0; y < 256; y++) {
+                int diff = 0;
+                for (int shift = 0; shift < 8; shift += 2) {
+                    const int d = std::abs((x >> shift & 3) - (y >> shift & 3));
+                    diff += d == 3 ? 6 : d;
+                }
+                t[x][y] = static_cast<std::uint8_t>(diff);
+            }
+        }
+        return t;
+    }();
+    return table;
+}
+
+// same value as tlsh's total_diff with the length included
+inline int tlsh_distance(const tlsh_digest& a, const tlsh_digest& b) {
+    const auto mod_diff = [](int x, int y, int range) {
+        const int d = std::abs(x - y);
+        return (std::min)(d, range - d);
+    };
+
+    int diff = 0;
+    const int ldiff = mod_diff(a.lvalue, b.lvalue, 256);
+    diff += ldiff <= 1 ? ldiff : ldiff * 12;
+
+    const int q1diff = mod_diff(a.q1ratio, b.q1ratio, 16);
+    diff += q1diff <= 1 ? q1diff : (q1diff - 1) * 12;
+    const int q2diff = mod_diff(a.q2ratio, b.q2ratio, 16);
+    diff += q2diff <= 1 ? q2diff : (q2diff - 1) * 12;
+
+    if (a.checksum != b.checksum)
+        diff++;
+
+    const auto& table = tlsh_body_diff_table();
+    for (size_t i = 0; i < a.body.size(); i++)
+        diff += table[a.body[i]][b.body[i]];
+    return diff;
+}
+
+struct tlsh_match {
+    std::uint32_t id;
+    int distance;
+};
+
+// locality sensitive index over tlsh bodies. every table keys a digest by the
+// quartiles of a fixed random sample of buckets, so two digests share a key
+// when they agree on all of them. a digest within the threshold differs in at
+// most a third of the buckets and shares a key in at least one of the tables
+// with high probability, while an unrelated one matches a sample about one
+// time in 4^sample_size. candidates are checked with the exact distance.
+// brute_force() is the exact answer the index approximates.
+class tlsh_index {
+    static constexpr size_t table_count = 40;
+    static constexpr size_t sample_size = 8;
+
+    struct table {
+        std::array<std::uint8_t, sample_size> buckets{};
+        std::vector<std::uint16_t> keys;
+        std::vector<std::uint32_t> ids;
+    };
+
+    std::vector<tlsh_digest> digests;
+    std::vector<std::string> families;
+    std::array<table, table_count> tables;
+
+    std::uint16_t key(const table& t, const tlsh_digest& digest) const {
+        std::uint16_t k = 0;
+        for (const auto bucket : t.buckets)
+            k = static_cast<std::uint16_t>(k << 2 | (digest.body[bucket >> 2] >> ((bucket & 3) * 2) & 3));
+        return k;
+    }
+
+public:
+    tlsh_index() {
+        // fixed seed, the samples only have to differ between tables
+        std::uint32_t state = 0x9E3779B9;
+        for (auto& t : tables) {
+            std::array<std::uint8_t, 128> buckets{};
+            for (size_t i = 0; i < buckets.size(); i++)
+                buckets[i] = static_cast<std::uint8_t>(i);
+            for (size_t i = 0; i < sample_size; i++) {
+                state = state * 1664525 + 1013904223;
+                std::swap(buckets[i], buckets[i + (state >> 8) % (buckets.size() - i)]);
+            }
+            std::copy(buckets.begin(), buckets.begin() + sample_size, t.buckets.begin());
+        }
+    }
+
+    void add(const tlsh_digest& digest, const std::string& family) {
+        digests.push_back(digest);
+        families.push_back(family);
+    }
+
+    // sorts every table by key, call once after the last add()
+    void build() {
+        std::vector<std::pair<std::uint16_t, std::uint32_t>> entries(digests.size());
+        for (auto& t : tables) {
+            for (std::uint32_t id = 0; id < digests.size(); id++)
+                entries[id] = { key(t, digests[id]), id };
+            std::sort(entries.begin(), entries.end());
+
+            t.keys.resize(entries.size());
+            t.ids.resize(entries.size());
+            for (size_t i = 0; i < entries.size(); i++) {
+                t.keys[i] = entries[i].first;
+                t.ids[i] = entries[i].second;
+            }
+        }
+    }
+
+    // every indexed digest within `threshold` that shares a key with the query,
+    // closest first
+    std::vector<tlsh_match> query(const tlsh_digest& digest, int threshold = tlsh_similarity_threshold) const {
+        std::vector<std::uint32_t> candidates;
+        for (const auto& t : tables) {
+            const auto k = key(t, digest);
+            const auto range = std::equal_range(t.keys.begin(), t.keys.end(), k);
+            for (auto it = range.first; it != range.second; ++it)
+                candidates.push_back(t.ids[it - t.keys.begin()]);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<tlsh_match> matches;
+        for (const auto id : candidates) {
+            const int distance = tlsh_distance(digest, digests[id]);
+            if (distance <= threshold)
+                matches.push_back({ id, distance });
+        }
+        std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) { return a.distance < b.distance; });
+        return matches;
+    }
+
+    std::vector<tlsh_match> brute_force(const tlsh_digest& digest, int threshold = tlsh_similarity_threshold) const {
+        std::vector<tlsh_match> matches;
+        for (std::uint32_t id = 0; id < digests.size(); id++) {
+            const int distance = tlsh_distance(digest, digests[id]);
+            if (distance <= threshold)
+                matches.push_back({ id, distance });
+        }
+        std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) { return a.distance < b.distance; });
+        return matches;
+    }
+
+    const std::string& family(std::uint32_t id) const {
+        return families[id];
+    }
+
+    size_t size() const {
+        return digests.size();
+    }
+};
+
+inline void parse_tlsh_library(std::istream& stream, tlsh_index& out) {
+    std::string line;
+    while (std::getline(stream, line)) {
+        const auto comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        const auto begin = line.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos)
+            continue;
+        const auto end = line.find_first_of(" \t\r\n", begin);
+        const std::string digest_text = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+
+        std::string family;
+        if (end != std::string::npos) {
+            const auto family_begin = line.find_first_not_of(" \t\r\n", end);
+            const auto family_end = line.find_last_not_of(" \t\r\n");
+            if (family_begin != std::string::npos)
+                family = line.substr(family_begin, family_end - family_begin + 1);
+        }
+
+        tlsh_digest digest;
+        if (parse_tlsh_digest(digest_text, digest))
+            out.add(digest, family.empty() ? digest_text : family);
+    }
+}
+
+// owns the index built from the library file. lookups share the current index
+// while a reload builds the next
+class tlsh_library {
+    reloading_file<tlsh_index> file;
+
+public:
+    void configure(const std::filesystem::path& file_path) {
+        file.configure(file_path, [](std::istream* stream) {
+            auto index = std::make_shared<tlsh_index>();
+            if (stream)
+                parse_tlsh_library(*stream, *index);
+            index->build();
+            return std::shared_ptr<const tlsh_index>(std::move(index));
+        });
+    }
+
+    std::shared_ptr<const tlsh_index> index() {
+        return file.get();
+    }
+};
+
+inline tlsh_library tlsh_families;
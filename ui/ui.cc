@@ -1,5 +1,11 @@
 ﻿#include "ui.h"
 #include <yara.h>
+#include <memory>
+#include "../cert_store.hh"
+#include "../file_pipeline.hh"
+#include "../metadata_probe.hh"
+#include "../similarity_index.hh"
+#include "../fingerprint_index.hh"
 
 
 std::vector<LogonSessionInfo> GetInteractiveLogonSessions() {
@@ -129,40 +135,296 @@ void CopyableText(const char* label)
 }
 
 
-std::vector<PrefetchFileInfo> GetPrefetchFileInfos() {
+std::vector<PrefetchFileInfo> GetPrefetchFileInfos(prefetch_read_stats& stats) {
     std::vector<PrefetchFileInfo> file_infos;
+    std::vector<std::string> names;
+    std::vector<std::string> paths;
     WIN32_FIND_DATA findFileData;
     HANDLE hFind = FindFirstFile("C:\\Windows\\Prefetch\\*.pf", &findFileData);
     if (hFind != INVALID_HANDLE_VALUE) {
-        SYSTEMTIME lastLogonTime;
-        FILETIME lastLogonFileTime;
-        SystemTimeToFileTime(&lastLogonTime, &lastLogonFileTime);
-        std::unordered_set<std::wstring> processedFiles;
         do {
-            std::string file_path = "C:\\Windows\\Prefetch\\" + std::string(findFileData.cFileName);
-            const auto parser = prefetch_parser(file_path.c_str());
-            if (parser.success()) {
-                PrefetchFileInfo info;
-                info.filename = findFileData.cFileName;
-                info.executed_time = parser.executed_time();
-                info.related_filenames = parser.get_filenames_strings();
-                info.last_eight_execution_times = parser.last_eight_execution_times();
-                info.readable_time = ConvertExecutedTime(info.executed_time);
-                std::wstring properPath = GetDriveLetterFromVolumePath(StringToWString(info.filename));
-                info.isInInstance = TimeValidator::isInInstance(info.readable_time);
-                info.is_signed = IsFileSignatureValid(properPath);
-                
-                file_infos.push_back(info);
-            }
+            names.push_back(findFileData.cFileName);
+            paths.push_back("C:\\Windows\\Prefetch\\" + std::string(findFileData.cFileName));
         } while (FindNextFile(hFind, &findFileData));
         FindClose(hFind);
     }
+    // the pf file info tab reads sizes and times through the probe, which would
+    // otherwise keep answering from its enumeration before this scan
+    file_probe.invalidate(L"C:\\Windows\\Prefetch");
+
+    stats = read_prefetch_files(paths, [&](size_t index, std::span<const char> content) {
+        const auto parser = prefetch_parser(content);
+        if (parser.success()) {
+            PrefetchFileInfo info;
+            info.filename = names[index];
+            info.executed_time = parser.executed_time();
+            info.related_filenames = parser.get_filenames_strings();
+            info.last_eight_execution_times = parser.last_eight_execution_times();
+            info.readable_time = ConvertExecutedTime(info.executed_time);
+            std::wstring properPath = GetDriveLetterFromVolumePath(StringToWString(info.filename));
+            info.isInInstance = TimeValidator::isInInstance(info.readable_time);
+            info.is_signed = IsFileSignatureValid(properPath);
+
+            file_infos.push_back(info);
+        }
+    });
+
     return file_infos;
 }
 
-void ui::initialize_prefetch_data() {
-    file_infos = GetPrefetchFileInfos();
+static bool is_own_executable(const std::wstring& path) {
+    static const std::wstring own_path = ToUpperCase(StringToWString(getOwnPath()));
+    return ToUpperCase(path) == own_path;
+}
+
+static void push_scan_result(PrefetchFileInfo& info, bool yara_match, const std::vector<std::string>& matched_rules) {
+    if (yara_match && !matched_rules.empty()) {
+        for (const auto& rule : matched_rules) {
+            info.matched_rules.push_back(rule);
+        }
+    }
+    else {
+        info.matched_rules.push_back("none");
+    }
+}
+
+// tlsh of an unsigned binary looked up among the known families, so renamed or
+// repacked builds that no rule matches still get a verdict
+static void push_similarity(PrefetchFileInfo& info) {
+    tlsh_digest digest;
+    if (!parse_tlsh_digest(info.tlsh, digest))
+        return;
+
+    const auto index = tlsh_families.index();
+    const auto matches = index->query(digest);
+    if (matches.empty())
+        return;
+
+    info.similar_to = index->family(matches.front().id);
+    info.similar_distance = matches.front().distance;
+}
+
+// imphash and rich header hash from libyara's pe parsers over the mapping the
+// scan reads anyway, no rule or module load involved
+static void push_fingerprints(PrefetchFileInfo& info, const mapped_file& target) {
+    if (!globals.pe_fingerprints || !target.valid())
+        return;
+
+    char imphash[YR_PE_FINGERPRINT_HEX_LENGTH];
+    char rich_hash[YR_PE_FINGERPRINT_HEX_LENGTH];
+    if (yr_pe_fingerprints(target.data(), static_cast<size_t>(target.size()), imphash, rich_hash) != ERROR_SUCCESS)
+        return;
+
+    info.fingerprints.imphash = imphash;
+    info.fingerprints.rich_hash = rich_hash;
+}
+
+// everything after the content pass: the signature check against the catalog
+// digest, then yara, fingerprints and similarity for unsigned binaries
+static void scan_target_binary(PrefetchFileInfo& info, const mapped_file& target, const std::vector<BYTE>& authenticode_sha1) {
+    info.is_signed = IsFileSignatureValid(info.proper_path, authenticode_sha1);
+
+    if (!info.is_signed) {
+        if (!is_own_executable(info.proper_path)) {
+            std::vector<std::string> matched_rules;
+            bool yara_match = scan_memory_with_yara(target.data(), static_cast<size_t>(target.size()), matched_rules);
+            push_scan_result(info, yara_match, matched_rules);
+            push_fingerprints(info, target);
+            if (globals.similarity_index)
+                push_similarity(info);
+        }
+    }
+    else {
+        info.matched_rules.push_back("none");
+    }
+}
+
+// the legacy branch lets every api read the file on its own, it is also taken
+// for binaries that could not be mapped
+static void process_target_legacy(PrefetchFileInfo& info, const mapped_file& target) {
+    const auto started = std::chrono::steady_clock::now();
+
+    // winverifytrust always hashes the file, the catalog check and yara read it again
+    info.is_signed = IsFileSignatureValid(info.proper_path);
+    info.bytes_read = target.size();
+
+    if (!info.is_signed) {
+        info.bytes_read += target.size();
+        if (!is_own_executable(info.proper_path)) {
+            std::vector<std::string> matched_rules;
+            bool yara_match = scan_with_yara(WStringToString(info.proper_path), matched_rules);
+            push_scan_result(info, yara_match, matched_rules);
+            push_fingerprints(info, target);
+            info.bytes_read += target.size();
+        }
+    }
+    else {
+        info.matched_rules.push_back("none");
+    }
+
+    info.process_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+// consumers of one binary's content pass
+struct target_pass {
+    hash_consumer content;
+    authenticode_consumer authenticode;
+    tlsh_consumer tlsh;
+
+    explicit target_pass(int algorithms) : content(algorithms) {}
+};
+
+// present binaries are mapped a batch at a time and read in one pass that feeds
+// the content hashes, the catalog digest and tlsh of every file. on avx2 cpus
+// without the sha extensions the sha256 of the batch is taken in the same pass,
+// eight files per register, otherwise it stays with md5 and sha1. the pass time
+// is charged to each file by size, the signature check and yara per file
+static void process_target_batch(const std::vector<PrefetchFileInfo*>& batch) {
+    std::vector<std::unique_ptr<mapped_file>> targets;
+    std::vector<const mapped_file*> views;
+    std::uint64_t total = 0;
+    for (auto* info : batch) {
+        targets.push_back(std::make_unique<mapped_file>(info->proper_path));
+        views.push_back(targets.back().get());
+        total += targets.back()->size();
+    }
+
+    if (!globals.single_read_pipeline) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            process_target_legacy(*batch[i], *views[i]);
+            batch[i]->signature_checked = true;
+        }
+        return;
+    }
+
+    const bool lanes = globals.batch_sha256 && strcmp(yr_digest_implementation(), "avx2") == 0;
+    std::vector<std::unique_ptr<target_pass>> passes;
+    std::vector<std::vector<file_consumer*>> consumers;
+    for (size_t i = 0; i < batch.size(); i++) {
+        passes.push_back(std::make_unique<target_pass>(YR_DIGEST_MD5 | YR_DIGEST_SHA1 | (lanes ? 0 : YR_DIGEST_SHA256)));
+        auto& pass = *passes.back();
+
+        // whether the binary is signed is only known after the pass, so the tlsh
+        // digest is taken for every binary and only looked up for unsigned ones
+        consumers.push_back({ &pass.content, &pass.authenticode });
+        if (globals.similarity_index)
+            consumers.back().push_back(&pass.tlsh);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<std::string> sha256;
+    const auto bytes = run_batch_pipeline(views, consumers, lanes ? &sha256 : nullptr);
+    const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        auto& info = *batch[i];
+        if (!views[i]->valid()) {
+            process_target_legacy(info, *views[i]);
+            info.signature_checked = true;
+            continue;
+        }
+
+        const auto scan_started = std::chrono::steady_clock::now();
+        const auto& pass = *passes[i];
+        info.bytes_read += bytes[i];
+        info.tlsh = pass.tlsh.digest();
+        info.md5 = pass.content.hex(YR_DIGEST_MD5);
+        info.sha1 = pass.content.hex(YR_DIGEST_SHA1);
+        info.sha256 = lanes ? sha256[i] : pass.content.hex(YR_DIGEST_SHA256);
+        scan_target_binary(info, *views[i], pass.authenticode.digest(YR_DIGEST_SHA1));
+        info.signature_checked = true;
+
+        info.process_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scan_started).count();
+        if (total)
+            info.process_ms += elapsed * views[i]->size() / total;
+    }
+}
+
+static std::vector<std::uint8_t> fingerprint_bytes;
+static fingerprint_index_view fingerprint_view;
+static std::string fingerprint_error;
+
+static std::wstring fingerprint_index_path() {
+    return (std::filesystem::path(getOwnPath()).parent_path() / "fingerprints.idx").wstring();
+}
+
+// every host that runs the tool from the same folder shares fingerprints.idx.
+// under the lock, this host's previous records are replaced by the current
+// sweep and the other hosts' records are carried over as they are. the bytes
+// written are kept in memory for the lookups in the binary info tab, so no
+// instance holds the file open and blocks the next host's replace
+static void update_fingerprint_index() {
+    fingerprint_view = {};
+    fingerprint_bytes.clear();
+    fingerprint_error.clear();
+
+    const auto path = fingerprint_index_path();
+
+    wchar_t computer_name[MAX_COMPUTERNAME_LENGTH + 1]{};
+    DWORD computer_name_size = MAX_COMPUTERNAME_LENGTH + 1;
+    const std::string host = GetComputerNameW(computer_name, &computer_name_size) ? WStringToString(computer_name) : "unknown";
+
+    // without the lock the other hosts' records are unknown, this sweep's are
+    // still shown but not written
+    const fingerprint_index_lock lock(path);
+    if (!lock.locked())
+        fingerprint_error = "fingerprints.idx is locked by another host, other hosts' records not shown";
+
+    fingerprint_index_builder builder;
+    if (lock.locked()) {
+        mapped_file previous(path);
+        fingerprint_index_view view;
+        if (previous.valid() && view.open(previous.data(), static_cast<size_t>(previous.size())))
+            builder.merge(view, host);
+    }
+
+    std::array<std::uint8_t, 16> digest;
+    for (const auto& info : file_infos) {
+        const std::string binary_path = WStringToString(info.proper_path);
+        if (parse_fingerprint(info.fingerprints.imphash, digest))
+            builder.add(fingerprint_kind::imphash, digest, host, info.filename, binary_path);
+        if (parse_fingerprint(info.fingerprints.rich_hash, digest))
+            builder.add(fingerprint_kind::rich, digest, host, info.filename, binary_path);
+    }
+    fingerprint_bytes = builder.serialize();
+    fingerprint_view.open(fingerprint_bytes.data(), fingerprint_bytes.size());
+
+    std::error_code ec;
+    if (lock.locked() && !write_fingerprint_index(path, fingerprint_bytes, ec))
+        fingerprint_error = "fingerprints.idx not updated: " + ec.message();
+}
+
+// other prefetch entries, on any host, whose binary shares the fingerprint
+static void render_fingerprint_matches(const char* label, fingerprint_kind kind, const std::string& hex, const PrefetchFileInfo& info) {
+    std::array<std::uint8_t, 16> digest;
+    if (!parse_fingerprint(hex, digest))
+        return;
+
+    CopyableText((std::string(label) + ": " + hex).c_str());
+
+    const std::string binary_path = WStringToString(info.proper_path);
+    int shown = 0;
+    for (const auto& hit : fingerprint_view.lookup(kind, digest)) {
+        if (hit.entry == info.filename && hit.path == binary_path)
+            continue;
+        if (shown++ == 10) {
+            ImGui::Text("    ...");
+            break;
+        }
+        ImGui::Text("    %.*s: %.*s (%.*s)", static_cast<int>(hit.host.size()), hit.host.data(),
+            static_cast<int>(hit.entry.size()), hit.entry.data(), static_cast<int>(hit.path.size()), hit.path.data());
+    }
+}
 
+void ui::initialize_prefetch_data() {
+    cert_store.refresh();
+    file_probe.clear();
+    if (globals.rule_profiling)
+        resetRuleProfile();
+    resetRuleTierStats();
+    file_infos = GetPrefetchFileInfos(prefetch_stats);
+
+    std::vector<std::wstring> candidates;
     for (auto& info : file_infos) {
         std::wstring prefetchFileName = StringToWString(info.filename);
         size_t hyphenPos = prefetchFileName.find(L'-');
@@ -173,42 +435,77 @@ void ui::initialize_prefetch_data() {
             if (properPath.find(fileNameFromPrefetch) != std::wstring::npos &&
                 properPath.find(L'.') != std::wstring::npos) {
                 info.proper_path = properPath;
-                if (GetFileAttributesW(properPath.c_str()) == INVALID_FILE_ATTRIBUTES) {
-                    info.is_signed = false;
-                    info.is_present = false;
-                    info.matched_rules.push_back("none");
-                }
-                else {
-                    info.is_signed = IsFileSignatureValid(properPath);
-                    
-                    if (!info.is_signed)
-                    {
-                        if (ToUpperCase(info.proper_path) == ToUpperCase(StringToWString(getOwnPath()))) {
-                            
-                        }
-                        else {
-                            std::vector<std::string> matched_rules;
-                            bool yara_match = scan_with_yara(WStringToString(info.proper_path), matched_rules);
-                            if (yara_match && !matched_rules.empty()) {
-                                for (const auto& rule : matched_rules) {
-                                    info.matched_rules.push_back(rule);
-                                }
-                            }
-                            else {
-                                info.matched_rules.push_back("none");
-                            }
-                        }
-                    }
-                    else
-                    {
-                        info.matched_rules.push_back("none");
-                    }
-                }
+                candidates.push_back(properPath);
                 break;
             }
         }
+    }
+
+    // one directory enumeration per parent folder instead of a stat per binary
+    file_probe.prefetch(candidates);
+
+    std::vector<PrefetchFileInfo*> batch;
+    for (auto& info : file_infos) {
+        if (!info.proper_path.empty()) {
+            if (!file_probe.exists(info.proper_path)) {
+                info.is_signed = false;
+                info.is_present = false;
+                info.matched_rules.push_back("none");
+            }
+            else {
+                batch.push_back(&info);
+                if (batch.size() == file_pipeline_batch_size) {
+                    process_target_batch(batch);
+                    batch.clear();
+                }
+                continue;
+            }
+        }
         info.signature_checked = true;
     }
+    if (!batch.empty())
+        process_target_batch(batch);
+
+    if (globals.rule_profiling) {
+        rule_profile = buildRuleProfileReport();
+        writeRuleProfileReport(rule_profile, getRuleProfilePath());
+    }
+
+    if (globals.pe_fingerprints)
+        update_fingerprint_index();
+}
+
+static void render_rule_profile(const RuleProfileReport& report) {
+    ImGui::Text("%zu scans, %.2f ms in rules", report.scans, report.total_cost_ns / 1e6);
+    if (report.total_cost_ns == 0)
+        ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "no costs recorded, libyara needs YR_PROFILING_ENABLED");
+
+    const auto table = [](const char* id, const char* what, const std::vector<RuleProfileEntry>& entries) {
+        if (ImGui::BeginTable(id, 4, ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY, ImVec2(ImGui::GetContentRegionAvail().x * 0.5f - 4, 0))) {
+            ImGui::TableSetupColumn("Cost (ms)", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Per scan (us)", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Atom hits", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn(what);
+            ImGui::TableHeadersRow();
+
+            for (const auto& entry : entries) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.cost_ns / 1e6);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.scans ? entry.cost_ns / 1e3 / entry.scans : 0.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", entry.atom_matches);
+                ImGui::TableNextColumn();
+                CopyableText(entry.name.c_str());
+            }
+            ImGui::EndTable();
+        }
+    };
+
+    table("RuleProfileRules", "Rule", report.rules);
+    ImGui::SameLine();
+    table("RuleProfileStrings", "String", report.strings);
 }
 
 void ui::render() {
@@ -288,6 +585,44 @@ void ui::render() {
         ImGui::Checkbox("Show Flagged Files Only", &show_flagged_only);
         ImGui::SameLine();
         ImGui::Checkbox("Only in Instance", &show_in_instance_only);
+        ImGui::SameLine();
+        {
+            unsigned long long total_bytes = 0;
+            double total_ms = 0.0;
+            for (const auto& info : file_infos) {
+                total_bytes += info.bytes_read;
+                total_ms += info.process_ms;
+            }
+            ImGui::Text("| rules %.0f ms (%s), %zu pf in %.0f ms, %.1f MB read, %.0f ms, %zu paths from %zu dirs probed (%zu stats) in %.0f ms",
+                ruleLoadStats.load_ms, ruleLoadStats.from_bundle ? "bundle" : "source", prefetch_stats.files, prefetch_stats.elapsed_ms,
+                total_bytes / (1024.0 * 1024.0), total_ms, file_probe.paths_looked_up(), file_probe.directories_enumerated(),
+                file_probe.stats_made(), file_probe.probe_ms());
+        }
+        {
+            const auto tiers = getRuleTierStats();
+            if (tiers.size() > 1) {
+                std::string text = "|";
+                for (const auto& tier : tiers) {
+                    char line[128];
+                    snprintf(line, sizeof(line), " tier %d: %zu files %.0f ms, %zu on", tier.tier, tier.files, tier.scan_ms, tier.advanced);
+                    text += line;
+                    if (tier.over_budget) {
+                        snprintf(line, sizeof(line), ", %zu over budget", tier.over_budget);
+                        text += line;
+                    }
+                    text += ";";
+                }
+                text.pop_back();
+                ImGui::SameLine();
+                ImGui::Text("%s", text.c_str());
+            }
+            if (!ruleLoadStats.moved_by_cost.empty()) {
+                std::string moved;
+                for (const auto& name : ruleLoadStats.moved_by_cost)
+                    moved += (moved.empty() ? "" : ", ") + name;
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Moved to tier 2 by rule profile cost (only gated files are scanned): %s", moved.c_str());
+            }
+        }
         ImGui::Separator();
 
         if (ImGui::BeginTable("PrefetchTable", 5, ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_Reorderable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit, ImVec2(0, table_height))) {
@@ -343,7 +678,7 @@ void ui::render() {
                             break;
                         }
                     }
-                    if (!has_non_none_rule) {
+                    if (!has_non_none_rule && info.similar_to.empty()) {
                         should_display = false;
                     }
                 }
@@ -402,6 +737,13 @@ void ui::render() {
                         CopyableText(rule.c_str());
                     }
                 }
+                if (!info.similar_to.empty())
+                {
+                    ImGui::SameLine();
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.6f, 0.0f, 1.0f));
+                    CopyableText(("Similar [" + info.similar_to + "]").c_str());
+                    ImGui::PopStyleColor();
+                }
             }
             ImGui::EndTable();
         }
@@ -442,27 +784,54 @@ void ui::render() {
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("PF File Info")) {
-                    std::string fullPath = "C:\\Windows\\Prefetch\\" + selected_info.filename;
+                    std::wstring fullPath = L"C:\\Windows\\Prefetch\\" + StringToWString(selected_info.filename);
 
-                    WIN32_FILE_ATTRIBUTE_DATA fileInfo;
-                    if (GetFileAttributesExA(fullPath.c_str(), GetFileExInfoStandard, &fileInfo)) {
+                    if (const auto fileInfo = file_probe.lookup(fullPath)) {
                         ImGui::Text("PF name: %s", selected_info.filename.c_str());
 
-                        LARGE_INTEGER fileSize;
-                        fileSize.HighPart = fileInfo.nFileSizeHigh;
-                        fileSize.LowPart = fileInfo.nFileSizeLow;
-                        ImGui::Text("File size: %.2f bytes", fileSize.QuadPart / 1024.0f);
-
-                        ImGui::Text("Creation time: %s", GetFileTimeString(fileInfo.ftCreationTime).c_str());
-                        ImGui::Text("Last access time: %s", GetFileTimeString(fileInfo.ftLastAccessTime).c_str());
-                        ImGui::Text("Last modified time: %s", GetFileTimeString(fileInfo.ftLastWriteTime).c_str());
+                        ImGui::Text("File size: %.2f bytes", fileInfo->size / 1024.0f);
+
+                        const auto to_filetime = [](unsigned long long ticks) {
+                            FILETIME time;
+                            time.dwLowDateTime = static_cast<DWORD>(ticks);
+                            time.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+                            return time;
+                        };
+                        ImGui::Text("Creation time: %s", GetFileTimeString(to_filetime(fileInfo->creation_time)).c_str());
+                        ImGui::Text("Last access time: %s", GetFileTimeString(to_filetime(fileInfo->access_time)).c_str());
+                        ImGui::Text("Last modified time: %s", GetFileTimeString(to_filetime(fileInfo->write_time)).c_str());
                         
                     }
                     ImGui::EndTabItem();
                 }
+                if (ImGui::BeginTabItem("Binary Info")) {
+                    if (selected_info.bytes_read != 0) {
+                        CopyableText(("MD5: " + selected_info.md5).c_str());
+                        CopyableText(("SHA-1: " + selected_info.sha1).c_str());
+                        CopyableText(("SHA-256: " + selected_info.sha256).c_str());
+                        if (!selected_info.tlsh.empty())
+                            CopyableText(("TLSH: " + selected_info.tlsh).c_str());
+                        if (!selected_info.similar_to.empty())
+                            CopyableText(("Similar to: " + selected_info.similar_to + " (distance " + std::to_string(selected_info.similar_distance) + ")").c_str());
+                        if (!fingerprint_error.empty())
+                            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%s", fingerprint_error.c_str());
+                        render_fingerprint_matches("Imphash", fingerprint_kind::imphash, selected_info.fingerprints.imphash, selected_info);
+                        render_fingerprint_matches("Rich hash", fingerprint_kind::rich, selected_info.fingerprints.rich_hash, selected_info);
+                        ImGui::Text("Bytes read: %llu", selected_info.bytes_read);
+                        ImGui::Text("Processing time: %.2f ms (%s)", selected_info.process_ms, globals.single_read_pipeline ? "single read" : "per-api reads");
+                    }
+                    ImGui::EndTabItem();
+                }
+                if (globals.rule_profiling && ImGui::BeginTabItem("Rule Profile")) {
+                    render_rule_profile(rule_profile);
+                    ImGui::EndTabItem();
+                }
             }
                 ImGui::EndTabBar();
             
+        }
+        else if (globals.rule_profiling) {
+            render_rule_profile(rule_profile);
         }
 
             ImGui::EndChild();
@@ -499,6 +868,11 @@ void ui::toggle_maximize() {
 void ui::init(LPDIRECT3DDEVICE9 device) {
     dev = device;
     initializeGenericRules();
+    loadGenericRules();
+    if (globals.lint_rules)
+        writeRuleLintReport(lintGenericRules(), getRuleLintPath());
+    InitializeSignerBlocklist();
+    InitializeTlshLibrary();
     initialize_prefetch_data();
     ImGui::StyleColorsDark();
     if (window_pos.x == 0) {
@@ -19,6 +19,8 @@ namespace ui {
         ImGuiWindowFlags_NoScrollbar;
     inline bool is_maximized = false;
     inline std::vector<PrefetchFileInfo> file_infos;
+    inline prefetch_read_stats prefetch_stats;
+    inline RuleProfileReport rule_profile;
 
     inline ImFont* smallFont;
 
@@ -1,5 +1,8 @@
 #include "include.h"
 #include <mscat.h>
+#include "cert_store.hh"
+#include "signer_blocklist.hh"
+#include "similarity_index.hh"
 
 std::string ConvertExecutedTime(long long executed_time) {
     std::time_t time = static_cast<std::time_t>(executed_time);
@@ -144,37 +147,45 @@ std::string GetFileTimeString(const FILETIME& fileTime) {
 }
 
 
-static bool VerifyFileViaCatalog(LPCWSTR filePath)
+static bool VerifyFileViaCatalog(LPCWSTR filePath, const std::vector<BYTE>* precomputedHash)
 {
     HANDLE hCatAdmin = NULL;
     if (!CryptCATAdminAcquireContext(&hCatAdmin, NULL, 0))
         return false;
 
-    HANDLE hFile = CreateFileW(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
-    if (hFile == INVALID_HANDLE_VALUE)
-    {
-        CryptCATAdminReleaseContext(hCatAdmin, 0);
-        return false;
+    std::vector<BYTE> hash;
+    if (precomputedHash && !precomputedHash->empty()) {
+        hash = *precomputedHash;
     }
+    else {
+        HANDLE hFile = CreateFileW(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            CryptCATAdminReleaseContext(hCatAdmin, 0);
+            return false;
+        }
 
-    DWORD dwHashSize = 0;
-    if (!CryptCATAdminCalcHashFromFileHandle(hFile, &dwHashSize, NULL, 0))
-    {
-        CloseHandle(hFile);
-        CryptCATAdminReleaseContext(hCatAdmin, 0);
-        return false;
-    }
+        DWORD hashSize = 0;
+        if (!CryptCATAdminCalcHashFromFileHandle(hFile, &hashSize, NULL, 0))
+        {
+            CloseHandle(hFile);
+            CryptCATAdminReleaseContext(hCatAdmin, 0);
+            return false;
+        }
+
+        hash.resize(hashSize);
+        if (!CryptCATAdminCalcHashFromFileHandle(hFile, &hashSize, hash.data(), 0))
+        {
+            CloseHandle(hFile);
+            CryptCATAdminReleaseContext(hCatAdmin, 0);
+            return false;
+        }
 
-    BYTE* pbHash = new BYTE[dwHashSize];
-    if (!CryptCATAdminCalcHashFromFileHandle(hFile, &dwHashSize, pbHash, 0))
-    {
-        delete[] pbHash;
         CloseHandle(hFile);
-        CryptCATAdminReleaseContext(hCatAdmin, 0);
-        return false;
     }
 
-    CloseHandle(hFile);
+    BYTE* pbHash = hash.data();
+    DWORD dwHashSize = static_cast<DWORD>(hash.size());
 
     CATALOG_INFO catInfo = { 0 };
     catInfo.cbStruct = sizeof(catInfo);
@@ -218,14 +229,30 @@ static bool VerifyFileViaCatalog(LPCWSTR filePath)
         CryptCATAdminReleaseCatalogContext(hCatAdmin, hCatInfo, 0);
 
     CryptCATAdminReleaseContext(hCatAdmin, 0);
-    delete[] pbHash;
 
     return isCatalogSigned;
 }
 
 
 
-bool IsFileSignatureValid(const std::wstring& filePath) {
+void InitializeSignerBlocklist() {
+    signer_blocklist_entries defaults;
+    defaults.subjects = {
+        "manthe industries, llc",
+        "slinkware",
+        "amstion limited",
+        "newfakeco",
+        "faked signatures inc"
+    };
+
+    signer_blocks.configure(std::filesystem::path(getOwnPath()).parent_path() / "signer_blocklist.txt", defaults);
+}
+
+void InitializeTlshLibrary() {
+    tlsh_families.configure(std::filesystem::path(getOwnPath()).parent_path() / "tlsh_families.txt");
+}
+
+static bool CheckFileSignature(const std::wstring& filePath, const std::vector<BYTE>* catalogHash) {
     WINTRUST_FILE_INFO fileInfo;
     ZeroMemory(&fileInfo, sizeof(fileInfo));
     fileInfo.cbStruct = sizeof(WINTRUST_FILE_INFO);
@@ -252,73 +279,34 @@ bool IsFileSignatureValid(const std::wstring& filePath) {
             if (pProvSigner) {
                 CRYPT_PROVIDER_CERT* pProvCert = WTHelperGetProvCertFromChain(pProvSigner, 0);
                 if (pProvCert && pProvCert->pCert) {
+                    PCCERT_CONTEXT pCert = pProvCert->pCert;
+                    const auto blocklist = signer_blocks.matcher();
+
                     char subjectName[256] = {};
                     CertNameToStrA(
-                        pProvCert->pCert->dwCertEncodingType,
-                        &pProvCert->pCert->pCertInfo->Subject,
+                        pCert->dwCertEncodingType,
+                        &pCert->pCertInfo->Subject,
                         CERT_X500_NAME_STR,
                         subjectName,
                         sizeof(subjectName)
                     );
-                    std::string subject(subjectName);
-                    std::transform(subject.begin(), subject.end(), subject.begin(), ::tolower);
-                    static const char* cheats[] = {
-                        "manthe industries, llc",
-                        "slinkware",
-                        "amstion limited",
-                        "newfakeco",
-                        "faked signatures inc"
-                    };
-                    for (auto& c : cheats) {
-                        if (subject.find(c) != std::string::npos) {
-                            isValid = false;
-                            break;
-                        }
+                    if (blocklist->subject_matches(subjectName)) {
+                        isValid = false;
                     }
 
-                    PCCERT_CONTEXT pCert = pProvCert->pCert;
-                    DWORD hashSize = 0;
-                    if (CertGetCertificateContextProperty(pCert, CERT_SHA1_HASH_PROP_ID, nullptr, &hashSize)) {
-                        std::vector<BYTE> hash(hashSize);
-                        if (CertGetCertificateContextProperty(pCert, CERT_SHA1_HASH_PROP_ID, hash.data(), &hashSize)) {
-                            CRYPT_HASH_BLOB hashBlob{ hashSize, hash.data() };
-                            static const LPCWSTR storeNames[] = {
-                                L"MY", L"Root", L"Trust", L"CA", L"UserDS",
-                                L"TrustedPublisher", L"Disallowed", L"AuthRoot",
-                                L"TrustedPeople", L"ClientAuthIssuer",
-                                L"CertificateEnrollment", L"SmartCardRoot"
-                            };
-                            const DWORD contexts[] = {
-                                CERT_SYSTEM_STORE_CURRENT_USER | CERT_STORE_OPEN_EXISTING_FLAG,
-                                CERT_SYSTEM_STORE_LOCAL_MACHINE | CERT_STORE_OPEN_EXISTING_FLAG
-                            };
-                            for (auto ctx : contexts) {
-                                for (auto& name : storeNames) {
-                                    HCERTSTORE hStore = CertOpenStore(
-                                        CERT_STORE_PROV_SYSTEM_W,
-                                        X509_ASN_ENCODING | PKCS_7_ASN_ENCODING,
-                                        NULL,
-                                        ctx,
-                                        name
-                                    );
-                                    if (!hStore) continue;
-                                    PCCERT_CONTEXT found = CertFindCertificateInStore(
-                                        hStore,
-                                        pCert->dwCertEncodingType,
-                                        0,
-                                        CERT_FIND_SHA1_HASH,
-                                        &hashBlob,
-                                        NULL
-                                    );
-                                    if (found) {
-                                        isValid = false;
-                                        CertFreeCertificateContext(found);
-                                    }
-                                    CertCloseStore(hStore, 0);
-                                    if (!isValid) break;
-                                }
-                                if (!isValid) break;
-                            }
+                    const CRYPT_INTEGER_BLOB& serialBlob = pCert->pCertInfo->SerialNumber;
+                    std::vector<BYTE> serial(serialBlob.pbData, serialBlob.pbData + serialBlob.cbData);
+                    std::reverse(serial.begin(), serial.end());
+                    if (blocklist->serial_blocked(thumbprint_to_hex(serial.data(), serial.size()))) {
+                        isValid = false;
+                    }
+
+                    BYTE hash[20];
+                    DWORD hashSize = sizeof(hash);
+                    if (CertGetCertificateContextProperty(pCert, CERT_SHA1_HASH_PROP_ID, hash, &hashSize)) {
+                        std::string thumbprint = thumbprint_to_hex(hash, hashSize);
+                        if (blocklist->thumbprint_blocked(thumbprint) || cert_store.contains(thumbprint)) {
+                            isValid = false;
                         }
                     }
                 }
@@ -326,7 +314,7 @@ bool IsFileSignatureValid(const std::wstring& filePath) {
         }
     } else {
         isValid = false;
-        if (VerifyFileViaCatalog(filePath.c_str())) {
+        if (VerifyFileViaCatalog(filePath.c_str(), catalogHash)) {
             isValid = true;
         }
     }
@@ -337,6 +325,14 @@ bool IsFileSignatureValid(const std::wstring& filePath) {
     return isValid;
 }
 
+bool IsFileSignatureValid(const std::wstring& filePath) {
+    return CheckFileSignature(filePath, nullptr);
+}
+
+bool IsFileSignatureValid(const std::wstring& filePath, const std::vector<BYTE>& catalogHash) {
+    return CheckFileSignature(filePath, &catalogHash);
+}
+
 
 
 
@@ -1,7 +1,29 @@
 #include "include.h"
+#include "rule_optimizer.hh"
+#include "rule_tiers.hh"
 
 std::vector<GenericRule> genericRules;
 
+// passes .NET assemblies, binaries that import next to nothing and binaries
+// with writable code (the usual shape of packed clients and loaders) on to the
+// rules tagged tier2 and up. reading the imports and the sections makes the pe
+// module parse them for every binary, so the gate is only added to tier 1 when
+// some source actually sits in a later tier
+static const char* tierGateName = "Tier gate";
+static const char* tierGateRule = R"(
+import "pe"
+rule tier_gate : candidate
+{
+    condition:
+        pe.is_pe and (
+            pe.data_directories[pe.IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].virtual_address != 0 or
+            pe.number_of_imported_functions < 32 or
+            for any section in pe.sections : (
+                section.characteristics & pe.SECTION_MEM_WRITE != 0 and
+                section.characteristics & pe.SECTION_MEM_EXECUTE != 0))
+}
+)";
+
 void addGenericRule(const std::string& name, const std::string& rule) {
     genericRules.push_back({ name, rule });
 }
@@ -66,13 +88,21 @@ rule sA
 }
 )");
     // MAS
+
 }
 
 int yara_callback(YR_SCAN_CONTEXT* context, int message, void* message_data, void* user_data) {
+    ScanOutput* output = (ScanOutput*)user_data;
     if (message == CALLBACK_MSG_RULE_MATCHING) {
         YR_RULE* rule = (YR_RULE*)message_data;
-        std::vector<std::string>* matched_rules = (std::vector<std::string>*)user_data;
-        matched_rules->push_back(rule->identifier);
+        const char* tag;
+        yr_rule_tags_foreach(rule, tag) {
+            if (strcmp(tag, rule_candidate_tag) == 0) {
+                output->candidate = true;
+                return CALLBACK_CONTINUE;
+            }
+        }
+        output->matched_rules->push_back(rule->identifier);
     }
     return CALLBACK_CONTINUE;
 }
@@ -81,41 +111,768 @@ void compiler_error_callback(int error_level, const char* file_name, int line_nu
     fprintf(stderr, "Error: %s at line %d: %s\n", file_name ? file_name : "N/A", line_number, message);
 }
 
-bool scan_with_yara(const std::string& path, std::vector<std::string>& matched_rules) {
-    YR_COMPILER* compiler = NULL;
+struct RuleBundleHeader {
+    char magic[8];
+    uint32_t yara_version;
+    uint32_t reserved;
+    uint64_t source_hash;
+};
+
+static const char ruleBundleMagic[8] = { 'P', 'F', 'R', 'U', 'L', 'E', 'S', '2' };
+
+// one compiled set per tier, in tier order; tier 1 is always there
+struct RuleTier {
+    int number = 1;
     YR_RULES* rules = NULL;
-    int result = yr_initialize();
-    if (result != ERROR_SUCCESS) return false;
+    bool has_candidates = false;
+};
 
-    result = yr_compiler_create(&compiler);
-    if (result != ERROR_SUCCESS) {
-        yr_finalize();
-        return false;
+static std::vector<RuleTier> ruleTiers;
+RuleLoadStats ruleLoadStats;
+
+static std::mutex ruleTierStatsMutex;
+static std::vector<RuleTierStats> ruleTierStats;
+
+// fnv-1a over every rule name and source of a tier, a bundle is only reused
+// for the exact same set
+static uint64_t hashGenericRules(int tier) {
+    uint64_t hash = 1469598103934665603ULL;
+    const auto mix = [&](const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xFF;
+        hash *= 1099511628211ULL;
+    };
+    for (const auto& rule : genericRules) {
+        if (rule.tier != tier)
+            continue;
+        mix(rule.name);
+        mix(rule.rule);
     }
+    mix(globals.optimize_rules ? "optimized" : "verbatim");
+    return hash;
+}
+
+static size_t rule_stream_read(void* ptr, size_t size, size_t count, void* user_data) {
+    return fread(ptr, size, count, (FILE*)user_data);
+}
+
+static size_t rule_stream_write(const void* ptr, size_t size, size_t count, void* user_data) {
+    return fwrite(ptr, size, count, (FILE*)user_data);
+}
+
+std::string getRuleBundlePath() {
+    return (std::filesystem::path(getOwnPath()).parent_path() / "generic_rules.yarc").string();
+}
+
+// generic_rules.yarc holds tier 1, generic_rules.tier2.yarc tier 2 and so on
+static std::string getTierBundlePath(const std::string& path, int tier) {
+    if (tier == 1)
+        return path;
+    return std::filesystem::path(path).replace_extension(".tier" + std::to_string(tier) + ".yarc").string();
+}
+
+// the header is checked with a plain read, the rules themselves are mapped in
+// place so every running instance shares the automaton pages
+static bool loadRuleBundle(const std::string& path, uint64_t sourceHash, YR_RULES** rules) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path.c_str(), "rb") != 0 || !file)
+        return false;
+
+    RuleBundleHeader header{};
+    bool loaded = fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, ruleBundleMagic, sizeof(ruleBundleMagic)) == 0 &&
+        header.yara_version == YR_VERSION_HEX &&
+        header.source_hash == sourceHash;
+
+    fclose(file);
+
+    return loaded && yr_rules_load_mapped(path.c_str(), sizeof(header), rules) == ERROR_SUCCESS;
+}
+
+static bool saveTierBundle(const std::string& path, const RuleTier& tier) {
+    const std::string temporaryPath = path + ".tmp";
+    FILE* file = NULL;
+    if (fopen_s(&file, temporaryPath.c_str(), "wb") != 0 || !file)
+        return false;
+
+    RuleBundleHeader header{};
+    memcpy(header.magic, ruleBundleMagic, sizeof(ruleBundleMagic));
+    header.yara_version = YR_VERSION_HEX;
+    header.source_hash = hashGenericRules(tier.number);
+
+    YR_STREAM stream = { file, rule_stream_read, rule_stream_write };
+    bool saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        yr_rules_save_mappable_stream(tier.rules, &stream) == ERROR_SUCCESS;
+
+    fclose(file);
+
+    std::error_code ec;
+    if (saved)
+        std::filesystem::rename(temporaryPath, path, ec);
+    if (!saved || ec)
+        std::filesystem::remove(temporaryPath, ec);
+
+    return saved;
+}
+
+bool saveRuleBundle(const std::string& path) {
+    bool saved = !ruleTiers.empty();
+    for (const auto& tier : ruleTiers)
+        saved &= saveTierBundle(getTierBundlePath(path, tier.number), tier);
+    return saved;
+}
+
+static std::string genericRuleSource(const GenericRule& rule, bool optimize, std::vector<rule_rewrite>* rewrites = nullptr) {
+    return optimize ? optimize_rule_source(rule.rule, rewrites) : rule.rule;
+}
+
+// tier 0 compiles every generic rule into one set
+static bool compileGenericRules(YR_RULES** rules, bool optimize = globals.optimize_rules,
+    YR_COMPILER_ATOM_QUALITY_CALLBACK_FUNC qualityCallback = NULL, void* qualityUserData = NULL, int tier = 0) {
+    YR_COMPILER* compiler = NULL;
+    if (yr_compiler_create(&compiler) != ERROR_SUCCESS)
+        return false;
 
     yr_compiler_set_callback(compiler, compiler_error_callback, NULL);
+    if (qualityCallback)
+        yr_compiler_set_atom_quality_callback(compiler, qualityCallback, qualityUserData);
 
     for (const auto& rule : genericRules) {
-        result = yr_compiler_add_string(compiler, rule.rule.c_str(), NULL);
-        if (result != 0) {
+        if (tier != 0 && rule.tier != tier)
+            continue;
+        if (yr_compiler_add_string(compiler, genericRuleSource(rule, optimize).c_str(), NULL) != 0) {
             yr_compiler_destroy(compiler);
-            yr_finalize();
             return false;
         }
     }
 
-    result = yr_compiler_get_rules(compiler, &rules);
-    if (result != ERROR_SUCCESS) {
-        yr_compiler_destroy(compiler);
-        yr_finalize();
+    int result = yr_compiler_get_rules(compiler, rules);
+    yr_compiler_destroy(compiler);
+    return result == ERROR_SUCCESS;
+}
+
+static std::vector<size_t> profiledScans;
+
+// places every generic rule in its tier. the costs come from the
+// rule_profile.txt of an earlier profiled sweep, and are only read when
+// placement by cost is turned on; every source they move is reported
+static void assignRuleTiers() {
+    genericRules.erase(std::remove_if(genericRules.begin(), genericRules.end(), [](const GenericRule& rule) {
+        return rule.name == tierGateName;
+    }), genericRules.end());
+    ruleLoadStats.moved_by_cost.clear();
+
+    std::unordered_map<std::string, double> costs;
+    if (globals.tiered_scanning && globals.tier_cost_threshold_us > 0) {
+        std::ifstream profile(getRuleProfilePath());
+        if (profile.good())
+            costs = parse_rule_costs(profile);
+    }
+
+    bool laterTier = false;
+    for (auto& rule : genericRules) {
+        bool byCost = false;
+        rule.tier = globals.tiered_scanning ? assign_rule_tier(rule.rule, costs, globals.tier_cost_threshold_us, &byCost) : 1;
+        if (byCost) {
+            ruleLoadStats.moved_by_cost.push_back(rule.name);
+            fprintf(stderr, "Rules: \"%s\" moved to tier %d, its profiled cost is over %.0f us/scan\n",
+                rule.name.c_str(), rule.tier, globals.tier_cost_threshold_us);
+        }
+        laterTier |= rule.tier >= 2;
+    }
+
+    if (laterTier) {
+        genericRules.push_back({ tierGateName, tierGateRule });
+        genericRules.back().tier = 1;
+    }
+}
+
+// a bundle left by an earlier layout with more tiers would never be read again
+static void removeStaleTierBundles(const std::string& path, const std::vector<int>& numbers) {
+    const std::filesystem::path bundle(path);
+    const std::string prefix = bundle.stem().string() + ".tier";
+    const std::string extension = bundle.extension().string();
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(bundle.parent_path(), ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() + extension.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - extension.size(), extension.size(), extension) != 0)
+            continue;
+
+        const std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+        if (digits.empty() || !std::all_of(digits.begin(), digits.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+            continue;
+        if (std::find(numbers.begin(), numbers.end(), std::atoi(digits.c_str())) == numbers.end()) {
+            std::error_code removeError;
+            std::filesystem::remove(entry.path(), removeError);
+        }
+    }
+}
+
+// the generic set is compiled once per process, one set per tier. a bundle saved
+// by a previous run (or shipped next to the exe) is loaded instead when it was
+// built by the same libyara from the same sources; otherwise the tier's sources
+// are compiled and its bundle is rewritten for the next start
+bool loadGenericRules() {
+    if (!ruleTiers.empty())
+        return true;
+
+    const auto started = std::chrono::steady_clock::now();
+    if (yr_initialize() != ERROR_SUCCESS)
         return false;
+
+    yr_set_configuration_uint32(YR_CONFIG_AC_COMPACT_LAYOUT, globals.compact_ac_layout ? 1 : 0);
+
+    assignRuleTiers();
+    std::vector<int> numbers = { 1 };
+    for (const auto& rule : genericRules)
+        numbers.push_back(rule.tier);
+    std::sort(numbers.begin(), numbers.end());
+    numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+    const std::string bundlePath = getRuleBundlePath();
+    ruleLoadStats.from_bundle = true;
+    for (const int number : numbers) {
+        RuleTier tier;
+        tier.number = number;
+        for (const auto& rule : genericRules) {
+            if (rule.tier != number)
+                continue;
+            for (const auto& declared : declared_rules(rule.rule))
+                tier.has_candidates |= is_candidate_rule(declared);
+        }
+
+        const std::string tierPath = getTierBundlePath(bundlePath, number);
+        if (!loadRuleBundle(tierPath, hashGenericRules(number), &tier.rules)) {
+            ruleLoadStats.from_bundle = false;
+            if (!compileGenericRules(&tier.rules, globals.optimize_rules, NULL, NULL, number)) {
+                for (const auto& loaded : ruleTiers)
+                    yr_rules_destroy(loaded.rules);
+                ruleTiers.clear();
+                yr_finalize();
+                return false;
+            }
+            saveTierBundle(tierPath, tier);
+        }
+        ruleTiers.push_back(tier);
     }
+    removeStaleTierBundles(bundlePath, numbers);
 
-    result = yr_rules_scan_file(rules, path.c_str(), 0, yara_callback, &matched_rules, 0);
+    profiledScans.assign(ruleTiers.size(), 0);
+    resetRuleTierStats();
 
-    yr_rules_destroy(rules);
+    ruleLoadStats.load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+// every worker thread keeps one scanner alive for the whole sweep. libyara
+// resets the scanner's notebook (matches, module objects, iterators) between
+// scans instead of freeing it, so a reused scanner stops hitting the heap, and
+// when profiling the per-rule and per-string counters add up over every
+// scanned binary. a thread has one scanner per tier. the generation lets a
+// thread notice its scanners were destroyed by an unload
+static std::mutex workerScannersMutex;
+static std::vector<std::pair<size_t, YR_SCANNER*>> workerScanners;
+static uint64_t workerGeneration = 0;
+
+struct ScanWorker {
+    std::vector<YR_SCANNER*> scanners;
+    uint64_t generation = 0;
+};
+
+static thread_local ScanWorker scanWorker;
+
+static YR_SCANNER* getWorkerScanner(size_t tier) {
+    std::lock_guard<std::mutex> lock(workerScannersMutex);
+    if (scanWorker.generation != workerGeneration || scanWorker.scanners.size() != ruleTiers.size())
+        scanWorker = { std::vector<YR_SCANNER*>(ruleTiers.size()), workerGeneration };
+    if (scanWorker.scanners[tier])
+        return scanWorker.scanners[tier];
+
+    YR_SCANNER* scanner = NULL;
+    if (yr_scanner_create(ruleTiers[tier].rules, &scanner) != ERROR_SUCCESS)
+        return NULL;
+
+    workerScanners.push_back({ tier, scanner });
+    scanWorker.scanners[tier] = scanner;
+    return scanner;
+}
+
+static void destroyWorkerScanners() {
+    std::lock_guard<std::mutex> lock(workerScannersMutex);
+    for (const auto& [tier, scanner] : workerScanners)
+        yr_scanner_destroy(scanner);
+    workerScanners.clear();
+    profiledScans.clear();
+    workerGeneration++;
+}
+
+void resetRuleProfile() {
+    std::lock_guard<std::mutex> lock(workerScannersMutex);
+    for (const auto& [tier, scanner] : workerScanners)
+        yr_scanner_reset_profiling_info(scanner);
+    std::fill(profiledScans.begin(), profiledScans.end(), 0);
+}
+
+std::vector<RuleTierStats> getRuleTierStats() {
+    std::lock_guard<std::mutex> lock(ruleTierStatsMutex);
+    return ruleTierStats;
+}
+
+void resetRuleTierStats() {
+    std::lock_guard<std::mutex> lock(ruleTierStatsMutex);
+    ruleTierStats.assign(ruleTiers.size(), {});
+    for (size_t i = 0; i < ruleTiers.size(); i++)
+        ruleTierStats[i].tier = ruleTiers[i].number;
+}
+
+// sums the counters of every worker scanner, must not race a running scan
+RuleProfileReport buildRuleProfileReport() {
+    RuleProfileReport report;
+    report.tiers = getRuleTierStats();
+    std::lock_guard<std::mutex> lock(workerScannersMutex);
+    report.scans = profiledScans.empty() ? 0 : profiledScans.front();
+
+    std::unordered_map<const YR_RULE*, RuleProfileEntry> rules;
+    std::unordered_map<const YR_STRING*, RuleProfileEntry> strings;
+
+    for (const auto& [tier, scanner] : workerScanners) {
+        const size_t scans = profiledScans[tier];
+        if (YR_RULE_PROFILING_INFO* info = yr_scanner_get_profiling_info(scanner)) {
+            for (YR_RULE_PROFILING_INFO* entry = info; entry->rule != NULL; entry++) {
+                auto& rule = rules[entry->rule];
+                rule.name = std::string(entry->rule->ns->name) + ":" + entry->rule->identifier;
+                rule.cost_ns += entry->cost;
+                rule.scans = scans;
+            }
+            yr_free(info);
+        }
+
+        if (YR_STRING_PROFILING_INFO* info = yr_scanner_get_string_profiling_info(scanner)) {
+            for (YR_STRING_PROFILING_INFO* entry = info; entry->string != NULL; entry++) {
+                const YR_RULE* owner = &ruleTiers[tier].rules->rules_table[entry->string->rule_idx];
+                auto& string = strings[entry->string];
+                string.name = std::string(owner->identifier) + ":" + entry->string->identifier;
+                string.cost_ns += entry->cost;
+                string.atom_matches += entry->atom_matches;
+                string.scans = scans;
+                rules[owner].atom_matches += entry->atom_matches;
+                rules[owner].scans = scans;
+            }
+            yr_free(info);
+        }
+    }
+
+    const auto by_cost = [](const RuleProfileEntry& a, const RuleProfileEntry& b) {
+        return a.cost_ns > b.cost_ns;
+    };
+    for (auto& [rule, entry] : rules)
+        report.rules.push_back(std::move(entry));
+    for (auto& [string, entry] : strings)
+        report.strings.push_back(std::move(entry));
+    std::sort(report.rules.begin(), report.rules.end(), by_cost);
+    std::sort(report.strings.begin(), report.strings.end(), by_cost);
+
+    for (const auto& entry : report.rules)
+        report.total_cost_ns += entry.cost_ns;
+
+    return report;
+}
+
+std::string getRuleProfilePath() {
+    return (std::filesystem::path(getOwnPath()).parent_path() / "rule_profile.txt").string();
+}
+
+bool writeRuleProfileReport(const RuleProfileReport& report, const std::string& path) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+        return false;
+
+    fprintf(file, "rule profile over %zu scans, %.3f ms total\n", report.scans, report.total_cost_ns / 1e6);
+    if (report.total_cost_ns == 0)
+        fprintf(file, "all costs are zero: libyara was built without YR_PROFILING_ENABLED\n");
+
+    for (const auto& tier : report.tiers) {
+        fprintf(file, "tier %d: %zu files in %.3f ms, %zu passed on, %zu over budget\n",
+            tier.tier, tier.files, tier.scan_ms, tier.advanced, tier.over_budget);
+    }
+
+    // us/scan is what loadGenericRules compares with tier_cost_threshold_us
+    const auto per_scan_us = [](const RuleProfileEntry& entry) {
+        return entry.scans ? entry.cost_ns / 1e3 / entry.scans : 0.0;
+    };
+
+    fprintf(file, "\n%-12s %-12s %-12s %s\n", "cost ms", "us/scan", "atom hits", "rule");
+    for (const auto& entry : report.rules)
+        fprintf(file, "%-12.3f %-12.3f %-12u %s\n", entry.cost_ns / 1e6, per_scan_us(entry), entry.atom_matches, entry.name.c_str());
+
+    fprintf(file, "\n%-12s %-12s %-12s %s\n", "cost ms", "us/scan", "atom hits", "string");
+    for (const auto& entry : report.strings)
+        fprintf(file, "%-12.3f %-12.3f %-12u %s\n", entry.cost_ns / 1e6, per_scan_us(entry), entry.atom_matches, entry.name.c_str());
+
+    fclose(file);
+    return true;
+}
+
+using AtomQualities = std::unordered_map<std::string, std::pair<int, int>>;
+
+static void collect_atom_quality(const YR_RULE* rule, const char* identifier, int quality, int atoms, void* user_data) {
+    (*(AtomQualities*)user_data)[std::string(rule->identifier) + ":" + identifier] = { quality, atoms };
+}
+
+static double measureScanThroughput(YR_RULES* rules, const std::vector<uint8_t>& sample) {
+    constexpr int rounds = 8;
+    std::vector<std::string> matched_rules;
+    ScanOutput output{ &matched_rules };
+
+    const auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        matched_rules.clear();
+        yr_rules_scan_mem(rules, sample.data(), sample.size(), 0, yara_callback, &output, 0);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    return seconds > 0 ? (sample.size() * rounds) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+// counting conditions see every branch of a split alternation as its own string,
+// these rules must be left alone by the optimizer and keep their verdict
+static const struct {
+    const char* name;
+    const char* rule;
+    const char* input;
+} optimizerChecks[] = {
+    { "all of them, one branch present",
+      "rule lint_all {\n strings:\n  $x = /(alpha|beta)/\n condition:\n  all of them\n}", "--alpha--" },
+    { "2 of them, one string present",
+      "rule lint_two {\n strings:\n  $x = /(alpha|beta)/\n  $y = \"gamma\"\n condition:\n  2 of them\n}", "--alpha--beta--" },
+    { "2 of them, both strings present",
+      "rule lint_two {\n strings:\n  $x = /(alpha|beta)/\n  $y = \"gamma\"\n condition:\n  2 of them\n}", "--beta--gamma--" },
+    { "wildcard set, one branch present",
+      "rule lint_wildcard {\n strings:\n  $x = /(alpha|beta)/\n condition:\n  all of ($x*)\n}", "--beta--" },
+};
+
+static bool matchesRuleSource(const std::string& source, const char* input, bool& matched) {
+    YR_COMPILER* compiler = NULL;
+    YR_RULES* rules = NULL;
+    if (yr_compiler_create(&compiler) != ERROR_SUCCESS)
+        return false;
+
+    const bool compiled = yr_compiler_add_string(compiler, source.c_str(), NULL) == 0 &&
+        yr_compiler_get_rules(compiler, &rules) == ERROR_SUCCESS;
     yr_compiler_destroy(compiler);
+    if (!compiled)
+        return false;
+
+    std::vector<std::string> matched_rules;
+    ScanOutput output{ &matched_rules };
+    yr_rules_scan_mem(rules, (const uint8_t*)input, strlen(input), 0, yara_callback, &output, 0);
+    yr_rules_destroy(rules);
+
+    matched = !matched_rules.empty();
+    return true;
+}
+
+static std::vector<RuleLintCheck> checkOptimizerEquivalence() {
+    std::vector<RuleLintCheck> checks;
+    for (const auto& check : optimizerChecks) {
+        const std::string optimized = optimize_rule_source(check.rule);
+        bool before = false, after = false;
+        checks.push_back({ check.name, optimized == check.rule &&
+            matchesRuleSource(check.rule, check.input, before) &&
+            matchesRuleSource(optimized, check.input, after) && before == after });
+    }
+    return checks;
+}
+
+// the lazy regexp dfa must report exactly what the fiber engine does. every case
+// is scanned with and without SCAN_FLAGS_NO_RE_DFA, over its own input and over
+// the lint sample, and each match (string, offset, length) compared. the cases
+// put the atom inside or after loops and alternations, so the verification
+// code starts in the middle of the regexp and runs backwards too
+static const struct {
+    const char* name;
+    const char* rule;
+    const char* input;
+    // 0 for a nul terminated input, wide inputs hold nuls
+    size_t length;
+} regexDfaChecks[] = {
+    { "alternation in a loop",
+      "rule dfa { strings: $x = /(ab|cd)+e/ condition: $x }", "xyz_`abcde QQ cde", 0 },
+    { "alternation loop without a tail",
+      "rule dfa { strings: $x = /(ab|cd)+/ condition: $x }", "xyz_`abcde QQ cde", 0 },
+    { "nocase wide alternation loop",
+      "rule dfa { strings: $x = /(ab|cd)+e/ nocase wide ascii condition: $x }", "a\0B\0c\0D\0E\0 AbCdE", 16 },
+    { "uneven alternation loop",
+      "rule dfa { strings: $x = /(e|aa|c)+b[^a]/ nocase condition: $x }", "xaaecbz eeb ab cb\n", 0 },
+    { "atom after a class loop",
+      "rule dfa { strings: $x = /[a-d_]+(exit|quit)+/ condition: $x }", "__abc_exit dd_exitquit", 0 },
+    { "bounded repeat and alternation",
+      "rule dfa { strings: $x = /(load|free)[A-Z][a-z]{2,8}(A|W)?/ condition: $x }", "loadLibraryA freeLibrary loadXy", 0 },
+    { "lazy repeat",
+      "rule dfa { strings: $x = /ab.{0,6}?cd/ condition: $x }", "ab12cd34cd abcd", 0 },
+};
+
+using MatchList = std::vector<std::tuple<std::string, int64_t, int32_t>>;
+
+static int collectStringMatches(YR_SCAN_CONTEXT* context, int message, void* message_data, void* user_data) {
+    if (message != CALLBACK_MSG_RULE_MATCHING && message != CALLBACK_MSG_RULE_NOT_MATCHING)
+        return CALLBACK_CONTINUE;
+
+    YR_RULE* rule = (YR_RULE*)message_data;
+    YR_STRING* string;
+    YR_MATCH* match;
+    yr_rule_strings_foreach(rule, string) {
+        yr_string_matches_foreach(context, string, match) {
+            ((MatchList*)user_data)->emplace_back(std::string(rule->identifier) + ":" + string->identifier, match->base + match->offset, match->match_length);
+        }
+    }
+    return CALLBACK_CONTINUE;
+}
+
+static bool sameRegexMatches(YR_RULES* rules, const uint8_t* data, size_t size) {
+    MatchList withDfa, withFibers;
+    const int dfaResult = yr_rules_scan_mem(rules, data, size, 0, collectStringMatches, &withDfa, 0);
+    const int fiberResult = yr_rules_scan_mem(rules, data, size, SCAN_FLAGS_NO_RE_DFA, collectStringMatches, &withFibers, 0);
+    std::sort(withDfa.begin(), withDfa.end());
+    std::sort(withFibers.begin(), withFibers.end());
+    return dfaResult == fiberResult && withDfa == withFibers;
+}
+
+static std::vector<RuleLintCheck> checkRegexDfa(YR_RULES* generic, const std::vector<uint8_t>& sample) {
+    std::vector<RuleLintCheck> checks;
+    for (const auto& check : regexDfaChecks) {
+        YR_COMPILER* compiler = NULL;
+        YR_RULES* rules = NULL;
+        bool passed = false;
+        if (yr_compiler_create(&compiler) == ERROR_SUCCESS) {
+            if (yr_compiler_add_string(compiler, check.rule, NULL) == 0 && yr_compiler_get_rules(compiler, &rules) == ERROR_SUCCESS) {
+                const size_t length = check.length ? check.length : strlen(check.input);
+                passed = sameRegexMatches(rules, (const uint8_t*)check.input, length) &&
+                    sameRegexMatches(rules, sample.data(), (std::min)(sample.size(), size_t(2u << 20)));
+                yr_rules_destroy(rules);
+            }
+            yr_compiler_destroy(compiler);
+        }
+        checks.push_back({ check.name, passed });
+    }
+    if (generic)
+        checks.push_back({ "generic rules over the sample", sameRegexMatches(generic, sample.data(), sample.size()) });
+    return checks;
+}
+
+// compiles the generic set as written and as rewritten by the optimizer, reports
+// the atom quality of every string under both and scans the same sample (our
+// own image repeated to 16 mb, which keeps pe.is_pe true) with each set
+RuleLintReport lintGenericRules() {
+    RuleLintReport report;
+
+    std::vector<rule_rewrite> rewrites;
+    for (const auto& rule : genericRules)
+        genericRuleSource(rule, true, &rewrites);
+
+    AtomQualities before, after;
+    YR_RULES* verbatimRules = NULL;
+    YR_RULES* optimizedRules = NULL;
+    if (yr_initialize() != ERROR_SUCCESS)
+        return report;
+
+    report.checks = checkOptimizerEquivalence();
+
+    if (compileGenericRules(&verbatimRules, false, collect_atom_quality, &before) &&
+        compileGenericRules(&optimizedRules, true, collect_atom_quality, &after)) {
+        std::ifstream image(getOwnPath(), std::ios::binary);
+        const std::vector<uint8_t> own((std::istreambuf_iterator<char>(image)), std::istreambuf_iterator<char>());
+        std::vector<uint8_t> sample;
+        while (!own.empty() && sample.size() < (16u << 20))
+            sample.insert(sample.end(), own.begin(), own.end());
+
+        report.sample_bytes = sample.size();
+        report.mb_per_s_before = measureScanThroughput(verbatimRules, sample);
+        report.mb_per_s_after = measureScanThroughput(optimizedRules, sample);
+        report.dfa_checks = checkRegexDfa(optimizedRules, sample);
+    }
+
+    for (const auto& [key, quality] : before) {
+        RuleLintString entry;
+        entry.name = key;
+        entry.quality_before = quality.first;
+        entry.atoms_before = quality.second;
+
+        const auto separator = key.find(':');
+        const std::string rule = key.substr(0, separator);
+        const std::string identifier = key.substr(separator + 1);
+        const auto rewrite = std::find_if(rewrites.begin(), rewrites.end(), [&](const rule_rewrite& r) {
+            return r.rule == rule && r.identifier == identifier;
+        });
+
+        std::vector<std::string> rewrittenKeys = { key };
+        if (rewrite != rewrites.end()) {
+            entry.rewritten = rewrite->after;
+            if (rewrite->after.size() > 1) {
+                rewrittenKeys.clear();
+                for (size_t n = 0; n < rewrite->after.size(); n++)
+                    rewrittenKeys.push_back(key + "_" + std::to_string(n));
+            }
+            report.rewritten++;
+        }
+
+        entry.quality_after = YR_MAX_ATOM_QUALITY;
+        for (const auto& rewrittenKey : rewrittenKeys) {
+            const auto it = after.find(rewrittenKey);
+            if (it == after.end())
+                continue;
+            entry.quality_after = (std::min)(entry.quality_after, it->second.first);
+            entry.atoms_after += it->second.second;
+        }
+
+        report.strings.push_back(std::move(entry));
+    }
+
+    std::sort(report.strings.begin(), report.strings.end(), [](const RuleLintString& a, const RuleLintString& b) {
+        return a.quality_after < b.quality_after;
+    });
+
+    if (verbatimRules)
+        yr_rules_destroy(verbatimRules);
+    if (optimizedRules)
+        yr_rules_destroy(optimizedRules);
+    yr_finalize();
+
+    return report;
+}
+
+std::string getRuleLintPath() {
+    return (std::filesystem::path(getOwnPath()).parent_path() / "rule_lint.txt").string();
+}
+
+bool writeRuleLintReport(const RuleLintReport& report, const std::string& path) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+        return false;
+
+    fprintf(file, "%zu of %zu regex strings rewritten as text\n", report.rewritten, report.strings.size());
+    fprintf(file, "scan throughput over %.1f MB: %.1f MB/s as written, %.1f MB/s optimized\n\n",
+        report.sample_bytes / (1024.0 * 1024.0), report.mb_per_s_before, report.mb_per_s_after);
+
+    for (const auto& check : report.checks)
+        fprintf(file, "optimizer check %-36s %s\n", check.name.c_str(), check.passed ? "ok" : "FAILED");
+    for (const auto& check : report.dfa_checks)
+        fprintf(file, "regex dfa check %-36s %s\n", check.name.c_str(), check.passed ? "ok" : "FAILED");
+    fprintf(file, "\n");
+
+    // atom quality is libyara's 0..255 heuristic, strings under its warning
+    // threshold are the ones that flood the automaton with hits
+    fprintf(file, "%-24s %-16s %-16s %s\n", "string", "quality before", "quality after", "rewrite");
+    for (const auto& entry : report.strings) {
+        fprintf(file, "%-24s %3d (%3d atoms)  %3d (%3d atoms)  %s%s\n", entry.name.c_str(),
+            entry.quality_before, entry.atoms_before, entry.quality_after, entry.atoms_after,
+            entry.rewritten.empty() ? "-" : entry.rewritten.front().c_str(),
+            entry.rewritten.size() > 1 ? " ..." : "");
+    }
+
+    fclose(file);
+    return true;
+}
+
+void unloadGenericRules() {
+    if (ruleTiers.empty())
+        return;
+
+    destroyWorkerScanners();
+    for (const auto& tier : ruleTiers)
+        yr_rules_destroy(tier.rules);
+    ruleTiers.clear();
     yr_finalize();
+}
+
+template <typename... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+template <typename... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+template <typename Scan>
+static void scan_rule_tier(size_t tier, ScanOutput& output, Scan& scan) {
+    YR_SCANNER* scanner = getWorkerScanner(tier);
+    if (!scanner) {
+        scan(ruleTiers[tier].rules);
+        return;
+    }
+
+    // libyara only splits buffers of at least two YR_PARALLEL_SCAN_MIN_RANGE,
+    // smaller files still run on the calling thread alone
+    yr_scanner_set_callback(scanner, yara_callback, &output);
+    yr_scanner_set_threads(scanner, globals.split_large_files ? static_cast<int>(std::thread::hardware_concurrency()) : 0);
+    scan(scanner);
+
+    if (globals.rule_profiling) {
+        std::lock_guard<std::mutex> lock(workerScannersMutex);
+        profiledScans[tier]++;
+    }
+}
+
+// tier 1 runs on every file. each later tier only sees the files the tier
+// before it passed on, and stops taking them once it has spent tier_budget_ms
+// in the current sweep
+template <typename Scan>
+static bool scan_with_generic_rules(ScanOutput& output, Scan scan) {
+    if (!loadGenericRules())
+        return false;
+
+    for (size_t tier = 0; tier < ruleTiers.size(); tier++) {
+        if (tier > 0 && globals.tier_budget_ms > 0) {
+            std::lock_guard<std::mutex> lock(ruleTierStatsMutex);
+            if (ruleTierStats[tier].scan_ms >= globals.tier_budget_ms) {
+                ruleTierStats[tier].over_budget++;
+                break;
+            }
+        }
+
+        output.candidate = false;
+        const auto started = std::chrono::steady_clock::now();
+        scan_rule_tier(tier, output, scan);
+        const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        const bool advance = tier + 1 < ruleTiers.size() && (output.candidate || !ruleTiers[tier].has_candidates);
+        {
+            std::lock_guard<std::mutex> lock(ruleTierStatsMutex);
+            ruleTierStats[tier].files++;
+            ruleTierStats[tier].scan_ms += elapsed;
+            if (advance)
+                ruleTierStats[tier].advanced++;
+        }
+        if (!advance)
+            break;
+    }
+
+    return !output.matched_rules->empty();
+}
+
+bool scan_with_yara(const std::string& path, std::vector<std::string>& matched_rules) {
+    ScanOutput output{ &matched_rules };
+    return scan_with_generic_rules(output, overloaded{
+        [&](YR_RULES* rules) {
+            return yr_rules_scan_file(rules, path.c_str(), 0, yara_callback, &output, 0);
+        },
+        [&](YR_SCANNER* scanner) {
+            return yr_scanner_scan_file(scanner, path.c_str());
+        } });
+}
 
-    return !matched_rules.empty();
+bool scan_memory_with_yara(const uint8_t* data, size_t size, std::vector<std::string>& matched_rules) {
+    ScanOutput output{ &matched_rules };
+    return scan_with_generic_rules(output, overloaded{
+        [&](YR_RULES* rules) {
+            return yr_rules_scan_mem(rules, data, size, 0, yara_callback, &output, 0);
+        },
+        [&](YR_SCANNER* scanner) {
+            return yr_scanner_scan_mem(scanner, data, size);
+        } });
 }